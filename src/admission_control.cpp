@@ -0,0 +1,268 @@
+#include "admission_control.h"
+#include <algorithm>
+
+using namespace admission_control;
+
+// ---------------------------------------------------------------------------
+// TokenBucket
+// ---------------------------------------------------------------------------
+
+TokenBucket::TokenBucket(double ratePerSecond, double burst)
+    : m_rate(ratePerSecond), m_burst(max(1.0, burst)), m_tokens(max(1.0, burst)),
+      m_last(Clock::now())
+{
+}
+
+bool TokenBucket::tryAcquire()
+{
+    if (m_rate <= 0.0) return true;
+    lock_guard<mutex> lock(m_mutex);
+    Clock::time_point now = Clock::now();
+    double elapsed = chrono::duration<double>(now - m_last).count();
+    m_last   = now;
+    m_tokens = min(m_burst, m_tokens + elapsed * m_rate);
+    if (m_tokens < 1.0) return false;
+    m_tokens -= 1.0;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Semaphore
+// ---------------------------------------------------------------------------
+
+Semaphore::Semaphore(size_t permits) : m_permits(permits), m_used(0)
+{
+}
+
+bool Semaphore::acquire(chrono::steady_clock::time_point deadline,
+                        const cancel_token::CancelToken* cancel)
+{
+    unique_lock<mutex> lock(m_mutex);
+    if (m_permits == 0) {           // unlimited
+        ++m_used;
+        return true;
+    }
+    while (m_used >= m_permits) {
+        if (cancel_token::isCancelled(cancel)) return false;
+        auto now = chrono::steady_clock::now();
+        if (now >= deadline) return false;
+        auto slice = now + chrono::milliseconds(ADMISSION_WAIT_SLICE_MS);
+        m_cv.wait_until(lock, min(deadline, slice));
+    }
+    ++m_used;
+    return true;
+}
+
+void Semaphore::release()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_used > 0) --m_used;
+    }
+    m_cv.notify_one();
+}
+
+size_t Semaphore::inUse() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_used;
+}
+
+// ---------------------------------------------------------------------------
+// CircuitBreaker
+// ---------------------------------------------------------------------------
+
+CircuitBreaker::CircuitBreaker(int failureThreshold, int cooldownMs)
+    : m_threshold(failureThreshold), m_cooldownMs(cooldownMs), m_failures(0),
+      m_state(BREAKER_CLOSED), m_probing(false), m_trips(0)
+{
+}
+
+bool CircuitBreaker::allow()
+{
+    if (m_threshold <= 0) return true;
+    lock_guard<mutex> lock(m_mutex);
+    if (m_state == BREAKER_OPEN &&
+        Clock::now() - m_openedAt >= chrono::milliseconds(m_cooldownMs))
+        m_state = BREAKER_HALF_OPEN;
+    if (m_state == BREAKER_CLOSED) return true;
+    if (m_state == BREAKER_HALF_OPEN && !m_probing) {
+        m_probing = true;
+        return true;
+    }
+    return false;
+}
+
+void CircuitBreaker::recordSuccess()
+{
+    if (m_threshold <= 0) return;
+    lock_guard<mutex> lock(m_mutex);
+    m_failures = 0;
+    m_probing  = false;
+    m_state    = BREAKER_CLOSED;
+}
+
+void CircuitBreaker::recordFailure()
+{
+    if (m_threshold <= 0) return;
+    lock_guard<mutex> lock(m_mutex);
+    ++m_failures;
+    bool probeFailed = m_state == BREAKER_HALF_OPEN && m_probing;
+    m_probing = false;
+    if (probeFailed || (m_state == BREAKER_CLOSED && m_failures >= m_threshold)) {
+        m_state    = BREAKER_OPEN;
+        m_openedAt = Clock::now();
+        ++m_trips;
+    }
+}
+
+void CircuitBreaker::recordAbandoned()
+{
+    if (m_threshold <= 0) return;
+    lock_guard<mutex> lock(m_mutex);
+    m_probing = false;
+}
+
+BreakerState CircuitBreaker::state() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_state;
+}
+
+size_t CircuitBreaker::trips() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_trips;
+}
+
+// ---------------------------------------------------------------------------
+// SingleFlight
+// ---------------------------------------------------------------------------
+
+SingleFlight::Flight SingleFlight::join(uint64_t key)
+{
+    Flight flight;
+    flight.key = key;
+    lock_guard<mutex> lock(m_mutex);
+    auto it = m_calls.find(key);
+    if (it != m_calls.end()) {
+        flight.leader = false;
+        flight.result = it->second->result;
+        return flight;
+    }
+    shared_ptr<Call> call = make_shared<Call>();
+    call->result = call->done.get_future().share();
+    m_calls[key] = call;
+    flight.leader = true;
+    return flight;
+}
+
+void SingleFlight::finish(const Flight& flight, const FlightResult& result)
+{
+    shared_ptr<Call> call;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        auto it = m_calls.find(flight.key);
+        if (it == m_calls.end()) return;
+        call = it->second;
+        m_calls.erase(it);
+    }
+    call->done.set_value(result);
+}
+
+size_t SingleFlight::inFlight() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_calls.size();
+}
+
+// ---------------------------------------------------------------------------
+// AdmissionController
+// ---------------------------------------------------------------------------
+
+AdmissionController::AdmissionController(const AdmissionConfig& config)
+    : m_config(config),
+      m_bucket(config.ratePerSecond, config.burst),
+      m_slots(config.maxConcurrent),
+      m_breaker(config.breakerFailures, config.breakerCooldownMs),
+      m_admitted(0), m_coalesced(0), m_rateLimited(0), m_queueTimeouts(0),
+      m_breakerRejected(0), m_failures(0)
+{
+}
+
+string& AdmissionController::lastRejection()
+{
+    static thread_local string reason;
+    return reason;
+}
+
+const string& AdmissionController::rejected()
+{
+    return lastRejection();
+}
+
+bool AdmissionController::admit(const cancel_token::CancelToken* cancel)
+{
+    if (!m_breaker.allow()) {
+        m_breakerRejected++;
+        lastRejection() = "circuit breaker open after repeated failures";
+        return false;
+    }
+    if (!m_bucket.tryAcquire()) {
+        m_breaker.recordAbandoned();
+        m_rateLimited++;
+        lastRejection() = "rate limit reached";
+        return false;
+    }
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(m_config.queueTimeoutMs);
+    if (!m_slots.acquire(deadline, cancel)) {
+        m_breaker.recordAbandoned();
+        if (!cancel_token::isCancelled(cancel)) {
+            m_queueTimeouts++;
+            lastRejection() = "no request slot within the queue timeout";
+        }
+        return false;
+    }
+    m_admitted++;
+    return true;
+}
+
+void AdmissionController::complete(const string& reply, const cancel_token::CancelToken* cancel)
+{
+    m_slots.release();
+    if (!reply.empty()) {
+        m_breaker.recordSuccess();
+    } else if (cancel_token::isCancelled(cancel)) {
+        m_breaker.recordAbandoned();
+    } else {
+        m_failures++;
+        m_breaker.recordFailure();
+    }
+}
+
+bool AdmissionController::await(const SingleFlight::Flight& flight,
+                                const cancel_token::CancelToken* cancel, FlightResult& result)
+{
+    while (flight.result.wait_for(chrono::milliseconds(ADMISSION_WAIT_SLICE_MS)) !=
+           future_status::ready) {
+        if (cancel_token::isCancelled(cancel))
+            return false;
+    }
+    result = flight.result.get();
+    return true;
+}
+
+AdmissionStats AdmissionController::getStats() const
+{
+    AdmissionStats st;
+    st.admitted        = m_admitted.load();
+    st.coalesced       = m_coalesced.load();
+    st.rateLimited     = m_rateLimited.load();
+    st.queueTimeouts   = m_queueTimeouts.load();
+    st.breakerRejected = m_breakerRejected.load();
+    st.breakerTrips    = m_breaker.trips();
+    st.failures        = m_failures.load();
+    st.inFlight        = m_slots.inUse();
+    st.breaker         = m_breaker.state();
+    return st;
+}
@@ -0,0 +1,272 @@
+#ifndef __ADMISSION_CONTROL_H__
+#define __ADMISSION_CONTROL_H__
+
+/**
+ * admission_control.h — Load shedding for the GPT-4o fallback (Phase 6)
+ *
+ * With many concurrent sessions, a burst of inputs the local paths cannot
+ * answer would otherwise all reach the upstream API at once, and every turn
+ * would wait on it.  Each paid request therefore passes four gates:
+ *
+ *   SingleFlight    identical prompts already in flight are not sent again;
+ *                   the newcomer waits for the first request's reply.
+ *   CircuitBreaker  after BREAKER_FAILURES consecutive failures the
+ *                   fallback is refused outright for a cool-down.  Then one
+ *                   probe request is let through (half-open): success
+ *                   closes the breaker, failure opens it again.
+ *   TokenBucket     sustained rate limit with a burst allowance.  An empty
+ *                   bucket refuses at once rather than queueing.
+ *   Semaphore       at most N requests in flight.  Further requests queue
+ *                   for at most the queue timeout and are then refused.
+ *
+ * A refused request returns "" like a failed one, so the NSVD pipeline's
+ * local answer (or its default) stands and tail latency stays bounded by
+ * the queue timeout instead of by the upstream.  Waiting is cancellable,
+ * so a cancelled speculative request leaves the queue at once.
+ */
+
+#include "cancel_token.h"
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+namespace admission_control {
+
+    static const double ADMISSION_RATE_PER_S       = 5.0;
+    static const double ADMISSION_BURST            = 10.0;
+    static const size_t ADMISSION_MAX_CONCURRENT   = 8;
+    static const int    ADMISSION_QUEUE_TIMEOUT_MS = 2000;
+    static const int    BREAKER_FAILURES           = 5;
+    static const int    BREAKER_COOLDOWN_MS        = 30000;
+    static const int    ADMISSION_WAIT_SLICE_MS    = 20;   // cancellation check interval
+
+    struct AdmissionConfig {
+        double ratePerSecond;      // <= 0: no rate limit
+        double burst;
+        size_t maxConcurrent;      // 0: no concurrency limit
+        int    queueTimeoutMs;
+        int    breakerFailures;    // 0: no circuit breaker
+        int    breakerCooldownMs;
+
+        AdmissionConfig()
+            : ratePerSecond(ADMISSION_RATE_PER_S), burst(ADMISSION_BURST),
+              maxConcurrent(ADMISSION_MAX_CONCURRENT),
+              queueTimeoutMs(ADMISSION_QUEUE_TIMEOUT_MS),
+              breakerFailures(BREAKER_FAILURES),
+              breakerCooldownMs(BREAKER_COOLDOWN_MS) {}
+    };
+
+    /**
+     * TokenBucket — ratePerSecond tokens accrue up to burst; each request
+     * takes one.
+     */
+    class TokenBucket {
+    public:
+        TokenBucket(double ratePerSecond, double burst);
+        bool tryAcquire();
+    private:
+        typedef chrono::steady_clock Clock;
+        mutex             m_mutex;
+        double            m_rate;
+        double            m_burst;
+        double            m_tokens;
+        Clock::time_point m_last;
+    };
+
+    /**
+     * Semaphore — counting semaphore with a timed, cancellable acquire.
+     */
+    class Semaphore {
+    public:
+        explicit Semaphore(size_t permits);
+        // False at the deadline or when cancelled.
+        bool acquire(chrono::steady_clock::time_point deadline,
+                     const cancel_token::CancelToken* cancel = nullptr);
+        void release();
+        size_t inUse() const;
+    private:
+        mutable mutex      m_mutex;
+        condition_variable m_cv;
+        size_t             m_permits;
+        size_t             m_used;
+    };
+
+    enum BreakerState { BREAKER_CLOSED, BREAKER_OPEN, BREAKER_HALF_OPEN };
+
+    /**
+     * CircuitBreaker — allow() before a request, then exactly one of
+     * recordSuccess() / recordFailure() / recordAbandoned() for every
+     * allowed request.
+     */
+    class CircuitBreaker {
+    public:
+        CircuitBreaker(int failureThreshold, int cooldownMs);
+        bool allow();
+        void recordSuccess();
+        void recordFailure();
+        // Cancelled before an outcome was known: frees the half-open probe.
+        void recordAbandoned();
+        BreakerState state() const;
+        size_t trips() const;
+    private:
+        typedef chrono::steady_clock Clock;
+        mutable mutex     m_mutex;
+        int               m_threshold;
+        int               m_cooldownMs;
+        int               m_failures;       // consecutive
+        BreakerState      m_state;
+        bool              m_probing;        // half-open probe in flight
+        Clock::time_point m_openedAt;
+        size_t            m_trips;
+    };
+
+    struct FlightResult {
+        string reply;
+        bool   cancelled;    // the leader gave up; followers should retry
+    };
+
+    /**
+     * SingleFlight — coalesces concurrent calls with the same key.  The
+     * first caller leads and must finish(); the others wait on its result.
+     */
+    class SingleFlight {
+    public:
+        struct Flight {
+            bool                       leader;
+            uint64_t                   key;
+            shared_future<FlightResult> result;    // followers only
+        };
+
+        Flight join(uint64_t key);
+        void finish(const Flight& flight, const FlightResult& result);
+        size_t inFlight() const;
+
+    private:
+        struct Call {
+            promise<FlightResult>       done;
+            shared_future<FlightResult> result;
+        };
+        mutable mutex                   m_mutex;
+        map<uint64_t, shared_ptr<Call>> m_calls;
+    };
+
+    struct AdmissionStats {
+        size_t admitted;        // requests sent upstream
+        size_t coalesced;       // answered by another caller's request
+        size_t rateLimited;
+        size_t queueTimeouts;   // no slot within the queue timeout
+        size_t breakerRejected;
+        size_t breakerTrips;
+        size_t failures;        // admitted requests that failed
+        size_t inFlight;
+        BreakerState breaker;
+    };
+
+    /**
+     * AdmissionController — the four gates around one upstream.
+     *
+     *   string reply = ac.run(key, cancel, [&]() { return send(); });
+     *
+     * key identifies the prompt for coalescing (0: never coalesce).  send
+     * returns "" on failure.  run() returns "" when the request was refused,
+     * failed or was cancelled; after a refusal, rejected() says why.
+     */
+    class AdmissionController {
+    public:
+        explicit AdmissionController(const AdmissionConfig& config = AdmissionConfig());
+
+        AdmissionController(const AdmissionController&) = delete;
+        AdmissionController& operator=(const AdmissionController&) = delete;
+
+        template <typename Send>
+        string run(uint64_t key, const cancel_token::CancelToken* cancel, Send send);
+
+        // Why the calling thread's last run() was refused; "" when it was
+        // not.
+        static const string& rejected();
+
+        const AdmissionConfig& config() const { return m_config; }
+        AdmissionStats getStats() const;
+
+    private:
+        AdmissionConfig m_config;
+        TokenBucket     m_bucket;
+        Semaphore       m_slots;
+        CircuitBreaker  m_breaker;
+        SingleFlight    m_flights;
+
+        atomic<size_t> m_admitted;
+        atomic<size_t> m_coalesced;
+        atomic<size_t> m_rateLimited;
+        atomic<size_t> m_queueTimeouts;
+        atomic<size_t> m_breakerRejected;
+        atomic<size_t> m_failures;
+
+        static string& lastRejection();
+
+        // Gates before sending; false (reason set) when refused.
+        bool admit(const cancel_token::CancelToken* cancel);
+        // After sending; frees the slot and feeds the breaker.
+        void complete(const string& reply, const cancel_token::CancelToken* cancel);
+        // Wait for a leader's result, in cancellable slices.
+        bool await(const SingleFlight::Flight& flight, const cancel_token::CancelToken* cancel,
+                   FlightResult& result);
+    };
+
+    template <typename Send>
+    string AdmissionController::run(uint64_t key, const cancel_token::CancelToken* cancel, Send send)
+    {
+        lastRejection().clear();
+        // A follower whose leader was cancelled tries again, usually as
+        // the new leader.
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            SingleFlight::Flight flight;
+            flight.leader = true;
+            flight.key    = key;
+            if (key != 0)
+                flight = m_flights.join(key);
+
+            if (!flight.leader) {
+                FlightResult result;
+                if (!await(flight, cancel, result))
+                    return "";
+                if (!result.cancelled) {
+                    m_coalesced++;
+                    return result.reply;
+                }
+                continue;
+            }
+
+            FlightResult result;
+            result.cancelled = false;
+            if (admit(cancel)) {
+                try {
+                    result.reply = send();
+                } catch (...) {
+                    complete("", cancel);
+                    result.cancelled = true;
+                    if (key != 0) m_flights.finish(flight, result);
+                    throw;
+                }
+                complete(result.reply, cancel);
+            }
+            result.cancelled = cancel_token::isCancelled(cancel);
+            if (key != 0)
+                m_flights.finish(flight, result);
+            return result.cancelled ? string() : result.reply;
+        }
+        return "";
+    }
+
+} // namespace admission_control
+
+#endif // __ADMISSION_CONTROL_H__
@@ -9,7 +9,7 @@ using namespace std;
 using namespace aiml;
 
 Category::Category(Pattern* pattern, Template* templ)
-:m_pPattern(pattern), m_tTemplate(templ) {
+:m_pPattern(pattern), m_tTemplate(templ), m_decayClock(nullptr), m_decayTurn(0) {
     m_tThat = new That();
     m_tTopic = new Topic();
 }
@@ -7,6 +7,8 @@
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include "strings.h"
 #include "aimlelement.h"
 #include "aimltopic.h"
@@ -56,16 +58,46 @@ namespace aiml {
         }
     };
 
+    /**
+     * DecayClock — turn counter for lazy recency decay.
+     *
+     * A soft category attached to a clock stores its confidence as of the
+     * turn it was last updated, and reads it as confidence * factor^(turns
+     * since).  Advancing the clock is then one increment per turn however
+     * many categories there are, and nothing is written on a read.
+     */
+    class DecayClock {
+    public:
+        explicit DecayClock(double factor = 0.99) : m_factor(factor), m_turn(0) {}
+
+        void          tick()      { m_turn.fetch_add(1, memory_order_relaxed); }
+        unsigned long now() const { return m_turn.load(memory_order_relaxed); }
+        double        factor() const { return m_factor; }
+
+        // What is left of a value last updated at turn since.
+        double remaining(unsigned long since) const {
+            unsigned long turns = now() - since;
+            return turns ? pow(m_factor, (double)turns) : 1.0;
+        }
+
+    private:
+        double                m_factor;
+        atomic<unsigned long> m_turn;
+
+        DecayClock(const DecayClock&) = delete;
+        DecayClock& operator=(const DecayClock&) = delete;
+    };
+
     class Category : public AIMLElement {
     public:
         Category()
             : m_pPattern(nullptr), m_tTemplate(nullptr),
               m_tThat(nullptr), m_tTopic(nullptr),
-              m_truthValue(1.0, 1.0, true) {}
+              m_truthValue(1.0, 1.0, true), m_decayClock(nullptr), m_decayTurn(0) {}
 
         Category(Pattern* pattern, That* that, Topic* topic, Template* templ)
             : m_pPattern(pattern), m_tThat(that), m_tTopic(topic), m_tTemplate(templ),
-              m_truthValue(1.0, 1.0, true) {}
+              m_truthValue(1.0, 1.0, true), m_decayClock(nullptr), m_decayTurn(0) {}
 
         Category(Pattern* pattern, Template* templ);
 
@@ -73,7 +105,7 @@ namespace aiml {
         Category(Pattern* pattern, Template* templ, const TruthValue& tv)
             : m_pPattern(pattern), m_tTemplate(templ),
               m_tThat(nullptr), m_tTopic(nullptr),
-              m_truthValue(tv) {}
+              m_truthValue(tv), m_decayClock(nullptr), m_decayTurn(0) {}
 
         ~Category() {
             delete(m_pPattern);
@@ -87,19 +119,36 @@ namespace aiml {
         void appendChildren(vector<AIMLElement*> children);
 
         void setTopic(Topic* topic);
+        // Categories of one <topic> share it.
+        Topic* topic() { return m_tTopic; }
         string toString();
 
         Pattern* pattern();
         Template* templ();
 
-        // TruthValue accessors
-        const TruthValue& getTruthValue() const { return m_truthValue; }
-        TruthValue&       getTruthValue()       { return m_truthValue; }
-        void setTruthValue(const TruthValue& tv) { m_truthValue = tv; }
+        // TruthValue accessors.  With a decay clock, the confidence read
+        // has the decay since the last update applied.
+        TruthValue getTruthValue() const {
+            if (!m_decayClock || m_truthValue.immutable) return m_truthValue;
+            TruthValue tv = m_truthValue;
+            tv.confidence *= m_decayClock->remaining(m_decayTurn);
+            return tv;
+        }
+        void setTruthValue(const TruthValue& tv) {
+            m_truthValue = tv;
+            if (m_decayClock) m_decayTurn = m_decayClock->now();
+        }
+
+        // Decay this (soft) category lazily from now on.  Null: no decay.
+        void setDecayClock(const DecayClock* clock) {
+            settleDecay();
+            m_decayClock = clock;
+            m_decayTurn  = clock ? clock->now() : 0;
+        }
 
         // Convenience wrappers
-        void reinforceMatch(double amount = 0.05) { m_truthValue.reinforce(amount); }
-        void decayConfidence(double factor = 0.99) { m_truthValue.decay(factor); }
+        void reinforceMatch(double amount = 0.05) { settleDecay(); m_truthValue.reinforce(amount); }
+        void decayConfidence(double factor = 0.99) { settleDecay(); m_truthValue.decay(factor); }
 
     private:
         Pattern*    m_pPattern;
@@ -107,6 +156,15 @@ namespace aiml {
         That*       m_tThat;
         Topic*      m_tTopic;
         TruthValue  m_truthValue;
+        const DecayClock* m_decayClock;   // not owned; null for static categories
+        unsigned long     m_decayTurn;    // clock turn m_truthValue is as of
+
+        // Store the pending decay, so m_truthValue is as of now.
+        void settleDecay() {
+            if (!m_decayClock) return;
+            m_truthValue = getTruthValue();
+            m_decayTurn  = m_decayClock->now();
+        }
     };
 }
 
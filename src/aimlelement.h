@@ -13,6 +13,8 @@ using namespace std;
 namespace aiml {
     class AIMLElement {
     public:
+        virtual ~AIMLElement() {}
+
         virtual void appendChild(AIMLElement* child) = 0;
         virtual void appendChildren(vector<AIMLElement*> children) = 0;
         virtual string toString() = 0;
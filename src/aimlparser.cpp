@@ -22,90 +22,148 @@
 #include <iostream>
 #include <limits.h>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
 
 using namespace std;
 
 #define TIXML_USE_STL
 
-extern vector<CategoryList*> cls;
 Topic* topic;
 
-lev_pat_templ parse_categoryList(CategoryList* cl, string input, string prevTemplate, map<string, string> &mVars) {
-    unsigned int bestLev = UINT_MAX;
-    lev_pat_templ levPatTempl;
+// database/vars.xml is shared by every session; mVars holds the calling
+// session's own predicates and is consulted first.
+static mutex varsFileMutex;
+
+// srai counters, shared by all threads.
+static atomic<size_t> sraiCalls(0);
+static atomic<size_t> sraiMemoHits(0);
+static atomic<size_t> sraiCycles(0);
+static atomic<size_t> sraiDepthLimited(0);
+static atomic<int>    sraiMaxDepth(0);
+
+// Seeds for EvalContext RNGs: distinct per turn, no shared rand() state.
+static atomic<unsigned int> evalSeed((unsigned int) time(NULL));
+
+EvalContext::EvalContext(const vector<CategoryList*>& lists, const string& input,
+                         const string& that, map<string, string>& vars,
+                         const cancel_token::CancelToken* cancel)
+    : lists(lists), input(&input), pattern(NULL), that(that), vars(vars), starsSplit(false),
+      rng(evalSeed.fetch_add(0x9E3779B9u)), cancel(cancel) {
+}
+
+SraiStats srai_stats() {
+    SraiStats st;
+    st.calls        = sraiCalls.load();
+    st.memoHits     = sraiMemoHits.load();
+    st.cycles       = sraiCycles.load();
+    st.depthLimited = sraiDepthLimited.load();
+    st.maxDepth     = sraiMaxDepth.load();
+    return st;
+}
+
+lev_pat_templ match_category_lists(const vector<CategoryList*>& lists, const string& input,
+                                   unsigned int* listIndex, vector<unsigned int>& distRow,
+                                   const cancel_token::CancelToken* cancel) {
+    lev_pat_templ best = {UINT_MAX, NULL, NULL};
+    unsigned int bestIndex = 0;
+
+    for (unsigned int i=0, s=lists.size(); i<s; ++i) {
+        if (cancel_token::isCancelled(cancel)) break;
+        lev_pat_templ lt = parse_categoryList(lists[i], input, distRow, cancel);
+
+        if (i == 0 || (best.patternLevDist > lt.patternLevDist && lt.templ &&
+                       lt.templ->toString() != "")) {
+            best = lt;
+            bestIndex = i;
+        }
+    }
 
-    //to do
-    //if (cl->size() > 0)
-    //    response = cl->child(0)->templ()->toString();
+    if (listIndex)
+        *listIndex = bestIndex;
+    return best;
+}
 
-    //cout << "parse_graph input=" << input << endl;
+lev_pat_templ parse_categoryList(CategoryList* cl, const string& input, vector<unsigned int>& distRow,
+                                const cancel_token::CancelToken* cancel) {
+    unsigned int bestLev = UINT_MAX;
+    lev_pat_templ levPatTempl = {UINT_MAX, NULL, NULL};
 
     for (int i=0, s=cl->size(); i<s; ++i) {
-        Category* category = cl->child(i);
-        lev_pat_templ lt = parse_category(cl, category, input, prevTemplate, mVars);
+        // Deadline hit: return the best match seen so far.
+        if (cancel_token::pollCancelled(cancel, i))
+            break;
 
-        //cout << bestLev << endl;
-        //cout << lt.bestResponse << endl;
+        lev_pat_templ lt = parse_category(cl->child(i), input, distRow);
 
         if (bestLev > lt.patternLevDist) {
             bestLev = lt.patternLevDist;
-            levPatTempl = {lt.patternLevDist, lt.pat, lt.templ};
+            levPatTempl = lt;
         }
     }
 
-    //cout << bestLev << endl;
-
     return levPatTempl;
 }
 
-lev_pat_templ parse_category(CategoryList* cl, Category* category, string input, string prevTemplate, map<string, string> &mVars) {
-    string sPattern = "";
-    TiXmlNode* bestPattern = NULL;
-    TiXmlNode* bestTemplate = NULL;
-    TiXmlNode* nPattern = NULL;
-    TiXmlNode* bestThat = NULL;
-
-    sPattern = category->pattern()->toString();
-
-    //cout << "parse_category sPattern=" << sPattern << endl;
-
-    lev_pat_templ levTempl = {edit_distance(input, sPattern), category->pattern(), category->templ()};
+lev_pat_templ parse_category(Category* category, const string& input, vector<unsigned int>& distRow) {
+    lev_pat_templ levTempl = {edit_distance(input, category->pattern()->text(), distRow),
+                              category->pattern(), category->templ()};
 
     return levTempl;
 }
 
-string parse_template(CategoryList* cl, Pattern* pattern, Template* templ, string input, string prevTemplate, map<string, string> &mVars) {
-    string response = "";
-    vector<TemplateElement*> children;
-    string sPattern = pattern->toString();
-
-    children = templ->children();
+void parse_template(Template* templ, Pattern* pattern, const string& input, EvalContext& ctx, string& out) {
+    // Bind the match for <star/>; a srai evaluates its reduction through
+    // here too, so the caller's binding is restored afterwards.
+    const string* prevInput = ctx.input;
+    Pattern* prevPattern = ctx.pattern;
+    bool prevSplit = ctx.starsSplit;
+    vector<string> prevStars;
+    prevStars.swap(ctx.stars);
+
+    ctx.input = &input;
+    ctx.pattern = pattern;
+    ctx.starsSplit = false;
+
+    parse_elements(templ->children(), ctx, out);
+
+    ctx.input = prevInput;
+    ctx.pattern = prevPattern;
+    ctx.starsSplit = prevSplit;
+    ctx.stars.swap(prevStars);
+}
 
+void parse_elements(const vector<TemplateElement*>& children, EvalContext& ctx, string& out) {
     for (int i=0, s=children.size(); i<s; ++i) {
         TemplateElement* te = children[i];
 
         if (Text* t = dynamic_cast<Text*>(te)) {
-            //cout << response << endl;
-            response += t->toString() + " ";
+            out += t->value();
+            out += ' ';
         } else if (Srai* srai = dynamic_cast<Srai*>(te)) {
-            // cout << "parse_template srai" << endl;
-            response += parse_srai(cl, srai, pattern, input, prevTemplate, mVars) + " ";
-            // cout << "parse_template srai response=" << response << endl;
+            parse_srai(srai, ctx, out);
+            out += ' ';
         } else if (Star* star = dynamic_cast<Star*>(te)) {
-            //cout << "parse_template star" << endl;
-            response += parse_star(cl, star, pattern, input, prevTemplate, mVars) + " ";
+            parse_star(star, ctx, out);
+            out += ' ';
         } else if (Bot* bot = dynamic_cast<Bot*>(te)) {
-            response += parse_bot(cl, bot, pattern, input, prevTemplate, mVars) + " ";
+            parse_bot(bot, out);
+            out += ' ';
         } else if (Get* get = dynamic_cast<Get*>(te)) {
-            response += parse_get(cl, get, pattern, input, prevTemplate, mVars) + " ";
+            out += parse_get(get->name(), ctx);
+            out += ' ';
         } else if (Set* set = dynamic_cast<Set*>(te)) {
-            Template* templ = new Template(te->children());
-
-            response += parse_set(cl, set, parse_template(cl, pattern, templ, input, prevTemplate, mVars), pattern, input, prevTemplate, mVars) + " ";
+            string value;
+            parse_elements(te->children(), ctx, value);
+            if (parse_set(set, value, ctx))
+                out += value;
+            out += ' ';
         } else if (Think* think = dynamic_cast<Think*>(te)) {
-            response += parse_think(cl, think, pattern, input, prevTemplate, mVars) + " ";
-        } else if (Condition* condition = dynamic_cast<Condition*>(te)) {
-            vector<TemplateElement*> childr = te->children();
+            parse_think(think, ctx);
+            out += ' ';
+        } else if (dynamic_cast<Condition*>(te)) {
+            const vector<TemplateElement*>& childr = te->children();
 
             //<condition>
             //  <li name="state" value="happy">I am happy!</li>
@@ -117,12 +175,12 @@ string parse_template(CategoryList* cl, Pattern* pattern, Template* templ, strin
             //  <li value="sad">I am sad!</li>
             //</condition>
             if (childr.size() > 0 && dynamic_cast<Li*>(childr[0])) {
-                response += parse_condition(cl, childr, pattern, input, prevTemplate, mVars);
+                parse_condition(childr, ctx, out);
             //<condition name="state" value="happy">I am happy!</condition>
             //<condition name="state" value="sad">I am sad!</condition>
             } else {
                 while(i<s && dynamic_cast<Condition*>(children[i])) {
-                    response += parse_condition(cl, dynamic_cast<Condition*>(children[i]), pattern, input, prevTemplate, mVars);
+                    parse_condition(dynamic_cast<Condition*>(children[i]), ctx, out);
                     i++;
                 }
             }
@@ -138,67 +196,58 @@ string parse_template(CategoryList* cl, Pattern* pattern, Template* templ, strin
             //<li> handsome.</li>
             //</condition>
         } else if (Random* random = dynamic_cast<Random*>(te)) {
-            response += parse_random(cl, random, pattern, input, prevTemplate, mVars) + " ";
+            parse_random(random, ctx, out);
+            out += ' ';
         }
     }
-
-    //cout << response << endl;
-
-    return response;
 }
 
-string parse_random(CategoryList* cl, Random* random, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
-    vector<TemplateElement*> lis = random->children();
-    int n;
+void parse_random(Random* random, EvalContext& ctx, string& out) {
+    const vector<TemplateElement*>& lis = random->children();
 
-    srand((unsigned) time(NULL));
+    if (lis.empty())
+        return;
 
-    n = rand() % lis.size();
+    size_t n = ctx.rng() % lis.size();
 
-    return parse_template(cl, pattern, new Template(lis[n]->children()), input, prevTemplate, mVars);
+    parse_elements(lis[n]->children(), ctx, out);
 }
 
-string parse_condition(CategoryList* cl, vector<TemplateElement*> lis, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
-    string response = "";
+// Shared by both condition forms: evaluate children when the predicate
+// name has the given value.
+static void parse_condition(const string& name, const string& value,
+                            const vector<TemplateElement*>& children, EvalContext& ctx, string& out) {
+    if (parse_get(name, ctx) == value)
+        parse_elements(children, ctx, out);
+}
 
+void parse_condition(const vector<TemplateElement*>& lis, EvalContext& ctx, string& out) {
     for (int i=0, s=lis.size(); i<s; ++i) {
         Li* li = dynamic_cast<Li*>(lis[i]);
-        Condition* cond = new Condition(li->name(), li->value(), li->children());
+        if (!li) continue;
 
-        response += parse_condition(cl, cond, pattern, input, prevTemplate, mVars);
+        parse_condition(li->name(), li->value(), li->children(), ctx, out);
     }
-
-    return response;
 }
 
-string parse_condition(CategoryList* cl, Condition* condition, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
-    string name = condition->name();
-    string value = condition->value();
-    string getValue = parse_get(cl, new Get(name), pattern, input, prevTemplate, mVars);
-    vector<TemplateElement*> children = condition->children();
-
-    //cout << (getValue == value ? "true" : "false") << endl;
-
-    return getValue == value ? parse_template(cl, pattern, new Template(children), input, prevTemplate, mVars) : "";
+void parse_condition(Condition* condition, EvalContext& ctx, string& out) {
+    parse_condition(condition->name(), condition->value(), condition->children(), ctx, out);
 }
 
-string parse_think(CategoryList* cl, Think* think, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
-    vector<TemplateElement*> children = think->children();
-    Template* templ = new Template(children);
-
-    parse_template(cl, pattern, templ, input, prevTemplate, mVars);
+void parse_think(Think* think, EvalContext& ctx) {
+    string discarded;
 
-    return "";
+    parse_elements(think->children(), ctx, discarded);
 }
 
-string parse_bot(CategoryList* cl, Bot* bot, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
+void parse_bot(Bot* bot, string& out) {
     TiXmlDocument doc;
     TiXmlElement* root;
     string botPath = "database/bot.xml";
 
     if (!doc.LoadFile(botPath.c_str())) {
         cerr << doc.ErrorDesc() << " " << botPath << endl;
-        return "";
+        return;
     }
 
     root = doc.FirstChildElement();
@@ -206,25 +255,30 @@ string parse_bot(CategoryList* cl, Bot* bot, Pattern* pattern, string input, str
     if (root == NULL) {
         cerr << "Failed to load file: No root element. " << botPath << endl;
         doc.Clear();
-        return "";
+        return;
     }
 
     TiXmlElement* elem = root->FirstChildElement();
 
     for(TiXmlElement* e = elem; e; e = e->NextSiblingElement()) {
         if (e->Attribute("name") == bot->name()) {
-            return e->FirstChild()->ToText()->Value();
+            out += e->FirstChild()->ToText()->Value();
+            return;
         }
     }
-
-    return "";
 }
 
-string parse_get(CategoryList* cl, Get* get, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
+string parse_get(const string& name, EvalContext& ctx) {
     TiXmlDocument doc;
     TiXmlElement* root;
     string varsPath = "database/vars.xml";
 
+    auto it = ctx.vars.find(name);
+    if (it != ctx.vars.end())
+        return it->second;
+
+    lock_guard<mutex> lock(varsFileMutex);
+
     if (!doc.LoadFile(varsPath.c_str())) {
         cerr << doc.ErrorDesc() << " " << varsPath << endl;
         return "";
@@ -241,7 +295,7 @@ string parse_get(CategoryList* cl, Get* get, Pattern* pattern, string input, str
     TiXmlElement* elem = root->FirstChildElement();
 
     for(TiXmlElement* e = elem; e; e = e->NextSiblingElement()) {
-        if (e->Attribute("name") == get->name()) {
+        if (e->Attribute("name") == name) {
             return e->FirstChild()->ToText()->Value();
         }
     }
@@ -249,16 +303,20 @@ string parse_get(CategoryList* cl, Get* get, Pattern* pattern, string input, str
     return "";
 }
 
-string parse_set(CategoryList* cl, Set* set, string value, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
+// The session predicate is always set; false when database/vars.xml could
+// not be updated (the <set> then outputs nothing).
+bool parse_set(Set* set, const string& value, EvalContext& ctx) {
     TiXmlDocument doc;
     TiXmlElement* root;
     string varsPath = "database/vars.xml";
 
-    //cout << "parse_set() : " << value << endl;
+    ctx.vars[set->name()] = value;
+
+    lock_guard<mutex> lock(varsFileMutex);
 
     if (!doc.LoadFile(varsPath.c_str())) {
         cerr << doc.ErrorDesc() << " " << varsPath << endl;
-        return "";
+        return false;
     }
 
     root = doc.FirstChildElement();
@@ -266,7 +324,7 @@ string parse_set(CategoryList* cl, Set* set, string value, Pattern* pattern, str
     if (root == NULL) {
         cerr << "Failed to load file: No root element. " << varsPath << endl;
         doc.Clear();
-        return "";
+        return false;
     }
 
     TiXmlDocument doc2;
@@ -293,93 +351,116 @@ string parse_set(CategoryList* cl, Set* set, string value, Pattern* pattern, str
 
     doc2.SaveFile(varsPath.c_str());
 
-    return value;
+    return true;
 }
 
-string parse_srai(CategoryList* cl, Srai* srai, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
-    string response = "";
-    unsigned int bestLev = UINT_MAX;
-    vector<TemplateElement*> children;
-    Template* templ;
-    string sTempl;
-
-    children = srai->children();
-    templ = new Template(children);
-
-    // cout << cls.size() << endl;
+void parse_srai(Srai* srai, EvalContext& ctx, string& out) {
+    string reduced;
 
-    for(unsigned int i=0, clss=cls.size(); i<clss; ++i) {
-        CategoryList* cl = cls[i];
+    // The reduction is matched exactly like a top-level input.
+    parse_elements(srai->children(), ctx, reduced);
+    reduced = Chatmachine::normalized(reduced);
 
-        // cout <<  cl->file() << endl;
-        // cout << i << endl;
+    sraiCalls++;
 
-        sTempl = parse_template(cl, pattern, templ, input, prevTemplate, mVars);
-
-        lev_pat_templ lpt = parse_categoryList(cl, sTempl, prevTemplate, mVars);
-
-        // response = lpt.templ->toString();
-
-        if (lpt.templ->toString() == "") {
-            // cout << "continue" << endl;
-            continue;
-        }
-
-        response = parse_template(cl, pattern, lpt.templ, input, prevTemplate, mVars);
+    auto hit = ctx.sraiMemo.find(reduced);
+    if (hit != ctx.sraiMemo.end()) {
+        sraiMemoHits++;
+        out += hit->second;
+        return;
+    }
 
-        // response = lpt.templ->toString();
+    if (find(ctx.sraiStack.begin(), ctx.sraiStack.end(), reduced) != ctx.sraiStack.end()) {
+        sraiCycles++;
+        return;
+    }
 
-        // cout << "pattern : " + pattern->toString() << endl;
-        // cout << "lpt.pat : " + lpt.pat->toString() << endl;
-        // cout << "response : " + response << endl;
+    if ((int)ctx.sraiStack.size() >= SRAI_MAX_DEPTH) {
+        sraiDepthLimited++;
+        return;
+    }
 
-        if (response != "") {
-            //cout << response << endl;
-            break;
-        }
+    // Past the deadline the turn's reply is discarded; don't start a scan.
+    if (cancel_token::isCancelled(ctx.cancel))
+        return;
 
-        // cout << cl->file() << endl;
-        // cout << i << endl;
-    }
+    ctx.sraiStack.push_back(reduced);
+    int depth = (int)ctx.sraiStack.size();
+    int seen = sraiMaxDepth.load();
+    while (depth > seen && !sraiMaxDepth.compare_exchange_weak(seen, depth)) {}
 
-    /*sTempl = parse_template(cl, pattern, templ, input, prevTemplate, mVars);
+    unsigned int listIndex = 0;
+    lev_pat_templ lpt = match_category_lists(ctx.lists, reduced, &listIndex, ctx.distRow, ctx.cancel);
 
-    lev_pat_templ lpt = parse_categoryList(cl, sTempl, prevTemplate, mVars);
+    string response;
+    if (lpt.templ && lpt.templ->toString() != "")
+        parse_template(lpt.templ, lpt.pat, reduced, ctx, response);
 
-    response = lpt.templ->toString();*/
+    ctx.sraiStack.pop_back();
 
-    return response;
+    out += response;
+    ctx.sraiMemo[reduced].swap(response);
 }
 
 // DO YOU KNOW WHO * IS
 // DO YOU KNOW WHO ALBERT IS
 // vsPattern={"DO YOU KNOW WHO", "*", "IS"}
 // vsInput={"DO YOU KNOW WHO", "ALBERT", "IS"}
-string parse_star(CategoryList* cl, Star* star, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars) {
-    string response = "";
-    string sPattern = pattern->toString();
-    vector<string> vsPattern;
-    vector<string> vsInput;
+//
+// The split is done once per match; ctx.stars then holds the captures in
+// <star index="n"/> order.
+void parse_star(Star* star, EvalContext& ctx, string& out) {
+    if (!ctx.starsSplit) {
+        vector<string> vsPattern;
+        vector<string> vsInput;
+
+        ctx.stars.clear();
+        ctx.starsSplit = true;
+
+        if (ctx.pattern && split(ctx.pattern->text(), *ctx.input, vsPattern, vsInput) &&
+            !vsPattern.empty() && !vsInput.empty()) {
+            // Pattern opening with a wildcard: every token is a capture;
+            // otherwise captures sit between the literal runs.
+            bool leadingStar = vsPattern[0] != vsInput[0];
+            for (size_t i = leadingStar ? 0 : 1; i < vsInput.size(); i += leadingStar ? 1 : 2)
+                ctx.stars.push_back(vsInput[i]);
+        }
+    }
+
     unsigned int index = star->index();
-    int i = 0;
 
-    //cout << "parse_star() : sPattern=" << sPattern << endl;
-    //cout << "parse_star() : input=" << input << endl;
-    //cout << "parse_star() : index=" << index << endl;
+    if (index >= 1 && index <= ctx.stars.size())
+        out += ctx.stars[index - 1];
+}
 
-    split(sPattern, input, vsPattern, vsInput);
+bool is_deterministic(TemplateElement* element) {
+    if (!(dynamic_cast<Text*>(element) || dynamic_cast<Star*>(element) ||
+          dynamic_cast<Br*>(element) || dynamic_cast<Bot*>(element) ||
+          dynamic_cast<Template*>(element)))
+        return false;
 
-    if (vsPattern[0] != vsInput[0]) {
-        index--;
-    } else if (index > 1) {
-        index += 1 + index - 2;
+    vector<TemplateElement*> children = element->children();
+    for (int i=0, s=children.size(); i<s; ++i) {
+        if (!is_deterministic(children[i]))
+            return false;
     }
+    return true;
+}
 
-    response = vsInput[index];
+size_t mark_deterministic_templates(const vector<CategoryList*>& lists) {
+    size_t marked = 0;
 
-    //cout << "parse_star() : response=" << response << endl;
+    for (unsigned int i=0, s=lists.size(); i<s; ++i) {
+        for (Category* category : lists[i]->getCategories()) {
+            Template* templ = category->templ();
+            if (!templ) continue;
+            templ->setDeterministic(is_deterministic(templ));
+            if (templ->isDeterministic())
+                marked++;
+        }
+    }
 
-    return response;
+    return marked;
 }
 
 void createCategoryList(CategoryList* cl, TiXmlElement* root) {
@@ -18,28 +18,88 @@
 #include "aimlbr.h"
 #include "aimlcategory.h"
 #include "xml.h"
+#include "cancel_token.h"
 #include <string>
 #include <vector>
 #include <map>
+#include <cstddef>
+#include <random>
 
 using namespace std;
 using namespace aiml;
 
 #define TIXML_USE_STL
 
+// <srai> resolution limits.  Reductions nest at most SRAI_MAX_DEPTH deep;
+// a reduction that is already being resolved further up the chain (a
+// cycle) resolves to "".
+static const int SRAI_MAX_DEPTH = 16;
+
+struct SraiStats {
+    size_t calls;         // srai reductions resolved
+    size_t memoHits;      // answered from the per-turn memo
+    size_t cycles;        // cut because the reduction was already on the stack
+    size_t depthLimited;  // cut at SRAI_MAX_DEPTH
+    int    maxDepth;      // deepest chain seen
+};
+
+SraiStats srai_stats();
+
+// State of one turn's template evaluation, passed by reference through the
+// whole evaluator instead of copying the input, <that> and predicates into
+// every parse_* call.  input/pattern describe the match whose template is
+// being evaluated; parse_srai rebinds them while it evaluates a reduction.
+// Reductions are matched against the same lists as the input, so a turn
+// stays on one brain generation.  One context per turn: it is not shared
+// between threads.
+struct EvalContext {
+    EvalContext(const vector<CategoryList*>& lists, const string& input,
+                const string& that, map<string, string>& vars,
+                const cancel_token::CancelToken* cancel = nullptr);
+
+    const vector<CategoryList*>& lists;  // categories of the turn, in match order
+    const string*        input;       // text the current pattern matched
+    Pattern*             pattern;     // the matched pattern, for <star/>
+    const string&        that;        // previous bot response
+    map<string, string>& vars;        // the session's predicates
+    vector<string>       stars;       // <star/> captures of input/pattern ...
+    bool                 starsSplit;  // ... split on first use
+    minstd_rand          rng;         // <random> choices
+    vector<string>       sraiStack;   // reductions being resolved, outermost first
+    map<string, string>  sraiMemo;    // reduced input -> response, this turn
+    vector<unsigned int> distRow;     // edit-distance scratch for srai matching
+    const cancel_token::CancelToken* cancel;  // turn deadline; stops srai matching
+};
+
+// Best category over all lists, chosen as top-level matching chooses it:
+// the lowest edit distance, ties to the earlier list, and lists after the
+// first only win with a non-empty template.  *listIndex receives the
+// winning list.  pat/templ are NULL when nothing was scanned.
+lev_pat_templ match_category_lists(const vector<CategoryList*>& lists, const string& input,
+                                   unsigned int* listIndex, vector<unsigned int>& distRow,
+                                   const cancel_token::CancelToken* cancel = nullptr);
+
 void loadData(string aimlFiles[], unsigned int aimlFilesSize, vector<lex_field> &vLexFields, string dir);
-lev_pat_templ parse_categoryList(CategoryList* cl, string input, string prevTemplate, map<string, string> &mVars);
-lev_pat_templ parse_category(CategoryList* cl, Category* nCategory, string input, string prevTemplate, map<string, string> &mVars);
-string parse_template(CategoryList* cl, Pattern* pattern, Template* templ, string input, string prevTemplate, map<string, string> &mVars);
-string parse_random(CategoryList* cl, Random* random, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
-string parse_condition(CategoryList* cl, Condition* condition, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
-string parse_condition(CategoryList* cl, vector<TemplateElement*> lis, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
-string parse_think(CategoryList* cl, Think* think, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
-string parse_bot(CategoryList* cl, Bot* bot, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
-string parse_get(CategoryList* cl, Get* get, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
-string parse_set(CategoryList* cl, Set* set, string value, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
-string parse_srai(CategoryList* cl, Srai* srai, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
-string parse_star(CategoryList* cl, Star* star, Pattern* pattern, string input, string prevTemplate, map<string, string> &mVars);
+lev_pat_templ parse_categoryList(CategoryList* cl, const string& input, vector<unsigned int>& distRow,
+                                const cancel_token::CancelToken* cancel = nullptr);
+lev_pat_templ parse_category(Category* category, const string& input, vector<unsigned int>& distRow);
+
+// Evaluators append their output to out.
+void parse_template(Template* templ, Pattern* pattern, const string& input, EvalContext& ctx, string& out);
+void parse_elements(const vector<TemplateElement*>& elements, EvalContext& ctx, string& out);
+void parse_random(Random* random, EvalContext& ctx, string& out);
+void parse_condition(Condition* condition, EvalContext& ctx, string& out);
+void parse_condition(const vector<TemplateElement*>& lis, EvalContext& ctx, string& out);
+void parse_think(Think* think, EvalContext& ctx);
+void parse_bot(Bot* bot, string& out);
+string parse_get(const string& name, EvalContext& ctx);
+bool parse_set(Set* set, const string& value, EvalContext& ctx);
+void parse_srai(Srai* srai, EvalContext& ctx, string& out);
+void parse_star(Star* star, EvalContext& ctx, string& out);
+// Purity analysis: flag every template whose output depends only on the
+// input and its star captures.  Returns the number flagged.
+size_t mark_deterministic_templates(const vector<CategoryList*>& lists);
+bool is_deterministic(TemplateElement* element);
 void createCategoryList(CategoryList* cl, TiXmlElement* root);
 void createCategories(CategoryList* cl, TiXmlElement* eCategory, string sTopic);
 TemplateElement* createTemplateElement(TiXmlNode* nTemplateElement);
@@ -20,12 +20,14 @@ void Pattern::appendChildren(vector<AIMLElement*> children) {
 }
 
 string Pattern::toString() {
+    return m_sPattern;
+}
+
+string Pattern::join() const {
 	string buffer = "";
 
-    for (int i = 0, n = m_vPattern.size();;) {
+    for (int i = 0, n = m_vPattern.size(); i < n;) {
 		buffer.append(m_vPattern[i]);
-
-		//cout << "toString() : " << m_vPattern[i] << endl;
 
 		if (++i >= n)
 			break;
@@ -17,6 +17,7 @@ namespace aiml {
         Pattern() {}
         Pattern(string pattern) {
             m_vPattern = split(trim(pattern));
+            m_sPattern = join();
         }
 
         vector<string> getElements();
@@ -25,8 +26,13 @@ namespace aiml {
         void appendChildren(vector<AIMLElement*> children);
 
         string toString();
+        // toString() without the copy; matching reads it once per category.
+        const string& text() const { return m_sPattern; }
     private:
         vector<string> m_vPattern;
+        string         m_sPattern;
+
+        string join() const;
     };
 }
 
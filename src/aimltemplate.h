@@ -14,15 +14,20 @@ using namespace std;
 namespace aiml {
     class Template : public TemplateElement {
     public:
-        Template() {}
-        Template(vector<TemplateElement*> children) :TemplateElement(children) {}
+        Template() : m_bDeterministic(false) {}
+        Template(vector<TemplateElement*> children) :TemplateElement(children), m_bDeterministic(false) {}
 
         void appendChild(AIMLElement* child);
         void appendChildren(vector<AIMLElement*> children);
 
         string toString();
+
+        // Set at load time when the output depends only on the input and
+        // its star captures (see mark_deterministic_templates).
+        bool isDeterministic() const { return m_bDeterministic; }
+        void setDeterministic(bool deterministic) { m_bDeterministic = deterministic; }
     private:
-    private:
+        bool m_bDeterministic;
 
     };
 }
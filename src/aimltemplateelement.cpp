@@ -25,6 +25,11 @@ TemplateElement::TemplateElement(vector<TemplateElement*> elements) {
 	}
 }
 
+TemplateElement::~TemplateElement() {
+	for (int i=0, s=m_vtChildren.size(); i<s; ++i)
+		delete m_vtChildren[i];
+}
+
 vector<TemplateElement*> TemplateElement::getChildren() {
 	return m_vtChildren;
 }
@@ -38,7 +43,7 @@ void TemplateElement::appendChildren(vector<AIMLElement*> elements) {
 		m_vtChildren.push_back((TemplateElement*) elements[i]);
 }
 
-vector<TemplateElement*> TemplateElement::children() {
+const vector<TemplateElement*>& TemplateElement::children() const {
 	return m_vtChildren;
 }
 
@@ -17,6 +17,8 @@ namespace aiml {
     public:
         TemplateElement() {}
         TemplateElement(vector<TemplateElement*> elements);
+        // Deletes the children: every element has exactly one parent.
+        virtual ~TemplateElement();
 
         vector<TemplateElement*> getChildren();
 
@@ -25,7 +27,7 @@ namespace aiml {
 
         virtual string toString() = 0;
 
-        vector<TemplateElement*> children();
+        const vector<TemplateElement*>& children() const;
 
         void setChildren(vector<TemplateElement*> elements);
     private:
@@ -13,6 +13,7 @@ namespace aiml {
         Text(string value) :m_sValue(value) {}
 
         string toString();
+        const string& value() const { return m_sValue; }
     private:
     private:
     	string m_sValue;
@@ -27,6 +27,9 @@ vector<Category*> Topic::categories() {
 void Topic::appendChild(AIMLElement* child) {
     Category* category = (Category*) child;
 
+    // Replaces the empty topic the category was created with.
+    if (category->topic() != this)
+        delete category->topic();
     category->setTopic(this);
 
     m_vCategories.push_back(category);
@@ -0,0 +1,258 @@
+#include "batch.h"
+#include "chatmachine.h"
+#include "session.h"
+#include "worker_pool.h"
+#include "json.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+using namespace batch;
+
+namespace {
+
+    struct Record {
+        size_t line;        // 1-based line in the input file
+        string sessionId;
+        string turn;        // as given; empty if absent
+        double turnNum;
+        bool   numericTurn;
+        string text;
+        string error;       // non-empty: malformed, not run
+        string response;
+        double ms;
+
+        Record() : line(0), turnNum(0.0), numericTurn(false), ms(0.0) {}
+    };
+
+    bool parseNumber(const string& s, double& out)
+    {
+        if (s.empty()) return false;
+        char* end = nullptr;
+        out = strtod(s.c_str(), &end);
+        return end && *end == '\0';
+    }
+
+    bool parsePositive(const char* s, int& out)
+    {
+        char* end = nullptr;
+        long v = strtol(s, &end, 10);
+        if (!end || *end != '\0' || v <= 0 || v > 4096) return false;
+        out = (int)v;
+        return true;
+    }
+
+    void printBatchUsage()
+    {
+        cerr << "usage: chatmachine9 batch <input.jsonl> <output.jsonl>"
+             << " [--mode <mode>] [--workers <n>]" << endl;
+    }
+
+    Record parseRecord(const string& text, size_t line)
+    {
+        Record r;
+        r.line = line;
+        map<string, string> fields;
+        string err;
+        if (!json::parseObject(text, fields, &err)) {
+            r.error = "malformed JSON: " + err;
+            return r;
+        }
+        auto sid = fields.find("session_id");
+        auto txt = fields.find("text");
+        if (sid == fields.end() || txt == fields.end()) {
+            r.error = "record needs \"session_id\" and \"text\"";
+            return r;
+        }
+        r.sessionId = sid->second;
+        r.text      = txt->second;
+        auto turn = fields.find("turn");
+        if (turn != fields.end()) {
+            r.turn = turn->second;
+            r.numericTurn = parseNumber(r.turn, r.turnNum);
+        }
+        return r;
+    }
+
+    // Run one session's turns in order; each record is written only here.
+    void runSession(Chatmachine& bot, const string& sessionId,
+                    vector<Record>& records, const vector<size_t>& order)
+    {
+        shared_ptr<session::Session> s = bot.newSession(sessionId);
+        for (size_t idx : order) {
+            Record& r = records[idx];
+            auto start = chrono::steady_clock::now();
+            try {
+                r.response = bot.respondTo(*s, Chatmachine::normalized(r.text));
+            } catch (const exception& e) {
+                cerr << "[Batch] Turn failed at line " << r.line << ": " << e.what() << endl;
+            } catch (...) {
+                cerr << "[Batch] Turn failed at line " << r.line << endl;
+            }
+            r.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    string formatRecord(const Record& r)
+    {
+        ostringstream out;
+        if (!r.error.empty()) {
+            out << "{\"line\":" << r.line << ",\"error\":" << json::quote(r.error) << "}";
+            return out.str();
+        }
+        out << "{\"session_id\":" << json::quote(r.sessionId);
+        if (!r.turn.empty())
+            out << ",\"turn\":" << (r.numericTurn ? r.turn : json::quote(r.turn));
+        out << ",\"text\":" << json::quote(r.text)
+            << ",\"response\":" << json::quote(r.response)
+            << ",\"ms\":" << r.ms << "}";
+        return out.str();
+    }
+
+    double percentile(const vector<double>& sorted, double p)
+    {
+        if (sorted.empty()) return 0.0;
+        size_t i = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+        return sorted[min(i, sorted.size() - 1)];
+    }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Command line
+// ---------------------------------------------------------------------------
+
+bool batch::parseBatchArgs(int argc, char* argv[], int first,
+                           BatchConfig& config, string& mode)
+{
+    if (argc < first + 2) {
+        printBatchUsage();
+        return false;
+    }
+    config.inputPath  = argv[first];
+    config.outputPath = argv[first + 1];
+    for (int i = first + 2; i < argc; ++i) {
+        string opt = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "[Batch] Missing value for " << opt << endl;
+            printBatchUsage();
+            return false;
+        }
+        const char* value = argv[++i];
+        if (opt == "--mode") {
+            mode = value;
+        } else if (opt == "--workers") {
+            if (!parsePositive(value, config.workers)) {
+                cerr << "[Batch] Invalid worker count: " << value << endl;
+                return false;
+            }
+        } else {
+            cerr << "[Batch] Unknown option: " << opt << endl;
+            printBatchUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+int batch::resolveWorkers(const BatchConfig& config)
+{
+    if (config.workers > 0) return config.workers;
+    unsigned cores = thread::hardware_concurrency();
+    return cores > 0 ? (int)cores : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Run
+// ---------------------------------------------------------------------------
+
+bool batch::runBatch(Chatmachine& bot, const BatchConfig& config)
+{
+    ifstream in(config.inputPath.c_str());
+    if (!in) {
+        cerr << "[Batch] Cannot open input " << config.inputPath << endl;
+        return false;
+    }
+    ofstream out(config.outputPath.c_str());
+    if (!out) {
+        cerr << "[Batch] Cannot open output " << config.outputPath << endl;
+        return false;
+    }
+
+    // Read and group by session, sessions in order of first appearance.
+    vector<Record>         records;
+    vector<string>         sessionOrder;
+    map<string, vector<size_t>> bySession;
+    string line;
+    size_t lineNo = 0;
+    while (getline(in, line)) {
+        ++lineNo;
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        records.push_back(parseRecord(line, lineNo));
+        const Record& r = records.back();
+        if (!r.error.empty()) continue;
+        auto it = bySession.find(r.sessionId);
+        if (it == bySession.end()) {
+            sessionOrder.push_back(r.sessionId);
+            it = bySession.insert(make_pair(r.sessionId, vector<size_t>())).first;
+        }
+        it->second.push_back(records.size() - 1);
+    }
+
+    for (auto& kv : bySession) {
+        vector<size_t>& order = kv.second;
+        bool numeric = all_of(order.begin(), order.end(),
+                              [&](size_t i) { return records[i].numericTurn; });
+        if (numeric)
+            stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return records[a].turnNum < records[b].turnNum;
+            });
+    }
+
+    // One task per session; the pool bounds how many run at once.
+    int workers = resolveWorkers(config);
+    auto start = chrono::steady_clock::now();
+    {
+        worker_pool::WorkerPool pool((size_t)workers);
+        vector<future<void>> done;
+        done.reserve(sessionOrder.size());
+        for (const string& id : sessionOrder) {
+            const vector<size_t>* order = &bySession[id];
+            done.push_back(pool.submit([&bot, &records, id, order]() {
+                runSession(bot, id, records, *order);
+            }));
+        }
+        for (auto& f : done) f.get();
+    }
+    double wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    vector<double> latencies;
+    size_t errors = 0;
+    for (const Record& r : records) {
+        out << formatRecord(r) << "\n";
+        if (r.error.empty()) latencies.push_back(r.ms);
+        else ++errors;
+    }
+    out.flush();
+
+    sort(latencies.begin(), latencies.end());
+    double seconds = wallMs / 1000.0;
+    cout << "Batch: " << latencies.size() << " turns across " << sessionOrder.size()
+         << " sessions (" << workers << " workers) in " << seconds << " s";
+    if (seconds > 0.0)
+        cout << ", " << (double)latencies.size() / seconds << " turns/s";
+    cout << "." << endl;
+    cout << "  Turn latency ms: p50=" << percentile(latencies, 0.50)
+         << " p95=" << percentile(latencies, 0.95)
+         << " p99=" << percentile(latencies, 0.99)
+         << " max=" << (latencies.empty() ? 0.0 : latencies.back()) << endl;
+    if (errors > 0)
+        cout << "  Skipped " << errors << " malformed line(s)." << endl;
+    return true;
+}
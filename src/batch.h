@@ -0,0 +1,56 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+/**
+ * batch.h — Offline batch replay (Phase 6)
+ *
+ * `chatmachine9 batch <input.jsonl> <output.jsonl>` runs a file of
+ * utterances through the bot without the REPL.  Each input line is one
+ * record:
+ *
+ *     {"session_id":"alice","turn":1,"text":"hello"}
+ *
+ * Records are grouped by session_id and ordered by turn (file order breaks
+ * ties, and is used as-is for a session with a missing or non-numeric
+ * turn).  Sessions are independent, so they run concurrently on a worker
+ * pool — one task per session, which keeps each session's turns in order.  Every record gets one output line,
+ * written in input order:
+ *
+ *     {"session_id":"alice","turn":1,"text":"hello","response":"Hi there!","ms":1.8}
+ *     {"line":7,"error":"..."}                      (malformed input line)
+ *
+ * A summary (turns, sessions, wall time, throughput, latency percentiles)
+ * goes to stdout when the run ends.
+ */
+
+#include <string>
+
+using namespace std;
+
+class Chatmachine;
+
+namespace batch {
+
+    struct BatchConfig {
+        string inputPath;
+        string outputPath;
+        int    workers;    // concurrent sessions; 0 = one per core
+
+        BatchConfig() : workers(0) {}
+    };
+
+    // Parse `batch <input> <output> [--mode <mode>] [--workers <n>]`
+    // starting at argv[first].  mode is left unchanged unless --mode is
+    // given.  Prints usage and returns false on bad arguments.
+    bool parseBatchArgs(int argc, char* argv[], int first,
+                        BatchConfig& config, string& mode);
+
+    // Worker count after resolving 0 to the number of cores.
+    int resolveWorkers(const BatchConfig& config);
+
+    // Run the whole file.  Returns false if a file could not be opened.
+    bool runBatch(Chatmachine& bot, const BatchConfig& config);
+
+} // namespace batch
+
+#endif // __BATCH_H__
@@ -0,0 +1,207 @@
+#include "brain.h"
+#include "aimlparser.h"
+#include "aimltopic.h"
+#include "pattern_lattice.h"
+#include "response_cache.h"
+#include <set>
+#include <algorithm>
+#include <sys/stat.h>
+
+using namespace brain;
+
+namespace {
+
+    bool fileStamp(const string& path, time_t& mtime, long long& size) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return false;
+        mtime = st.st_mtime;
+        size  = (long long)st.st_size;
+        return true;
+    }
+
+    shared_ptr<AimlFile> findFile(const Generation* g, const string& path) {
+        if (!g) return shared_ptr<AimlFile>();
+        for (const auto& f : g->files)
+            if (f->path == path) return f;
+        return shared_ptr<AimlFile>();
+    }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// AimlFile / Generation
+// ---------------------------------------------------------------------------
+
+AimlFile::~AimlFile() {
+    if (!list) return;
+
+    // The categories of one <topic> share its Topic: detach it from each
+    // category and delete it once.
+    set<aiml::Topic*> topics;
+    for (aiml::Category* cat : list->getCategories()) {
+        topics.insert(cat->topic());
+        cat->setTopic(nullptr);
+        delete cat;
+    }
+    for (aiml::Topic* t : topics)
+        delete t;
+    delete list;
+}
+
+Generation::Generation() : number(0) {
+}
+
+Generation::~Generation() {
+}
+
+vector<aiml::Category*> Generation::categories() const {
+    vector<aiml::Category*> all;
+    all.reserve(categoryCount());
+    for (aiml::CategoryList* cl : lists) {
+        const auto& cats = cl->getCategories();
+        all.insert(all.end(), cats.begin(), cats.end());
+    }
+    return all;
+}
+
+size_t Generation::categoryCount() const {
+    size_t n = 0;
+    for (aiml::CategoryList* cl : lists)
+        n += cl->getCategories().size();
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// Loading
+// ---------------------------------------------------------------------------
+
+bool brain::loadFiles(const vector<Source>& sources, const Generation* previous,
+                      Generation& next, LoadResult& result) {
+    result.parsed = result.reused = result.deterministic = 0;
+    result.error.clear();
+    result.skipped.clear();
+
+    for (const Source& source : sources) {
+        time_t mtime = 0;
+        long long size = -1;
+        bool stamped = fileStamp(source.path, mtime, size);
+
+        shared_ptr<AimlFile> old = findFile(previous, source.path);
+        if (old && stamped && old->mtime == mtime && old->size == size) {
+            next.files.push_back(old);
+            if (old->loaded)
+                next.lists.push_back(old->list);
+            result.reused++;
+            continue;
+        }
+
+        shared_ptr<AimlFile> file = make_shared<AimlFile>();
+        file->path  = source.path;
+        file->mtime = mtime;
+        file->size  = size;
+        file->list  = new CategoryList(source.name);
+        next.files.push_back(file);
+
+        string error;
+        TiXmlDocument doc;
+        TiXmlElement* root = NULL;
+        if (!doc.LoadFile(source.path.c_str()))
+            error = string(doc.ErrorDesc()) + " " + source.path;
+        else if ((root = doc.FirstChildElement()) == NULL)
+            error = "Failed to load file: No root element. " + source.path;
+
+        if (!error.empty()) {
+            if (source.optional) {
+                result.skipped.push_back(error);
+                continue;
+            }
+            next.lists.push_back(file->list);
+            result.error = error;
+            return false;
+        }
+
+        createCategoryList(file->list, root);
+        file->loaded = true;
+        next.lists.push_back(file->list);
+        result.deterministic += mark_deterministic_templates(
+            vector<CategoryList*>(1, file->list));
+        result.parsed++;
+    }
+    return true;
+}
+
+bool brain::changedOnDisk(const Generation& g, const vector<Source>& sources) {
+    if (sources.size() != g.files.size())
+        return true;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const AimlFile& f = *g.files[i];
+        time_t mtime;
+        long long size;
+        if (sources[i].path != f.path || !fileStamp(f.path, mtime, size) ||
+            mtime != f.mtime || size != f.size)
+            return true;
+    }
+    return false;
+}
+
+string brain::diskStamp(const vector<Source>& sources) {
+    string stamp;
+    for (const Source& source : sources) {
+        time_t mtime = 0;
+        long long size = -1;
+        fileStamp(source.path, mtime, size);
+        stamp += source.path + ":" + to_string((long long)mtime) + ":" +
+                 to_string(size) + ";";
+    }
+    return stamp;
+}
+
+// ---------------------------------------------------------------------------
+// Registry
+// ---------------------------------------------------------------------------
+
+void Registry::publish(shared_ptr<Generation> next) {
+    shared_ptr<Generation> old = atomic_exchange(&m_current, next);
+    if (!old) return;
+    lock_guard<mutex> lock(m_retiredMutex);
+    m_retired.push_back(old);
+}
+
+vector<shared_ptr<Generation>> Registry::live() const {
+    vector<shared_ptr<Generation>> generations;
+    if (shared_ptr<Generation> g = current())
+        generations.push_back(g);
+    lock_guard<mutex> lock(m_retiredMutex);
+    generations.insert(generations.end(), m_retired.begin(), m_retired.end());
+    return generations;
+}
+
+size_t Registry::reclaim() {
+    // Freed outside the lock: dropping a generation deletes its categories.
+    vector<shared_ptr<Generation>> released;
+    size_t pinned = 0;
+    {
+        lock_guard<mutex> lock(m_retiredMutex);
+        vector<shared_ptr<Generation>> kept;
+        for (auto& g : m_retired) {
+            // Apart from turns, this list is its only owner.
+            if (g.use_count() == 1) released.push_back(std::move(g));
+            else kept.push_back(std::move(g));
+        }
+        m_retired.swap(kept);
+        pinned = m_retired.size();
+        m_reclaimed += released.size();
+    }
+    return pinned;
+}
+
+RegistryStats Registry::getStats() const {
+    RegistryStats st;
+    shared_ptr<Generation> g = current();
+    st.current = g ? g->number : 0;
+    lock_guard<mutex> lock(m_retiredMutex);
+    st.retired   = m_retired.size();
+    st.reclaimed = m_reclaimed;
+    return st;
+}
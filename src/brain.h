@@ -0,0 +1,158 @@
+#ifndef __BRAIN_H__
+#define __BRAIN_H__
+
+/**
+ * brain.h — Reloadable AIML brain generations (Phase 6)
+ *
+ * A Generation is one loaded AIML set: the category lists in load order,
+ * the PatternLattice over them (NSVD modes) and the response cache for
+ * their answers.  Each turn pins the generation that is current when it
+ * starts (a shared_ptr copy held in its session) and matches against that
+ * one until it returns, so a reload never changes the brain under a turn.
+ *
+ * A reload builds the next generation off to the side.  Only files whose
+ * size or modification time changed are parsed again; unchanged files are
+ * shared with the previous generation.  Registry::publish() then swaps the
+ * new generation in with one atomic pointer store, and the old one is
+ * retired: the registry keeps it alive until no turn has it pinned, and
+ * reclaim() frees it after that.  A turn letting go of its pin therefore
+ * never pays for freeing a brain, turns never wait for a reload, and a
+ * reload never waits for turns.
+ *
+ * A published generation's lists are read-only.  Its lattice still takes
+ * learned categories (under the brain lock, like before), and its cache is
+ * internally locked.
+ */
+
+#include "categorylist.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <ctime>
+
+using namespace std;
+
+namespace pattern_lattice {
+    class PatternLattice;
+}
+
+namespace response_cache {
+    class ResponseCache;
+}
+
+namespace brain {
+
+    // A reload polls this often for the turns still on the old generation.
+    static const int BRAIN_RECLAIM_POLL_MS = 20;
+
+    // An AIML file to load, and the name its category list gets.
+    // Optional files (consolidation output) that fail to load are skipped;
+    // a required one that fails stops the load.
+    struct Source {
+        string path;
+        string name;
+        bool   optional;
+
+        Source(const string& p, const string& n, bool opt = false)
+            : path(p), name(n), optional(opt) {}
+    };
+
+    // One parsed AIML file.  Shared by every generation loaded while the
+    // file was unchanged; frees its categories with the last of them.
+    struct AimlFile {
+        string              path;
+        time_t              mtime;
+        long long           size;
+        bool                loaded;   // false: an optional file that failed (kept
+                                      // so it is not retried until it changes)
+        aiml::CategoryList* list;
+
+        AimlFile() : mtime(0), size(-1), loaded(false), list(nullptr) {}
+        ~AimlFile();
+
+        AimlFile(const AimlFile&) = delete;
+        AimlFile& operator=(const AimlFile&) = delete;
+    };
+
+    struct Generation {
+        unsigned long                               number;      // 1 for the startup load
+        vector<shared_ptr<AimlFile>>                files;
+        vector<aiml::CategoryList*>                 lists;       // of the files that loaded
+        unique_ptr<pattern_lattice::PatternLattice> lattice;     // NSVD modes only
+        unique_ptr<response_cache::ResponseCache>   cache;
+
+        Generation();
+        ~Generation();
+
+        // Every category of every list, in load order.
+        vector<aiml::Category*> categories() const;
+        size_t categoryCount() const;
+    };
+
+    struct LoadResult {
+        size_t parsed;            // files read and parsed
+        size_t reused;            // files shared with the previous generation
+        size_t deterministic;     // newly parsed categories flagged deterministic
+        string error;             // why loading stopped; empty on success
+        vector<string> skipped;   // why optional files were left out
+    };
+
+    // Load the sources into next, in order.  Files that previous holds
+    // unchanged are shared instead of parsed.  Newly parsed templates are
+    // checked for purity (see response_cache.h).  Stops at the first
+    // required file that fails to load; next then holds the files before
+    // it and an empty list for the failing one, and result.error says why.
+    bool loadFiles(const vector<Source>& sources, const Generation* previous,
+                   Generation& next, LoadResult& result);
+
+    // True when the sources differ from g's files, or one of them was
+    // modified, replaced or removed on disk.
+    bool changedOnDisk(const Generation& g, const vector<Source>& sources);
+    // Paths, modification times and sizes of the sources as they are on
+    // disk now, as one comparable string.
+    string diskStamp(const vector<Source>& sources);
+
+    struct RegistryStats {
+        unsigned long current;     // number of the current generation, 0 if none
+        size_t        retired;     // replaced generations not reclaimed yet
+        size_t        reclaimed;   // replaced generations freed so far
+    };
+
+    /**
+     * Registry - the current generation.  current() pins it; publish()
+     * swaps in the next one and retires the old one.  Safe from any thread;
+     * neither call waits on the other's users.
+     */
+    class Registry {
+    public:
+        Registry() : m_reclaimed(0) {}
+
+        shared_ptr<Generation> current() const { return atomic_load(&m_current); }
+        void publish(shared_ptr<Generation> next);
+
+        // The current generation and the retired ones not reclaimed yet:
+        // every generation a turn may still be running on.
+        vector<shared_ptr<Generation>> live() const;
+
+        // Free the retired generations no turn holds any more.  Returns how
+        // many are still pinned.  A retired generation cannot be pinned
+        // again, so once released it stays released.
+        size_t reclaim();
+
+        RegistryStats getStats() const;
+
+    private:
+        shared_ptr<Generation>         m_current;
+        mutable mutex                  m_retiredMutex;
+        vector<shared_ptr<Generation>> m_retired;
+        size_t                         m_reclaimed;
+
+        Registry(const Registry&) = delete;
+        Registry& operator=(const Registry&) = delete;
+    };
+
+} // namespace brain
+
+#endif // __BRAIN_H__
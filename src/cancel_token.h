@@ -0,0 +1,66 @@
+#ifndef __CANCEL_TOKEN_H__
+#define __CANCEL_TOKEN_H__
+
+/**
+ * cancel_token.h — Cooperative cancellation with a deadline
+ *
+ * A CancelToken is shared between the code that owns a unit of work and the
+ * work itself.  The owner may cancel() explicitly; the token also reports
+ * cancelled once its deadline has passed.  Long-running loops poll
+ * cancelled() every few iterations (see CANCEL_CHECK_INTERVAL) and return
+ * whatever partial result they have.
+ *
+ * Functions take a `const CancelToken*` defaulting to nullptr, so existing
+ * callers are unaffected; use isCancelled() for the null-safe check.
+ */
+
+#include <atomic>
+#include <chrono>
+
+namespace cancel_token {
+
+    // Poll the clock at most once per this many loop iterations.
+    static const int CANCEL_CHECK_INTERVAL = 32;
+
+    class CancelToken {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        CancelToken()
+            : m_cancelled(false), m_deadline(Clock::time_point::max()) {}
+        explicit CancelToken(Clock::time_point deadline)
+            : m_cancelled(false), m_deadline(deadline) {}
+
+        CancelToken(const CancelToken&) = delete;
+        CancelToken& operator=(const CancelToken&) = delete;
+
+        void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+        bool cancelled() const
+        {
+            return m_cancelled.load(std::memory_order_relaxed) ||
+                   Clock::now() >= m_deadline;
+        }
+
+        Clock::time_point deadline() const { return m_deadline; }
+
+    private:
+        std::atomic<bool> m_cancelled;
+        Clock::time_point m_deadline;
+    };
+
+    inline bool isCancelled(const CancelToken* token)
+    {
+        return token && token->cancelled();
+    }
+
+    // For loops: true every CANCEL_CHECK_INTERVAL iterations when cancelled.
+    inline bool pollCancelled(const CancelToken* token, int iteration)
+    {
+        return token && (iteration % CANCEL_CHECK_INTERVAL) == 0 &&
+               token->cancelled();
+    }
+
+} // namespace cancel_token
+
+#endif // __CANCEL_TOKEN_H__
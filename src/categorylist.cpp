@@ -35,26 +35,36 @@ unsigned int CategoryList::size() {
 // LearnableCategoryList
 // ---------------------------------------------------------------------------
 
-LearnableCategoryList::LearnableCategoryList()
-    : CategoryList("__learned__") {}
+LearnableCategoryList::LearnableCategoryList(double decayPerTurn)
+    : CategoryList("__learned__"), m_clock(decayPerTurn) {}
 
 LearnableCategoryList::~LearnableCategoryList() {
-    // m_vChildren owns its Category* pointers; delete them here since
-    // the base class destructor is not virtual-delete-aware.
+    // The pool does not destruct what is still alive.
     for (Category* cat : m_vChildren)
-        delete cat;
+        m_pool.destroy(cat);
     m_vChildren.clear();
+    m_index.clear();
     m_uSize = 0;
 }
 
 Category* LearnableCategoryList::synthesize(const string& input,
-                                             const string& response)
+                                             const string& response,
+                                             bool* created)
 {
+    if (created) *created = false;
     if (input.empty() || response.empty()) return nullptr;
 
     string patternStr = generaliseInput(input);
     if (patternStr.empty()) return nullptr;
 
+    auto it = m_index.find(canonicalPattern(patternStr));
+    if (it != m_index.end()) {
+        vector<string>& responses = it->second.responses;
+        if (std::find(responses.begin(), responses.end(), response) == responses.end())
+            responses.push_back(response);
+        return it->second.category;
+    }
+
     // Build Pattern and Template objects from raw strings.
     Pattern*  pat   = new Pattern(patternStr);
     Text*     tText = new Text(response);
@@ -62,26 +72,43 @@ Category* LearnableCategoryList::synthesize(const string& input,
     templ->appendChild(tText);
 
     TruthValue tv(0.5, 0.1, false);
-    Category* cat = new Category(pat, templ, tv);
+    Category* cat = m_pool.create(pat, templ, tv);
+    cat->setDecayClock(&m_clock);
 
+    Entry entry;
+    entry.category = cat;
+    entry.responses.push_back(response);
+    m_index.insert(make_pair(canonicalPattern(patternStr), std::move(entry)));
     append(cat);
+    if (created) *created = true;
     return cat;
 }
 
+Category* LearnableCategoryList::find(const string& patternStr) const {
+    auto it = m_index.find(canonicalPattern(patternStr));
+    return it != m_index.end() ? it->second.category : nullptr;
+}
+
 void LearnableCategoryList::reinforce(const string& patternStr, double amount) {
-    for (Category* cat : m_vChildren) {
-        if (cat && cat->pattern() &&
-            cat->pattern()->toString() == patternStr)
-        {
-            cat->reinforceMatch(amount);
-            break;
-        }
-    }
+    Category* cat = find(patternStr);
+    if (cat)
+        cat->reinforceMatch(amount);
+}
+
+vector<string> LearnableCategoryList::alternatives(const Category* cat) const {
+    // Category's accessors are not const.
+    Category* c = const_cast<Category*>(cat);
+    if (!c || !c->pattern()) return vector<string>();
+    auto it = m_index.find(canonicalPattern(c->pattern()->toString()));
+    if (it == m_index.end() || it->second.category != cat) return vector<string>();
+    return it->second.responses;
 }
 
-void LearnableCategoryList::decayAll(double factor) {
+bool LearnableCategoryList::anyBelow(double minConfidence) const {
     for (Category* cat : m_vChildren)
-        cat->decayConfidence(factor);
+        if (cat && cat->getTruthValue().confidence < minConfidence)
+            return true;
+    return false;
 }
 
 vector<Category*> LearnableCategoryList::consolidate(double threshold) const {
@@ -93,23 +120,49 @@ vector<Category*> LearnableCategoryList::consolidate(double threshold) const {
     return result;
 }
 
-void LearnableCategoryList::prune(double minConfidence) {
-    vector<Category*> survivors;
-    for (Category* cat : m_vChildren) {
-        if (cat && cat->getTruthValue().confidence >= minConfidence) {
-            survivors.push_back(cat);
-        } else {
-            delete cat;
-        }
+size_t LearnableCategoryList::prune(
+    double minConfidence,
+    const function<void(const unordered_set<Category*>&)>& onRemove)
+{
+    unordered_set<Category*> doomed;
+    for (Category* cat : m_vChildren)
+        if (cat && cat->getTruthValue().confidence < minConfidence)
+            doomed.insert(cat);
+    if (doomed.empty()) return 0;
+
+    if (onRemove)
+        onRemove(doomed);
+
+    m_vChildren.erase(remove_if(m_vChildren.begin(), m_vChildren.end(),
+                                [&](Category* cat) { return doomed.count(cat) > 0; }),
+                      m_vChildren.end());
+    for (Category* cat : doomed) {
+        m_index.erase(canonicalPattern(cat->pattern()->toString()));
+        m_pool.destroy(cat);
     }
-    m_vChildren = survivors;
-    m_uSize = (unsigned int)survivors.size();
+    m_uSize = (unsigned int)m_vChildren.size();
+    return doomed.size();
 }
 
 // ---------------------------------------------------------------------------
 // Private helpers
 // ---------------------------------------------------------------------------
 
+string LearnableCategoryList::canonicalPattern(const string& pattern) {
+    string key;
+    key.reserve(pattern.size());
+    bool pendingSpace = false;
+    for (char c : pattern) {
+        if (isspace((unsigned char)c)) {
+            pendingSpace = !key.empty();
+            continue;
+        }
+        if (pendingSpace) { key += ' '; pendingSpace = false; }
+        key += (char)tolower((unsigned char)c);
+    }
+    return key;
+}
+
 string LearnableCategoryList::generaliseInput(const string& input) const {
     istringstream ss(input);
     string tok;
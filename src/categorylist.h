@@ -6,8 +6,12 @@
 #include <cstdlib>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
 #include "aimlelement.h"
 #include "aimlcategory.h"
+#include "object_pool.h"
 
 using namespace std;
 
@@ -33,6 +37,11 @@ namespace aiml {
         unsigned int m_uSize;
     };
 
+    // Share of a soft category's confidence kept per turn without reuse.
+    static const double LEARNED_DECAY_PER_TURN = 0.9801;
+    // Confidence below which a soft category is pruned.
+    static const double LEARNED_PRUNE_CONFIDENCE = 0.02;
+
     /**
      * LearnableCategoryList — a mutable extension of CategoryList for
      * dynamically synthesised (soft) categories.
@@ -40,33 +49,74 @@ namespace aiml {
      * Soft categories have TruthValue(strength=0.5, confidence=0.1, immutable=false).
      * They are kept separate from the statically loaded AIML files and can be:
      *   - reinforced when they are reused,
-     *   - decayed each conversation turn,
+     *   - decayed each conversation turn (lazily: tick() advances the
+     *     list's DecayClock, and each category applies the decay when read),
      *   - consolidated (exported to AIML XML) when confidence > threshold,
      *   - pruned when confidence falls below a minimum.
+     *
+     * There is one soft category per generalised pattern: they are indexed
+     * by the canonical pattern (lower case, single spaces), and a response
+     * synthesised for a pattern that already has one is kept as another
+     * alternative of that category rather than as a duplicate.  The
+     * categories come from a slab pool (object_pool.h).
      */
     class LearnableCategoryList : public CategoryList {
     public:
-        LearnableCategoryList();
+        explicit LearnableCategoryList(double decayPerTurn = LEARNED_DECAY_PER_TURN);
         ~LearnableCategoryList();
 
-        // Synthesise a new soft category from a raw input string and response.
+        // Synthesise a soft category from a raw input string and response.
         // The pattern is a generalised form (low-frequency words replaced by *).
-        // Returns the new category, which is owned by this list.
-        Category* synthesize(const string& input, const string& response);
+        // If that pattern already has a category, response becomes one of its
+        // alternatives and that category is returned; *created (if given)
+        // says which.  The category is owned by this list.
+        Category* synthesize(const string& input, const string& response,
+                             bool* created = nullptr);
+
+        // The soft category for patternStr (compared case-insensitively with
+        // whitespace collapsed), or nullptr.
+        Category* find(const string& patternStr) const;
 
-        // Reinforce the first soft category whose pattern string equals patternStr.
+        // Reinforce the soft category whose pattern equals patternStr.
         void reinforce(const string& patternStr, double amount = 0.05);
 
-        // Decay the confidence of every soft category by factor.
-        void decayAll(double factor = 0.99);
+        // Every response synthesised for cat's pattern, first one first (the
+        // category's own template).  Empty for a category not in this list.
+        vector<string> alternatives(const Category* cat) const;
+
+        // One conversation turn: every soft category decays by the factor
+        // given at construction.  O(1).
+        void tick() { m_clock.tick(); }
+
+        // True when some category has confidence < minConfidence, i.e.
+        // prune() would remove something.
+        bool anyBelow(double minConfidence) const;
 
         // Return categories whose confidence >= threshold (for consolidation).
         vector<Category*> consolidate(double threshold = 0.7) const;
 
-        // Remove categories with confidence < minConfidence.
-        void prune(double minConfidence = 0.02);
+        // Remove categories with confidence < minConfidence.  onRemove, if
+        // given, sees them before they are freed, so references held
+        // elsewhere (PatternLattice) can be dropped first.  Returns how many
+        // were removed.
+        size_t prune(double minConfidence = LEARNED_PRUNE_CONFIDENCE,
+                     const function<void(const unordered_set<Category*>&)>& onRemove = nullptr);
+
+        // Slots in the category pool (live categories are size()).
+        size_t poolCapacity() const { return m_pool.capacity(); }
 
     private:
+        struct Entry {
+            Category*      category;
+            vector<string> responses;   // alternatives, first is the template
+        };
+
+        DecayClock                        m_clock;
+        object_pool::ObjectPool<Category> m_pool;
+        unordered_map<string, Entry>      m_index;   // canonical pattern -> entry
+
+        static string canonicalPattern(const string& pattern);
+
         // Generalise input into a pattern by replacing non-keyword tokens with *.
         string generaliseInput(const string& input) const;
 
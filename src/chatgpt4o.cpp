@@ -1,19 +1,85 @@
 #include "chatgpt4o.h"
+#include "worker_pool.h"
+#include "json.h"
 #include <iostream>
-#include <sstream>
-#include <regex>
 #include <cstring>
 #include <algorithm>
 #include <fstream>
+#include <thread>
 
 using namespace chatgpt4o;
 
+// LlmRequest implementation
+bool LlmRequest::ready() const {
+    return m_future.valid() &&
+           m_future.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+bool LlmRequest::waitUntil(chrono::steady_clock::time_point deadline) const {
+    return m_future.valid() && m_future.wait_until(deadline) == future_status::ready;
+}
+
+string LlmRequest::get() {
+    if (!m_future.valid()) return "";
+    try {
+        string reply = m_future.get();
+        return m_cancel && m_cancel->cancelled() ? "" : reply;
+    } catch (const exception& e) {
+        cerr << "[ChatGPT-4o] Async request failed: " << e.what() << endl;
+        return "";
+    }
+}
+
+string LlmRequest::get(const TokenSink& onToken) {
+    if (!onToken || !m_progress) return get();
+
+    // Hand on the text as it arrives, until the request is done.
+    size_t sent = 0;
+    bool forwarding = true;
+    unique_lock<mutex> lock(m_progress->lock);
+    for (;;) {
+        m_progress->changed.wait(lock, [&]() {
+            return m_progress->text.size() > sent || m_progress->done;
+        });
+        if (m_progress->text.size() == sent) break;
+        string delta = m_progress->text.substr(sent);
+        sent = m_progress->text.size();
+        lock.unlock();
+        if (forwarding && !onToken(delta)) {
+            forwarding = false;
+            cancel();
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    return get();
+}
+
+void LlmRequest::cancel() {
+    if (m_cancel) m_cancel->cancel();
+}
+
 // ChatGPT4oIntegration implementation
 ChatGPT4oIntegration::ChatGPT4oIntegration() 
-    : m_model("gpt-4o-latest"), m_temperature(0.7), m_maxTokens(1000) {
+    : m_model("gpt-4o-latest"), m_temperature(0.7), m_maxTokens(1000),
+      m_endpoint(OPENAI_CHAT_COMPLETIONS_URL), m_bSimulate(false), m_mockLatencyMs(0),
+      m_pHttp(new http_client::HttpClient()),
+      m_pAdmission(new admission_control::AdmissionController()),
+      m_asyncSubmitted(0), m_asyncCompleted(0), m_asyncCancelled(0),
+      m_streams(0), m_firstTokenMsTotal(0.0), m_firstTokenMsMax(0.0), m_streamMsTotal(0.0) {
+    // Canned replies instead of network requests, with an optional
+    // simulated round trip for exercising the async path offline.
+    const char* simulateEnv = getenv("CHATGPT4O_SIMULATE");
+    if (simulateEnv)
+        m_bSimulate = atoi(simulateEnv) != 0;
+    const char* latencyEnv = getenv("CHATGPT4O_MOCK_LATENCY_MS");
+    if (latencyEnv)
+        m_mockLatencyMs = max(0, atoi(latencyEnv));
 }
 
 ChatGPT4oIntegration::~ChatGPT4oIntegration() {
+    if (!m_cachePath.empty() && m_cache.unsaved() > 0)
+        m_cache.save(m_cachePath);
 }
 
 void ChatGPT4oIntegration::setApiKey(const string& apiKey) {
@@ -32,20 +98,129 @@ void ChatGPT4oIntegration::setMaxTokens(int maxTokens) {
     m_maxTokens = maxTokens;
 }
 
+void ChatGPT4oIntegration::setEndpoint(const string& url) {
+    m_endpoint = url;
+}
+
+void ChatGPT4oIntegration::setTimeouts(int connectTimeoutMs, int requestTimeoutMs) {
+    if (connectTimeoutMs > 0) m_httpConfig.connectTimeoutMs = connectTimeoutMs;
+    if (requestTimeoutMs > 0) m_httpConfig.requestTimeoutMs = requestTimeoutMs;
+    m_pHttp.reset(new http_client::HttpClient(m_httpConfig, m_transport));
+}
+
+void ChatGPT4oIntegration::setTransport(shared_ptr<http_client::Transport> transport) {
+    m_transport = transport;
+    m_pHttp.reset(new http_client::HttpClient(m_httpConfig, m_transport));
+}
+
+void ChatGPT4oIntegration::configureCache(size_t capacity, int ttlSeconds, const string& path) {
+    m_cache.configure(capacity, ttlSeconds);
+    m_cachePath = capacity > 0 ? path : string();
+    if (!m_cachePath.empty())
+        m_cache.load(m_cachePath);
+}
+
+bool ChatGPT4oIntegration::saveCache() {
+    return !m_cachePath.empty() && m_cache.save(m_cachePath);
+}
+
+llm_cache::LlmCacheStats ChatGPT4oIntegration::getCacheStats() const {
+    return m_cache.getStats();
+}
+
+void ChatGPT4oIntegration::cacheReply(const string& scope, const string& input, const string& reply,
+                                      chrono::steady_clock::time_point started) {
+    if (reply.empty()) return;
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+    m_cache.insert(scope, input, reply, ms);
+    if (!m_cachePath.empty() && m_cache.unsaved() >= LLM_CACHE_SAVE_EVERY)
+        m_cache.save(m_cachePath);
+}
+
+void ChatGPT4oIntegration::setAdmission(const admission_control::AdmissionConfig& config) {
+    m_pAdmission.reset(new admission_control::AdmissionController(config));
+}
+
+admission_control::AdmissionStats ChatGPT4oIntegration::getAdmissionStats() const {
+    return m_pAdmission->getStats();
+}
+
+string ChatGPT4oIntegration::admitted(const string& scope, const string& systemPrompt,
+                                      const vector<string>& conversationHistory,
+                                      const string& input,
+                                      const cancel_token::CancelToken* cancel,
+                                      const function<string()>& send) {
+    // Coalesce only byte-identical requests: every part of the payload,
+    // each behind its length so parts cannot run into one another.
+    uint64_t flightKey = 1469598103934665603ULL;
+    auto add = [&flightKey](const string& part) {
+        flightKey = llm_cache::fnv1a(part, llm_cache::fnv1a(to_string(part.size()) + ":",
+                                                            flightKey));
+    };
+    add(scope);
+    add(systemPrompt);
+    for (const string& h : conversationHistory)
+        add(h);
+    add(input);
+    if (flightKey == 0) flightKey = 1;     // 0: never coalesce
+    string reply = m_pAdmission->run(flightKey, cancel, send);
+    const string& refused = admission_control::AdmissionController::rejected();
+    if (reply.empty() && !refused.empty())
+        setLastError("GPT-4o request refused: " + refused);
+    return reply;
+}
+
 bool ChatGPT4oIntegration::isConfigured() const {
-    return !m_apiKey.empty();
+    return m_bSimulate || !m_apiKey.empty();
 }
 
 string ChatGPT4oIntegration::getLastError() const {
+    lock_guard<mutex> lock(m_errorMutex);
     return m_lastError;
 }
 
+void ChatGPT4oIntegration::setLastError(const string& error) {
+    lock_guard<mutex> lock(m_errorMutex);
+    m_lastError = error;
+}
+
 void ChatGPT4oIntegration::printConfiguration() const {
     cout << "\n=== ChatGPT-4o Configuration ===" << endl;
     cout << "Model: " << m_model << endl;
     cout << "Temperature: " << m_temperature << endl;
     cout << "Max Tokens: " << m_maxTokens << endl;
     cout << "API Key: " << (m_apiKey.empty() ? "Not set" : "Configured") << endl;
+    cout << "Endpoint: " << (m_bSimulate ? "simulated" : m_endpoint) << endl;
+    if (!m_bSimulate) {
+        auto hs = m_pHttp->getStats();
+        cout << "HTTP: " << hs.requests << " requests, " << hs.failures << " failed, "
+             << hs.connectionsOpened << " connections opened, " << hs.connectionsReused
+             << " reused, " << hs.idle << " idle" << endl;
+    }
+    auto as = m_pAdmission->getStats();
+    static const char* const breakerNames[] = {"closed", "open", "half-open"};
+    cout << "Admission: " << as.admitted << " sent, " << as.coalesced << " coalesced, "
+         << as.rateLimited << " rate-limited, " << as.queueTimeouts << " queue timeouts, "
+         << as.breakerRejected << " refused by breaker, " << as.failures << " failed, "
+         << as.inFlight << " in flight" << endl;
+    cout << "Circuit breaker: " << breakerNames[as.breaker] << " (" << as.breakerTrips
+         << " trips)" << endl;
+    auto ss = getStreamStats();
+    if (ss.streams > 0)
+        cout << "Streaming: " << ss.streams << " replies, first token avg "
+             << (long)ss.firstTokenMsAvg << " ms (max " << (long)ss.firstTokenMsMax
+             << " ms), total avg " << (long)ss.totalMsAvg << " ms" << endl;
+    auto cs = m_cache.getStats();
+    if (m_cache.enabled()) {
+        cout << "Reply cache: " << cs.entries << " entries, " << cs.hits << " hits ("
+             << cs.nearHits << " near-duplicate), " << cs.misses << " misses, "
+             << (int)(cs.hitRate() * 100.0 + 0.5) << "% hit rate, "
+             << (long)cs.msSaved << " ms saved" << endl;
+        if (!m_cachePath.empty())
+            cout << "Reply cache file: " << m_cachePath << endl;
+    } else {
+        cout << "Reply cache: disabled" << endl;
+    }
     cout << "==============================\n" << endl;
 }
 
@@ -55,40 +230,15 @@ string ChatGPT4oIntegration::generateResponse(const string& input) {
 
 string ChatGPT4oIntegration::generateContextualResponse(const string& input, const vector<string>& conversationHistory) {
     if (!isConfigured()) {
-        m_lastError = "API key not configured";
+        setLastError("API key not configured");
         return "";
     }
-    
+
     try {
-        // Build the request payload
-        string payload = buildOpenAIPayload(input, conversationHistory);
-        
-        // Prepare headers
-        stringstream headerStream;
-        headerStream << "Content-Type: application/json\r\n";
-        headerStream << "Authorization: Bearer " << m_apiKey << "\r\n";
-        headerStream << "Content-Length: " << payload.length() << "\r\n";
-        string headers = headerStream.str();
-        
-        // Make the API request
-        string url = "https://api.openai.com/v1/chat/completions";
-        string response = makeHttpRequest(url, headers, payload);
-        
-        if (response.empty()) {
-            m_lastError = "Failed to get response from OpenAI API";
-            return "";
-        }
-        
-        // Extract response from JSON
-        string result = extractResponseFromJson(response);
-        if (result.empty()) {
-            m_lastError = "Failed to parse response from OpenAI API";
-        }
-        
-        return result;
-        
+        return complete("contextual:" + m_model, DEFAULT_SYSTEM_PROMPT, conversationHistory,
+                        input, nullptr, nullptr, nullptr);
     } catch (const exception& e) {
-        m_lastError = "Exception in generateContextualResponse: " + string(e.what());
+        setLastError("Exception in generateContextualResponse: " + string(e.what()));
         return "";
     }
 }
@@ -96,171 +246,376 @@ string ChatGPT4oIntegration::generateContextualResponse(const string& input, con
 string ChatGPT4oIntegration::generateConstrainedResponse(
     const string& input,
     const vector<string>& conversationHistory,
-    const string& systemConstraintPrompt)
+    const string& systemConstraintPrompt,
+    const cancel_token::CancelToken* cancel)
 {
     if (!isConfigured()) {
-        m_lastError = "API key not configured";
+        setLastError("API key not configured");
         return "";
     }
 
     try {
-        // Build payload with the constraint-aware system prompt.
-        stringstream payload;
-        payload << "{";
-        payload << "\"model\":\"" << m_model << "\",";
-        payload << "\"temperature\":" << m_temperature << ",";
-        payload << "\"max_tokens\":" << m_maxTokens << ",";
-        payload << "\"messages\":[";
-
-        // Use the injected system prompt instead of the default one.
-        string sysMsg = systemConstraintPrompt.empty()
-            ? "You are a helpful AI assistant integrated into an AIML chatbot."
-            : systemConstraintPrompt;
-        payload << "{\"role\":\"system\",\"content\":\""
-                << escapeJsonString(sysMsg) << "\"},";
-
-        // Add conversation history.
-        for (size_t i = 0; i < conversationHistory.size() && i < 10; i += 2) {
-            if (i + 1 < conversationHistory.size()) {
-                payload << "{\"role\":\"user\",\"content\":\""
-                        << escapeJsonString(conversationHistory[i]) << "\"},";
-                payload << "{\"role\":\"assistant\",\"content\":\""
-                        << escapeJsonString(conversationHistory[i + 1]) << "\"},";
-            }
-        }
-
-        payload << "{\"role\":\"user\",\"content\":\""
-                << escapeJsonString(input) << "\"}";
-        payload << "]}";
-
-        stringstream headerStream;
-        headerStream << "Content-Type: application/json\r\n";
-        headerStream << "Authorization: Bearer " << m_apiKey << "\r\n";
-        headerStream << "Content-Length: " << payload.str().length() << "\r\n";
+        return complete("constrained:" + m_model,
+                        systemConstraintPrompt.empty() ? CONSTRAINED_SYSTEM_PROMPT
+                                                       : systemConstraintPrompt,
+                        conversationHistory, input, cancel, nullptr, nullptr);
+    } catch (const exception& e) {
+        setLastError("Exception in generateConstrainedResponse: " +
+                     string(e.what()));
+        return "";
+    }
+}
 
-        string url = "https://api.openai.com/v1/chat/completions";
-        string response = makeHttpRequest(url, headerStream.str(), payload.str());
+string ChatGPT4oIntegration::streamContextualResponse(const string& input,
+                                                      const vector<string>& conversationHistory,
+                                                      const TokenSink& onToken,
+                                                      StreamTiming* timing) {
+    if (!isConfigured()) {
+        setLastError("API key not configured");
+        return "";
+    }
 
-        if (response.empty()) {
-            m_lastError = "Failed to get response from OpenAI API (constrained)";
-            return "";
-        }
+    try {
+        return complete("contextual:" + m_model, DEFAULT_SYSTEM_PROMPT, conversationHistory,
+                        input, nullptr, &onToken, timing);
+    } catch (const exception& e) {
+        setLastError("Exception in streamContextualResponse: " + string(e.what()));
+        return "";
+    }
+}
 
-        return extractResponseFromJson(response);
+string ChatGPT4oIntegration::streamConstrainedResponse(
+    const string& input,
+    const vector<string>& conversationHistory,
+    const string& systemConstraintPrompt,
+    const TokenSink& onToken,
+    const cancel_token::CancelToken* cancel,
+    StreamTiming* timing)
+{
+    if (!isConfigured()) {
+        setLastError("API key not configured");
+        return "";
+    }
 
+    try {
+        return complete("constrained:" + m_model,
+                        systemConstraintPrompt.empty() ? CONSTRAINED_SYSTEM_PROMPT
+                                                       : systemConstraintPrompt,
+                        conversationHistory, input, cancel, &onToken, timing);
     } catch (const exception& e) {
-        m_lastError = "Exception in generateConstrainedResponse: " +
-                      string(e.what());
+        setLastError("Exception in streamConstrainedResponse: " + string(e.what()));
         return "";
     }
 }
 
-string ChatGPT4oIntegration::buildOpenAIPayload(const string& input, const vector<string>& conversationHistory) {
-    stringstream payload;
-    payload << "{";
-    payload << "\"model\":\"" << m_model << "\",";
-    payload << "\"temperature\":" << m_temperature << ",";
-    payload << "\"max_tokens\":" << m_maxTokens << ",";
-    payload << "\"messages\":[";
-    
-    // Add system message
-    payload << "{\"role\":\"system\",\"content\":\"You are a helpful AI assistant integrated into an AIML chatbot. Provide clear, helpful responses.\"},";
-    
-    // Add conversation history
-    for (size_t i = 0; i < conversationHistory.size() && i < 10; i += 2) {
-        if (i + 1 < conversationHistory.size()) {
-            payload << "{\"role\":\"user\",\"content\":\"" << escapeJsonString(conversationHistory[i]) << "\"},";
-            payload << "{\"role\":\"assistant\",\"content\":\"" << escapeJsonString(conversationHistory[i + 1]) << "\"},";
-        }
+string ChatGPT4oIntegration::complete(const string& scope, const string& systemPrompt,
+                                      const vector<string>& conversationHistory,
+                                      const string& input,
+                                      const cancel_token::CancelToken* cancel,
+                                      const TokenSink* onToken, StreamTiming* timing) {
+    auto called = chrono::steady_clock::now();
+    auto msSince = [](chrono::steady_clock::time_point t) {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - t).count();
+    };
+    StreamTiming local;
+    StreamTiming& st = timing ? *timing : local;
+    st.firstTokenMs = -1.0;
+    st.totalMs      = 0.0;
+    st.pieces       = 0;
+
+    // Counts what is handed on, and when the first of it arrived.
+    TokenSink forward;
+    if (onToken)
+        forward = [&](const string& delta) -> bool {
+            if (st.pieces++ == 0)
+                st.firstTokenMs = msSince(called);
+            return (*onToken)(delta);
+        };
+
+    // A cached reply is only reused under the same system prompt and
+    // recent history, and never when the user has just seen it.
+    const string cacheScope = llm_cache::conversationScope(scope, systemPrompt,
+                                                           conversationHistory);
+    string reply;
+    if (!m_cache.lookup(cacheScope, input, reply, conversationHistory)) {
+        reply = admitted(scope, systemPrompt, conversationHistory, input, cancel,
+                         [&]() -> string {
+            auto started = chrono::steady_clock::now();
+
+            // Build the request payload in this thread's reusable buffer
+            static thread_local string payload;
+            buildOpenAIPayload(systemPrompt, conversationHistory, input, (bool)onToken, payload);
+
+            string result;
+            if (onToken) {
+                result = makeStreamingRequest(m_endpoint, requestHeaders(), payload, forward,
+                                              cancel);
+            } else {
+                string response = makeHttpRequest(m_endpoint, requestHeaders(), payload, cancel);
+                if (cancel_token::isCancelled(cancel) || response.empty())
+                    return "";
+                result = extractResponseFromJson(response);
+                if (result.empty())
+                    setLastError("Failed to parse response from OpenAI API");
+            }
+            if (cancel_token::isCancelled(cancel))
+                return "";
+            cacheReply(cacheScope, input, result, started);
+            return result;
+        });
     }
-    
-    // Add current input
-    payload << "{\"role\":\"user\",\"content\":\"" << escapeJsonString(input) << "\"}";
-    
-    payload << "]}";
-    
-    return payload.str();
-}
-
-string ChatGPT4oIntegration::escapeJsonString(const string& input) {
-    string escaped;
-    for (char c : input) {
-        switch (c) {
-            case '"': escaped += "\\\""; break;
-            case '\\': escaped += "\\\\"; break;
-            case '\b': escaped += "\\b"; break;
-            case '\f': escaped += "\\f"; break;
-            case '\n': escaped += "\\n"; break;
-            case '\r': escaped += "\\r"; break;
-            case '\t': escaped += "\\t"; break;
-            default: escaped += c; break;
-        }
+    if (!onToken)
+        return reply;
+
+    // From the cache, or another caller's request: nothing has been
+    // handed on yet.
+    bool streamed = st.pieces > 0;
+    if (!streamed && !reply.empty() && !cancel_token::isCancelled(cancel))
+        forward(reply);
+    st.totalMs = msSince(called);
+
+    if (streamed && !reply.empty()) {
+        lock_guard<mutex> lock(m_streamMutex);
+        m_streams++;
+        m_firstTokenMsTotal += st.firstTokenMs;
+        m_firstTokenMsMax    = max(m_firstTokenMsMax, st.firstTokenMs);
+        m_streamMsTotal     += st.totalMs;
     }
-    return escaped;
+    return reply;
 }
 
-string ChatGPT4oIntegration::extractResponseFromJson(const string& jsonResponse) {
-    // Simple JSON parsing to extract the assistant's response
-    // Look for: "choices":[{"message":{"content":"..."}}]
-    
-    size_t choicesPos = jsonResponse.find("\"choices\":");
-    if (choicesPos == string::npos) return "";
-    
-    size_t contentPos = jsonResponse.find("\"content\":", choicesPos);
-    if (contentPos == string::npos) return "";
-    
-    size_t startQuote = jsonResponse.find("\"", contentPos + 10);
-    if (startQuote == string::npos) return "";
-    
-    size_t endQuote = startQuote + 1;
-    int escapeCount = 0;
-    while (endQuote < jsonResponse.length()) {
-        if (jsonResponse[endQuote] == '\\') {
-            escapeCount++;
-        } else if (jsonResponse[endQuote] == '"' && escapeCount % 2 == 0) {
-            break;
-        } else {
-            escapeCount = 0;
-        }
-        endQuote++;
+LlmRequest ChatGPT4oIntegration::submitConstrained(
+    const string& input,
+    const vector<string>& conversationHistory,
+    const string& systemConstraintPrompt)
+{
+    LlmRequest request;
+    request.m_cancel = make_shared<cancel_token::CancelToken>();
+    request.m_progress = make_shared<LlmRequest::Progress>();
+    auto cancel = request.m_cancel;
+    auto progress = request.m_progress;
+
+    lock_guard<mutex> lock(m_asyncMutex);
+    if (!m_pAsyncPool)
+        m_pAsyncPool.reset(new worker_pool::WorkerPool(LLM_ASYNC_THREADS));
+    m_asyncSubmitted++;
+    request.m_future = m_pAsyncPool->submit(
+        [this, input, conversationHistory, systemConstraintPrompt, cancel, progress]() {
+            // Wakes LlmRequest::get(onToken) however the request ends.
+            struct Finish {
+                LlmRequest::Progress& p;
+                ~Finish() {
+                    { lock_guard<mutex> lock(p.lock); p.done = true; }
+                    p.changed.notify_all();
+                }
+            } finish = {*progress};
+
+            if (cancel->cancelled()) {
+                m_asyncCancelled++;
+                return string();
+            }
+            string reply = streamConstrainedResponse(
+                input, conversationHistory, systemConstraintPrompt,
+                [progress](const string& delta) {
+                    { lock_guard<mutex> lock(progress->lock); progress->text += delta; }
+                    progress->changed.notify_all();
+                    return true;
+                },
+                cancel.get());
+            if (cancel->cancelled())
+                m_asyncCancelled++;
+            else if (!reply.empty())
+                m_asyncCompleted++;
+            return reply;
+        });
+    return request;
+}
+
+void ChatGPT4oIntegration::stopAsync() {
+    lock_guard<mutex> lock(m_asyncMutex);
+    m_pAsyncPool.reset();
+    m_pHttp->closeIdle();
+}
+
+LlmAsyncStats ChatGPT4oIntegration::getAsyncStats() const {
+    LlmAsyncStats st;
+    st.submitted = m_asyncSubmitted.load();
+    st.completed = m_asyncCompleted.load();
+    st.cancelled = m_asyncCancelled.load();
+    return st;
+}
+
+LlmStreamStats ChatGPT4oIntegration::getStreamStats() const {
+    lock_guard<mutex> lock(m_streamMutex);
+    LlmStreamStats st;
+    st.streams         = m_streams;
+    st.firstTokenMsAvg = m_streams ? m_firstTokenMsTotal / m_streams : 0.0;
+    st.firstTokenMsMax = m_firstTokenMsMax;
+    st.totalMsAvg      = m_streams ? m_streamMsTotal / m_streams : 0.0;
+    return st;
+}
+
+string ChatGPT4oIntegration::requestHeaders() const {
+    return "Content-Type: application/json\r\nAuthorization: Bearer " + m_apiKey + "\r\n";
+}
+
+void ChatGPT4oIntegration::buildOpenAIPayload(const string& systemPrompt,
+                                              const vector<string>& conversationHistory,
+                                              const string& input, bool stream,
+                                              string& payload) const {
+    payload.clear();
+    json::Writer w(payload);
+    w.beginObject()
+        .key("model").str(m_model)
+        .key("temperature").number(m_temperature)
+        .key("max_tokens").integer(m_maxTokens);
+    if (stream)
+        w.key("stream").boolean(true);
+    w.key("messages").beginArray();
+
+    w.beginObject().key("role").str("system").key("content").str(systemPrompt).endObject();
+
+    // Up to five earlier exchanges.
+    for (size_t i = 0; i + 1 < conversationHistory.size() && i < 10; i += 2) {
+        w.beginObject().key("role").str("user")
+            .key("content").str(conversationHistory[i]).endObject();
+        w.beginObject().key("role").str("assistant")
+            .key("content").str(conversationHistory[i + 1]).endObject();
     }
-    
-    if (endQuote >= jsonResponse.length()) return "";
-    
-    string content = jsonResponse.substr(startQuote + 1, endQuote - startQuote - 1);
-    
-    // Unescape basic JSON escapes
-    size_t pos = 0;
-    while ((pos = content.find("\\\"", pos)) != string::npos) {
-        content.replace(pos, 2, "\"");
-        pos += 1;
+
+    w.beginObject().key("role").str("user").key("content").str(input).endObject();
+    w.endArray().endObject();
+}
+
+string ChatGPT4oIntegration::extractResponseFromJson(const string& jsonResponse) {
+    // choices[0].message.content, read without building a DOM.
+    string content;
+    json::getString(jsonResponse, "choices.0.message.content", content);
+    return content;
+}
+
+string ChatGPT4oIntegration::makeHttpRequest(const string& url, const string& headers, const string& payload,
+                                             const cancel_token::CancelToken* cancel) {
+    if (!m_bSimulate) {
+        http_client::HttpResponse reply = m_pHttp->post(url, headers, payload, cancel);
+        if (reply.success)
+            return reply.body;
+        reportHttpFailure(reply);
+        return "";
     }
-    pos = 0;
-    while ((pos = content.find("\\n", pos)) != string::npos) {
-        content.replace(pos, 2, "\n");
-        pos += 1;
+
+    // Simulated response (CHATGPT4O_SIMULATE)
+    string content;
+    if (!simulateReply(url, payload, cancel, content))
+        return "";
+    return "{\"choices\":[{\"message\":{\"content\":" + json::quote(content) + "}}]}";
+}
+
+string ChatGPT4oIntegration::makeStreamingRequest(const string& url, const string& headers,
+                                                  const string& payload, const TokenSink& onDelta,
+                                                  const cancel_token::CancelToken* cancel) {
+    string reply;
+    string body;              // until the first event, in case the reply is not a stream
+    bool events  = false;
+    bool done    = false;     // the closing [DONE] arrived
+    bool stopped = false;     // onDelta wanted no more
+    bool failed  = false;     // an error event
+    http_client::SseDecoder sse([&](const string&, const string& data) -> bool {
+        events = true;
+        body.clear();
+        if (data == "[DONE]") {
+            done = true;
+            return true;
+        }
+        string text;
+        if (json::getString(data, "choices.0.delta.content", text)) {
+            if (text.empty()) return true;
+            reply += text;
+            if (!onDelta(text)) {
+                stopped = true;
+                return false;
+            }
+        } else if (json::getString(data, "error.message", text)) {
+            setLastError("OpenAI API stream error: " + text);
+            failed = true;
+        }
+        return true;
+    });
+    http_client::BodySink sink = [&](const char* data, size_t size) -> bool {
+        if (!events) body.append(data, size);
+        return sse.feed(data, size);
+    };
+
+    if (!m_bSimulate) {
+        http_client::HttpResponse response = m_pHttp->postStreaming(url, headers, payload, sink,
+                                                                    cancel);
+        if (!response.success && !stopped) {
+            reportHttpFailure(response);
+            return "";
+        }
+    } else {
+        // The canned reply as server-sent events, a word at a time.
+        string content;
+        if (!simulateReply(url, payload, cancel, content))
+            return "";
+        string event;
+        for (size_t pos = 0; pos < content.size() && !stopped; ) {
+            size_t end = content.find(' ', pos);
+            end = end == string::npos ? content.size() : end + 1;
+            event = "data: {\"choices\":[{\"delta\":{\"content\":" +
+                    json::quote(content.substr(pos, end - pos)) + "}}]}\n\n";
+            sink(event.data(), event.size());
+            pos = end;
+            this_thread::sleep_for(chrono::milliseconds(SIMULATED_TOKEN_MS));
+            if (cancel_token::isCancelled(cancel))
+                return "";
+        }
+        event = "data: [DONE]\n\n";
+        sink(event.data(), event.size());
     }
-    pos = 0;
-    while ((pos = content.find("\\t", pos)) != string::npos) {
-        content.replace(pos, 2, "\t");
-        pos += 1;
+
+    if (stopped || failed || cancel_token::isCancelled(cancel))
+        return "";
+    // A stream read to close that was cut off is only told apart from a
+    // finished one by the missing [DONE].
+    if (events && !done) {
+        setLastError("OpenAI API stream ended before [DONE]");
+        return "";
     }
-    pos = 0;
-    while ((pos = content.find("\\\\", pos)) != string::npos) {
-        content.replace(pos, 2, "\\");
-        pos += 1;
+    // An endpoint that ignores "stream" answers with a plain completion.
+    if (!events) {
+        reply = extractResponseFromJson(body);
+        if (!reply.empty() && !onDelta(reply))
+            return "";
     }
-    
-    return content;
+    if (reply.empty())
+        setLastError("Failed to parse streamed response from OpenAI API");
+    return reply;
 }
 
-string ChatGPT4oIntegration::makeHttpRequest(const string& url, const string& headers, const string& payload) {
-    // Simulated response for demonstration purposes
-    // In production, this would make an actual HTTPS request to OpenAI API
-    
+void ChatGPT4oIntegration::reportHttpFailure(const http_client::HttpResponse& reply) {
+    // A status with an error is a response that broke off (e.g. a stream
+    // cut mid-reply); the error says why.
+    if (reply.statusCode != 0 && reply.error.empty())
+        setLastError("OpenAI API returned HTTP " + to_string(reply.statusCode) + ": " +
+                     reply.body.substr(0, 200));
+    else
+        setLastError("Failed to get response from OpenAI API: " + reply.error);
+}
+
+bool ChatGPT4oIntegration::simulateReply(const string& url, const string& payload,
+                                         const cancel_token::CancelToken* cancel, string& reply) {
     cout << "\n[ChatGPT-4o Simulation] Making API request..." << endl;
     cout << "URL: " << url << endl;
     cout << "Payload preview: " << payload.substr(0, 100) << "..." << endl;
+
+    // Simulated round trip, abandoned as soon as the request is cancelled.
+    auto replyAt = chrono::steady_clock::now() + chrono::milliseconds(m_mockLatencyMs);
+    while (chrono::steady_clock::now() < replyAt) {
+        if (cancel_token::isCancelled(cancel))
+            return false;
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
     
     // Check if we have mock responses file
     ifstream mockFile("database/chatgpt4o_mock_responses.txt");
@@ -270,7 +625,8 @@ string ChatGPT4oIntegration::makeHttpRequest(const string& url, const string& he
             if (!line.empty()) {
                 // Return first non-empty line as mock response
                 mockFile.close();
-                return "{\"choices\":[{\"message\":{\"content\":\"" + line + "\"}}]}";
+                reply = line;
+                return true;
             }
         }
         mockFile.close();
@@ -280,57 +636,16 @@ string ChatGPT4oIntegration::makeHttpRequest(const string& url, const string& he
     string lowerPayload = payload;
     transform(lowerPayload.begin(), lowerPayload.end(), lowerPayload.begin(), ::tolower);
     
-    string mockResponse;
     if (lowerPayload.find("hello") != string::npos || lowerPayload.find("hi") != string::npos) {
-        mockResponse = "Hello! I'm ChatGPT-4o integrated into this AIML chatbot. How can I help you today?";
+        reply = "Hello! I'm ChatGPT-4o integrated into this AIML chatbot. How can I help you today?";
     } else if (lowerPayload.find("weather") != string::npos) {
-        mockResponse = "I'm sorry, I don't have access to real-time weather data. You might want to check a weather website or app for current conditions.";
+        reply = "I'm sorry, I don't have access to real-time weather data. You might want to check a weather website or app for current conditions.";
     } else if (lowerPayload.find("what") != string::npos && lowerPayload.find("you") != string::npos) {
-        mockResponse = "I'm ChatGPT-4o-latest, an advanced AI language model integrated into this AIML chatbot to provide enhanced responses when traditional patterns don't suffice.";
+        reply = "I'm ChatGPT-4o-latest, an advanced AI language model integrated into this AIML chatbot to provide enhanced responses when traditional patterns don't suffice.";
     } else if (lowerPayload.find("help") != string::npos) {
-        mockResponse = "I can help you with a wide variety of topics including answering questions, having conversations, providing explanations, and more. What would you like to know?";
+        reply = "I can help you with a wide variety of topics including answering questions, having conversations, providing explanations, and more. What would you like to know?";
     } else {
-        mockResponse = "I understand you're asking about something, but I'd need more context to provide a helpful response. Could you please elaborate on your question?";
-    }
-    
-    // Return mock JSON response
-    return "{\"choices\":[{\"message\":{\"content\":\"" + escapeJsonString(mockResponse) + "\"}}]}";
-}
-
-// SimpleHttpClient implementation (simplified for demo)
-SimpleHttpClient::HttpResponse SimpleHttpClient::post(const string& url, const string& headers, const string& body) {
-    HttpResponse response;
-    response.success = false;
-    response.statusCode = 0;
-    
-    // This would need proper HTTPS implementation with SSL/TLS
-    // For now, we'll return a failure response
-    response.body = "HTTPS client implementation required";
-    
-    return response;
-}
-
-string SimpleHttpClient::parseHostFromUrl(const string& url) {
-    regex urlRegex(R"(https?://([^/]+))");
-    smatch match;
-    if (regex_search(url, match, urlRegex)) {
-        return match[1].str();
-    }
-    return "";
-}
-
-string SimpleHttpClient::parsePathFromUrl(const string& url) {
-    size_t pos = url.find('/', 8); // Skip "https://"
-    if (pos != string::npos) {
-        return url.substr(pos);
+        reply = "I understand you're asking about something, but I'd need more context to provide a helpful response. Could you please elaborate on your question?";
     }
-    return "/";
+    return true;
 }
-
-int SimpleHttpClient::parsePortFromUrl(const string& url) {
-    return isHttps(url) ? 443 : 80;
-}
-
-bool SimpleHttpClient::isHttps(const string& url) {
-    return url.substr(0, 5) == "https";
-}
\ No newline at end of file
@@ -1,14 +1,106 @@
 #ifndef __CHATGPT4O_H__
 #define __CHATGPT4O_H__
 
+#include "cancel_token.h"
+#include "http_client.h"
+#include "llm_cache.h"
+#include "admission_control.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
 
 using namespace std;
 
+namespace worker_pool {
+    class WorkerPool;
+}
+
 namespace chatgpt4o {
+
+    // Background threads for asynchronous requests (submitConstrained).
+    static const size_t LLM_ASYNC_THREADS = 4;
+
+    static const char* const OPENAI_CHAT_COMPLETIONS_URL = "https://api.openai.com/v1/chat/completions";
+
+    static const char* const DEFAULT_SYSTEM_PROMPT =
+        "You are a helpful AI assistant integrated into an AIML chatbot. Provide clear, helpful responses.";
+    static const char* const CONSTRAINED_SYSTEM_PROMPT =
+        "You are a helpful AI assistant integrated into an AIML chatbot.";
+
+    // Replies cached before the cache file is rewritten.
+    static const size_t LLM_CACHE_SAVE_EVERY = 8;
+
+    // CHATGPT4O_SIMULATE: pause between streamed words.
+    static const int SIMULATED_TOKEN_MS = 30;
+
+    // Receives reply text as it is generated; false stops the request.
+    typedef function<bool(const string& delta)> TokenSink;
+
+    // One streamed reply, measured from the call.
+    struct StreamTiming {
+        double firstTokenMs;   // until the first text arrived; -1 if none did
+        double totalMs;
+        size_t pieces;         // deltas delivered
+    };
+
+    struct LlmStreamStats {
+        size_t streams;          // streamed replies with text
+        double firstTokenMsAvg;
+        double firstTokenMsMax;
+        double totalMsAvg;
+    };
+
+    struct LlmAsyncStats {
+        size_t submitted;   // asynchronous requests started
+        size_t completed;   // finished with a reply
+        size_t cancelled;   // abandoned through LlmRequest::cancel()
+    };
+
+    /**
+     * LlmRequest - handle on a GPT-4o request running in the background.
+     * cancel() abandons it: the request stops at its next cancellation
+     * check and get() returns "".  Destroying a handle never blocks, so a
+     * caller can cancel and walk away.
+     */
+    class LlmRequest {
+    public:
+        LlmRequest() {}
+
+        bool valid() const { return m_future.valid(); }
+        bool ready() const;
+        // True once the reply is ready; false at the deadline.
+        bool waitUntil(chrono::steady_clock::time_point deadline) const;
+        // Blocks for the reply; "" when the request failed or was cancelled.
+        string get();
+        // The same, handing the text to onToken as it is generated: first
+        // what has arrived so far, then the rest as it streams in.
+        string get(const TokenSink& onToken);
+        void cancel();
+
+    private:
+        friend class ChatGPT4oIntegration;
+
+        // Text streamed so far by the background request.
+        struct Progress {
+            mutex              lock;
+            condition_variable changed;
+            string             text;
+            bool               done;
+            Progress() : done(false) {}
+        };
+
+        future<string>                        m_future;
+        shared_ptr<cancel_token::CancelToken> m_cancel;
+        shared_ptr<Progress>                  m_progress;
+    };
     
+
     /**
      * ChatGPT4oIntegration - Integration with OpenAI's ChatGPT-4o-latest model
      * This class provides access to the latest ChatGPT-4o model for enhanced responses
@@ -23,6 +115,22 @@ namespace chatgpt4o {
         void setModel(const string& model = "gpt-4o-latest");
         void setTemperature(double temperature = 0.7);
         void setMaxTokens(int maxTokens = 1000);
+        // Chat-completions URL (OPENAI_API_URL); http:// works for local
+        // mock servers.
+        void setEndpoint(const string& url);
+        void setTimeouts(int connectTimeoutMs, int requestTimeoutMs);
+        // Replace the byte transport, e.g. with an in-process fake.
+        void setTransport(shared_ptr<http_client::Transport> transport);
+        // Reply cache for near-duplicate inputs (capacity 0 disables it).
+        // With a path, entries are loaded from it now and written back
+        // every LLM_CACHE_SAVE_EVERY new replies and on destruction.
+        void configureCache(size_t capacity, int ttlSeconds, const string& path);
+        bool saveCache();
+        llm_cache::LlmCacheStats getCacheStats() const;
+        // Coalescing, rate limit, concurrency limit and circuit breaker
+        // for upstream requests.  Call before requests start.
+        void setAdmission(const admission_control::AdmissionConfig& config);
+        admission_control::AdmissionStats getAdmissionStats() const;
         
         // Core functionality
         string generateResponse(const string& input);
@@ -32,7 +140,36 @@ namespace chatgpt4o {
         // NSVD: constraint-guided generation with an injected system prompt.
         string generateConstrainedResponse(const string& input,
                                            const vector<string>& conversationHistory,
-                                           const string& systemConstraintPrompt);
+                                           const string& systemConstraintPrompt,
+                                           const cancel_token::CancelToken* cancel = nullptr);
+
+        // Streamed variants: the reply is requested with "stream": true and
+        // its text handed to onToken as the server-sent events arrive.  They
+        // return the whole reply like the calls above.  A reply from the
+        // cache, or shared with an identical request in flight, arrives as
+        // one piece.
+        string streamContextualResponse(const string& input,
+                                        const vector<string>& conversationHistory,
+                                        const TokenSink& onToken,
+                                        StreamTiming* timing = nullptr);
+        string streamConstrainedResponse(const string& input,
+                                         const vector<string>& conversationHistory,
+                                         const string& systemConstraintPrompt,
+                                         const TokenSink& onToken,
+                                         const cancel_token::CancelToken* cancel = nullptr,
+                                         StreamTiming* timing = nullptr);
+
+        // The same request started on a background thread; the arguments
+        // are copied.  Safe to call from concurrent turns.  The reply is
+        // streamed, so LlmRequest::get(onToken) can show it early.
+        LlmRequest submitConstrained(const string& input,
+                                     const vector<string>& conversationHistory,
+                                     const string& systemConstraintPrompt);
+        // Finish queued requests and stop the background threads (before
+        // fork()); the next submit starts them again.
+        void stopAsync();
+        LlmAsyncStats getAsyncStats() const;
+        LlmStreamStats getStreamStats() const;
         
         // Status and debugging
         bool isConfigured() const;
@@ -45,33 +182,70 @@ namespace chatgpt4o {
         double m_temperature;
         int m_maxTokens;
         string m_lastError;
-        
-        // HTTP client functionality
-        string makeHttpRequest(const string& url, const string& headers, const string& payload);
-        string buildOpenAIPayload(const string& input, const vector<string>& conversationHistory = vector<string>());
+        mutable mutex m_errorMutex;          // requests may run concurrently
+        string m_endpoint;
+        bool m_bSimulate;                    // CHATGPT4O_SIMULATE: canned replies, no network
+        int m_mockLatencyMs;                 // CHATGPT4O_MOCK_LATENCY_MS
+        http_client::HttpClientConfig         m_httpConfig;
+        shared_ptr<http_client::Transport>    m_transport;
+        unique_ptr<http_client::HttpClient>   m_pHttp;   // pooled keep-alive connections
+        llm_cache::LlmCache                   m_cache;
+        string                                m_cachePath;
+        unique_ptr<admission_control::AdmissionController> m_pAdmission;
+
+        unique_ptr<worker_pool::WorkerPool> m_pAsyncPool;
+        mutex          m_asyncMutex;
+        atomic<size_t> m_asyncSubmitted;
+        atomic<size_t> m_asyncCompleted;
+        atomic<size_t> m_asyncCancelled;
+
+        mutable mutex m_streamMutex;
+        size_t m_streams;
+        double m_firstTokenMsTotal;
+        double m_firstTokenMsMax;
+        double m_streamMsTotal;
+
+        void setLastError(const string& error);
+
+        // One chat completion through the reply cache and admission
+        // control, streamed to onToken when it is given.
+        string complete(const string& scope, const string& systemPrompt,
+                        const vector<string>& conversationHistory, const string& input,
+                        const cancel_token::CancelToken* cancel,
+                        const TokenSink* onToken, StreamTiming* timing);
+
+        // Send an upstream request through admission control; identical
+        // requests (same scope, system prompt, history and input) in
+        // flight share one.  "" with the last error set when it was refused.
+        string admitted(const string& scope, const string& systemPrompt,
+                        const vector<string>& conversationHistory, const string& input,
+                        const cancel_token::CancelToken* cancel,
+                        const function<string()>& send);
+
+        // After a paid request: remember the reply and persist now and then.
+        void cacheReply(const string& scope, const string& input, const string& reply,
+                        chrono::steady_clock::time_point started);
+
+        // POST to the endpoint (or simulate); the response body, or "" with
+        // the last error set.
+        string makeHttpRequest(const string& url, const string& headers, const string& payload,
+                               const cancel_token::CancelToken* cancel = nullptr);
+        // Streamed POST: each text delta goes to onDelta as it arrives.
+        // The whole reply, or "" with the last error set.
+        string makeStreamingRequest(const string& url, const string& headers,
+                                    const string& payload, const TokenSink& onDelta,
+                                    const cancel_token::CancelToken* cancel);
+        void reportHttpFailure(const http_client::HttpResponse& reply);
+        // CHATGPT4O_SIMULATE: canned reply text after the simulated round
+        // trip; false when cancelled meanwhile.
+        bool simulateReply(const string& url, const string& payload,
+                           const cancel_token::CancelToken* cancel, string& reply);
+        string requestHeaders() const;
+        // Chat-completions request body, written into payload (cleared
+        // first, so a buffer can be reused across requests).
+        void buildOpenAIPayload(const string& systemPrompt, const vector<string>& conversationHistory,
+                                const string& input, bool stream, string& payload) const;
         string extractResponseFromJson(const string& jsonResponse);
-        string escapeJsonString(const string& input);
-    };
-    
-    /**
-     * Simple HTTP client implementation without external dependencies
-     */
-    class SimpleHttpClient {
-    public:
-        struct HttpResponse {
-            int statusCode;
-            string headers;
-            string body;
-            bool success;
-        };
-        
-        static HttpResponse post(const string& url, const string& headers, const string& body);
-        
-    private:
-        static string parseHostFromUrl(const string& url);
-        static string parsePathFromUrl(const string& url);
-        static int parsePortFromUrl(const string& url);
-        static bool isHttps(const string& url);
     };
 }
 
@@ -19,6 +19,19 @@
 #include "logic_meta_patterns.h"
 #include "logic_classifier.h"
 #include "workflow_engine.h"
+#include "model_store.h"
+#include "replay_trainer.h"
+#include "path_gate.h"
+#include "worker_pool.h"
+#include "cancel_token.h"
+#include "session.h"
+#include "server.h"
+#include "batch.h"
+#include "prefork.h"
+#include "response_cache.h"
+#include "brain.h"
+#include "consolidation.h"
+#include "write_behind.h"
 #include <iostream>
 #include <sstream>
 #include <cstdlib>
@@ -29,6 +42,8 @@
 #include <vector>
 #include <future>
 #include <chrono>
+#include <functional>
+#include <thread>
 #include <sys/stat.h>
 #include <cerrno>
 #include <cstring>
@@ -127,53 +142,71 @@ string dataDir = "database/Alice/";
 string sUserPrompt = "USER> ";
 string sBotPrompt = "CHATMACHINE> ";
 
-CategoryList* cl;
-vector<CategoryList*> cls;
-
-map<string, string> mVars;
-
 string strategy = "alice";
 
+// Start the GPT-4o fallback speculatively when the symbolic path scored
+// below this on the session's previous turn (and no exact match answers).
+static const double LLM_SPECULATE_SCORE = 0.25;
+
 int main(int argc, char* argv[])
 {
     cout << "Chatmachine v2.1 with OpenCog + ChatGPT-4o Integration Copyright (C) 2017-2024 Simon Grandsire\n" << endl;
 
     Chatmachine cm("Chatmachine");
 
-    if (argc > 1) {
-        if (string(argv[1]) == "basic") {
+    // `serve` runs the multi-session server and `batch` replays a file;
+    // for both the bot mode comes from --mode.
+    string mode = argc > 1 ? string(argv[1]) : "";
+    bool serve = (mode == "serve");
+    bool batchMode = (mode == "batch");
+    server::ServerConfig serveConfig;
+    batch::BatchConfig batchConfig;
+    if (serve) {
+        mode = "nsvd-neural";
+        if (!server::parseServeArgs(argc, argv, 2, serveConfig, mode))
+            return 1;
+        cm.setConcurrentTurns(serveConfig.workers);
+    } else if (batchMode) {
+        mode = "nsvd-neural";
+        if (!batch::parseBatchArgs(argc, argv, 2, batchConfig, mode))
+            return 1;
+        cm.setConcurrentTurns(batch::resolveWorkers(batchConfig));
+    }
+
+    if (!mode.empty()) {
+        if (mode == "basic") {
             strategy = "basic";
             dataDir = "database/Basic/";
-        } else if (string(argv[1]) == "opencog") {
+        } else if (mode == "opencog") {
             strategy = "alice";
             dataDir = "database/Alice/";
             cm.setOpenCogMode(true);
             cout << "OpenCog cognitive mode enabled!" << endl;
-        } else if (string(argv[1]) == "chatgpt4o") {
+        } else if (mode == "chatgpt4o") {
             strategy = "basic";
             dataDir = "database/Basic/";
             cm.setOpenCogMode(false);  // Disable OpenCog for ChatGPT-4o only mode
             cm.setChatGPT4oMode(true);
             cout << "ChatGPT-4o mode enabled (OpenCog disabled)!" << endl;
-        } else if (string(argv[1]) == "full") {
+        } else if (mode == "full") {
             strategy = "basic";  // Use basic for demo since Alice files don't exist
             dataDir = "database/Basic/";
             cm.setOpenCogMode(true);
             cm.setChatGPT4oMode(true);
             cout << "Full AI mode enabled (OpenCog + ChatGPT-4o)!" << endl;
-        } else if (string(argv[1]) == "noopencog") {
+        } else if (mode == "noopencog") {
             strategy = "alice";
             dataDir = "database/Alice/";
             cm.setOpenCogMode(false);
             cout << "OpenCog mode disabled - using traditional AIML only." << endl;
-        } else if (string(argv[1]) == "nsvd") {
+        } else if (mode == "nsvd") {
             strategy = "basic";
             dataDir = "database/Basic/";
             cm.setOpenCogMode(true);
             cm.setChatGPT4oMode(true);
             cm.setNSVDMode(true);
             cout << "NSVD mode enabled (PatternLattice + ConstraintEngine + DiffusionEngine)!" << endl;
-        } else if (string(argv[1]) == "nsvd-learn") {
+        } else if (mode == "nsvd-learn") {
             strategy = "basic";
             dataDir = "database/Basic/";
             cm.setOpenCogMode(true);
@@ -181,7 +214,7 @@ int main(int argc, char* argv[])
             cm.setNSVDMode(true);
             cm.setNSVDLearning(true);
             cout << "NSVD-Learn mode enabled (online AIML synthesis + consolidation)!" << endl;
-        } else if (string(argv[1]) == "nsvd-constrained") {
+        } else if (mode == "nsvd-constrained") {
             strategy = "basic";
             dataDir = "database/Basic/";
             cm.setOpenCogMode(true);
@@ -190,7 +223,7 @@ int main(int argc, char* argv[])
             cm.setNSVDLearning(true);
             cm.setNSVDConstrained(true);
             cout << "NSVD-Constrained mode enabled (strict topicality + constraint optimisation)!" << endl;
-        } else if (string(argv[1]) == "nsvd-neural") {
+        } else if (mode == "nsvd-neural") {
             strategy = "basic";
             dataDir = "database/Basic/";
             cm.setOpenCogMode(true);
@@ -213,28 +246,56 @@ int main(int argc, char* argv[])
 
     cm.createCategoryLists();
 
+    if (serve && serveConfig.processes > 1) {
+        prefork::Supervisor supervisor(cm, serveConfig);
+        return supervisor.run();
+    }
+    if (serve) {
+        server::Server srv(cm, serveConfig);
+        if (!srv.start())
+            return 1;
+        srv.run();
+        return 0;
+    }
+
+    if (batchMode)
+        return batch::runBatch(cm, batchConfig) ? 0 : 1;
+
     cout << "Type 'stats' to see knowledge statistics, 'gpt4o' to see ChatGPT-4o config,\n"
-         << "     'nsvd' to see NSVD stats, 'logic'/'workflow' for routing status, 'quit' to exit." << endl;
+         << "     'nsvd' to see NSVD stats, 'logic'/'workflow' for routing status,\n"
+         << "     'reload' to re-read changed AIML files, 'quit' to exit." << endl;
 
     while(1) {
         try {
             cm.listen();
+
+            // listen() normalises the input (upper case, padded with
+            // spaces): compare commands without either.
+            string command = trim(cm.m_sInput);
+            transform(command.begin(), command.end(), command.begin(),
+                      [](unsigned char c) { return (char)::tolower(c); });
             
-            if (cm.m_sInput == "quit" || cm.m_sInput == "exit") {
+            if (command == "quit" || command == "exit") {
                 cout << "Goodbye!" << endl;
                 break;
-            } else if (cm.m_sInput == "stats") {
+            } else if (command == "stats") {
                 cm.showKnowledgeStats();
                 continue;
-            } else if (cm.m_sInput == "gpt4o") {
+            } else if (command == "gpt4o") {
                 cm.showChatGPT4oConfig();
                 continue;
-            } else if (cm.m_sInput == "nsvd") {
+            } else if (command == "nsvd") {
                 cm.showNSVDStats();
                 continue;
-            } else if (cm.m_sInput == "logic" || cm.m_sInput == "workflow") {
+            } else if (command == "logic" || command == "workflow") {
                 cm.showLogicWorkflowStats();
                 continue;
+            } else if (command == "reload") {
+                if (cm.reload())
+                    cout << "Reloading changed AIML files in the background..." << endl;
+                else
+                    cout << "A reload is already pending." << endl;
+                continue;
             }
             
             cm.respond();
@@ -253,24 +314,41 @@ void Chatmachine::init_random() {
 }
 
 Chatmachine::Chatmachine(string str)
-    : m_sChatBotName(str), m_sInput(""), m_bInput_prepared(0), m_nFileIndex(0), m_sPrevResponse(""), 
+    : m_sChatBotName(str), m_sInput(""), m_bInput_prepared(0),
       m_bOpenCogEnabled(true), m_pOpenCogIntegration(nullptr),  // Keep original default (enabled)
       m_bChatGPT4oEnabled(false), m_pChatGPT4oIntegration(nullptr),
       m_bNSVDEnabled(false), m_bNSVDLearning(false), m_bNSVDConstrained(false),
       m_bNSVDNeural(false),
-      m_pPatternLattice(nullptr), m_pConstraintEngine(nullptr),
+      m_pConstraintEngine(nullptr),
       m_pDiffusionEngine(nullptr), m_pLearnableCategoryList(nullptr),
       m_pHGNN(nullptr), m_pDTESNN(nullptr), m_pMLP(nullptr),
-      m_pLogicClassifier(nullptr), m_pWorkflowEngine(nullptr),
+      m_pLogicClassifier(nullptr),
+      m_pTrainer(nullptr), m_pPathGate(nullptr),
+      m_turnDeadlineMs(path_gate::GATE_TURN_BUDGET_MS), m_concurrentTurns(1),
+      m_bLlmSpeculation(true), m_llmSpeculated(0), m_llmSpeculationUsed(0),
+      m_llmSpeculationCancelled(0),
+      m_pBrains(new brain::Registry()), m_reloadRequested(false), m_saveRequested(false),
+      m_pruneRequested(false),
+      m_reloadStop(false),
+      m_shuttingDown(false), m_watchMs(0),
+      m_pWriter(new write_behind::FileWriter()),
+      m_pConsole(make_shared<session::Session>("console")),
       m_turnCount(0), m_lastOuterLoopCount(0),
-      m_lastLogicSystem("NONE"), m_lastLogicConfidence(0.0)
+      m_modelPath("database/nsvd_model.bin")
 {
     init_random();
+    m_pWriter->start();
     // OpenCog, ChatGPT-4o, and NSVD initialization will happen after categories are loaded
 }
 
 Chatmachine::~Chatmachine() {
-    // Destructor - unique_ptr will automatically clean up
+    // The reloader thread uses the members: stop it first.  Then write
+    // out everything still queued.
+    m_shuttingDown = true;
+    stopReloader();
+    // Paths abandoned by their turns may still be running on the members.
+    m_pPathPool.reset();
+    m_pWriter->stop();
 }
 
 void Chatmachine::listen() {
@@ -282,51 +360,87 @@ void Chatmachine::listen() {
 }
 
 void Chatmachine::respond() {
+    init_random();
+
+    // Streamed GPT-4o text is printed as it arrives.
+    string streamed;
+    m_pConsole->partial = [&streamed](const string& piece) {
+        if (streamed.empty()) cout << sBotPrompt;
+        streamed += piece;
+        cout << piece << flush;
+    };
+    string reply = respondTo(*m_pConsole, m_sInput);
+    m_pConsole->partial = nullptr;
+
+    if (streamed.empty())
+        cout << sBotPrompt << reply << endl;
+    else if (reply != streamed)
+        cout << endl << sBotPrompt << reply << endl;
+    else
+        cout << endl;
+}
+
+string Chatmachine::respondTo(session::Session& s, const string& input) {
     string response;
 
-    init_random();
+    s.input      = input;
+    s.lastActive = chrono::steady_clock::now();
 
-    if (m_sInput == "") {
-        cout << sBotPrompt << "Hmm." << endl;
-        return;
-    }
+    if (s.input == "")
+        return "Hmm.";
 
-    if (m_sPrevInput != "" && m_sInput == m_sPrevInput) {
-        cout << sBotPrompt << "You have already said that." << endl;
-        return;
-    }
+    if (s.prevInput != "" && s.input == s.prevInput)
+        return "You have already said that.";
+
+    s.turns++;
+
+    // The whole turn runs on the brain generation current now; a reload
+    // publishing meanwhile only affects later turns.
+    s.brain = m_pBrains->current();
+    struct Unpin {
+        session::Session& s;
+        ~Unpin() { s.brain.reset(); }
+    } unpin = {s};
 
     // -----------------------------------------------------------------------
     // NSVD parallel pipeline (new modes: nsvd / nsvd-learn / nsvd-constrained)
     // -----------------------------------------------------------------------
     if (m_bNSVDEnabled) {
-        response = nsvd_respond();
+        response = nsvd_respond(s);
     } else {
         // -------------------------------------------------------------------
         // Legacy sequential pipeline (backward-compatible)
         // -------------------------------------------------------------------
-        shuffle();
-
-        // Use OpenCog enhanced response if enabled
-        if (m_bOpenCogEnabled && m_pOpenCogIntegration) {
-            vector<aiml::Category*> allCategories;
-            for (auto& categoryList : cls) {
-                for (auto& category : categoryList->getCategories()) {
-                    allCategories.push_back(category);
+        // Lists are tried in a fresh random order every turn.
+        vector<CategoryList*> order = s.brain->lists;
+        {
+            // OpenCog learning modifies the shared brain (and shuffle()
+            // reseeds rand()).
+            rw_lock::WriteGuard lock(m_brainLock);
+            shuffle(order);
+
+            // Use OpenCog enhanced response if enabled
+            if (m_bOpenCogEnabled && m_pOpenCogIntegration) {
+                vector<aiml::Category*> allCategories;
+                for (auto& categoryList : order) {
+                    for (auto& category : categoryList->getCategories()) {
+                        allCategories.push_back(category);
+                    }
                 }
-            }
 
-            response = m_pOpenCogIntegration->enhancedPatternMatch(m_sInput, allCategories);
+                response = m_pOpenCogIntegration->enhancedPatternMatch(s.input, allCategories);
 
-            // Learn from this interaction
-            if (!response.empty()) {
-                m_pOpenCogIntegration->learnFromInteraction(m_sInput, response, 0.8);
+                // Learn from this interaction
+                if (!response.empty()) {
+                    m_pOpenCogIntegration->learnFromInteraction(s.input, response, 0.8);
+                }
             }
         }
 
         // Fall back to traditional AIML if no OpenCog response
         if (response.empty()) {
-            response = get_response(m_sInput);
+            rw_lock::ReadGuard lock(m_brainLock);
+            response = get_response(s, order, s.input);
         }
 
         // Use ChatGPT-4o as final fallback if enabled and no good response found
@@ -335,8 +449,10 @@ void Chatmachine::respond() {
             m_pChatGPT4oIntegration->isConfigured())
         {
             cout << "[Consulting ChatGPT-4o...]" << endl;
-            string gptResponse = m_pChatGPT4oIntegration->generateContextualResponse(
-                m_sInput, m_conversationHistory);
+            chatgpt4o::TokenSink forward = gptForwarder(s);
+            string gptResponse = forward
+                ? m_pChatGPT4oIntegration->streamContextualResponse(s.input, s.history, forward)
+                : m_pChatGPT4oIntegration->generateContextualResponse(s.input, s.history);
 
             if (!gptResponse.empty()) {
                 response = "[GPT-4o] " + gptResponse;
@@ -344,73 +460,103 @@ void Chatmachine::respond() {
         }
     }
 
-    if (response.empty()) {
-        cout << sBotPrompt << "I don't understand what you're saying." << endl;
-    } else {
-        setResponse(response);
+    if (response.empty())
+        return "I don't understand what you're saying.";
 
-        // Update conversation history for ChatGPT-4o context
-        if (m_bChatGPT4oEnabled) {
-            m_conversationHistory.push_back(m_sInput);
-            m_conversationHistory.push_back(response);
+    setResponse(s, response);
 
-            // Keep only recent history (last 10 exchanges)
-            if (m_conversationHistory.size() > 20) {
-                m_conversationHistory.erase(m_conversationHistory.begin(),
-                                             m_conversationHistory.begin() + 2);
-            }
+    // Update conversation history for ChatGPT-4o context
+    if (m_bChatGPT4oEnabled)
+        s.remember(s.input, response);
+
+    return s.prevResponse;
+}
+
+chatgpt4o::TokenSink Chatmachine::gptForwarder(session::Session& s) {
+    if (!s.partial)
+        return chatgpt4o::TokenSink();
+    // The reply will read "[GPT-4o] <text>": send the prefix with the
+    // first piece.
+    auto prefixed = make_shared<bool>(false);
+    return [&s, prefixed](const string& delta) {
+        if (!*prefixed) {
+            *prefixed = true;
+            s.partial("[GPT-4o] ");
         }
+        s.partial(delta);
+        return true;
+    };
+}
 
-        cout << sBotPrompt << m_sResponse << endl;
-    }
+shared_ptr<session::Session> Chatmachine::newSession(const string& id) {
+    auto s = make_shared<session::Session>(id);
+    initSessionState(*s);
+    return s;
+}
+
+void Chatmachine::initSessionState(session::Session& s) {
+    if (m_pDTESNN)
+        s.temporal.reset(new dtesnn::DeepTreeEchoStateNet(m_pDTESNN->getModel()));
+    if (m_pLogicClassifier)
+        s.workflow.reset(new workflow_engine::WorkflowEngine());
+    s.lastPathScores.assign(path_gate::GATE_PATHS, 0.0);
 }
 
-string Chatmachine::get_response(string input) {
+map<string, double> Chatmachine::contextSnapshot() const {
+    if (!m_pOpenCogIntegration) return map<string, double>();
+    lock_guard<mutex> lock(m_opencogMutex);
+    return m_pOpenCogIntegration->getContextVector();
+}
+
+string Chatmachine::get_response(session::Session& s, const vector<CategoryList*>& lists,
+                                 string input, const cancel_token::CancelToken* cancel) {
     string bestResponse;
 
-    bestResponse = get_best_response(input);
+    bestResponse = get_best_response(s, lists, input, cancel);
 
     return bestResponse;
 }
 
-string Chatmachine::get_best_response(string input) {
-    vector<lev_pat_templ> levTempls;
-    TiXmlDocument doc;
-    TiXmlElement* root;
+string Chatmachine::get_best_response(session::Session& s, const vector<CategoryList*>& lists,
+                                      string input, const cancel_token::CancelToken* cancel) {
     Template* bestTemplate;
     Pattern* bestPattern;
     string bestResponse;
-    unsigned int bestLevDist, bestIndex;
-
-    for(unsigned int i=0, clss=cls.size(); i<clss; ++i) {
-        levTempls.push_back(parse_categoryList(cls[i], input, m_sPrevResponse, mVars));
-    }
-
-    bestLevDist = levTempls[0].patternLevDist;
-    bestIndex = 0;
-
-    for(int i=1, s=levTempls.size(); i<s; ++i) {
-        if (bestLevDist > levTempls[i].patternLevDist && levTempls[i].templ->toString() != "") {
-            bestLevDist = levTempls[i].patternLevDist;
-            bestIndex = i;
-        }
-    }
+    response_cache::ResponseCache* cache = s.brain ? s.brain->cache.get() : nullptr;
+
+    // Matching ignores <that> (the loader drops that-guards), so only the
+    // topic goes into the cache key besides the input.
+    auto topicVar = s.vars.find("topic");
+    const string topic = topicVar != s.vars.end() ? topicVar->second : "";
+    if (cache && cache->lookup(input, "", topic, bestResponse))
+        return bestResponse;
+
+    // One evaluation context for the turn: srai reductions share its memo.
+    EvalContext ctx(lists, input, s.prevResponse, s.vars, cancel);
+    lev_pat_templ best = match_category_lists(lists, input, nullptr, ctx.distRow, cancel);
+
+    // Cancelled before any list was scanned, or the winning scan was cut
+    // short before it saw a category.
+    bestTemplate = best.templ;
+    bestPattern = best.pat;
+    if (!bestTemplate || cancel_token::isCancelled(cancel))
+        return "";
 
-    bestTemplate = levTempls[bestIndex].templ;
-    bestPattern = levTempls[bestIndex].pat;
-    bestResponse = bestTemplate->toString();
+    parse_template(bestTemplate, bestPattern, input, ctx, bestResponse);
 
-    bestResponse = parse_template(cls[bestIndex], bestPattern, bestTemplate, input, m_sPrevResponse, mVars);
+    // A scan cut short may have missed the true best match: don't cache it.
+    if (cache && bestTemplate->isDeterministic() &&
+        !cancel_token::isCancelled(cancel))
+        cache->insert(input, "", topic, bestResponse);
 
     return bestResponse;
 }
 
-void Chatmachine::setResponse(string response) {
-    m_sResponse = response;
-    prepare_response(m_sResponse);
+void Chatmachine::setResponse(session::Session& s, string response) {
+    prepare_response(response);
 
-    m_sPrevResponse = m_sResponse;
-    m_sPrevInput = m_sInput;
+    s.prevResponse = response;
+    s.prevInput    = s.input;
 }
 
 void Chatmachine::prepare_response(string &resp) {
@@ -418,63 +564,58 @@ void Chatmachine::prepare_response(string &resp) {
 }
 
 void Chatmachine::normalize(string &input) {
-    //subsitute(input, subs);
-    toUpper(input);
-    shrink(input);
-    insert_spaces(input);
+    input = normalized(input);
 
     m_sInput = input;
 
     m_bInput_prepared = 1;
 }
 
-void Chatmachine::createCategoryLists() {
-    TiXmlDocument doc;
-    TiXmlElement* root;
-    unsigned int aimlFilesSize = strategy == "basic" ? basicAimlFilesSize : aliceAimlFilesSize;
-    string* aimlFiles = strategy == "basic" ? basicAimlFiles : aliceAimlFiles;
-
-    while(m_nFileIndex < aimlFilesSize) {
-        string sAimlFile;
-        const char* aimlFile;
-
-        sAimlFile = dataDir + aimlFiles[m_nFileIndex] + ".aiml";
-        aimlFile = sAimlFile.c_str();
-
-        cl = new CategoryList(aimlFiles[m_nFileIndex]);
-        cls.push_back(cl);
-
-        if (!doc.LoadFile(aimlFile)) {
-            cerr << doc.ErrorDesc() << " " << aimlFile << endl;
-            return;
-        }
-
-        root = doc.FirstChildElement();
-
-        if (root == NULL) {
-            cerr << "Failed to load file: No root element. " << aimlFile << endl;
-            doc.Clear();
-            return;
-        }
-
-        createCategoryList(cl, root);
+string Chatmachine::normalized(string input) {
+    //subsitute(input, subs);
+    toUpper(input);
+    shrink(input);
+    insert_spaces(input);
+    return input;
+}
 
-        m_nFileIndex++;
+void Chatmachine::createCategoryLists() {
+    shared_ptr<brain::Generation> g = make_shared<brain::Generation>();
+    g->number = 1;
+    g->cache.reset(new response_cache::ResponseCache());
+
+    compactConsolidated();
+    vector<brain::Source> sources = aimlSources();
+    brain::LoadResult loaded;
+    bool ok = brain::loadFiles(sources, nullptr, *g, loaded);
+    m_pBrains->publish(g);
+    if (!ok) {
+        cerr << loaded.error << endl;
+        return;
+    }
+    for (const string& skipped : loaded.skipped)
+        cerr << "[Consolidation] Skipped " << skipped << endl;
+
+    size_t consolidatedFiles = 0, consolidatedCategories = 0;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (!sources[i].optional || !g->files[i]->loaded) continue;
+        consolidatedFiles++;
+        consolidatedCategories += g->files[i]->list->getCategories().size();
     }
+    if (consolidatedFiles > 0)
+        cout << "Consolidated AIML: " << consolidatedCategories << " categories from "
+             << consolidatedFiles << " files." << endl;
+
+    // Purity analysis for the response cache (done by the loader).
+    cout << "Response cache: " << loaded.deterministic << " of " << g->categoryCount()
+         << " categories deterministic." << endl;
 
-    //to do
-    //cout << cl << endl;
-    
     // Initialize OpenCog with loaded categories after successful loading
     if (m_bOpenCogEnabled) {
         try {
             initializeOpenCog();
             
-            vector<aiml::Category*> allCategories;
-            for (auto& categoryList : cls) {
-                const auto& categories = categoryList->getCategories();
-                allCategories.insert(allCategories.end(), categories.begin(), categories.end());
-            }
+            vector<aiml::Category*> allCategories = g->categories();
             
             if (m_pOpenCogIntegration) {
                 m_pOpenCogIntegration->initializeFromCategories(allCategories);
@@ -507,23 +648,64 @@ void Chatmachine::createCategoryLists() {
             m_bNSVDEnabled = false;
         }
     }
+
+    startReloader();
 }
 
-void Chatmachine::shuffle() {
+vector<brain::Source> Chatmachine::aimlSources() const {
+    unsigned int aimlFilesSize = strategy == "basic" ? basicAimlFilesSize : aliceAimlFilesSize;
+    string* aimlFiles = strategy == "basic" ? basicAimlFiles : aliceAimlFiles;
+    vector<brain::Source> sources;
+    for (unsigned int i = 0; i < aimlFilesSize; ++i)
+        sources.push_back(brain::Source(dataDir + aimlFiles[i] + ".aiml", aimlFiles[i]));
+
+    // Consolidation output; the list is named after the file.
+    const pair<const char*, const char*> consolidated[] = {
+        make_pair(consolidation::LEARNED_DIR,  consolidation::LEARNED_PREFIX),
+        make_pair(consolidation::WORKFLOW_DIR, consolidation::WORKFLOW_PREFIX),
+    };
+    for (const auto& dir : consolidated) {
+        for (const string& path : consolidation::listFiles(dir.first, dir.second)) {
+            string name = path.substr(path.rfind('/') + 1);
+            sources.push_back(brain::Source(path, name.substr(0, name.size() - 5), true));
+        }
+    }
+    return sources;
+}
+
+void Chatmachine::compactConsolidated() {
+    const pair<const char*, const char*> consolidated[] = {
+        make_pair(consolidation::LEARNED_DIR,  consolidation::LEARNED_PREFIX),
+        make_pair(consolidation::WORKFLOW_DIR, consolidation::WORKFLOW_PREFIX),
+    };
+    for (const auto& dir : consolidated) {
+        consolidation::CompactResult result;
+        if (consolidation::compact(dir.first, dir.second,
+                                   consolidation::CONSOLIDATION_COMPACT_FILES, result)) {
+            cout << "[Consolidation] Compacted " << result.files << " files into "
+                 << result.output << ": " << result.categories << " categories, "
+                 << result.duplicates << " duplicate templates dropped." << endl;
+        } else if (!result.error.empty()) {
+            cerr << "[Consolidation] " << result.error << endl;
+        }
+    }
+}
+
+void Chatmachine::shuffle(vector<CategoryList*>& lists) {
     srand(time(NULL));
 
     vector<CategoryList*> cls_;
 
-    for(unsigned int i=0, s=cls.size(); i<s; ++i) {
-        cls_.push_back(cls[i]);
+    for(unsigned int i=0, s=lists.size(); i<s; ++i) {
+        cls_.push_back(lists[i]);
     }
 
-    cls.clear();
+    lists.clear();
 
     while(cls_.size() > 0) {
         unsigned int i = rand() % cls_.size();
 
-        cls.push_back(cls_[i]);
+        lists.push_back(cls_[i]);
         cls_.erase(cls_.begin() + i);
     }
 }
@@ -544,6 +726,24 @@ void Chatmachine::showKnowledgeStats() {
     } else {
         cout << "OpenCog integration not available." << endl;
     }
+    shared_ptr<brain::Generation> g = m_pBrains->current();
+    if (g) {
+        brain::RegistryStats bs = m_pBrains->getStats();
+        cout << "AIML brain: generation " << g->number << ", " << g->categoryCount()
+             << " categories in " << g->lists.size() << " files; " << bs.retired
+             << " replaced generation(s) awaiting reclaim, " << bs.reclaimed << " reclaimed." << endl;
+    }
+    if (g && g->cache) {
+        auto cs = g->cache->getStats();
+        cout << "Response cache: " << cs.entries << " entries, " << cs.hits << " hits / "
+             << cs.misses << " misses (" << (int)(cs.hitRate() * 100.0 + 0.5) << "% hit rate), "
+             << cs.evictions << " evictions, " << cs.invalidations << " invalidations"
+             << " (this generation)." << endl;
+    }
+    SraiStats ss = srai_stats();
+    cout << "srai: " << ss.calls << " reductions, " << ss.memoHits << " memo hits, "
+         << ss.cycles << " cycles cut, " << ss.depthLimited << " depth-limited, max depth "
+         << ss.maxDepth << "." << endl;
 }
 
 void Chatmachine::initializeChatGPT4o() {
@@ -555,9 +755,61 @@ void Chatmachine::initializeChatGPT4o() {
         if (apiKey) {
             m_pChatGPT4oIntegration->setApiKey(string(apiKey));
             cout << "ChatGPT-4o API key loaded from environment." << endl;
-        } else {
+        } else if (m_pChatGPT4oIntegration->isConfigured()) {
             cout << "No OPENAI_API_KEY environment variable found. ChatGPT-4o will run in simulation mode." << endl;
+        } else {
+            cout << "No OPENAI_API_KEY environment variable found. ChatGPT-4o fallback disabled (set CHATGPT4O_SIMULATE=1 for mock responses)." << endl;
         }
+
+        // Another endpoint (e.g. a local mock server) and request timeout.
+        const char* apiUrl = getenv("OPENAI_API_URL");
+        if (apiUrl)
+            m_pChatGPT4oIntegration->setEndpoint(string(apiUrl));
+        const char* timeoutEnv = getenv("CHATGPT4O_TIMEOUT_MS");
+        if (timeoutEnv)
+            m_pChatGPT4oIntegration->setTimeouts(0, atoi(timeoutEnv));
+
+        // Near-duplicate reply cache, persisted across restarts.  An empty
+        // CHATGPT4O_CACHE_FILE keeps it in memory only; size 0 disables it.
+        size_t cacheSize = llm_cache::LLM_CACHE_CAPACITY;
+        int cacheTtl = llm_cache::LLM_CACHE_TTL_S;
+        string cacheFile = "database/chatgpt4o_cache.bin";
+        const char* cacheSizeEnv = getenv("CHATGPT4O_CACHE_SIZE");
+        if (cacheSizeEnv)
+            cacheSize = (size_t)max(0, atoi(cacheSizeEnv));
+        const char* cacheTtlEnv = getenv("CHATGPT4O_CACHE_TTL_S");
+        if (cacheTtlEnv)
+            cacheTtl = atoi(cacheTtlEnv);
+        const char* cacheFileEnv = getenv("CHATGPT4O_CACHE_FILE");
+        if (cacheFileEnv)
+            cacheFile = cacheFileEnv;
+        m_pChatGPT4oIntegration->configureCache(cacheSize, cacheTtl, cacheFile);
+
+        // Load shedding for bursts of fallbacks from concurrent sessions.
+        admission_control::AdmissionConfig admission;
+        const char* rateEnv = getenv("CHATGPT4O_RATE");
+        if (rateEnv)
+            admission.ratePerSecond = atof(rateEnv);
+        const char* burstEnv = getenv("CHATGPT4O_BURST");
+        if (burstEnv)
+            admission.burst = atof(burstEnv);
+        const char* concurrentEnv = getenv("CHATGPT4O_MAX_CONCURRENT");
+        if (concurrentEnv)
+            admission.maxConcurrent = (size_t)max(0, atoi(concurrentEnv));
+        const char* queueEnv = getenv("CHATGPT4O_QUEUE_TIMEOUT_MS");
+        if (queueEnv)
+            admission.queueTimeoutMs = max(0, atoi(queueEnv));
+        const char* breakerEnv = getenv("CHATGPT4O_BREAKER_FAILURES");
+        if (breakerEnv)
+            admission.breakerFailures = max(0, atoi(breakerEnv));
+        const char* cooldownEnv = getenv("CHATGPT4O_BREAKER_COOLDOWN_MS");
+        if (cooldownEnv)
+            admission.breakerCooldownMs = max(0, atoi(cooldownEnv));
+        m_pChatGPT4oIntegration->setAdmission(admission);
+        auto cs = m_pChatGPT4oIntegration->getCacheStats();
+        if (cs.entries > 0)
+            cout << "ChatGPT-4o reply cache: " << cs.entries << " entries restored from "
+                 << cacheFile << "." << endl;
         
         cout << "ChatGPT-4o integration initialized successfully." << endl;
     } catch (const exception& e) {
@@ -576,7 +828,7 @@ void Chatmachine::showChatGPT4oConfig() {
     if (m_pChatGPT4oIntegration) {
         m_pChatGPT4oIntegration->printConfiguration();
         cout << "Enabled: " << (m_bChatGPT4oEnabled ? "Yes" : "No") << endl;
-        cout << "Conversation history length: " << m_conversationHistory.size() << endl;
+        cout << "Conversation history length: " << m_pConsole->history.size() << endl;
     } else {
         cout << "ChatGPT-4o integration not available." << endl;
     }
@@ -596,31 +848,26 @@ void Chatmachine::initializeNSVD() {
         cerr << "[NSVD] Failed to create directory database/logic: "
              << strerror(errno) << endl;
     }
-    math_primitives::MathPrimitiveRegistry::getInstance()
-        .writeAIMLFile("database/logic/math_primitives.aiml");
-    logic_meta_patterns::MetaPatternRegistry::getInstance()
-        .writeAIMLFiles("database/logic");
+    // Regenerated every start, but written only when they changed.
+    m_pWriter->submit("database/logic/math_primitives.aiml",
+                      math_primitives::MathPrimitiveRegistry::getInstance().renderAIML());
+    for (auto& file : logic_meta_patterns::MetaPatternRegistry::getInstance()
+                          .renderAIMLFiles("database/logic"))
+        m_pWriter->submit(file.first, std::move(file.second));
 
     // PatternLattice — build over loaded categories + runtime math primitives.
-    m_pPatternLattice.reset(new pattern_lattice::PatternLattice());
-    vector<aiml::Category*> allCategories;
-    for (auto& cl_item : cls) {
-        for (auto& cat : cl_item->getCategories())
-            allCategories.push_back(cat);
-    }
-
+    // Nothing is answering yet, so the startup generation gets it in place.
     m_runtimeCategories.clear();
     auto primitives = math_primitives::MathPrimitiveRegistry::getInstance()
         .generateCategories();
-    for (auto& p : primitives) {
-        allCategories.push_back(p.get());
+    for (auto& p : primitives)
         m_runtimeCategories.push_back(std::move(p));
-    }
 
-    m_pPatternLattice->build(allCategories);
-    cout << "PatternLattice built: " << m_pPatternLattice->size()
-         << " categories (" << m_pPatternLattice->wildcardCount()
-         << " wildcard, " << m_pPatternLattice->specificCount()
+    shared_ptr<brain::Generation> g = m_pBrains->current();
+    buildLattice(*g);
+    cout << "PatternLattice built: " << g->lattice->size()
+         << " categories (" << g->lattice->wildcardCount()
+         << " wildcard, " << g->lattice->specificCount()
          << " specific, including " << m_runtimeCategories.size()
          << " math primitives)." << endl;
 
@@ -632,6 +879,7 @@ void Chatmachine::initializeNSVD() {
         m_pDiffusionEngine.reset(
             new diffusion_engine::DiffusionEngine(
                 opencog::AtomSpaceManager::getInstance()));
+        m_pDiffusionEngine->setWriter(m_pWriter.get());
     }
 
     // LearnableCategoryList.
@@ -640,24 +888,57 @@ void Chatmachine::initializeNSVD() {
         cout << "LearnableCategoryList initialised (online synthesis enabled)." << endl;
     }
 
+    // Previously saved weights, if any: restoring them skips random
+    // initialisation and spectral-radius estimation.
+    model_store::ModelFile modelFile;
+    auto openStart = chrono::steady_clock::now();
+    bool haveModel = modelFile.open(m_modelPath);
+    chrono::steady_clock::duration loadTime = chrono::steady_clock::now() - openStart;
+    int  restored = 0, expected = 0;
+    auto restore = [&](const char* name, const function<bool(model_store::SectionReader&)>& fn) {
+        ++expected;
+        if (!haveModel || !modelFile.hasSection(name)) return;
+        auto start = chrono::steady_clock::now();
+        model_store::SectionReader in = modelFile.section(name);
+        bool ok = fn(in);
+        loadTime += chrono::steady_clock::now() - start;
+        if (ok) ++restored;
+        else cerr << "[NSVD] Ignoring malformed '" << name << "' section in "
+                  << m_modelPath << endl;
+    };
+
     // Neural complement modules (HGNN + DTESNN + MLP).
     if (m_bNSVDNeural) {
         // HGNN — spatially-aware message-passing on the AtomSpace.
         m_pHGNN.reset(new hgnn::HyperGraphNeuralNet(
             opencog::AtomSpaceManager::getInstance()));
+        restore("hgnn", [&](model_store::SectionReader& in) {
+            return m_pHGNN->importFrom(in);
+        });
         // Run an initial forward pass to populate embeddings.
         m_pHGNN->forwardPass();
         cout << "HGNN initialised: " << m_pHGNN->size()
              << " concept embeddings." << endl;
 
         // DTESNN — temporally-aware deep-tree echo state network.
-        m_pDTESNN.reset(new dtesnn::DeepTreeEchoStateNet());
+        shared_ptr<const dtesnn::ReservoirModel> reservoir;
+        restore("dtesnn", [&](model_store::SectionReader& in) {
+            reservoir = dtesnn::ReservoirModel::importFrom(in);
+            return reservoir != nullptr;
+        });
+        m_pDTESNN.reset(reservoir ? new dtesnn::DeepTreeEchoStateNet(reservoir)
+                                  : new dtesnn::DeepTreeEchoStateNet());
         cout << "DTESNN initialised (tree depth="
              << dtesnn::DTESNN_TREE_DEPTH << ", reservoir="
-             << dtesnn::DTESNN_RESERVOIR << " per level)." << endl;
+             << m_pDTESNN->getReservoirSize() << " per level, connectivity="
+             << m_pDTESNN->getConnectivity() << ", "
+             << m_pDTESNN->nonZeroWeights() << " weights)." << endl;
 
         // Emergent MLP — fuses HGNN + DTESNN features.
         m_pMLP.reset(new mlp_engine::MLPEngine());
+        restore("mlp", [&](model_store::SectionReader& in) {
+            return m_pMLP->importFrom(in);
+        });
         cout << "MLPEngine initialised (input="
              << mlp_engine::MLP_INPUT_DIM << ", output="
              << mlp_engine::MLP_OUTPUT_DIM << ")." << endl;
@@ -665,8 +946,267 @@ void Chatmachine::initializeNSVD() {
 
     // Logic classifier + workflow engine (independent of neural mode).
     m_pLogicClassifier.reset(new logic_classifier::LogicClassifier());
-    m_pWorkflowEngine.reset(new workflow_engine::WorkflowEngine());
+    restore("logic_classifier", [&](model_store::SectionReader& in) {
+        return m_pLogicClassifier->importFrom(in);
+    });
     cout << "LogicClassifier and WorkflowEngine initialised." << endl;
+
+    if (restored > 0) {
+        auto us = chrono::duration_cast<chrono::microseconds>(loadTime).count();
+        cout << "Neural weights restored from " << m_modelPath << " ("
+             << restored << "/" << expected << " modules, "
+             << modelFile.size() << " bytes, " << us << " us)." << endl;
+    }
+    modelFile.close();
+
+    // First run (or new modules enabled): persist the fresh initialisation
+    // so the next start reuses it.
+    if (restored < expected)
+        saveNSVDModel();
+
+    // Per-turn deadline for the NSVD paths (NSVD_TURN_DEADLINE_MS overrides).
+    const char* deadlineEnv = getenv("NSVD_TURN_DEADLINE_MS");
+    if (deadlineEnv) {
+        double ms = atof(deadlineEnv);
+        if (ms > 0.0)
+            m_turnDeadlineMs = ms;
+        else
+            cerr << "[NSVD] Ignoring invalid NSVD_TURN_DEADLINE_MS=" << deadlineEnv << endl;
+    }
+    cout << "NSVD turn deadline: " << m_turnDeadlineMs << " ms." << endl;
+
+    // Speculative GPT-4o fallback (NSVD_LLM_SPECULATE=0 turns it off).
+    const char* speculateEnv = getenv("NSVD_LLM_SPECULATE");
+    if (speculateEnv)
+        m_bLlmSpeculation = atoi(speculateEnv) != 0;
+
+    // Pre-dispatch gating of the NSVD paths, budgeted against the deadline.
+    m_pPathGate.reset(new path_gate::PathGate(path_gate::GATE_MIN_WEIGHT,
+                                              m_turnDeadlineMs));
+    // Enough path threads for every concurrent turn to run all its paths.
+    m_pPathPool.reset(new worker_pool::WorkerPool(
+        (size_t)path_gate::GATE_PATHS * m_concurrentTurns));
+
+    // Background mini-batch training for the MLP and logic classifier.
+    m_pTrainer.reset(new replay_trainer::ReplayTrainer(m_pMLP.get(),
+                                                       m_pLogicClassifier.get()));
+    m_pTrainer->start();
+
+    // The console conversation gets its reservoir state and workflow engine
+    // now that the shared modules exist.
+    initSessionState(*m_pConsole);
+}
+
+void Chatmachine::prepareFork() {
+    stopReloader();
+    m_pWriter->stop();
+    if (m_pTrainer)
+        m_pTrainer->stop();
+    m_pPathPool.reset();
+    if (m_pChatGPT4oIntegration)
+        m_pChatGPT4oIntegration->stopAsync();
+    cout.flush();
+    cerr.flush();
+}
+
+void Chatmachine::afterFork(int workerIndex) {
+    if (m_pDiffusionEngine)
+        m_pDiffusionEngine->setFileTag("w" + to_string(workerIndex) + "_");
+    if (m_bNSVDEnabled) {
+        m_pPathPool.reset(new worker_pool::WorkerPool(
+            (size_t)path_gate::GATE_PATHS * m_concurrentTurns));
+        if (m_pTrainer)
+            m_pTrainer->start();
+    }
+    m_pWriter->start();
+    startReloader();
+}
+
+void Chatmachine::flushFiles() {
+    m_pWriter->flush();
+}
+
+// ---------------------------------------------------------------------------
+// Hot reload
+// ---------------------------------------------------------------------------
+
+bool Chatmachine::reload() {
+    {
+        lock_guard<mutex> lock(m_reloadMutex);
+        if (m_reloadRequested)
+            return false;
+        m_reloadRequested = true;
+    }
+    m_reloadWake.notify_all();
+    return true;
+}
+
+void Chatmachine::buildLattice(brain::Generation& g) {
+    vector<aiml::Category*> allCategories = g.categories();
+    for (auto& p : m_runtimeCategories)
+        allCategories.push_back(p.get());
+    g.lattice.reset(new pattern_lattice::PatternLattice());
+    g.lattice->build(allCategories);
+}
+
+bool Chatmachine::rebuildBrain() {
+    auto start = chrono::steady_clock::now();
+    shared_ptr<brain::Generation> previous = m_pBrains->current();
+    if (!previous) return false;
+
+    shared_ptr<brain::Generation> next = make_shared<brain::Generation>();
+    next->number = previous->number + 1;
+    brain::LoadResult loaded;
+    try {
+        compactConsolidated();
+        if (!brain::loadFiles(aimlSources(), previous.get(), *next, loaded)) {
+            cerr << "[Reload] " << loaded.error << "; keeping generation "
+                 << previous->number << "." << endl;
+            return false;
+        }
+        for (const string& skipped : loaded.skipped)
+            cerr << "[Consolidation] Skipped " << skipped << endl;
+        // Every file reused and none added or removed: same set.
+        if (loaded.parsed == 0 && next->files.size() == previous->files.size()) {
+            cout << "[Reload] No AIML file changed." << endl;
+            return true;
+        }
+        next->cache.reset(new response_cache::ResponseCache());
+        if (previous->lattice)
+            buildLattice(*next);
+    } catch (const exception& e) {
+        cerr << "[Reload] Failed: " << e.what() << "; keeping generation "
+             << previous->number << "." << endl;
+        return false;
+    }
+
+    {
+        // Learned categories outlive generations.  Copy them in while
+        // holding the learning lock, so one synthesised during the build
+        // is not lost, and publish before letting go of it.
+        lock_guard<mutex> learnLock(m_learnMutex);
+        if (next->lattice && m_pLearnableCategoryList)
+            for (aiml::Category* cat : m_pLearnableCategoryList->getCategories())
+                next->lattice->addLearnedCategory(cat);
+        m_pBrains->publish(next);
+    }
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "[Reload] Generation " << next->number << ": " << next->categoryCount()
+         << " categories, " << loaded.parsed << " of " << next->files.size()
+         << " files parsed, published in " << (int)(ms + 0.5) << " ms." << endl;
+
+    // The old generation is freed here, on this thread, once the turns
+    // that started on it have finished.
+    previous.reset();
+    next.reset();
+    while (m_pBrains->reclaim() > 0 && !m_shuttingDown)
+        this_thread::sleep_for(chrono::milliseconds(brain::BRAIN_RECLAIM_POLL_MS));
+    return true;
+}
+
+void Chatmachine::startReloader() {
+    if (m_reloadThread.joinable())
+        return;
+    const char* watchMs = getenv("AIML_WATCH_MS");
+    m_watchMs = watchMs ? atoi(watchMs) : 0;
+    if (m_watchMs > 0)
+        cout << "AIML watch: checking for changed files every " << m_watchMs << " ms." << endl;
+
+    m_reloadStop = false;
+    m_reloadThread = thread([this]() {
+        string failedStamp;   // files as they were when a reload last failed
+        auto woken = [this]() {
+            return m_reloadStop || m_reloadRequested || m_saveRequested || m_pruneRequested;
+        };
+        unique_lock<mutex> lock(m_reloadMutex);
+        while (true) {
+            if (m_watchMs > 0)
+                m_reloadWake.wait_for(lock, chrono::milliseconds(m_watchMs), woken);
+            else
+                m_reloadWake.wait(lock, woken);
+            bool save = m_saveRequested;
+            m_saveRequested = false;
+            if (m_reloadStop) {
+                lock.unlock();
+                if (save)
+                    saveNSVDModel();
+                break;
+            }
+            bool requested = m_reloadRequested;
+            bool prune = m_pruneRequested;
+            m_reloadRequested = false;
+            m_pruneRequested = false;
+            lock.unlock();
+
+            if (save)
+                saveNSVDModel();
+            if (prune)
+                pruneLearned();
+            if (requested) {
+                failedStamp = rebuildBrain() ? "" : brain::diskStamp(aimlSources());
+            } else {
+                vector<brain::Source> sources = aimlSources();
+                shared_ptr<brain::Generation> g = m_pBrains->current();
+                if (g && brain::changedOnDisk(*g, sources)) {
+                    // Retry a failed load only once the files change again.
+                    string stamp = brain::diskStamp(sources);
+                    g.reset();
+                    if (stamp != failedStamp) {
+                        cout << "[Reload] AIML files changed on disk." << endl;
+                        failedStamp = rebuildBrain() ? "" : stamp;
+                    }
+                }
+            }
+            lock.lock();
+        }
+    });
+}
+
+void Chatmachine::stopReloader() {
+    if (!m_reloadThread.joinable())
+        return;
+    {
+        lock_guard<mutex> lock(m_reloadMutex);
+        m_reloadStop = true;
+    }
+    m_reloadWake.notify_all();
+    m_reloadThread.join();
+}
+
+bool Chatmachine::saveNSVDModel() {
+    if (m_pTrainer)
+        m_pTrainer->flush();
+    model_store::ModelWriter writer;
+    {
+        // Turns go on meanwhile; only learning updates are held off.
+        rw_lock::ReadGuard lock(m_brainLock);
+        if (m_pHGNN)
+            m_pHGNN->exportTo(writer.section("hgnn"));
+        if (m_pDTESNN)
+            m_pDTESNN->getModel()->exportTo(writer.section("dtesnn"));
+        if (m_pMLP)
+            m_pMLP->exportTo(writer.section("mlp"));
+        if (m_pLogicClassifier)
+            m_pLogicClassifier->exportTo(writer.section("logic_classifier"));
+    }
+    return m_pWriter->submit(m_modelPath, writer.image());
+}
+
+void Chatmachine::requestModelSave() {
+    {
+        lock_guard<mutex> lock(m_reloadMutex);
+        m_saveRequested = true;
+    }
+    m_reloadWake.notify_all();
+}
+
+void Chatmachine::requestPrune() {
+    {
+        lock_guard<mutex> lock(m_reloadMutex);
+        m_pruneRequested = true;
+    }
+    m_reloadWake.notify_all();
 }
 
 void Chatmachine::showNSVDStats() {
@@ -676,19 +1216,22 @@ void Chatmachine::showNSVDStats() {
     cout << "NSVD constrained: " << (m_bNSVDConstrained ? "Yes" : "No") << endl;
     cout << "NSVD neural:      " << (m_bNSVDNeural      ? "Yes" : "No") << endl;
     cout << "Turn count:       " << m_turnCount << endl;
-    if (m_pPatternLattice) {
-        cout << "PatternLattice:   " << m_pPatternLattice->size()
+    shared_ptr<brain::Generation> g = m_pBrains->current();
+    if (g && g->lattice) {
+        cout << "PatternLattice:   " << g->lattice->size()
              << " categories" << endl;
     }
     if (m_pLearnableCategoryList) {
         cout << "Learned cats:     "
-             << m_pLearnableCategoryList->size() << endl;
+             << m_pLearnableCategoryList->size() << " (pool "
+             << m_pLearnableCategoryList->poolCapacity() << ")" << endl;
     }
     if (m_pHGNN) {
         cout << "HGNN embeddings:  " << m_pHGNN->size() << endl;
     }
     if (m_pDTESNN) {
-        cout << "DTESNN steps:     " << m_pDTESNN->getStepCount() << endl;
+        cout << "DTESNN steps:     "
+             << (m_pConsole->temporal ? m_pConsole->temporal->getStepCount() : 0) << endl;
     }
     if (m_pMLP) {
         cout << "MLP updates:      " << m_pMLP->getUpdateCount()
@@ -697,9 +1240,46 @@ void Chatmachine::showNSVDStats() {
     if (m_pLogicClassifier) {
         cout << "Logic updates:    " << m_pLogicClassifier->getUpdateCount() << endl;
     }
-    if (m_pWorkflowEngine) {
-        cout << "Workflow done:    " << m_pWorkflowEngine->getCompletionCount() << endl;
-        const auto& stats = m_pWorkflowEngine->getActivationStats();
+    if (m_pPathGate) {
+        static const char* names[path_gate::GATE_PATHS] = {
+            "symbolic", "subsymbolic", "hgnn", "dtesnn", "workflow" };
+        auto gs = m_pPathGate->getStats();
+        double savedTotal = 0.0;
+        for (int p = 0; p < path_gate::GATE_PATHS; ++p) savedTotal += gs.savedMs[p];
+        cout << "Turn deadline:    " << m_turnDeadlineMs << " ms" << endl;
+        cout << "Path gating:      " << gs.decisions << " turns, "
+             << gs.earlyExits << " exact-match early exits, ~"
+             << (long)savedTotal << " ms saved" << endl;
+        for (int p = 0; p < path_gate::GATE_PATHS; ++p) {
+            cout << "  " << names[p] << ": ran " << gs.runs[p]
+                 << " (explore " << gs.explores[p] << "), skipped " << gs.skips[p]
+                 << ", avg " << gs.latencyMs[p] << " ms, saved ~"
+                 << (long)gs.savedMs[p] << " ms, deadline misses "
+                 << gs.deadlineMisses[p] << endl;
+        }
+    }
+    if (m_pChatGPT4oIntegration) {
+        auto as = m_pChatGPT4oIntegration->getAsyncStats();
+        cout << "LLM speculation:  " << (m_bLlmSpeculation ? "on" : "off") << ", "
+             << m_llmSpeculated.load() << " started, " << m_llmSpeculationUsed.load()
+             << " used, " << m_llmSpeculationCancelled.load() << " cancelled ("
+             << as.cancelled << " stopped in flight)" << endl;
+    }
+    if (m_pTrainer) {
+        auto ts = m_pTrainer->getStats();
+        cout << "Trainer:          " << ts.queued << " queued, " << ts.dropped
+             << " dropped, " << ts.batches << " batches, " << ts.samples
+             << " samples" << endl;
+    }
+    {
+        auto ws = m_pWriter->getStats();
+        cout << "File writer:      " << ws.queued << " queued, " << ws.written
+             << " written, " << ws.unchanged << " unchanged, " << ws.failed
+             << " failed, " << ws.dropped << " dropped" << endl;
+    }
+    if (m_pConsole->workflow) {
+        cout << "Workflow done:    " << m_pConsole->workflow->getCompletionCount() << endl;
+        const auto& stats = m_pConsole->workflow->getActivationStats();
         if (!stats.empty()) {
             cout << "Workflow activations: ";
             for (auto it = stats.begin(); it != stats.end(); ++it) {
@@ -717,21 +1297,23 @@ void Chatmachine::showNSVDStats() {
 
 void Chatmachine::showLogicWorkflowStats() {
     cout << "\n=== Logic / Workflow Status ===" << endl;
-    cout << "Last logic class: " << m_lastLogicSystem
-         << " (confidence=" << m_lastLogicConfidence << ")" << endl;
+    const session::Session& console = *m_pConsole;
+    cout << "Last logic class: " << console.lastLogicSystem
+         << " (confidence=" << console.lastLogicConfidence << ")" << endl;
     if (m_pLogicClassifier) {
         cout << "Classifier updates: " << m_pLogicClassifier->getUpdateCount() << endl;
     } else {
         cout << "Classifier: not initialised" << endl;
     }
 
-    if (m_pWorkflowEngine) {
-        cout << "Workflow active: " << (m_pWorkflowEngine->isActive() ? "Yes" : "No") << endl;
-        cout << "Active system: " << logic_meta_patterns::toString(m_pWorkflowEngine->getActiveSystem()) << endl;
-        cout << "Current step: " << m_pWorkflowEngine->getCurrentStepIndex()
-             << "/" << m_pWorkflowEngine->getStepCount() << endl;
-        cout << "Workflow completions: " << m_pWorkflowEngine->getCompletionCount() << endl;
-        const auto& vars = m_pWorkflowEngine->getVariables();
+    if (console.workflow) {
+        const workflow_engine::WorkflowEngine& wf = *console.workflow;
+        cout << "Workflow active: " << (wf.isActive() ? "Yes" : "No") << endl;
+        cout << "Active system: " << logic_meta_patterns::toString(wf.getActiveSystem()) << endl;
+        cout << "Current step: " << wf.getCurrentStepIndex()
+             << "/" << wf.getStepCount() << endl;
+        cout << "Workflow completions: " << wf.getCompletionCount() << endl;
+        const auto& vars = wf.getVariables();
         if (!vars.empty()) {
             cout << "Bound vars: ";
             for (auto it = vars.begin(); it != vars.end(); ++it) {
@@ -750,22 +1332,50 @@ void Chatmachine::showLogicWorkflowStats() {
 // NSVD parallel respond
 // ---------------------------------------------------------------------------
 
-string Chatmachine::nsvd_respond() {
+namespace {
+
+    // What the paths see of a session: the turn's input, pinned brain
+    // generation, predicates and copies of the reservoir state and workflow
+    // engine.  Owned by the path tasks, so a path that misses the deadline
+    // can finish after the turn has returned without touching the live
+    // session; the turn merges back what on-time paths changed.
+    shared_ptr<session::Session> pathView(const session::Session& s) {
+        auto v = make_shared<session::Session>(s.id);
+        v->input        = s.input;
+        v->prevResponse = s.prevResponse;
+        v->vars         = s.vars;
+        v->brain        = s.brain;
+        if (s.temporal)
+            v->temporal.reset(new dtesnn::DeepTreeEchoStateNet(*s.temporal));
+        if (s.workflow)
+            v->workflow.reset(new workflow_engine::WorkflowEngine(*s.workflow));
+        v->lastLogicSystem     = s.lastLogicSystem;
+        v->lastLogicConfidence = s.lastLogicConfidence;
+        v->lastLogicFeatures   = s.lastLogicFeatures;
+        return v;
+    }
+
+} // namespace
+
+string Chatmachine::nsvd_respond(session::Session& s) {
     using namespace constraint_engine;
     using namespace mlp_engine;
 
+    // Read phase: gating and candidate selection only read the shared
+    // brain.  Released before the GPT-4o fallback, which needs nothing from
+    // it once its prompt is built, and before the learning updates.
+    unique_ptr<rw_lock::ReadGuard> readLock(new rw_lock::ReadGuard(m_brainLock));
+
     // 1. Choose constraint profile.
     ResponseConstraints constraints = m_bNSVDConstrained
         ? ConstraintEngine::strictConstraints()
         : ConstraintEngine::defaultConstraints();
 
     // 2. Get context vector from OpenCog layer.
-    map<string, double> contextVector;
-    if (m_pOpenCogIntegration)
-        contextVector = m_pOpenCogIntegration->getContextVector();
+    map<string, double> contextVector = contextSnapshot();
 
     // Capture input by value for lambdas (thread safety).
-    string inputCopy = m_sInput;
+    string inputCopy = s.input;
 
     // Workflow reset command.
     {
@@ -773,89 +1383,214 @@ string Chatmachine::nsvd_respond() {
         transform(upper.begin(), upper.end(), upper.begin(),
                   [](unsigned char c) { return (char)::toupper(c); });
         if (upper == "RESET WORKFLOW") {
-            if (m_pWorkflowEngine) m_pWorkflowEngine->reset();
-            m_lastLogicSystem = "NONE";
-            m_lastLogicConfidence = 0.0;
+            if (s.workflow) s.workflow->reset();
+            s.lastLogicSystem = "NONE";
+            s.lastLogicConfidence = 0.0;
             return "Workflow state reset.";
         }
     }
 
-    // 3. Launch symbolic path asynchronously.
-    auto symbFuture = std::async(std::launch::async,
-        [this, inputCopy]() -> SymbolicResult {
-            return symbolicPath(inputCopy);
-        });
+    // 3. Gating: predict each path's value from last turn's path scores
+    //    and the current HGNN / DTESNN features, then launch only the paths
+    //    worth their expected cost.  An exact, fully-trusted symbolic match
+    //    answers the turn without dispatching anything.
+    auto turnStart = chrono::steady_clock::now();
+    auto msSince = [](chrono::steady_clock::time_point t0) {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    };
+
+    vector<double> hgnnFeats, dtesnnFeats;
+    if (m_bNSVDNeural && m_pHGNN && s.temporal) {
+        vector<string> toks;
+        istringstream iss(inputCopy);
+        string tok;
+        while (iss >> tok) {
+            string lower;
+            for (char c : tok) if (isalpha((unsigned char)c)) lower += tolower((unsigned char)c);
+            if (!lower.empty()) toks.push_back(lower);
+        }
+        hgnnFeats   = m_pHGNN->aggregateEmbeddings(toks);
+        dtesnnFeats = s.temporal->getReadout();
+    }
+
+    pattern_lattice::PatternLattice* lattice = s.brain->lattice.get();
+    bool workflowActive = s.workflow && s.workflow->isActive();
+    Category* exact = (lattice && !workflowActive)
+                      ? lattice->findExact(inputCopy) : nullptr;
+    bool earlyExit = exact && exact->templ() &&
+                     exact->getTruthValue().weight() >= 1.0 &&
+                     !exact->templ()->toString().empty();
+
+    path_gate::GateDecision gate;
+    for (int p = 0; p < path_gate::GATE_PATHS; ++p) gate.run[p] = !earlyExit;
+    if (m_pPathGate) {
+        if (earlyExit) {
+            m_pPathGate->recordEarlyExit();
+        } else {
+            vector<double> predicted;
+            if (m_bNSVDNeural && m_pMLP && m_pHGNN && m_pDTESNN)
+                predicted = m_pMLP->forward(MLPEngine::encodeFeatures(
+                    s.lastPathScores[PATH_SYMBOLIC], s.lastPathScores[PATH_SUBSYMBOLIC],
+                    s.lastPathScores[PATH_HGNN],     s.lastPathScores[PATH_DTESNN],
+                    s.lastPathScores[PATH_WORKFLOW],
+                    hgnnFeats, dtesnnFeats));
+            unsigned pinned = workflowActive ? (1u << PATH_WORKFLOW) : 0u;
+            gate = m_pPathGate->decide(predicted, msSince(turnStart), pinned);
+        }
+    }
 
-    // 4. Sub-symbolic path (parallel).
-    auto subSymFuture = std::async(std::launch::async,
-        [this, inputCopy]() -> SymbolicResult {
-            return subSymbolicPath(inputCopy);
+    // Speculative GPT-4o fallback: when the local paths look unlikely to
+    // answer, send the request now so its network round trip overlaps the
+    // paths instead of following them.  Cancelled below if a local
+    // candidate wins.
+    bool llmAvailable = m_bChatGPT4oEnabled && m_pChatGPT4oIntegration &&
+                        m_pChatGPT4oIntegration->isConfigured();
+    chatgpt4o::LlmRequest speculative;
+    if (llmAvailable && m_bLlmSpeculation && !earlyExit &&
+        s.lastPathScores[PATH_SYMBOLIC] < LLM_SPECULATE_SCORE)
+    {
+        speculative = m_pChatGPT4oIntegration->submitConstrained(
+            inputCopy, s.history,
+            m_pConstraintEngine->buildGPT4oConstraintPrompt(
+                constraints, contextVector, s.recentResponses));
+        m_llmSpeculated++;
+    }
+
+    // All paths share one cancellation token that fires at the turn
+    // deadline.  They run on the path pool, so a path still running at the
+    // deadline can be abandoned: its future is dropped and the path itself
+    // stops at its next cancellation check.  Each task holds its own read
+    // lock and works on a session view it co-owns, so the turn never waits
+    // for a late one.
+    auto deadline = turnStart + chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double, milli>(m_turnDeadlineMs));
+    auto cancel = make_shared<cancel_token::CancelToken>(deadline);
+
+    // Per-path wall-clock time and whether the path ran into the deadline
+    // (and so may have returned a partial result); shared because a late
+    // task outlives this call.  Only read for paths whose future is ready.
+    auto pathMs = make_shared<vector<double>>(path_gate::GATE_PATHS, 0.0);
+    auto pathCut = make_shared<vector<char>>(path_gate::GATE_PATHS, 0);
+    typedef SymbolicResult (Chatmachine::*PathFn)(const string&, session::Session&,
+                                                  const cancel_token::CancelToken*);
+    shared_ptr<session::Session> view = pathView(s);
+    auto launch = [this, &inputCopy, view, cancel, pathMs, pathCut, msSince](int path, PathFn fn) {
+        return m_pPathPool->submit([this, inputCopy, view, cancel, pathMs, pathCut, msSince, path, fn]() {
+            rw_lock::ReadGuard lock(m_brainLock);
+            auto t0 = chrono::steady_clock::now();
+            SymbolicResult r = (this->*fn)(inputCopy, *view, cancel.get());
+            (*pathMs)[path]  = msSince(t0);
+            (*pathCut)[path] = cancel->cancelled();
+            return r;
         });
+    };
+
+    // 4. Symbolic path (parallel).
+    std::future<SymbolicResult> symbFuture;
+    bool symbLaunched = false;
+    if (gate.run[PATH_SYMBOLIC]) {
+        symbFuture = launch(PATH_SYMBOLIC, &Chatmachine::symbolicPath);
+        symbLaunched = true;
+    }
 
-    // 5. HGNN spatial path (parallel, only when neural mode is active).
+    // 5. Sub-symbolic path (parallel).
+    std::future<SymbolicResult> subSymFuture;
+    bool subSymLaunched = false;
+    if (gate.run[PATH_SUBSYMBOLIC]) {
+        subSymFuture = launch(PATH_SUBSYMBOLIC, &Chatmachine::subSymbolicPath);
+        subSymLaunched = true;
+    }
+
+    // 6. HGNN spatial path (parallel, only when neural mode is active).
     std::future<SymbolicResult> hgnnFuture;
     bool hgnnLaunched = false;
-    if (m_bNSVDNeural && m_pHGNN) {
-        hgnnFuture = std::async(std::launch::async,
-            [this, inputCopy]() -> SymbolicResult {
-                return hgnnPath(inputCopy);
-            });
+    if (m_bNSVDNeural && m_pHGNN && gate.run[PATH_HGNN]) {
+        hgnnFuture = launch(PATH_HGNN, &Chatmachine::hgnnPath);
         hgnnLaunched = true;
     }
 
-    // 6. DTESNN temporal path (parallel, only when neural mode is active).
+    // 7. DTESNN temporal path (parallel, only when neural mode is active).
     std::future<SymbolicResult> dtesnnFuture;
     bool dtesnnLaunched = false;
-    if (m_bNSVDNeural && m_pDTESNN) {
-        dtesnnFuture = std::async(std::launch::async,
-            [this, inputCopy, contextVector]() -> SymbolicResult {
-                return dtesnnPath(inputCopy);
-            });
+    if (m_bNSVDNeural && m_pDTESNN && gate.run[PATH_DTESNN]) {
+        dtesnnFuture = launch(PATH_DTESNN, &Chatmachine::dtesnnPath);
         dtesnnLaunched = true;
     }
 
-    // 7. Workflow path (parallel): logic-system classifier + workflow sequencing.
+    // 8. Workflow path (parallel): logic-system classifier + workflow sequencing.
     std::future<SymbolicResult> workflowFuture;
     bool workflowLaunched = false;
-    if (m_pWorkflowEngine && m_pLogicClassifier) {
-        workflowFuture = std::async(std::launch::async,
-            [this, inputCopy]() -> SymbolicResult {
-                return workflowPath(inputCopy);
-            });
+    if (s.workflow && m_pLogicClassifier && gate.run[PATH_WORKFLOW]) {
+        workflowFuture = launch(PATH_WORKFLOW, &Chatmachine::workflowPath);
         workflowLaunched = true;
     }
 
-    // 8. Collect results.
+    // Collect whatever is ready by the deadline.
     SymbolicResult symbResult    = {"", 0.0, 0.0};
     SymbolicResult subSymResult  = {"", 0.0, 0.0};
     SymbolicResult hgnnResult    = {"", 0.0, 0.0};
     SymbolicResult dtesnnResult  = {"", 0.0, 0.0};
     SymbolicResult workflowResult= {"", 0.0, 0.0};
 
-    try { symbResult   = symbFuture.get();   }
-    catch (const exception& e) { cerr << "[NSVD] Symbolic path error: "    << e.what() << endl; }
-    catch (...) { cerr << "[NSVD] Symbolic path: unknown error" << endl; }
-
-    try { subSymResult = subSymFuture.get(); }
-    catch (const exception& e) { cerr << "[NSVD] SubSymbolic path error: " << e.what() << endl; }
-    catch (...) { cerr << "[NSVD] Sub-symbolic path: unknown error" << endl; }
-
-    if (hgnnLaunched) {
-        try { hgnnResult = hgnnFuture.get(); }
-        catch (const exception& e) { cerr << "[NSVD] HGNN path error: "   << e.what() << endl; }
-        catch (...) { cerr << "[NSVD] HGNN path: unknown error" << endl; }
+    if (earlyExit) {
+        symbResult.text       = exact->templ()->toString();
+        symbResult.score      = 1.0;
+        symbResult.confidence = exact->getTruthValue().confidence;
     }
 
-    if (dtesnnLaunched) {
-        try { dtesnnResult = dtesnnFuture.get(); }
-        catch (const exception& e) { cerr << "[NSVD] DTESNN path error: " << e.what() << endl; }
-        catch (...) { cerr << "[NSVD] DTESNN path: unknown error" << endl; }
+    bool missed[path_gate::GATE_PATHS] = { false };
+    bool finished[path_gate::GATE_PATHS] = { false };
+    auto collect = [&](int path, const char* name,
+                       std::future<SymbolicResult>& fut, SymbolicResult& out) {
+        if (fut.wait_until(deadline) != future_status::ready) {
+            missed[path] = true;
+            return;
+        }
+        finished[path] = true;
+        try { out = fut.get(); missed[path] = (*pathCut)[path] != 0; }
+        catch (const exception& e) { cerr << "[NSVD] " << name << " path error: " << e.what() << endl; }
+        catch (...) { cerr << "[NSVD] " << name << " path: unknown error" << endl; }
+    };
+
+    if (symbLaunched)     collect(PATH_SYMBOLIC,    "Symbolic",     symbFuture,     symbResult);
+    if (subSymLaunched)   collect(PATH_SUBSYMBOLIC, "Sub-symbolic", subSymFuture,   subSymResult);
+    if (hgnnLaunched)     collect(PATH_HGNN,        "HGNN",         hgnnFuture,     hgnnResult);
+    if (dtesnnLaunched)   collect(PATH_DTESNN,      "DTESNN",       dtesnnFuture,   dtesnnResult);
+    if (workflowLaunched) collect(PATH_WORKFLOW,    "Workflow",     workflowFuture, workflowResult);
+
+    // Stop late paths now rather than letting them run to the deadline's
+    // natural end of their current loop.
+    cancel->cancel();
+
+    // Keep what finished paths changed in the view: predicates set by the
+    // symbolic path's templates, workflow progress and the logic system.
+    // A late path's changes are dropped with it.
+    if (finished[PATH_SYMBOLIC])
+        s.vars.swap(view->vars);
+    if (finished[PATH_WORKFLOW]) {
+        s.workflow            = std::move(view->workflow);
+        s.lastLogicSystem     = view->lastLogicSystem;
+        s.lastLogicConfidence = view->lastLogicConfidence;
+        s.lastLogicFeatures.swap(view->lastLogicFeatures);
     }
 
-    if (workflowLaunched) {
-        try { workflowResult = workflowFuture.get(); }
-        catch (const exception& e) { cerr << "[NSVD] Workflow path error: " << e.what() << endl; }
-        catch (...) { cerr << "[NSVD] Workflow path: unknown error" << endl; }
+    // Feed latencies and scores back into next turn's gating decision.
+    // Skipped paths keep their previous score so the prediction is not
+    // biased towards "never useful" just because they were not asked;
+    // a path that missed the deadline is charged the full budget instead
+    // (any partial result it returned is still a candidate).
+    bool launched[path_gate::GATE_PATHS] = {
+        symbLaunched, subSymLaunched, hgnnLaunched, dtesnnLaunched, workflowLaunched };
+    const SymbolicResult* results[path_gate::GATE_PATHS] = {
+        &symbResult, &subSymResult, &hgnnResult, &dtesnnResult, &workflowResult };
+    for (int p = 0; p < path_gate::GATE_PATHS; ++p) {
+        if (!launched[p]) continue;
+        if (missed[p]) {
+            if (m_pPathGate) m_pPathGate->recordDeadlineMiss(p);
+            continue;
+        }
+        if (m_pPathGate) m_pPathGate->recordLatency(p, (*pathMs)[p]);
+        s.lastPathScores[p] = results[p]->score;
     }
 
     // 9. Build candidate list.
@@ -882,9 +1617,9 @@ string Chatmachine::nsvd_respond() {
         candidates.emplace_back(workflowResult.text, workflowResult.score,
                                  "workflow", workflowResult.confidence);
 
-    // Add learned categories.
-    if (m_pLearnableCategoryList && m_pPatternLattice) {
-        auto scored = m_pPatternLattice->findBestCategories(
+    // Add learned categories (not needed when an exact match answered).
+    if (m_pLearnableCategoryList && lattice && !earlyExit) {
+        auto scored = lattice->findBestCategories(
             inputCopy, contextVector, 3);
         for (const auto& sc : scored) {
             if (sc.category && sc.category->getTruthValue().immutable == false &&
@@ -898,28 +1633,15 @@ string Chatmachine::nsvd_respond() {
         }
     }
 
-    if (candidates.empty())
+    // Nothing local: go straight to the GPT-4o fallback when there is one.
+    if (candidates.empty() && !llmAvailable)
         return "";
 
     // 10. MLP blend weighting (neural mode only).
     //    Reweight candidate base-scores by the MLP's blend weights.
     int winningPath = -1;
+    vector<double> mlpFeatures;
     if (m_bNSVDNeural && m_pMLP && m_pHGNN && m_pDTESNN) {
-        // Derive HGNN/DTESNN feature vectors for the MLP input.
-        auto inputTokens = [](const string& s) {
-            vector<string> toks;
-            istringstream iss(s);
-            string tok;
-            while (iss >> tok) {
-                string lower;
-                for (char c : tok) if (isalpha((unsigned char)c)) lower += tolower((unsigned char)c);
-                if (!lower.empty()) toks.push_back(lower);
-            }
-            return toks;
-        };
-        auto hgnnFeats   = m_pHGNN->aggregateEmbeddings(inputTokens(inputCopy));
-        auto dtesnnFeats = m_pDTESNN->getReadout();
-
         auto feat = MLPEngine::encodeFeatures(
             symbResult.score,   subSymResult.score,
             hgnnResult.score,   dtesnnResult.score,
@@ -927,6 +1649,7 @@ string Chatmachine::nsvd_respond() {
             hgnnFeats, dtesnnFeats);
 
         auto blendWeights = m_pMLP->forward(feat);
+        mlpFeatures = feat;
 
         // Scale each candidate's base score by its MLP blend weight.
         // The formula (0.5 + 0.5 * w * MLP_OUTPUT_DIM) maps a uniform weight
@@ -946,7 +1669,7 @@ string Chatmachine::nsvd_respond() {
 
     // 11. Apply constraint engine.
     ResponseCandidate best = m_pConstraintEngine->selectBestCandidate(
-        candidates, constraints, contextVector, m_recentResponses);
+        candidates, constraints, contextVector, s.recentResponses);
 
     // Determine winning path index for MLP update.
     if (!best.text.empty()) {
@@ -959,24 +1682,49 @@ string Chatmachine::nsvd_respond() {
 
     string response = best.text;
 
-    // 12. GPT-4o fallback if still empty.
-    if (response.empty() && m_bChatGPT4oEnabled && m_pChatGPT4oIntegration &&
-        m_pChatGPT4oIntegration->isConfigured())
+    // A local candidate won: the speculative request is not needed.
+    if (!response.empty() && speculative.valid()) {
+        speculative.cancel();
+        m_llmSpeculationCancelled++;
+    }
+
+    // 12. GPT-4o fallback if still empty, from the speculative request when
+    //     one is in flight.  The prompt is built under the read lock; the
+    //     wait for the reply is not, so a slow upstream cannot hold off
+    //     writers.
+    bool fallback = response.empty() && llmAvailable;
+    string constraintPrompt;
+    if (fallback && !speculative.valid())
+        constraintPrompt = m_pConstraintEngine->buildGPT4oConstraintPrompt(
+            constraints, contextVector, s.recentResponses);
+    readLock.reset();
+
+    if (fallback)
     {
         cout << "[NSVD → ChatGPT-4o constrained...]" << endl;
-        string constraintPrompt = m_pConstraintEngine->buildGPT4oConstraintPrompt(
-            constraints, contextVector, m_recentResponses);
-        string gptResp = m_pChatGPT4oIntegration->generateConstrainedResponse(
-            inputCopy, m_conversationHistory, constraintPrompt);
+        string gptResp;
+        chatgpt4o::TokenSink forward = gptForwarder(s);
+        if (speculative.valid()) {
+            gptResp = speculative.get(forward);
+            m_llmSpeculationUsed++;
+        } else {
+            gptResp = forward
+                ? m_pChatGPT4oIntegration->streamConstrainedResponse(
+                      inputCopy, s.history, constraintPrompt, forward)
+                : m_pChatGPT4oIntegration->generateConstrainedResponse(
+                      inputCopy, s.history, constraintPrompt);
+        }
         if (!gptResp.empty()) {
             response = "[GPT-4o] " + gptResp;
             best = ResponseCandidate(response, 0.6, "gpt4o", 1.0);
         }
     }
 
-    // 13. Post-response updates.
+    // 13. Post-response updates, exclusive against other turns (and
+    //     against late paths, which hold their own read locks).
     if (!response.empty()) {
-        updateNSVDState(inputCopy, response, winningPath);
+        rw_lock::WriteGuard writeLock(m_brainLock);
+        updateNSVDState(s, inputCopy, response, winningPath, mlpFeatures);
         if (m_bNSVDLearning && best.source == "gpt4o")
             maybeSynthesizeCategory(inputCopy, response);
     }
@@ -984,16 +1732,16 @@ string Chatmachine::nsvd_respond() {
     return response;
 }
 
-Chatmachine::SymbolicResult Chatmachine::symbolicPath(const string& input) {
+Chatmachine::SymbolicResult Chatmachine::symbolicPath(const string& input, session::Session& s,
+                                                      const cancel_token::CancelToken* cancel) {
     SymbolicResult result = {"", 0.0, 0.0};
-    if (!m_pPatternLattice) return result;
+    const pattern_lattice::PatternLattice* lattice = s.brain->lattice.get();
+    if (!lattice || cancel_token::isCancelled(cancel)) return result;
 
-    map<string, double> contextVector;
-    if (m_pOpenCogIntegration)
-        contextVector = m_pOpenCogIntegration->getContextVector();
+    map<string, double> contextVector = contextSnapshot();
 
-    auto candidates = m_pPatternLattice->findBestCategories(
-        input, contextVector, 3);
+    auto candidates = lattice->findBestCategories(
+        input, contextVector, 3, cancel);
 
     for (const auto& sc : candidates) {
         if (!sc.category || !sc.category->templ()) continue;
@@ -1006,7 +1754,8 @@ Chatmachine::SymbolicResult Chatmachine::symbolicPath(const string& input) {
     }
 
     // Fallback to traditional AIML parser if lattice gives nothing.
-    string fallback = get_response(input);
+    if (cancel_token::isCancelled(cancel)) return result;
+    string fallback = get_response(s, s.brain->lists, input, cancel);
     if (!fallback.empty()) {
         result.text       = fallback;
         result.score      = 0.3;
@@ -1015,15 +1764,20 @@ Chatmachine::SymbolicResult Chatmachine::symbolicPath(const string& input) {
     return result;
 }
 
-Chatmachine::SymbolicResult Chatmachine::subSymbolicPath(const string& input) {
+Chatmachine::SymbolicResult Chatmachine::subSymbolicPath(const string& input, session::Session& s,
+                                                         const cancel_token::CancelToken* cancel) {
     SymbolicResult result = {"", 0.0, 0.0};
-    if (!m_pOpenCogIntegration) return result;
+    if (!m_pOpenCogIntegration || cancel_token::isCancelled(cancel)) return result;
+
+    // Writes the shared context vector and reads the AtomSpace alongside
+    // other sessions' turns.
+    lock_guard<mutex> lock(m_opencogMutex);
 
     // 1. Update context vector.
     m_pOpenCogIntegration->updateContextVector(input);
 
     // 2. Try concept interpolation via DiffusionEngine.
-    if (m_pDiffusionEngine) {
+    if (m_pDiffusionEngine && !cancel_token::isCancelled(cancel)) {
         auto topConcepts = m_pOpenCogIntegration->getTopConcepts(2);
         if (topConcepts.size() >= 2) {
             string blend = m_pDiffusionEngine->interpolateConcepts(
@@ -1043,6 +1797,7 @@ Chatmachine::SymbolicResult Chatmachine::subSymbolicPath(const string& input) {
     }
 
     // 3. OpenCog knowledge-based generation.
+    if (cancel_token::isCancelled(cancel)) return result;
     string kbResponse = m_pOpenCogIntegration->generateKnowledgeBasedResponse(input);
     if (!kbResponse.empty()) {
         result.text       = kbResponse;
@@ -1065,20 +1820,61 @@ void Chatmachine::maybeSynthesizeCategory(const string& input,
         cleanResponse = cleanResponse.substr(prefix.size());
     }
 
+    // Into the current generation, which may be newer than the one this
+    // turn ran on.  A pattern learned before gets the response as another
+    // alternative, and the repeat counts towards its consolidation.
+    lock_guard<mutex> learnLock(m_learnMutex);
+    bool created = false;
     aiml::Category* cat = m_pLearnableCategoryList->synthesize(input,
-                                                                 cleanResponse);
-    if (cat && m_pPatternLattice)
-        m_pPatternLattice->addLearnedCategory(cat);
+                                                                 cleanResponse,
+                                                                 &created);
+    if (!cat) return;
+    shared_ptr<brain::Generation> g = m_pBrains->current();
+    if (created && g->lattice)
+        g->lattice->addLearnedCategory(cat);
+    if (!created)
+        cat->reinforceMatch();
+    if (g->cache)
+        g->cache->invalidate();
+}
+
+void Chatmachine::pruneLearned() {
+    if (!m_pLearnableCategoryList) return;
+
+    // Turns go on during the scan; only a prune takes the brain.
+    {
+        lock_guard<mutex> learnLock(m_learnMutex);
+        if (!m_pLearnableCategoryList->anyBelow(aiml::LEARNED_PRUNE_CONFIDENCE))
+            return;
+    }
+
+    // Every generation a session may still hold must drop the pruned
+    // categories before they are freed.  No turn reads a lattice
+    // meanwhile (exclusive brain lock), and a reload copies learned
+    // categories under the learning lock.
+    rw_lock::WriteGuard writeLock(m_brainLock);
+    lock_guard<mutex> learnLock(m_learnMutex);
+    size_t pruned = m_pLearnableCategoryList->prune(aiml::LEARNED_PRUNE_CONFIDENCE,
+        [this](const unordered_set<aiml::Category*>& doomed) {
+            for (const auto& live : m_pBrains->live())
+                if (live->lattice)
+                    live->lattice->removeCategories(doomed);
+        });
+    shared_ptr<brain::Generation> g = m_pBrains->current();
+    if (g->cache && pruned > 0)
+        g->cache->invalidate();
 }
 
 // ---------------------------------------------------------------------------
 // HGNN spatial path
 // ---------------------------------------------------------------------------
 
-Chatmachine::SymbolicResult Chatmachine::hgnnPath(const string& input)
+Chatmachine::SymbolicResult Chatmachine::hgnnPath(const string& input, session::Session& s,
+                                                  const cancel_token::CancelToken* cancel)
 {
     SymbolicResult result = {"", 0.0, 0.0};
-    if (!m_pHGNN || !m_pPatternLattice) return result;
+    const pattern_lattice::PatternLattice* lattice = s.brain->lattice.get();
+    if (!m_pHGNN || !lattice || cancel_token::isCancelled(cancel)) return result;
 
     // Extract input concepts (tokenise input into lowercase words).
     vector<string> inputTokens;
@@ -1094,14 +1890,13 @@ Chatmachine::SymbolicResult Chatmachine::hgnnPath(const string& input)
     }
 
     // Use the cached (read-only) HGNN embeddings to score PatternLattice candidates.
-    map<string, double> contextVector;
-    if (m_pOpenCogIntegration)
-        contextVector = m_pOpenCogIntegration->getContextVector();
+    map<string, double> contextVector = contextSnapshot();
 
-    auto candidates = m_pPatternLattice->findBestCategories(input, contextVector, 5);
+    auto candidates = lattice->findBestCategories(input, contextVector, 5, cancel);
     double bestScore = -1.0;
 
     for (const auto& sc : candidates) {
+        if (cancel_token::isCancelled(cancel)) break;
         if (!sc.category || !sc.category->templ()) continue;
         string text = sc.category->templ()->toString();
         if (text.empty()) continue;
@@ -1124,24 +1919,25 @@ Chatmachine::SymbolicResult Chatmachine::hgnnPath(const string& input)
 // DTESNN temporal path
 // ---------------------------------------------------------------------------
 
-Chatmachine::SymbolicResult Chatmachine::dtesnnPath(const string& input)
+Chatmachine::SymbolicResult Chatmachine::dtesnnPath(const string& input, session::Session& s,
+                                                    const cancel_token::CancelToken* cancel)
 {
     SymbolicResult result = {"", 0.0, 0.0};
-    if (!m_pDTESNN || !m_pPatternLattice) return result;
+    const pattern_lattice::PatternLattice* lattice = s.brain->lattice.get();
+    if (!s.temporal || !lattice || cancel_token::isCancelled(cancel)) return result;
 
-    map<string, double> contextVector;
-    if (m_pOpenCogIntegration)
-        contextVector = m_pOpenCogIntegration->getContextVector();
+    map<string, double> contextVector = contextSnapshot();
 
-    auto candidates = m_pPatternLattice->findBestCategories(input, contextVector, 5);
+    auto candidates = lattice->findBestCategories(input, contextVector, 5, cancel);
     double bestScore = -1.0;
 
     for (const auto& sc : candidates) {
+        if (cancel_token::isCancelled(cancel)) break;
         if (!sc.category || !sc.category->templ()) continue;
         string text = sc.category->templ()->toString();
         if (text.empty()) continue;
 
-        double temporalScore = m_pDTESNN->scoreResponse(text, contextVector);
+        double temporalScore = s.temporal->scoreResponse(text, contextVector);
         double combined      = 0.5 * sc.score + 0.5 * temporalScore;
 
         if (combined > bestScore) {
@@ -1155,20 +1951,20 @@ Chatmachine::SymbolicResult Chatmachine::dtesnnPath(const string& input)
     return result;
 }
 
-Chatmachine::SymbolicResult Chatmachine::workflowPath(const string& input)
+Chatmachine::SymbolicResult Chatmachine::workflowPath(const string& input, session::Session& s,
+                                                      const cancel_token::CancelToken* cancel)
 {
     SymbolicResult result = {"", 0.0, 0.0};
-    if (!m_pWorkflowEngine || !m_pLogicClassifier) return result;
+    if (!s.workflow || !m_pLogicClassifier || cancel_token::isCancelled(cancel))
+        return result;
 
-    map<string, double> contextVector;
-    if (m_pOpenCogIntegration)
-        contextVector = m_pOpenCogIntegration->getContextVector();
+    map<string, double> contextVector = contextSnapshot();
 
     // Explicit user override: USE <SYSTEM>: <input>
     logic_meta_patterns::LogicSystem overrideSystem = logic_meta_patterns::LOGIC_NONE;
     string remainingInput;
     if (m_pLogicClassifier->parseOverride(input, overrideSystem, remainingInput)) {
-        auto activated = m_pWorkflowEngine->activate(
+        auto activated = s.workflow->activate(
             overrideSystem,
             remainingInput.empty() ? input : remainingInput);
         if (!activated.response.empty()) {
@@ -1176,37 +1972,46 @@ Chatmachine::SymbolicResult Chatmachine::workflowPath(const string& input)
             result.score = activated.score;
             result.confidence = activated.confidence;
         }
-        m_lastLogicSystem = logic_meta_patterns::toString(overrideSystem);
-        m_lastLogicConfidence = 1.0;
+        s.lastLogicSystem = logic_meta_patterns::toString(overrideSystem);
+        s.lastLogicConfidence = 1.0;
+        s.lastLogicFeatures.clear();
         if (overrideSystem != logic_meta_patterns::LOGIC_NONE) {
-            m_pLogicClassifier->reinforce(input, contextVector, m_pHGNN.get(), m_pDTESNN.get(),
-                                          overrideSystem, 0.05);
+            if (m_pTrainer)
+                m_pTrainer->submitLogic(m_pLogicClassifier->buildFeatures(
+                    input, contextVector, m_pHGNN.get(), s.temporal.get()),
+                    overrideSystem, 0.05);
+            else
+                m_pLogicClassifier->reinforce(input, contextVector, m_pHGNN.get(),
+                                              s.temporal.get(), overrideSystem, 0.05);
         }
         return result;
     }
 
     // Continue active workflow first.
-    if (m_pWorkflowEngine->isActive()) {
-        auto progressed = m_pWorkflowEngine->advance(input);
+    if (s.workflow->isActive()) {
+        auto progressed = s.workflow->advance(input);
         if (!progressed.response.empty()) {
             result.text = progressed.response;
             result.score = progressed.score;
             result.confidence = progressed.confidence;
         }
-        m_lastLogicSystem = logic_meta_patterns::toString(m_pWorkflowEngine->getActiveSystem());
-        m_lastLogicConfidence = progressed.confidence;
+        s.lastLogicSystem = logic_meta_patterns::toString(s.workflow->getActiveSystem());
+        s.lastLogicConfidence = progressed.confidence;
+        s.lastLogicFeatures.clear();
         return result;
     }
 
     // Classify and activate if confidence is high enough.
-    auto c = m_pLogicClassifier->classify(input, contextVector, m_pHGNN.get(), m_pDTESNN.get());
-    m_lastLogicSystem = logic_meta_patterns::toString(c.system);
-    m_lastLogicConfidence = c.confidence;
+    if (cancel_token::isCancelled(cancel)) return result;
+    auto c = m_pLogicClassifier->classify(input, contextVector, m_pHGNN.get(), s.temporal.get());
+    s.lastLogicSystem = logic_meta_patterns::toString(c.system);
+    s.lastLogicConfidence = c.confidence;
+    s.lastLogicFeatures = c.features;
 
     if (c.system == logic_meta_patterns::LOGIC_NONE || c.confidence < 0.60)
         return result;
 
-    auto activated = m_pWorkflowEngine->activate(c.system, input);
+    auto activated = s.workflow->activate(c.system, input);
     if (!activated.response.empty()) {
         result.text = activated.response;
         result.score = activated.score;
@@ -1215,9 +2020,11 @@ Chatmachine::SymbolicResult Chatmachine::workflowPath(const string& input)
     return result;
 }
 
-void Chatmachine::updateNSVDState(const string& input,
+void Chatmachine::updateNSVDState(session::Session& s,
+                                   const string& input,
                                    const string& response,
-                                   int winningPath) {
+                                   int winningPath,
+                                   const vector<double>& mlpFeatures) {
     m_turnCount++;
 
     // Update context vector in OpenCog layer.
@@ -1242,48 +2049,41 @@ void Chatmachine::updateNSVDState(const string& input,
     // --- Neural module updates (inner-loop work) ---
 
     // DTESNN: advance reservoir state with current context.
-    if (m_bNSVDNeural && m_pDTESNN && m_pOpenCogIntegration) {
+    if (m_bNSVDNeural && s.temporal && m_pOpenCogIntegration) {
         auto inputFeats = dtesnn::DeepTreeEchoStateNet::encodeContextVector(
             m_pOpenCogIntegration->getContextVector());
-        m_pDTESNN->step(inputFeats);
+        s.temporal->step(inputFeats);
     }
 
-    // MLP: backprop toward the winning path (if known).
-    if (m_bNSVDNeural && m_pMLP && m_pHGNN && m_pDTESNN &&
+    // MLP: queue the features this turn's blend actually used, labelled
+    // with the winning path; the background trainer does the backprop.
+    if (m_bNSVDNeural && m_pMLP && !mlpFeatures.empty() &&
         winningPath >= 0 && winningPath < mlp_engine::MLP_OUTPUT_DIM)
     {
-        auto hgnnFeats   = m_pHGNN->aggregateEmbeddings(
-            [&]() {
-                vector<string> toks;
-                istringstream iss(input);
-                string tok;
-                while (iss >> tok) {
-                    string lower;
-                    for (char c : tok)
-                        if (isalpha((unsigned char)c)) lower += tolower((unsigned char)c);
-                    if (!lower.empty()) toks.push_back(lower);
-                }
-                return toks;
-            }());
-        auto dtesnnFeats = m_pDTESNN->getReadout();
-
-        auto feat = mlp_engine::MLPEngine::encodeFeatures(
-            0.5, 0.5, 0.5, 0.5, 0.5,   // placeholder scores for backward pass
-            hgnnFeats, dtesnnFeats);
-        m_pMLP->backward(feat, winningPath, m_pMLP->getLearningRate());
+        if (m_pTrainer)
+            m_pTrainer->submitMLP(mlpFeatures, winningPath);
+        else
+            m_pMLP->backward(mlpFeatures, winningPath, m_pMLP->getLearningRate());
     }
 
     // Logic-classifier reinforcement when workflow path wins.
     if (m_pLogicClassifier && winningPath == mlp_engine::PATH_WORKFLOW &&
-        !m_lastLogicSystem.empty() && m_lastLogicSystem != "NONE")
+        !s.lastLogicSystem.empty() && s.lastLogicSystem != "NONE")
     {
-        auto system = logic_meta_patterns::logicSystemFromString(m_lastLogicSystem);
+        auto system = logic_meta_patterns::logicSystemFromString(s.lastLogicSystem);
         if (system != logic_meta_patterns::LOGIC_NONE) {
-            map<string, double> contextVector;
-            if (m_pOpenCogIntegration)
-                contextVector = m_pOpenCogIntegration->getContextVector();
-            m_pLogicClassifier->reinforce(
-                input, contextVector, m_pHGNN.get(), m_pDTESNN.get(), system, 0.01);
+            // Workflow continuations skip classify(); build features now.
+            if (s.lastLogicFeatures.empty()) {
+                map<string, double> contextVector = contextSnapshot();
+                s.lastLogicFeatures = m_pLogicClassifier->buildFeatures(
+                    input, contextVector, m_pHGNN.get(), s.temporal.get());
+            }
+            if (m_pTrainer) {
+                m_pTrainer->submitLogic(s.lastLogicFeatures, system, 0.01);
+            } else {
+                logic_classifier::TrainingSample sample = {s.lastLogicFeatures, system, 0.01};
+                m_pLogicClassifier->trainBatch(vector<logic_classifier::TrainingSample>(1, sample));
+            }
         }
     }
 
@@ -1302,30 +2102,22 @@ void Chatmachine::updateNSVDState(const string& input,
         if (outerNow > m_lastOuterLoopCount) {
             m_pMLP->decayLearningRate(0.95);
             m_lastOuterLoopCount = outerNow;
+            requestModelSave();
         }
     }
 
-    // Decay learned categories.
+    // Decay learned categories (lazily; static ones never decay).
     if (m_pLearnableCategoryList)
-        m_pLearnableCategoryList->decayAll(0.99);
-
-    // Decay pattern lattice.
-    if (m_pPatternLattice)
-        m_pPatternLattice->decayAll(0.99);
+        m_pLearnableCategoryList->tick();
 
     // Rolling recent-responses window.
-    m_recentResponses.push_back(response);
-    if ((int)m_recentResponses.size() > 10)
-        m_recentResponses.erase(m_recentResponses.begin());
+    s.recentResponses.push_back(response);
+    if (s.recentResponses.size() > session::SESSION_RECENT_MAX)
+        s.recentResponses.erase(s.recentResponses.begin());
 
     // Conversation history for GPT-4o.
-    if (m_bChatGPT4oEnabled) {
-        m_conversationHistory.push_back(input);
-        m_conversationHistory.push_back(response);
-        if (m_conversationHistory.size() > 20)
-            m_conversationHistory.erase(m_conversationHistory.begin(),
-                                         m_conversationHistory.begin() + 2);
-    }
+    if (m_bChatGPT4oEnabled)
+        s.remember(input, response);
 
     // Periodic consolidation (every 20 turns when learning is enabled).
     // Superseded by DiffusionEngine outer-loop for pure consolidation, but
@@ -1333,13 +2125,18 @@ void Chatmachine::updateNSVDState(const string& input,
     if (m_bNSVDLearning && m_pDiffusionEngine &&
         m_pLearnableCategoryList && m_turnCount % 20 == 0)
     {
-        m_pDiffusionEngine->consolidateLearnedCategories(
-            m_pLearnableCategoryList.get(), "database/Learned/");
-        if (m_pWorkflowEngine) {
-            m_pDiffusionEngine->consolidateWorkflowCategories(
-                m_pWorkflowEngine.get(), "database/logic/");
+        int exported = m_pDiffusionEngine->consolidateLearnedCategories(
+            m_pLearnableCategoryList.get(), consolidation::LEARNED_DIR);
+        if (s.workflow) {
+            exported += m_pDiffusionEngine->consolidateWorkflowCategories(
+                s.workflow.get(), consolidation::WORKFLOW_DIR);
         }
-        m_pLearnableCategoryList->prune(0.02);
+        // The new files join the brain on the reloader thread, once the
+        // writer has put them on disk.
+        if (exported > 0)
+            m_pWriter->then([this]() { reload(); });
+        // The scan for categories that decayed away runs off the turn too.
+        requestPrune();
         m_pDiffusionEngine->garbageCollectBlends(0.05);
     }
 }
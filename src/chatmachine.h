@@ -3,8 +3,15 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <memory>
 #include <future>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <condition_variable>
+#include "rw_lock.h"
 
 using namespace std;
 
@@ -51,10 +58,45 @@ namespace dtesnn {
     class DeepTreeEchoStateNet;
 }
 
+namespace replay_trainer {
+    class ReplayTrainer;
+}
+
+namespace path_gate {
+    class PathGate;
+}
+
+namespace worker_pool {
+    class WorkerPool;
+}
+
+namespace cancel_token {
+    class CancelToken;
+}
+
+namespace session {
+    struct Session;
+}
+
+namespace response_cache {
+    class ResponseCache;
+}
+
 namespace aiml {
     class LearnableCategoryList;
+    class CategoryList;
     class Category;
 }
+
+namespace write_behind {
+    class FileWriter;
+}
+
+namespace brain {
+    class Registry;
+    struct Generation;
+    struct Source;
+}
 
 class Chatmachine {
 public:
@@ -83,7 +125,49 @@ public:
     void setNSVDNeural(bool enabled)      { m_bNSVDNeural    = enabled; }
     void initializeNSVD();
     void showNSVDStats();
+
+    // Persist / restore all neural weights (database/nsvd_model.bin).
+    // Saving trains what the replay trainer still has queued, renders the
+    // file under a shared brain lock and queues it on the background
+    // writer; false if dropped.  It waits on training, so turns ask the
+    // reloader thread to do it instead (requestModelSave()).
+    bool saveNSVDModel();
     void showLogicWorkflowStats();
+
+    // --- Multi-session use (see session.h, server.h) ---
+    // A fresh conversation sharing this bot's brain.
+    shared_ptr<session::Session> newSession(const string& id);
+    // One turn for session s; input must already be normalised.  Returns the
+    // reply line.  Turns for different sessions may run concurrently; turns
+    // for one session must not.
+    string respondTo(session::Session& s, const string& input);
+    // Upper-case, collapse whitespace, pad punctuation (as listen() does).
+    static string normalized(string input);
+    // Upper bound on concurrent respondTo() calls; sizes the NSVD path pool.
+    // Call before createCategoryLists().
+    void setConcurrentTurns(int turns) { m_concurrentTurns = turns > 0 ? turns : 1; }
+
+    // --- Pre-forked workers (see prefork.h) ---
+    // fork() only copies the calling thread: stop the background threads
+    // (path pool, replay trainer, file writer, reloader) before forking,
+    // and start them again in each child with afterFork().  workerIndex
+    // tags the files the child writes so workers never collide.
+    void prepareFork();
+    void afterFork(int workerIndex);
+    // Write out the files still queued (a worker calls this before _exit(),
+    // which skips the destructor).
+    void flushFiles();
+    // The background file writer, for other stores writing through it
+    // (the server's session snapshots).
+    write_behind::FileWriter* fileWriter() { return m_pWriter.get(); }
+
+    // --- Hot reload (see brain.h) ---
+    // Ask the reloader thread to re-read the AIML files that changed since
+    // they were loaded (consolidated ones included, see consolidation.h)
+    // and swap the new brain in when it is built.  Turns already running
+    // finish on the old one.  Safe from any thread; false if a reload is
+    // already waiting to start.
+    bool reload();
     
     // Public access to input for main loop
     string m_sInput;
@@ -91,49 +175,96 @@ public:
 private:
     void init_random();
     void normalize(string &input);
-    string get_response(string input);
-    string get_best_response(string input);
-    void setResponse(string sResponse);
+    // lists: the categories to match, in priority order (normally the
+    // lists of the turn's brain generation).
+    string get_response(session::Session& s, const vector<aiml::CategoryList*>& lists,
+                        string input, const cancel_token::CancelToken* cancel = nullptr);
+    string get_best_response(session::Session& s, const vector<aiml::CategoryList*>& lists,
+                             string input, const cancel_token::CancelToken* cancel = nullptr);
+    void setResponse(session::Session& s, string sResponse);
     void prepare_response(string &resp);
-    void shuffle();
+    void shuffle(vector<aiml::CategoryList*>& lists);
 
     // NSVD parallel pipeline — returns the best candidate response string.
-    string nsvd_respond();
+    // Reads the brain under a shared lock; learning updates take it exclusively.
+    string nsvd_respond(session::Session& s);
 
     // Symbolic path: PatternLattice lookup with context-aware scoring.
-    // Returns {response, score, confidence}.
+    // Returns {response, score, confidence}.  Every path takes a private
+    // view of the turn's session and its cancellation token, and returns
+    // early (possibly empty) once the token fires.
     struct SymbolicResult { string text; double score; double confidence; };
-    SymbolicResult symbolicPath(const string& input);
+    SymbolicResult symbolicPath(const string& input, session::Session& s,
+                                const cancel_token::CancelToken* cancel = nullptr);
 
     // Sub-symbolic path: AtomSpace + optional GPT-4o.
-    SymbolicResult subSymbolicPath(const string& input);
+    SymbolicResult subSymbolicPath(const string& input, session::Session& s,
+                                   const cancel_token::CancelToken* cancel = nullptr);
 
     // HGNN async path: spatially-scored PatternLattice result.
-    SymbolicResult hgnnPath(const string& input);
+    SymbolicResult hgnnPath(const string& input, session::Session& s,
+                            const cancel_token::CancelToken* cancel = nullptr);
 
     // DTESNN async path: temporally-scored result.
-    SymbolicResult dtesnnPath(const string& input);
+    SymbolicResult dtesnnPath(const string& input, session::Session& s,
+                              const cancel_token::CancelToken* cancel = nullptr);
 
     // Workflow path: logic-system classification + operational workflow routing.
-    SymbolicResult workflowPath(const string& input);
+    SymbolicResult workflowPath(const string& input, session::Session& s,
+                                const cancel_token::CancelToken* cancel = nullptr);
 
     // Synthesise a learnable category if the GPT-4o response is novel enough.
     void maybeSynthesizeCategory(const string& input, const string& response);
+    // Remove learned categories that decayed below LEARNED_PRUNE_CONFIDENCE
+    // (categorylist.h).  Runs on the reloader thread (requestPrune()).
+    void pruneLearned();
+
+    // Consolidate and decay at end of turn.  winningPath = mlp_engine PATH_* index;
+    // mlpFeatures = the MLP input used for this turn's blend (empty if none).
+    void updateNSVDState(session::Session& s,
+                         const string& input, const string& response,
+                         int winningPath = -1,
+                         const vector<double>& mlpFeatures = vector<double>());
+
+    // Queue saveNSVDModel() / pruneLearned() on the reloader thread (from a
+    // turn's update).
+    void requestModelSave();
+    void requestPrune();
+
+    // Give s its NSVD state (reservoir state, workflow engine).
+    void initSessionState(session::Session& s);
 
-    // Consolidate and decay at end of turn.  winningPath = mlp_engine PATH_* index.
-    void updateNSVDState(const string& input, const string& response,
-                         int winningPath = -1);
+    // Streams GPT-4o text to s.partial behind the reply prefix; empty when
+    // the session's front end takes no partial replies.
+    function<bool(const string&)> gptForwarder(session::Session& s);
+
+    // Copy of the OpenCog context vector, safe against concurrent turns.
+    map<string, double> contextSnapshot() const;
+
+    // Hot reload.  The AIML files to load, in order: the current strategy's
+    // set, then the consolidated files (optional).
+    vector<brain::Source> aimlSources() const;
+    // Compact the consolidation directories that have piled up files.
+    void compactConsolidated();
+    // PatternLattice over g's categories and the math primitives (learned
+    // categories are added by the caller).
+    void buildLattice(brain::Generation& g);
+    // One reload: build, publish, then wait until the old generation is
+    // reclaimed.  Runs on the reloader thread.  False when a file failed to
+    // load (the current generation stays).
+    bool rebuildBrain();
+    // The reloader thread: runs requested reloads, model saves and prunes and,
+    // with AIML_WATCH_MS set, reloads whenever an AIML file changes.  A
+    // save still pending when it stops is done before it exits.
+    void startReloader();
+    void stopReloader();
 
 private:
     string m_sChatBotName;
-    string m_sResponse;
-    string m_sPrevInput;
-    string m_sPrevResponse;
     string m_sSubject;
     string m_sAimlFile;
     vector<string> m_vsInputTokens;
     bool m_bInput_prepared;
-    unsigned int m_nFileIndex;
     vector<string> response_list;
     
     // OpenCog integration
@@ -143,14 +274,12 @@ private:
     // ChatGPT-4o integration
     unique_ptr<chatgpt4o::ChatGPT4oIntegration> m_pChatGPT4oIntegration;
     bool m_bChatGPT4oEnabled;
-    vector<string> m_conversationHistory;
 
     // NSVD pipeline
     bool m_bNSVDEnabled;
     bool m_bNSVDLearning;
     bool m_bNSVDConstrained;
     bool m_bNSVDNeural;                                              // HGNN+DTESNN+MLP
-    unique_ptr<pattern_lattice::PatternLattice>      m_pPatternLattice;
     unique_ptr<constraint_engine::ConstraintEngine>  m_pConstraintEngine;
     unique_ptr<diffusion_engine::DiffusionEngine>    m_pDiffusionEngine;
     unique_ptr<aiml::LearnableCategoryList>          m_pLearnableCategoryList;
@@ -160,14 +289,58 @@ private:
     unique_ptr<dtesnn::DeepTreeEchoStateNet>         m_pDTESNN;
     unique_ptr<mlp_engine::MLPEngine>                m_pMLP;
     unique_ptr<logic_classifier::LogicClassifier>    m_pLogicClassifier;
-    unique_ptr<workflow_engine::WorkflowEngine>      m_pWorkflowEngine;
+    // Declared after the engines it trains so it is destroyed (and joined) first.
+    unique_ptr<replay_trainer::ReplayTrainer>        m_pTrainer;
+    unique_ptr<path_gate::PathGate>                  m_pPathGate;
+    // Runs the NSVD paths; declared after the engines so queued tasks finish first.
+    unique_ptr<worker_pool::WorkerPool>              m_pPathPool;
+    double                                           m_turnDeadlineMs;
+    int                                              m_concurrentTurns;
     vector<unique_ptr<aiml::Category>>               m_runtimeCategories;
 
-    vector<string> m_recentResponses;   // rolling window for anti-repetition
+    // Speculative GPT-4o fallback in nsvd_respond: started alongside the
+    // paths when the symbolic answer looks weak, cancelled if a local
+    // candidate wins.
+    bool                                             m_bLlmSpeculation;
+    atomic<size_t>                                   m_llmSpeculated;
+    atomic<size_t>                                   m_llmSpeculationUsed;
+    atomic<size_t>                                   m_llmSpeculationCancelled;
+
+    // Category lists, PatternLattice and response cache, as one reloadable
+    // generation (see brain.h).  A turn pins the current generation in its
+    // session for its whole length.
+    unique_ptr<brain::Registry>                      m_pBrains;
+    // Held while learned categories are added to or pruned from the
+    // current generation, and while a reload copies them into the next one
+    // and publishes it.  Turns never take it.
+    mutex                                            m_learnMutex;
+    thread                                           m_reloadThread;
+    mutex                                            m_reloadMutex;
+    condition_variable                               m_reloadWake;
+    bool                                             m_reloadRequested;   // under m_reloadMutex
+    bool                                             m_saveRequested;     // under m_reloadMutex
+    bool                                             m_pruneRequested;    // under m_reloadMutex
+    bool                                             m_reloadStop;        // under m_reloadMutex
+    atomic<bool>                                     m_shuttingDown;
+    int                                              m_watchMs;
+
+    // Consolidation files, registry files and model saves are written on
+    // its thread (see write_behind.h), never on a turn's.
+    unique_ptr<write_behind::FileWriter>             m_pWriter;
+
+    // Conversation state for the interactive REPL.
+    shared_ptr<session::Session> m_pConsole;
+
+    // Brain lock: turns read the shared modules under a shared lock and
+    // apply learning updates under an exclusive one.  The OpenCog context
+    // vector is also written during the read phase (sub-symbolic path), so
+    // it has its own mutex.
+    rw_lock::RWLock m_brainLock;
+    mutable mutex   m_opencogMutex;
+
     int            m_turnCount;
     int            m_lastOuterLoopCount; // tracks outer-loop completion for lr decay
-    string         m_lastLogicSystem;
-    double         m_lastLogicConfidence;
+    string         m_modelPath;          // binary model file for neural weights
 };
 
 #endif
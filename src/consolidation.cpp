@@ -0,0 +1,346 @@
+#include "consolidation.h"
+#include "tinyxml.h"
+#include "strings.h"
+#include "write_behind.h"
+#include "llm_cache.h"
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+using namespace consolidation;
+
+namespace {
+
+    static const char* const COMPACTED_NAME = "compacted.aiml";
+
+    bool endsWith(const string& s, const string& suffix) {
+        return s.size() >= suffix.size() &&
+               s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // The children of node as XML, without indentation or line breaks.
+    string innerXml(const TiXmlNode* node) {
+        TiXmlPrinter printer;
+        printer.SetStreamPrinting();
+        for (const TiXmlNode* c = node->FirstChild(); c; c = c->NextSibling())
+            c->Accept(&printer);
+        return trim(printer.CStr());
+    }
+
+    string childXml(const TiXmlElement* element, const char* name) {
+        const TiXmlElement* child = element->FirstChildElement(name);
+        return child ? innerXml(child) : string();
+    }
+
+    string escapeAttribute(const string& value) {
+        string out;
+        for (char c : value) {
+            switch (c) {
+                case '&': out += "&amp;";  break;
+                case '<': out += "&lt;";   break;
+                case '>': out += "&gt;";   break;
+                case '"': out += "&quot;"; break;
+                default:  out += c;
+            }
+        }
+        return out;
+    }
+
+    struct Merged {
+        string topic;
+        string that;
+        string pattern;
+        vector<string> templates;   // unique, first seen first
+    };
+
+    // Merges categories keyed by (topic, that, pattern), in first-seen order.
+    struct Merger {
+        vector<Merged>     categories;
+        map<string, size_t> index;
+        size_t             duplicates;
+
+        Merger() : duplicates(0) {}
+
+        void addTemplate(Merged& m, const string& templ) {
+            if (templ.empty()) return;
+            if (find(m.templates.begin(), m.templates.end(), templ) != m.templates.end())
+                duplicates++;
+            else
+                m.templates.push_back(templ);
+        }
+
+        void addCategory(const string& topic, const TiXmlElement* category) {
+            string pattern = childXml(category, "pattern");
+            if (pattern.empty()) return;
+            string that = childXml(category, "that");
+
+            // Unit separators do not occur in AIML text.
+            string key = topic + '\x1f' + that + '\x1f' + pattern;
+            auto it = index.find(key);
+            if (it == index.end()) {
+                it = index.insert(make_pair(key, categories.size())).first;
+                Merged m;
+                m.topic   = topic;
+                m.that    = that;
+                m.pattern = pattern;
+                categories.push_back(m);
+            }
+            Merged& m = categories[it->second];
+
+            // A template that is one <random> (an earlier merge) contributes
+            // its items; anything else is one alternative.
+            const TiXmlElement* templ = category->FirstChildElement("template");
+            if (!templ) return;
+            const TiXmlElement* random = templ->FirstChildElement("random");
+            bool onlyRandom = random && !random->NextSiblingElement();
+            for (const TiXmlNode* c = templ->FirstChild(); c && onlyRandom; c = c->NextSibling())
+                if (c->ToText()) onlyRandom = false;
+            if (!onlyRandom) {
+                addTemplate(m, innerXml(templ));
+                return;
+            }
+            for (const TiXmlElement* li = random->FirstChildElement("li"); li;
+                 li = li->NextSiblingElement("li"))
+                addTemplate(m, innerXml(li));
+        }
+
+        void addDocument(const TiXmlElement* root) {
+            for (const TiXmlElement* e = root->FirstChildElement(); e;
+                 e = e->NextSiblingElement()) {
+                if (strcmp(e->Value(), "category") == 0) {
+                    addCategory("", e);
+                } else if (strcmp(e->Value(), "topic") == 0) {
+                    const char* name = e->Attribute("name");
+                    for (const TiXmlElement* c = e->FirstChildElement("category"); c;
+                         c = c->NextSiblingElement("category"))
+                        addCategory(name ? name : "", c);
+                }
+            }
+        }
+    };
+
+    void writeCategory(ostringstream& out, const Merged& m, const string& indent) {
+        out << indent << "<category>\n"
+            << indent << "  <pattern>" << m.pattern << "</pattern>\n";
+        if (!m.that.empty())
+            out << indent << "  <that>" << m.that << "</that>\n";
+        if (m.templates.size() == 1) {
+            out << indent << "  <template>" << m.templates[0] << "</template>\n";
+        } else {
+            out << indent << "  <template>\n" << indent << "    <random>\n";
+            for (const auto& t : m.templates)
+                out << indent << "      <li>" << t << "</li>\n";
+            out << indent << "    </random>\n" << indent << "  </template>\n";
+        }
+        out << indent << "</category>\n";
+    }
+
+    // The categories of each topic together, topics in first-seen order.
+    string renderMerged(const vector<Merged>& categories) {
+        ostringstream out;
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<aiml version=\"1.0\">\n";
+        vector<string> topics;
+        for (const Merged& m : categories)
+            if (find(topics.begin(), topics.end(), m.topic) == topics.end())
+                topics.push_back(m.topic);
+        for (const string& topic : topics) {
+            if (!topic.empty())
+                out << "  <topic name=\"" << escapeAttribute(topic) << "\">\n";
+            for (const Merged& m : categories)
+                if (m.topic == topic)
+                    writeCategory(out, m, topic.empty() ? "  " : "    ");
+            if (!topic.empty())
+                out << "  </topic>\n";
+        }
+        out << "</aiml>\n";
+        return out.str();
+    }
+
+    // flock() on dir/.<prefix>compact.lock; released by the destructor.
+    struct DirLock {
+        int fd;
+
+        DirLock(const string& dir, const string& prefix)
+            : fd(open((dir + "/." + prefix + "compact.lock").c_str(),
+                      O_CREAT | O_RDWR, 0644)) {
+            if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        ~DirLock() {
+            if (fd >= 0) {
+                flock(fd, LOCK_UN);
+                close(fd);
+            }
+        }
+        bool held() const { return fd >= 0; }
+    };
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Listing
+// ---------------------------------------------------------------------------
+
+string consolidation::compactedPath(const string& dir, const string& prefix) {
+    return dir + prefix + COMPACTED_NAME;
+}
+
+vector<string> consolidation::listFiles(const string& dir, const string& prefix) {
+    vector<string> names;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return names;
+    string compacted = prefix + COMPACTED_NAME;
+    bool haveCompacted = false;
+    while (struct dirent* entry = readdir(d)) {
+        string name = entry->d_name;
+        if (name == compacted)
+            haveCompacted = true;
+        else if (name.compare(0, prefix.size(), prefix) == 0 && endsWith(name, ".aiml"))
+            names.push_back(name);
+    }
+    closedir(d);
+
+    sort(names.begin(), names.end());
+    vector<string> paths;
+    if (haveCompacted)
+        paths.push_back(compactedPath(dir, prefix));
+    for (const string& name : names)
+        paths.push_back(dir + name);
+    return paths;
+}
+
+// ---------------------------------------------------------------------------
+// Clustering
+// ---------------------------------------------------------------------------
+
+vector<LearnedCategory> consolidation::clusterLearned(const vector<LearnedCategory>& categories,
+                                                      size_t* merged) {
+    // Most confident first, so each cluster is led by its best pattern.
+    vector<size_t> order(categories.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return categories[a].confidence > categories[b].confidence;
+    });
+
+    vector<LearnedCategory>             clusters;
+    vector<llm_cache::Signature>        leaders;   // signature of clusters[i]'s pattern
+    unordered_multimap<uint64_t, size_t> bands;    // band key -> cluster
+    size_t folded = 0;
+
+    for (size_t i : order) {
+        const LearnedCategory& cat = categories[i];
+        llm_cache::Signature sig;
+        bool content = llm_cache::makePatternSignature("learned", cat.pattern, sig);
+
+        // Best leader sharing a band; patterns of only wildcards and filler
+        // words are never merged.
+        size_t best = clusters.size();
+        double bestJaccard = 0.0;
+        if (content) {
+            bool neg = llm_cache::negated(sig.words);
+            for (size_t b = 0; b < llm_cache::LLM_CACHE_BANDS; ++b) {
+                auto range = bands.equal_range(llm_cache::bandKey(sig, b));
+                for (auto it = range.first; it != range.second; ++it) {
+                    const llm_cache::Signature& leader = leaders[it->second];
+                    if (llm_cache::negated(leader.words) != neg) continue;
+                    double j = llm_cache::jaccard(sig.words, leader.words);
+                    if (j < CONSOLIDATION_CLUSTER_JACCARD) continue;
+                    // Most similar; on a tie, the more confident leader.
+                    if (best == clusters.size() || j > bestJaccard ||
+                        (j == bestJaccard && it->second < best)) {
+                        best = it->second;
+                        bestJaccard = j;
+                    }
+                }
+            }
+        }
+
+        if (best < clusters.size()) {
+            vector<string>& templates = clusters[best].templates;
+            for (const string& t : cat.templates)
+                if (find(templates.begin(), templates.end(), t) == templates.end())
+                    templates.push_back(t);
+            folded++;
+            continue;
+        }
+
+        size_t index = clusters.size();
+        clusters.push_back(cat);
+        leaders.push_back(sig);
+        if (content)
+            for (size_t b = 0; b < llm_cache::LLM_CACHE_BANDS; ++b)
+                bands.insert(make_pair(llm_cache::bandKey(sig, b), index));
+    }
+
+    if (merged) *merged = folded;
+    return clusters;
+}
+
+// ---------------------------------------------------------------------------
+// Compaction
+// ---------------------------------------------------------------------------
+
+bool consolidation::compact(const string& dir, const string& prefix, size_t minFiles,
+                            CompactResult& result) {
+    result.files = result.categories = result.duplicates = result.rejected = 0;
+    result.output = compactedPath(dir, prefix);
+    result.error.clear();
+
+    // Cheap check first; listed again under the lock, since another
+    // process may have just compacted.
+    auto enough = [&](const vector<string>& files) {
+        size_t others = files.size();
+        if (!files.empty() && files[0] == result.output) others--;
+        return others >= minFiles;
+    };
+    if (!enough(listFiles(dir, prefix)))
+        return false;
+    DirLock lock(dir, prefix);
+    if (!lock.held())
+        return false;
+    vector<string> files = listFiles(dir, prefix);
+    if (!enough(files))
+        return false;
+
+    Merger merger;
+    vector<string> merged;
+    for (const string& path : files) {
+        TiXmlDocument doc;
+        const TiXmlElement* root = NULL;
+        if (!doc.LoadFile(path.c_str()) || (root = doc.FirstChildElement()) == NULL) {
+            cerr << "[Consolidation] " << (doc.Error() ? doc.ErrorDesc() : "No root element.")
+                 << " " << path << "; renamed to .rejected." << endl;
+            if (rename(path.c_str(), (path + ".rejected").c_str()) == 0)
+                result.rejected++;
+            continue;
+        }
+        merger.addDocument(root);
+        merged.push_back(path);
+    }
+
+    // Written synchronously (the sources are deleted next), through a
+    // temporary, so a reader sees either the old compacted file or the
+    // complete new one.
+    if (!write_behind::writeFileAtomically(result.output, renderMerged(merger.categories),
+                                           result.error))
+        return false;
+    for (const string& path : merged)
+        if (path != result.output)
+            remove(path.c_str());
+
+    result.files      = merged.size();
+    result.categories = merger.categories.size();
+    result.duplicates = merger.duplicates;
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef __CONSOLIDATION_H__
+#define __CONSOLIDATION_H__
+
+/**
+ * consolidation.h — Loading and compacting consolidated AIML (Phase 6)
+ *
+ * DiffusionEngine writes the categories it consolidates to new AIML files
+ * every few turns: learned_<tag><time>_<n>.aiml into database/Learned/ and
+ * workflow_<tag><time>_<n>.aiml into database/logic/.  These files are
+ * part of the brain: Chatmachine loads them after the strategy's AIML set
+ * (as optional sources, see brain.h), and asks for a reload whenever a
+ * consolidation pass wrote one, so new files are parsed and merged into the
+ * running generation without a restart.
+ *
+ * Each pass writes every category above the threshold again, so the files
+ * repeat one another.  compact() merges a directory's files into one,
+ * <prefix>compacted.aiml, keeping each (topic, that, pattern) once with the
+ * union of its templates (several become one <random>), and deletes the
+ * files it merged.  It runs at startup and before each reload once
+ * CONSOLIDATION_COMPACT_FILES files have piled up, which bounds both the
+ * number of files and the startup cost.  A file that does not parse is
+ * renamed to <name>.rejected instead of being merged.
+ *
+ * compact() takes an flock() on a lock file in the directory, so
+ * pre-forked workers never compact the same directory at once; a worker
+ * that finds it taken skips compaction and loads the files as they are.
+ *
+ * Learned patterns that differ only in phrasing ("* how do black holes
+ * form", "how does a black hole form") are merged before they are written
+ * at all: clusterLearned() reduces each pattern to its content words and
+ * wildcards in order (llm_cache::makePatternSignature), buckets the
+ * MinHash signatures by LSH band, and puts a pattern into the cluster of
+ * the most confident pattern it shares a bucket with when their sets of
+ * words and adjacent word pairs have a Jaccard similarity of at least
+ * CONSOLIDATION_CLUSTER_JACCARD and agree on negation.  "my name is *"
+ * and "* is my name" stay apart.  Each pattern is compared with cluster
+ * leaders only, so the pass is roughly linear and clusters do not chain.
+ */
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+namespace consolidation {
+
+    static const char* const LEARNED_DIR     = "database/Learned/";
+    static const char* const LEARNED_PREFIX  = "learned_";
+    static const char* const WORKFLOW_DIR    = "database/logic/";
+    static const char* const WORKFLOW_PREFIX = "workflow_";
+
+    // Files that trigger a compaction of their directory.
+    static const size_t CONSOLIDATION_COMPACT_FILES = 8;
+
+    // dir/<prefix>compacted.aiml
+    string compactedPath(const string& dir, const string& prefix);
+
+    // The <prefix>*.aiml files in dir: the compacted file first, then the
+    // others in name order.  Empty if dir does not exist.
+    vector<string> listFiles(const string& dir, const string& prefix);
+
+    // Word and word-pair set similarity for two learned patterns to be merged.
+    static const double CONSOLIDATION_CLUSTER_JACCARD = 0.75;
+
+    // A learned category as exported: its pattern and alternative templates
+    // (plain text).
+    struct LearnedCategory {
+        string         pattern;
+        double         confidence;
+        vector<string> templates;
+    };
+
+    // Merge near-duplicate patterns (see above).  Each cluster keeps its
+    // most confident pattern and the union of the templates, in order of
+    // confidence.  merged (if given) receives the number of categories
+    // folded into another.
+    vector<LearnedCategory> clusterLearned(const vector<LearnedCategory>& categories,
+                                           size_t* merged = nullptr);
+
+    struct CompactResult {
+        size_t files;        // files merged (the previous compacted file included)
+        size_t categories;   // categories written
+        size_t duplicates;   // repeated templates dropped
+        size_t rejected;     // unparsable files renamed to .rejected
+        string output;       // the compacted file
+        string error;        // why writing failed; empty on success
+    };
+
+    // Merge dir's <prefix> files into the compacted file when at least
+    // minFiles others are present.  False when nothing was merged (too few
+    // files, the directory is being compacted by another process, or an
+    // error, in which case result.error says why and no file is deleted).
+    bool compact(const string& dir, const string& prefix, size_t minFiles,
+                 CompactResult& result);
+
+} // namespace consolidation
+
+#endif // __CONSOLIDATION_H__
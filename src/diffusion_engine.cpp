@@ -1,16 +1,57 @@
 #include "diffusion_engine.h"
 #include "workflow_engine.h"
+#include "write_behind.h"
+#include "consolidation.h"
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <cmath>
-#include <sys/stat.h>
-#include <cerrno>
-#include <cstring>
 
 using namespace diffusion_engine;
 
+namespace {
+
+    // Learned patterns and templates are plain text (user input, GPT-4o
+    // replies); escape them so the file parses back as AIML.
+    string escapeXml(const string& text) {
+        string out;
+        out.reserve(text.size());
+        for (char c : text) {
+            switch (c) {
+                case '&': out += "&amp;"; break;
+                case '<': out += "&lt;";  break;
+                case '>': out += "&gt;";  break;
+                default:  out += c;
+            }
+        }
+        return out;
+    }
+
+    // One AIML document of learned categories; several templates become
+    // one <random>.
+    string renderLearned(const vector<consolidation::LearnedCategory>& categories) {
+        ostringstream out;
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<aiml version=\"1.0\">\n";
+        for (const auto& cat : categories) {
+            out << "  <category>\n"
+                << "    <pattern>" << escapeXml(cat.pattern) << "</pattern>\n";
+            if (cat.templates.size() == 1) {
+                out << "    <template>" << escapeXml(cat.templates[0]) << "</template>\n";
+            } else {
+                out << "    <template>\n      <random>\n";
+                for (const auto& t : cat.templates)
+                    out << "        <li>" << escapeXml(t) << "</li>\n";
+                out << "      </random>\n    </template>\n";
+            }
+            out << "  </category>\n";
+        }
+        out << "</aiml>\n";
+        return out.str();
+    }
+
+} // namespace
+
 // ---------------------------------------------------------------------------
 // DiffusionEngine
 // ---------------------------------------------------------------------------
@@ -18,7 +59,7 @@ using namespace diffusion_engine;
 DiffusionEngine::DiffusionEngine(AtomSpace& atomSpace)
     : m_atomSpace(atomSpace), m_temperature(1.0), m_consolidationCounter(0),
       m_innerCount(0), m_middleCount(0), m_outerCount(0),
-      m_innerThreshold(10), m_outerThreshold(5)
+      m_innerThreshold(10), m_outerThreshold(5), m_writer(nullptr)
 {}
 
 // --- Temperature ---
@@ -91,66 +132,53 @@ int DiffusionEngine::consolidateLearnedCategories(
     auto candidates = learnedCL->consolidate(threshold);
     if (candidates.empty()) return 0;
 
-    // Ensure output directory exists (best-effort).
-    if (mkdir(outputDir.c_str(), 0755) != 0 && errno != EEXIST) {
-        cerr << "[DiffusionEngine] Failed to create output directory "
-             << outputDir << ": " << strerror(errno) << endl;
-        return 0;
-    }
-
-    // Group candidates that share the same generalised pattern key to merge
-    // semantically redundant categories.
-    // Simple merge strategy: same pattern → unify templates under <random>.
-    map<string, vector<string>> patternToTemplates;
+    // Copied now: the list changes while the writer thread works on them.
+    // The responses synthesised for a pattern are its alternatives.
+    vector<consolidation::LearnedCategory> learned;
     for (Category* cat : candidates) {
         if (!cat->pattern() || !cat->templ()) continue;
-        string pat = cat->pattern()->toString();
-        string tmpl = cat->templ()->toString();
-        if (!pat.empty() && !tmpl.empty())
-            patternToTemplates[pat].push_back(tmpl);
+        consolidation::LearnedCategory lc;
+        lc.pattern    = cat->pattern()->toString();
+        lc.confidence = cat->getTruthValue().confidence;
+        lc.templates  = learnedCL->alternatives(cat);
+        if (lc.templates.empty())
+            lc.templates.push_back(cat->templ()->toString());
+        lc.templates.erase(remove(lc.templates.begin(), lc.templates.end(), string()),
+                           lc.templates.end());
+        if (!lc.pattern.empty() && !lc.templates.empty())
+            learned.push_back(lc);
     }
+    if (learned.empty()) return 0;
 
     // Write a single AIML file for this consolidation pass.
     // Use a per-instance counter to avoid filename collisions within the same second.
-    string filename = outputDir + "/learned_" +
+    string filename = outputDir + "/learned_" + m_fileTag +
                       to_string((long long)time(nullptr)) + "_" +
                       to_string(m_consolidationCounter++) + ".aiml";
-    ofstream out(filename);
-    if (!out.is_open()) {
-        cerr << "[DiffusionEngine] Cannot write to " << filename << endl;
-        return 0;
-    }
 
-    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-        << "<aiml version=\"1.0\">\n";
-
-    int exported = 0;
-    for (const auto& kv : patternToTemplates) {
-        const string& pat = kv.first;
-        const vector<string>& tmpls = kv.second;
-
-        out << "  <category>\n"
-            << "    <pattern>" << pat << "</pattern>\n";
-
-        if (tmpls.size() == 1) {
-            out << "    <template>" << tmpls[0] << "</template>\n";
-        } else {
-            out << "    <template>\n      <random>\n";
-            for (const auto& t : tmpls)
-                out << "        <li>" << t << "</li>\n";
-            out << "      </random>\n    </template>\n";
+    // Clustering and rendering happen on the writer thread, off the turn.
+    // The file is written there directly rather than queued again, so it
+    // is on disk before anything queued after this pass (the reload).
+    auto exportFile = [learned, filename]() {
+        size_t merged = 0;
+        vector<consolidation::LearnedCategory> clusters =
+            consolidation::clusterLearned(learned, &merged);
+        string error;
+        if (!write_behind::writeFileAtomically(filename, renderLearned(clusters), error)) {
+            cerr << "[DiffusionEngine] " << error << endl;
+            return;
         }
-
-        out << "  </category>\n";
-        exported++;
+        cout << "[DiffusionEngine] Consolidated " << learned.size()
+             << " learned categories (" << merged << " near-duplicates merged) -> "
+             << filename << endl;
+    };
+    if (!m_writer) {
+        exportFile();
+    } else if (!m_writer->then(exportFile)) {
+        cerr << "[DiffusionEngine] Writer queue full; not writing " << filename << endl;
+        return 0;
     }
-
-    out << "</aiml>\n";
-    out.close();
-
-    cout << "[DiffusionEngine] Consolidated " << exported
-         << " learned categories -> " << filename << endl;
-    return exported;
+    return (int)learned.size();
 }
 
 int DiffusionEngine::consolidateWorkflowCategories(
@@ -163,22 +191,10 @@ int DiffusionEngine::consolidateWorkflowCategories(
     auto candidates = engine->collectConsolidatedMetaPatterns(threshold);
     if (candidates.empty()) return 0;
 
-    if (mkdir(outputDir.c_str(), 0755) != 0 && errno != EEXIST) {
-        cerr << "[DiffusionEngine] Failed to create workflow output directory "
-             << outputDir << ": " << strerror(errno) << endl;
-        return 0;
-    }
-    string filename = outputDir + "/workflow_" +
+    string filename = outputDir + "/workflow_" + m_fileTag +
                       to_string((long long)time(nullptr)) + "_" +
                       to_string(m_consolidationCounter++) + ".aiml";
-
-    ofstream out(filename.c_str());
-    if (!out.is_open()) {
-        cerr << "[DiffusionEngine] Cannot write workflow consolidation to "
-             << filename << endl;
-        return 0;
-    }
-
+    ostringstream out;
     out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
         << "<aiml version=\"1.0\">\n";
 
@@ -197,7 +213,8 @@ int DiffusionEngine::consolidateWorkflowCategories(
     }
 
     out << "</aiml>\n";
-    out.close();
+    if (!persist(filename, out.str()))
+        return 0;
 
     cout << "[DiffusionEngine] Consolidated " << candidates.size()
          << " workflow categories -> " << filename << endl;
@@ -278,6 +295,17 @@ void DiffusionEngine::outerLoopStep()
 // Private helpers
 // ---------------------------------------------------------------------------
 
+bool DiffusionEngine::persist(const string& filename, string contents) {
+    if (m_writer)
+        return m_writer->submit(filename, std::move(contents));
+    string error;
+    if (!write_behind::writeFileAtomically(filename, contents, error)) {
+        cerr << "[DiffusionEngine] " << error << endl;
+        return false;
+    }
+    return true;
+}
+
 string DiffusionEngine::formatAIMLCategory(const string& pattern,
                                             const string& templateText) const {
     ostringstream ss;
@@ -21,7 +21,8 @@
  *  3. Category consolidation (§4.3):
  *     A LearnableCategoryList is inspected; categories with confidence
  *     above a threshold are serialised as AIML XML into a target directory.
- *     Semantically similar soft categories are merged before export.
+ *     Semantically similar soft categories are merged before export
+ *     (MinHash/LSH clustering, see consolidation::clusterLearned).
  */
 
 #include "atomspace.h"
@@ -37,6 +38,10 @@ namespace workflow_engine {
     class WorkflowEngine;
 }
 
+namespace write_behind {
+    class FileWriter;
+}
+
 namespace diffusion_engine {
 
     class DiffusionEngine {
@@ -71,7 +76,10 @@ namespace diffusion_engine {
 
         // --- Category consolidation (§4.3) ---
         // Write high-confidence soft categories as AIML XML into outputDir.
-        // Returns number of categories exported.
+        // Returns number of categories exported, before near-duplicates are
+        // merged.  With a writer, they are clustered and written on its
+        // thread, ahead of anything queued later.  The files are loaded
+        // back and compacted by Chatmachine (see consolidation.h).
         int consolidateLearnedCategories(LearnableCategoryList* learnedCL,
                                          const string& outputDir,
                                          double threshold = 0.7);
@@ -118,10 +126,19 @@ namespace diffusion_engine {
         int getMiddleLoopCount() const { return m_middleCount; }
         int getOuterLoopCount()  const { return m_outerCount;  }
 
+        // Prefix for consolidation file names, so pre-forked workers writing
+        // to the same directory never pick the same name (e.g. "w2_").
+        void setFileTag(const string& tag) { m_fileTag = tag; }
+
+        // Hand consolidation files to writer instead of writing them on the
+        // calling thread (see write_behind.h).  Null: write synchronously.
+        void setWriter(write_behind::FileWriter* writer) { m_writer = writer; }
+
     private:
         AtomSpace& m_atomSpace;
         double     m_temperature;
         int        m_consolidationCounter; // prevents filename collisions in consolidation
+        string     m_fileTag;              // per-process filename prefix (see setFileTag)
 
         // Names of concepts that were created by interpolation.
         unordered_set<string> m_blendedConcepts;
@@ -132,6 +149,10 @@ namespace diffusion_engine {
         int m_outerCount;      // total outer-loop steps executed
         int m_innerThreshold;  // inner steps per middle-loop trigger (default 10)
         int m_outerThreshold;  // middle steps per outer-loop trigger  (default 5)
+        write_behind::FileWriter* m_writer;   // not owned; may be null
+
+        // Write (or queue) one consolidation file.
+        bool persist(const string& filename, string contents);
 
         // Build an AIML <category> XML string from pattern/template strings.
         string formatAIMLCategory(const string& pattern,
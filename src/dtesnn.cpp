@@ -10,11 +10,34 @@
 using namespace dtesnn;
 
 // ---------------------------------------------------------------------------
-// Construction
+// CSRMatrix
 // ---------------------------------------------------------------------------
 
-DeepTreeEchoStateNet::DeepTreeEchoStateNet()
-    : m_stepCount(0)
+void CSRMatrix::multiplyAdd(const float* x, float* y) const
+{
+    const int*   ptr = rowPtr.data();
+    const int*   idx = colIdx.data();
+    const float* val = values.data();
+    for (int i = 0; i < rows; ++i) {
+        float sum = 0.0f;
+        for (int k = ptr[i], e = ptr[i + 1]; k < e; ++k)
+            sum += val[k] * x[idx[k]];
+        y[i] += sum;
+    }
+}
+
+void CSRMatrix::scale(float factor)
+{
+    for (float& v : values) v *= factor;
+}
+
+// ---------------------------------------------------------------------------
+// ReservoirModel: construction
+// ---------------------------------------------------------------------------
+
+ReservoirModel::ReservoirModel(int reservoirSize, double connectivity)
+    : m_reservoirSize(max(1, reservoirSize)),
+      m_connectivity(max(1e-6, min(1.0, connectivity)))
 {
     // Leak rates: fast → medium → slow (tree leaf → root).
     double leakRates[DTESNN_TREE_DEPTH]     = {0.90, 0.50, 0.10};
@@ -22,60 +45,180 @@ DeepTreeEchoStateNet::DeepTreeEchoStateNet()
 
     m_levels.resize(DTESNN_TREE_DEPTH);
     for (int k = 0; k < DTESNN_TREE_DEPTH; ++k) {
-        // Level 0 receives the external input; higher levels receive the
-        // previous level's state, so their input dimension = DTESNN_RESERVOIR.
-        int inputDim = (k == 0) ? DTESNN_INPUT_DIM : DTESNN_RESERVOIR;
-        initLevel(m_levels[k], inputDim, leakRates[k], spectralRadii[k]);
+        // Level 0 receives the (small, dense) external input; higher levels
+        // receive the previous level's state through a sparse projection.
+        int    inputDim  = (k == 0) ? DTESNN_INPUT_DIM : m_reservoirSize;
+        double inputConn = (k == 0) ? 1.0 : m_connectivity;
+        initLevel(m_levels[k], inputDim, inputConn, leakRates[k], spectralRadii[k]);
     }
 
     // Initialise readout projection:
-    // DTESNN_OUTPUT_DIM × (TREE_DEPTH * RESERVOIR)
-    int fullStateDim = DTESNN_TREE_DEPTH * DTESNN_RESERVOIR;
+    // DTESNN_OUTPUT_DIM × (TREE_DEPTH * reservoirSize)
+    int fullStateDim = DTESNN_TREE_DEPTH * m_reservoirSize;
     double scale = 1.0 / sqrt((double)fullStateDim);
-    m_Wout = randMatrix(DTESNN_OUTPUT_DIM, fullStateDim, scale);
+    m_Wout.resize((size_t)DTESNN_OUTPUT_DIM * fullStateDim);
+    for (float& v : m_Wout) v = randUniform(scale);
+}
+
+ReservoirState ReservoirModel::createState() const
+{
+    ReservoirState s;
+    s.activation.assign((size_t)DTESNN_TREE_DEPTH * m_reservoirSize, 0.0f);
+    s.stepCount = 0;
+    return s;
+}
+
+size_t ReservoirModel::nonZeroWeights() const
+{
+    size_t n = m_Wout.size();
+    for (const auto& level : m_levels)
+        n += level.W.nnz() + level.Win.nnz();
+    return n;
 }
 
 // ---------------------------------------------------------------------------
-// Reservoir step
+// ReservoirModel: persistence
 // ---------------------------------------------------------------------------
 
-void DeepTreeEchoStateNet::step(const vector<double>& inputFeatures)
+namespace {
+
+    void writeCSR(model_store::SectionWriter& out, const CSRMatrix& M)
+    {
+        out.putU32((uint32_t)M.rows);
+        out.putU32((uint32_t)M.cols);
+        out.putI32Array(M.rowPtr.data(), M.rowPtr.size());
+        out.putI32Array(M.colIdx.data(), M.colIdx.size());
+        out.putF32Array(M.values.data(), M.values.size());
+    }
+
+    bool readCSR(model_store::SectionReader& in, CSRMatrix& M,
+                 int rows, int cols)
+    {
+        M.rows = (int)in.getU32();
+        M.cols = (int)in.getU32();
+        if (!in.ok() || M.rows != rows || M.cols != cols) return false;
+        if (!in.getI32Array(M.rowPtr, (size_t)rows + 1)) return false;
+        if (!in.getI32Array(M.colIdx)) return false;
+        if (!in.getF32Array(M.values, M.colIdx.size())) return false;
+
+        // Validate structure so a corrupt file cannot index out of bounds.
+        if (M.rowPtr[0] != 0 || M.rowPtr[rows] != (int)M.colIdx.size())
+            return false;
+        for (int i = 0; i < rows; ++i)
+            if (M.rowPtr[i] > M.rowPtr[i + 1]) return false;
+        for (int j : M.colIdx)
+            if (j < 0 || j >= cols) return false;
+        return true;
+    }
+
+} // namespace
+
+void ReservoirModel::exportTo(model_store::SectionWriter& out) const
 {
+    out.putU32((uint32_t)m_reservoirSize);
+    out.putF64(m_connectivity);
+    out.putU32((uint32_t)m_levels.size());
+    for (const auto& level : m_levels) {
+        out.putU32((uint32_t)level.inputDim);
+        out.putF64(level.leakRate);
+        out.putF64(level.spectralRadius);
+        writeCSR(out, level.W);
+        writeCSR(out, level.Win);
+    }
+    out.putF32Array(m_Wout.data(), m_Wout.size());
+}
+
+shared_ptr<ReservoirModel> ReservoirModel::importFrom(
+    model_store::SectionReader& in)
+{
+    shared_ptr<ReservoirModel> m(new ReservoirModel(Uninitialised()));
+    m->m_reservoirSize = (int)in.getU32();
+    m->m_connectivity  = in.getF64();
+    uint32_t depth     = in.getU32();
+    if (!in.ok() || m->m_reservoirSize <= 0 || depth != DTESNN_TREE_DEPTH)
+        return nullptr;
+
+    int n = m->m_reservoirSize;
+    m->m_levels.resize(depth);
+    for (uint32_t k = 0; k < depth; ++k) {
+        ReservoirLevel& level = m->m_levels[k];
+        level.reservoirSize  = n;
+        level.inputDim       = (int)in.getU32();
+        level.leakRate       = (float)in.getF64();
+        level.spectralRadius = in.getF64();
+        int expectedInput = (k == 0) ? DTESNN_INPUT_DIM : n;
+        if (!in.ok() || level.inputDim != expectedInput) return nullptr;
+        if (!readCSR(in, level.W, n, n))                 return nullptr;
+        if (!readCSR(in, level.Win, n, level.inputDim))  return nullptr;
+    }
+
+    size_t fullStateDim = (size_t)DTESNN_TREE_DEPTH * n;
+    if (!in.getF32Array(m->m_Wout, (size_t)DTESNN_OUTPUT_DIM * fullStateDim))
+        return nullptr;
+    return in.ok() ? m : nullptr;
+}
+
+// ---------------------------------------------------------------------------
+// ReservoirModel: reservoir step
+// ---------------------------------------------------------------------------
+
+void ReservoirModel::step(ReservoirState& state,
+                          const vector<double>& inputFeatures) const
+{
+    size_t fullStateDim = (size_t)DTESNN_TREE_DEPTH * m_reservoirSize;
+    if (state.activation.size() != fullStateDim)
+        state.activation.assign(fullStateDim, 0.0f);
+
+    // Per-thread scratch: the model itself is shared and stays const.
+    static thread_local vector<float> input, pre;
+    input.resize(DTESNN_INPUT_DIM);
+    pre.resize(m_reservoirSize);
+
     // Pad / truncate to DTESNN_INPUT_DIM.
-    vector<double> u = inputFeatures;
-    u.resize(DTESNN_INPUT_DIM, 0.0);
+    for (int j = 0; j < DTESNN_INPUT_DIM; ++j)
+        input[j] = (j < (int)inputFeatures.size()) ? (float)inputFeatures[j] : 0.0f;
 
     // Feed through levels: each level receives the previous level's new state.
+    float* x = state.activation.data();
     for (int k = 0; k < DTESNN_TREE_DEPTH; ++k) {
-        vector<double> levelInput = (k == 0) ? u : m_levels[k - 1].state;
-        m_levels[k].state = updateLevel(m_levels[k], levelInput);
+        float*       levelState = x + (size_t)k * m_reservoirSize;
+        const float* levelInput = (k == 0) ? input.data()
+                                           : levelState - m_reservoirSize;
+        updateLevel(m_levels[k], levelInput, levelState, pre.data());
     }
 
-    m_stepCount++;
+    state.stepCount++;
 }
 
 // ---------------------------------------------------------------------------
-// Readout
+// ReservoirModel: readout
 // ---------------------------------------------------------------------------
 
-vector<double> DeepTreeEchoStateNet::getReadout() const
+vector<double> ReservoirModel::readout(const ReservoirState& state) const
 {
-    auto fullState = getFullState();
+    size_t fullStateDim = (size_t)DTESNN_TREE_DEPTH * m_reservoirSize;
     vector<double> out(DTESNN_OUTPUT_DIM, 0.0);
-    int cols = min((int)fullState.size(), DTESNN_TREE_DEPTH * DTESNN_RESERVOIR);
-    for (int i = 0; i < DTESNN_OUTPUT_DIM; ++i)
-        for (int j = 0; j < cols; ++j)
-            out[i] += m_Wout[i][j] * fullState[j];
+    if (state.activation.size() != fullStateDim) return out;
+
+    const float* x = state.activation.data();
+    for (int i = 0; i < DTESNN_OUTPUT_DIM; ++i) {
+        const float* w = m_Wout.data() + (size_t)i * fullStateDim;
+        float sum = 0.0f;
+        for (size_t j = 0; j < fullStateDim; ++j)
+            sum += w[j] * x[j];
+        out[i] = sum;
+    }
     // Tanh squash to [-1, 1], then remap to [0, 1] for scoring.
     for (double& v : out) v = 0.5 * (1.0 + tanh(v));
     return out;
 }
 
-double DeepTreeEchoStateNet::scoreResponse(
+double ReservoirModel::scoreResponse(
+    const ReservoirState& state,
     const string& response,
     const map<string, double>& contextVector) const
 {
-    if (m_stepCount == 0) return 0.0;
+    if (state.stepCount == 0) return 0.0;
 
     // Encode the response text using the same hashed-binning as context vectors.
     // First build a pseudo context-vector from the response tokens.
@@ -84,8 +227,9 @@ double DeepTreeEchoStateNet::scoreResponse(
         respCtx[tok] += 1.0;
 
     // Encode both.
-    vector<double> reservoirReadout = getReadout();     // DTESNN_OUTPUT_DIM
-    vector<double> respEncoded = encodeContextVector(respCtx);
+    vector<double> reservoirReadout = readout(state);   // DTESNN_OUTPUT_DIM
+    vector<double> respEncoded =
+        DeepTreeEchoStateNet::encodeContextVector(respCtx);
 
     // Project respEncoded to DTESNN_OUTPUT_DIM via dot products with readout.
     // Score = cosine(readout, encoded_response[:OUTPUT_DIM]).
@@ -100,6 +244,41 @@ double DeepTreeEchoStateNet::scoreResponse(
     return 0.5 * (1.0 + dot_rr / (nr * ne));
 }
 
+// ---------------------------------------------------------------------------
+// DeepTreeEchoStateNet: single-conversation wrapper
+// ---------------------------------------------------------------------------
+
+DeepTreeEchoStateNet::DeepTreeEchoStateNet(int reservoirSize,
+                                           double connectivity)
+    : m_model(make_shared<ReservoirModel>(reservoirSize, connectivity))
+{
+    m_state = m_model->createState();
+}
+
+DeepTreeEchoStateNet::DeepTreeEchoStateNet(
+    shared_ptr<const ReservoirModel> model)
+    : m_model(model ? model : make_shared<ReservoirModel>())
+{
+    m_state = m_model->createState();
+}
+
+void DeepTreeEchoStateNet::step(const vector<double>& inputFeatures)
+{
+    m_model->step(m_state, inputFeatures);
+}
+
+vector<double> DeepTreeEchoStateNet::getReadout() const
+{
+    return m_model->readout(m_state);
+}
+
+double DeepTreeEchoStateNet::scoreResponse(
+    const string& response,
+    const map<string, double>& contextVector) const
+{
+    return m_model->scoreResponse(m_state, response, contextVector);
+}
+
 // ---------------------------------------------------------------------------
 // Context-vector encoding
 // ---------------------------------------------------------------------------
@@ -131,9 +310,8 @@ vector<double> DeepTreeEchoStateNet::encodeContextVector(
 
 void DeepTreeEchoStateNet::resetState()
 {
-    for (auto& level : m_levels)
-        fill(level.state.begin(), level.state.end(), 0.0);
-    m_stepCount = 0;
+    fill(m_state.activation.begin(), m_state.activation.end(), 0.0f);
+    m_state.stepCount = 0;
 }
 
 // ---------------------------------------------------------------------------
@@ -147,78 +325,56 @@ double DeepTreeEchoStateNet::temporalSalience(int turnsAgo) const
     return pow(DECAY, (double)turnsAgo);
 }
 
-// ---------------------------------------------------------------------------
-// Private: full reservoir state
-// ---------------------------------------------------------------------------
-
-vector<double> DeepTreeEchoStateNet::getFullState() const
-{
-    vector<double> full;
-    full.reserve(DTESNN_TREE_DEPTH * DTESNN_RESERVOIR);
-    for (const auto& level : m_levels)
-        full.insert(full.end(), level.state.begin(), level.state.end());
-    return full;
-}
-
 // ---------------------------------------------------------------------------
 // Private: reservoir initialisation
 // ---------------------------------------------------------------------------
 
-void DeepTreeEchoStateNet::initLevel(ReservoirLevel& level,
-                                      int inputDim,
-                                      double leakRate,
-                                      double targetSpectralRadius) const
+void ReservoirModel::initLevel(ReservoirLevel& level,
+                                int inputDim,
+                                double inputConnectivity,
+                                double leakRate,
+                                double targetSpectralRadius) const
 {
-    level.reservoirSize   = DTESNN_RESERVOIR;
-    level.leakRate        = leakRate;
+    level.reservoirSize   = m_reservoirSize;
+    level.inputDim        = inputDim;
+    level.leakRate        = (float)leakRate;
     level.spectralRadius  = targetSpectralRadius;
 
-    // Random reservoir matrix scaled to target spectral radius.
-    auto W = randMatrix(DTESNN_RESERVOIR, DTESNN_RESERVOIR, 1.0);
-    level.W = scaleToSpectralRadius(W, targetSpectralRadius);
-
-    // Random input matrix (dense).
-    level.Win = randMatrix(DTESNN_RESERVOIR, inputDim, 0.5);
+    // Sparse random reservoir matrix scaled to target spectral radius.
+    level.W = randSparse(m_reservoirSize, m_reservoirSize, m_connectivity, 1.0);
+    double rho = estimateSpectralRadius(level.W);
+    if (rho > 1e-12)
+        level.W.scale((float)(targetSpectralRadius / rho));
 
-    // Zero initial state.
-    level.state.assign(DTESNN_RESERVOIR, 0.0);
+    // Random input matrix (dense for the external input, sparse between levels).
+    level.Win = randSparse(m_reservoirSize, inputDim, inputConnectivity, 0.5);
 }
 
 // ---------------------------------------------------------------------------
 // Private: reservoir update
 // ---------------------------------------------------------------------------
 
-vector<double> DeepTreeEchoStateNet::updateLevel(
-    ReservoirLevel& level, const vector<double>& input) const
+void ReservoirModel::updateLevel(const ReservoirLevel& level,
+                                 const float* input, float* x, float* pre)
 {
     int n = level.reservoirSize;
-    int m = (int)input.size();
 
     // Pre-activation: W * x(t-1) + Win * u(t)
-    vector<double> pre(n, 0.0);
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < n; ++j)
-            pre[i] += level.W[i][j] * level.state[j];
-        for (int j = 0; j < min(m, (int)level.Win[i].size()); ++j)
-            pre[i] += level.Win[i][j] * input[j];
-    }
-    auto tanh_pre = tanhVec(pre);
+    fill(pre, pre + n, 0.0f);
+    level.W.multiplyAdd(x, pre);
+    level.Win.multiplyAdd(input, pre);
 
-    // Leaky integration: x(t) = (1-α)*x(t-1) + α*tanh(pre)
-    double alpha = level.leakRate;
-    vector<double> newState(n);
+    // Leaky integration in place: x(t) = (1-α)*x(t-1) + α*tanh(pre)
+    float alpha = level.leakRate;
     for (int i = 0; i < n; ++i)
-        newState[i] = (1.0 - alpha) * level.state[i] + alpha * tanh_pre[i];
-
-    return newState;
+        x[i] = (1.0f - alpha) * x[i] + alpha * tanhf(pre[i]);
 }
 
 // ---------------------------------------------------------------------------
 // Private: numeric helpers
 // ---------------------------------------------------------------------------
 
-double DeepTreeEchoStateNet::dot(const vector<double>& a,
-                                  const vector<double>& b)
+double dtesnn::dot(const vector<double>& a, const vector<double>& b)
 {
     double s = 0.0;
     int n = (int)min(a.size(), b.size());
@@ -226,70 +382,73 @@ double DeepTreeEchoStateNet::dot(const vector<double>& a,
     return s;
 }
 
-vector<double> DeepTreeEchoStateNet::tanhVec(const vector<double>& x)
+float ReservoirModel::randUniform(double scale)
 {
-    vector<double> out(x.size());
-    for (size_t i = 0; i < x.size(); ++i) out[i] = tanh(x[i]);
-    return out;
+    return (float)(((double)rand() / RAND_MAX * 2.0 - 1.0) * scale);
 }
 
-vector<double> DeepTreeEchoStateNet::randVec(int dim, double scale)
+CSRMatrix ReservoirModel::randSparse(
+    int rows, int cols, double connectivity, double scale)
 {
-    vector<double> v(dim);
-    for (double& x : v)
-        x = ((double)rand() / RAND_MAX * 2.0 - 1.0) * scale;
-    return v;
-}
-
-vector<vector<double>> DeepTreeEchoStateNet::randMatrix(
-    int rows, int cols, double scale)
-{
-    vector<vector<double>> M(rows, vector<double>(cols));
-    for (auto& row : M)
-        for (double& v : row)
-            v = ((double)rand() / RAND_MAX * 2.0 - 1.0) * scale;
+    // Fixed fan-in per row: choose ceil(connectivity * cols) distinct columns
+    // with a partial Fisher-Yates shuffle, then sort them for sequential access.
+    int fanIn = max(1, min(cols, (int)ceil(connectivity * cols)));
+
+    CSRMatrix M;
+    M.rows = rows;
+    M.cols = cols;
+    M.rowPtr.resize(rows + 1);
+    M.colIdx.reserve((size_t)rows * fanIn);
+    M.values.reserve((size_t)rows * fanIn);
+
+    vector<int> perm(cols);
+    for (int j = 0; j < cols; ++j) perm[j] = j;
+
+    M.rowPtr[0] = 0;
+    for (int i = 0; i < rows; ++i) {
+        for (int k = 0; k < fanIn; ++k) {
+            int r = k + rand() % (cols - k);
+            swap(perm[k], perm[r]);
+        }
+        sort(perm.begin(), perm.begin() + fanIn);
+        for (int k = 0; k < fanIn; ++k) {
+            M.colIdx.push_back(perm[k]);
+            M.values.push_back(randUniform(scale));
+        }
+        M.rowPtr[i + 1] = (int)M.colIdx.size();
+    }
     return M;
 }
 
-double DeepTreeEchoStateNet::estimateSpectralRadius(
-    const vector<vector<double>>& W)
+double ReservoirModel::estimateSpectralRadius(const CSRMatrix& W)
 {
-    int n = (int)W.size();
+    int n = W.rows;
     if (n == 0) return 0.0;
 
-    // Power iteration (50 steps).
-    vector<double> v = randVec(n, 1.0);
-    double norm = sqrt(dot(v, v));
+    // Power iteration (50 steps) over two reused buffers.
+    vector<float> v(n), Wv(n);
+    for (float& x : v) x = randUniform(1.0);
+
+    double norm = 0.0;
+    for (float x : v) norm += (double)x * x;
+    norm = sqrt(norm);
     if (norm < 1e-12) return 0.0;
-    for (double& x : v) x /= norm;
+    for (float& x : v) x = (float)(x / norm);
 
     double rho = 0.0;
     for (int iter = 0; iter < 50; ++iter) {
-        vector<double> Wv(n, 0.0);
-        for (int i = 0; i < n; ++i)
-            for (int j = 0; j < n; ++j)
-                Wv[i] += W[i][j] * v[j];
-        rho = sqrt(dot(Wv, Wv));
+        fill(Wv.begin(), Wv.end(), 0.0f);
+        W.multiplyAdd(v.data(), Wv.data());
+        double sq = 0.0;
+        for (float x : Wv) sq += (double)x * x;
+        rho = sqrt(sq);
         if (rho < 1e-12) break;
-        for (double& x : Wv) x /= rho;
-        v = Wv;
+        for (int i = 0; i < n; ++i) v[i] = (float)(Wv[i] / rho);
     }
     return rho;
 }
 
-vector<vector<double>> DeepTreeEchoStateNet::scaleToSpectralRadius(
-    vector<vector<double>> W, double targetRadius)
-{
-    double rho = estimateSpectralRadius(W);
-    if (rho < 1e-12) return W;
-    double factor = targetRadius / rho;
-    for (auto& row : W)
-        for (double& v : row)
-            v *= factor;
-    return W;
-}
-
-vector<string> DeepTreeEchoStateNet::tokenize(const string& text)
+vector<string> dtesnn::tokenize(const string& text)
 {
     vector<string> tokens;
     istringstream iss(text);
@@ -19,6 +19,17 @@
  *            + α_k * tanh(W_k * x_k(t-1) + Win_k * u_k(t))
  * where u_0(t) = inputFeatures,  u_k(t) = x_{k-1}(t)  for k > 0.
  *
+ * Reservoir (W) and inter-level input (Win, k > 0) matrices are stored in
+ * compressed sparse row form with a fixed fan-in of
+ * ceil(connectivity * cols) per row, so per-step cost grows with
+ * reservoirSize * fanIn rather than reservoirSize².  Weights and state are
+ * float32; state is updated in place using reused scratch buffers, so
+ * step() performs no heap allocation.  A connectivity of 1.0 yields the
+ * original fully-connected reservoir.
+ *
+ * Weights live in an immutable ReservoirModel that many conversations can
+ * share; each conversation owns only a small ReservoirState.
+ *
  * Complementary to HGNN (spatial): DTESNN captures *when* concepts appeared
  * and how conversation context evolved over time.
  *
@@ -29,28 +40,148 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+
+#include "model_store.h"
 
 using namespace std;
 
 namespace dtesnn {
 
-    static const int DTESNN_INPUT_DIM   = 16;  // matches HGNN_FEAT_DIM
-    static const int DTESNN_RESERVOIR   = 32;  // reservoir neurons per level
-    static const int DTESNN_TREE_DEPTH  = 3;   // number of hierarchy levels
-    static const int DTESNN_OUTPUT_DIM  = 8;   // readout dimension fed to MLP
+    static const int    DTESNN_INPUT_DIM    = 16;   // matches HGNN_FEAT_DIM
+    static const int    DTESNN_RESERVOIR    = 256;  // reservoir neurons per level
+    static const double DTESNN_CONNECTIVITY = 0.10; // fraction of non-zero weights per row
+    static const int    DTESNN_TREE_DEPTH   = 3;    // number of hierarchy levels
+    static const int    DTESNN_OUTPUT_DIM   = 8;    // readout dimension fed to MLP
+
+    /**
+     * CSRMatrix — compressed sparse row matrix with float32 values.
+     * Column indices within a row are sorted ascending.
+     */
+    struct CSRMatrix {
+        int           rows;
+        int           cols;
+        vector<int>   rowPtr;  // [rows + 1]
+        vector<int>   colIdx;  // [nnz]
+        vector<float> values;  // [nnz]
+
+        CSRMatrix() : rows(0), cols(0) {}
+
+        size_t nnz() const { return values.size(); }
 
+        // y[0..rows) += A * x[0..cols)
+        void multiplyAdd(const float* x, float* y) const;
+
+        // Multiply every stored value by factor.
+        void scale(float factor);
+    };
+
+    /**
+     * ReservoirLevel — the weights of one level of the tree.  Immutable once
+     * the owning ReservoirModel has been constructed.
+     */
     struct ReservoirLevel {
-        int    reservoirSize;
-        double leakRate;
-        double spectralRadius;
-        vector<vector<double>> W;    // [reservoirSize × reservoirSize]
-        vector<vector<double>> Win;  // [reservoirSize × inputDim]
-        vector<double>         state;// [reservoirSize] current activation
+        int           reservoirSize;
+        int           inputDim;
+        float         leakRate;
+        double        spectralRadius;
+        CSRMatrix     W;     // [reservoirSize × reservoirSize]
+        CSRMatrix     Win;   // [reservoirSize × inputDim]
+    };
+
+    /**
+     * ReservoirState — the per-conversation part of the network: the
+     * concatenated activations of every level plus a step counter
+     * (TREE_DEPTH * reservoirSize floats, ~3 KB at the default size).
+     */
+    struct ReservoirState {
+        vector<float> activation; // [TREE_DEPTH * reservoirSize], level-major
+        int           stepCount;
+
+        ReservoirState() : stepCount(0) {}
     };
 
+    /**
+     * ReservoirModel — the shared, read-only weights (W, Win per level and
+     * the readout Wout).  All methods are const and thread-safe, so one model
+     * can be shared via shared_ptr<const ReservoirModel> by any number of
+     * sessions, each owning only its ReservoirState.
+     */
+    class ReservoirModel {
+    public:
+        // reservoirSize: neurons per level.
+        // connectivity:  fraction (0, 1] of non-zero recurrent / inter-level
+        //                weights per row; 1.0 gives a dense reservoir.
+        explicit ReservoirModel(int reservoirSize = DTESNN_RESERVOIR,
+                                double connectivity = DTESNN_CONNECTIVITY);
+
+        // Fresh zero state sized for this model.
+        ReservoirState createState() const;
+
+        // Advance one session by one input step.
+        // inputFeatures is zero-padded / truncated to DTESNN_INPUT_DIM.
+        void step(ReservoirState& state,
+                  const vector<double>& inputFeatures) const;
+
+        // DTESNN_OUTPUT_DIM readout of a state, squashed to [0, 1].
+        vector<double> readout(const ReservoirState& state) const;
+
+        // Score a candidate response against a session's temporal state.
+        double scoreResponse(const ReservoirState& state,
+                             const string& response,
+                             const map<string, double>& contextVector) const;
+
+        int    getReservoirSize() const { return m_reservoirSize; }
+        double getConnectivity()  const { return m_connectivity; }
+        size_t nonZeroWeights()   const;
+
+        // Binary persistence (see model_store.h).  importFrom() restores the
+        // exact weights without re-running initialisation or spectral-radius
+        // estimation; returns nullptr if the section is malformed.
+        void exportTo(model_store::SectionWriter& out) const;
+        static shared_ptr<ReservoirModel> importFrom(model_store::SectionReader& in);
+
+    private:
+        struct Uninitialised {};
+        explicit ReservoirModel(Uninitialised)
+            : m_reservoirSize(0), m_connectivity(0.0) {}
+
+        int    m_reservoirSize;
+        double m_connectivity;
+        vector<ReservoirLevel> m_levels;
+
+        // Fixed readout projection, row-major:
+        // DTESNN_OUTPUT_DIM × (TREE_DEPTH * reservoirSize).
+        vector<float> m_Wout;
+
+        // Initialise one reservoir level.
+        void initLevel(ReservoirLevel& level,
+                       int inputDim,
+                       double inputConnectivity,
+                       double leakRate,
+                       double targetSpectralRadius) const;
+
+        // Update one level's activation x in place from input[0..inputDim).
+        // pre is a caller-provided scratch buffer of reservoirSize floats.
+        static void updateLevel(const ReservoirLevel& level,
+                                const float* input, float* x, float* pre);
+
+        // Numeric helpers.
+        static float  randUniform(double scale);
+        static CSRMatrix randSparse(int rows, int cols,
+                                    double connectivity, double scale);
+        static double estimateSpectralRadius(const CSRMatrix& W);
+    };
+
+    /**
+     * DeepTreeEchoStateNet — single-conversation convenience wrapper pairing
+     * a (possibly shared) ReservoirModel with one ReservoirState.
+     */
     class DeepTreeEchoStateNet {
     public:
-        DeepTreeEchoStateNet();
+        explicit DeepTreeEchoStateNet(int reservoirSize = DTESNN_RESERVOIR,
+                                      double connectivity = DTESNN_CONNECTIVITY);
+        explicit DeepTreeEchoStateNet(shared_ptr<const ReservoirModel> model);
         ~DeepTreeEchoStateNet() = default;
 
         // Feed one input step through the full tree reservoir.
@@ -78,40 +209,27 @@ namespace dtesnn {
         double temporalSalience(int turnsAgo) const;
 
         // Number of step() calls since last resetState().
-        int getStepCount() const { return m_stepCount; }
-
-    private:
-        vector<ReservoirLevel> m_levels;
-        int m_stepCount;
+        int getStepCount() const { return m_state.stepCount; }
 
-        // Fixed readout projection: DTESNN_OUTPUT_DIM × (TREE_DEPTH * RESERVOIR).
-        vector<vector<double>> m_Wout;
+        // Shared weights and this conversation's state.
+        shared_ptr<const ReservoirModel> getModel() const { return m_model; }
+        const ReservoirState& getState() const { return m_state; }
+        ReservoirState&       getState()       { return m_state; }
 
-        // Concatenation of all level states.
-        vector<double> getFullState() const;
+        // Reservoir geometry (for diagnostics).
+        int    getReservoirSize() const { return m_model->getReservoirSize(); }
+        double getConnectivity()  const { return m_model->getConnectivity(); }
+        size_t nonZeroWeights()   const { return m_model->nonZeroWeights(); }
 
-        // Initialise one reservoir level.
-        void initLevel(ReservoirLevel& level,
-                       int inputDim,
-                       double leakRate,
-                       double targetSpectralRadius) const;
-
-        // Update one level: returns new state.
-        vector<double> updateLevel(ReservoirLevel& level,
-                                   const vector<double>& input) const;
-
-        // Numeric helpers.
-        static double         dot(const vector<double>& a,
-                                  const vector<double>& b);
-        static vector<double> tanhVec(const vector<double>& x);
-        static vector<double> randVec(int dim, double scale);
-        static vector<vector<double>> randMatrix(int rows, int cols, double scale);
-        static vector<vector<double>> scaleToSpectralRadius(
-            vector<vector<double>> W, double targetRadius);
-        static double estimateSpectralRadius(const vector<vector<double>>& W);
-        static vector<string> tokenize(const string& text);
+    private:
+        shared_ptr<const ReservoirModel> m_model;
+        ReservoirState                   m_state;
     };
 
+    // Shared text helpers.
+    double         dot(const vector<double>& a, const vector<double>& b);
+    vector<string> tokenize(const string& text);
+
 } // namespace dtesnn
 
 #endif // __DTESNN_H__
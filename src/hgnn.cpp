@@ -87,6 +87,38 @@ void HyperGraphNeuralNet::reinforce(const string& name, double reward)
         emb[i] = min(1.0, emb[i] + reward * 0.1);
 }
 
+// ---------------------------------------------------------------------------
+// Persistence
+// ---------------------------------------------------------------------------
+
+void HyperGraphNeuralNet::exportTo(model_store::SectionWriter& out) const
+{
+    out.putMatrix(m_projection);
+    out.putU64(m_embeddings.size());
+    for (const auto& kv : m_embeddings) {
+        out.putString(kv.first);
+        out.putF64Array(kv.second.data(), kv.second.size());
+    }
+}
+
+bool HyperGraphNeuralNet::importFrom(model_store::SectionReader& in)
+{
+    vector<vector<double>> projection;
+    map<string, vector<double>> embeddings;
+
+    in.getMatrix(projection, HGNN_OUTPUT_DIM, HGNN_FEAT_DIM);
+    uint64_t count = in.getU64();
+    for (uint64_t i = 0; i < count && in.ok(); ++i) {
+        string name = in.getString();
+        in.getF64Array(embeddings[name], HGNN_FEAT_DIM);
+    }
+    if (!in.ok()) return false;
+
+    m_projection.swap(projection);
+    m_embeddings.swap(embeddings);
+    return true;
+}
+
 // ---------------------------------------------------------------------------
 // Private: message-passing round
 // ---------------------------------------------------------------------------
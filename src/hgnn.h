@@ -24,6 +24,8 @@
 #include <string>
 #include <map>
 
+#include "model_store.h"
+
 using namespace std;
 using namespace opencog;
 
@@ -63,6 +65,12 @@ namespace hgnn {
         // Number of concept embeddings currently maintained.
         size_t size() const { return m_embeddings.size(); }
 
+        // Binary persistence of the projection and concept embeddings
+        // (see model_store.h).  importFrom() leaves the network unchanged if
+        // the section is malformed.
+        void exportTo(model_store::SectionWriter& out) const;
+        bool importFrom(model_store::SectionReader& in);
+
     private:
         AtomSpace& m_atomSpace;
 
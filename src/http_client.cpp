@@ -0,0 +1,729 @@
+#include "http_client.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#ifdef CHATMACHINE_WITH_OPENSSL
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#endif
+
+using namespace http_client;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    int msUntil(Clock::time_point deadline)
+    {
+        auto ms = chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()).count();
+        return ms <= 0 ? 0 : (ms > 1000000 ? 1000000 : (int)ms);
+    }
+
+    string lower(string text)
+    {
+        transform(text.begin(), text.end(), text.begin(),
+                  [](unsigned char c) { return (char)tolower(c); });
+        return text;
+    }
+
+    string trimmed(const string& text)
+    {
+        size_t b = text.find_first_not_of(" \t");
+        if (b == string::npos) return "";
+        size_t e = text.find_last_not_of(" \t\r");
+        return text.substr(b, e - b + 1);
+    }
+
+    // Wait for events on fd; 1 ready, 0 timeout, -1 error.
+    int waitFd(int fd, short events, int timeoutMs)
+    {
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = events;
+        pfd.revents = 0;
+        for (;;) {
+            int n = poll(&pfd, 1, timeoutMs);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return -1;
+            return n == 0 ? 0 : 1;
+        }
+    }
+
+    // -----------------------------------------------------------------------
+    // Plain TCP
+    // -----------------------------------------------------------------------
+
+    class SocketConnection : public Connection {
+    public:
+        explicit SocketConnection(int fd) : m_fd(fd) {}
+        ~SocketConnection() { close(m_fd); }
+
+        long write(const char* data, size_t size, int timeoutMs)
+        {
+            int ready = waitFd(m_fd, POLLOUT, timeoutMs);
+            if (ready == 0) return HTTP_IO_TIMEOUT;
+            if (ready < 0) return HTTP_IO_ERROR;
+            ssize_t n = send(m_fd, data, size, MSG_NOSIGNAL);
+            if (n < 0)
+                return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                       ? HTTP_IO_TIMEOUT : HTTP_IO_ERROR;
+            return (long)n;
+        }
+
+        long read(char* buffer, size_t size, int timeoutMs)
+        {
+            int ready = waitFd(m_fd, POLLIN, timeoutMs);
+            if (ready == 0) return HTTP_IO_TIMEOUT;
+            if (ready < 0) return HTTP_IO_ERROR;
+            ssize_t n = recv(m_fd, buffer, size, 0);
+            if (n < 0)
+                return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                       ? HTTP_IO_TIMEOUT : HTTP_IO_ERROR;
+            return n == 0 ? HTTP_IO_CLOSED : (long)n;
+        }
+
+        int fd() const { return m_fd; }
+
+    private:
+        int m_fd;
+    };
+
+    // Non-blocking connect to the first address that answers by the deadline.
+    int connectSocket(const Url& url, Clock::time_point deadline, string& error)
+    {
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addrs = nullptr;
+        int rc = getaddrinfo(url.host.c_str(), to_string(url.port).c_str(), &hints, &addrs);
+        if (rc != 0) {
+            error = "resolve " + url.host + ": " + gai_strerror(rc);
+            return -1;
+        }
+
+        int fd = -1;
+        for (addrinfo* a = addrs; a && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, a->ai_protocol);
+            if (fd < 0) { error = string("socket: ") + strerror(errno); continue; }
+
+            if (::connect(fd, a->ai_addr, a->ai_addrlen) < 0 && errno != EINPROGRESS) {
+                error = "connect " + url.host + ": " + strerror(errno);
+                close(fd); fd = -1;
+                continue;
+            }
+            int ready = waitFd(fd, POLLOUT, msUntil(deadline));
+            int soError = 0;
+            socklen_t len = sizeof(soError);
+            if (ready <= 0 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &soError, &len) < 0 || soError != 0) {
+                error = "connect " + url.host + ": " +
+                        (ready == 0 ? string("timed out") : string(strerror(soError ? soError : errno)));
+                close(fd); fd = -1;
+            }
+        }
+        freeaddrinfo(addrs);
+
+        if (fd >= 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        return fd;
+    }
+
+#ifdef CHATMACHINE_WITH_OPENSSL
+    // -----------------------------------------------------------------------
+    // TLS (OpenSSL)
+    // -----------------------------------------------------------------------
+
+    SSL_CTX* tlsContext()
+    {
+        static SSL_CTX* ctx = []() {
+            SSL_CTX* c = SSL_CTX_new(TLS_client_method());
+            if (c) {
+                SSL_CTX_set_default_verify_paths(c);
+                SSL_CTX_set_verify(c, SSL_VERIFY_PEER, nullptr);
+                SSL_CTX_set_min_proto_version(c, TLS1_2_VERSION);
+            }
+            return c;
+        }();
+        return ctx;
+    }
+
+    string tlsError()
+    {
+        unsigned long e = ERR_get_error();
+        if (!e) return "TLS error";
+        char buffer[256];
+        ERR_error_string_n(e, buffer, sizeof(buffer));
+        return buffer;
+    }
+
+    class TlsConnection : public Connection {
+    public:
+        TlsConnection(int fd, SSL* ssl) : m_fd(fd), m_ssl(ssl) {}
+        ~TlsConnection()
+        {
+            SSL_free(m_ssl);
+            close(m_fd);
+        }
+
+        long write(const char* data, size_t size, int timeoutMs)
+        {
+            return transfer(timeoutMs, false, [&]() { return SSL_write(m_ssl, data, (int)size); });
+        }
+
+        long read(char* buffer, size_t size, int timeoutMs)
+        {
+            return transfer(timeoutMs, true, [&]() { return SSL_read(m_ssl, buffer, (int)size); });
+        }
+
+        // Handshake, retried until it completes or the deadline passes.
+        bool handshake(Clock::time_point deadline, string& error)
+        {
+            for (;;) {
+                ERR_clear_error();
+                int rc = SSL_connect(m_ssl);
+                if (rc == 1) return true;
+                int err = SSL_get_error(m_ssl, rc);
+                short events = err == SSL_ERROR_WANT_READ ? POLLIN :
+                               err == SSL_ERROR_WANT_WRITE ? POLLOUT : 0;
+                if (!events) { error = "TLS handshake: " + tlsError(); return false; }
+                if (waitFd(m_fd, events, msUntil(deadline)) <= 0) {
+                    error = "TLS handshake timed out";
+                    return false;
+                }
+            }
+        }
+
+    private:
+        int  m_fd;
+        SSL* m_ssl;
+
+        // EOF without the peer's close_notify, as many servers end a
+        // Connection: close response.  Read as a plain close: a body framed
+        // by Content-Length or chunks still fails when it is cut short, so
+        // only a read-to-close body can end this way.
+        static bool closedWithoutNotify(int rc, int err)
+        {
+            if (err == SSL_ERROR_SYSCALL)                // OpenSSL 1.1
+                return rc == 0 && ERR_peek_error() == 0;
+#ifdef SSL_R_UNEXPECTED_EOF_WHILE_READING
+            if (err == SSL_ERROR_SSL)                    // OpenSSL 3
+                return ERR_GET_REASON(ERR_peek_error()) == SSL_R_UNEXPECTED_EOF_WHILE_READING;
+#endif
+            return false;
+        }
+
+        template <typename Op>
+        long transfer(int timeoutMs, bool reading, Op op)
+        {
+            Clock::time_point until = Clock::now() + chrono::milliseconds(timeoutMs);
+            for (;;) {
+                ERR_clear_error();
+                int rc = op();
+                if (rc > 0) return rc;
+                int err = SSL_get_error(m_ssl, rc);
+                if (err == SSL_ERROR_ZERO_RETURN) return HTTP_IO_CLOSED;
+                if (reading && closedWithoutNotify(rc, err)) return HTTP_IO_CLOSED;
+                short events = err == SSL_ERROR_WANT_READ ? POLLIN :
+                               err == SSL_ERROR_WANT_WRITE ? POLLOUT : 0;
+                if (!events) return HTTP_IO_ERROR;
+                int ready = waitFd(m_fd, events, msUntil(until));
+                if (ready == 0) return HTTP_IO_TIMEOUT;
+                if (ready < 0) return HTTP_IO_ERROR;
+            }
+        }
+    };
+#endif
+
+    // -----------------------------------------------------------------------
+    // Response reading
+    // -----------------------------------------------------------------------
+
+    // Buffered reads from a connection against the request deadline.
+    class Reader {
+    public:
+        Reader(Connection& connection, Clock::time_point deadline,
+               const cancel_token::CancelToken* cancel)
+            : m_connection(connection), m_deadline(deadline), m_cancel(cancel),
+              m_pos(0), m_received(0), m_closed(false) {}
+
+        // Bytes read from the connection so far.
+        size_t received() const { return m_received; }
+        bool   closed() const { return m_closed; }
+        const string& error() const { return m_error; }
+
+        // A line without its CRLF.
+        bool readLine(string& line, size_t limit)
+        {
+            for (;;) {
+                size_t eol = m_buffer.find("\r\n", m_pos);
+                if (eol != string::npos) {
+                    line.assign(m_buffer, m_pos, eol - m_pos);
+                    m_pos = eol + 2;
+                    return true;
+                }
+                if (m_buffer.size() - m_pos > limit) { m_error = "header line too long"; return false; }
+                if (!fill()) return false;
+            }
+        }
+
+        // Up to limit bytes: what is buffered, or else what arrives next.
+        // data stays valid until the next read.
+        bool readSome(size_t limit, const char*& data, size_t& size)
+        {
+            if (m_pos == m_buffer.size()) {
+                m_buffer.clear();
+                m_pos = 0;
+                if (!fill()) return false;
+            }
+            size = min(limit, m_buffer.size() - m_pos);
+            data = m_buffer.data() + m_pos;
+            m_pos += size;
+            return true;
+        }
+
+    private:
+        Connection&                      m_connection;
+        Clock::time_point                m_deadline;
+        const cancel_token::CancelToken* m_cancel;
+        string                           m_buffer;
+        size_t                           m_pos;
+        size_t                           m_received;
+        bool                             m_closed;
+        string                           m_error;
+
+        bool fill()
+        {
+            char chunk[16 * 1024];
+            for (;;) {
+                if (cancel_token::isCancelled(m_cancel)) { m_error = "cancelled"; return false; }
+                int left = msUntil(m_deadline);
+                if (left <= 0) { m_error = "timed out"; return false; }
+                long n = m_connection.read(chunk, sizeof(chunk), min(left, HTTP_POLL_SLICE_MS));
+                if (n == HTTP_IO_TIMEOUT) continue;
+                if (n == HTTP_IO_CLOSED) { m_closed = true; m_error = "connection closed"; return false; }
+                if (n < 0) { m_error = "read failed"; return false; }
+                if (m_pos > 64 * 1024) {     // drop what has been consumed
+                    m_buffer.erase(0, m_pos);
+                    m_pos = 0;
+                }
+                m_buffer.append(chunk, (size_t)n);
+                m_received += (size_t)n;
+                return true;
+            }
+        }
+    };
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// URLs and transport
+// ---------------------------------------------------------------------------
+
+bool http_client::parseUrl(const string& text, Url& url)
+{
+    size_t hostStart;
+    if (text.compare(0, 7, "http://") == 0) {
+        url.https = false;
+        hostStart = 7;
+    } else if (text.compare(0, 8, "https://") == 0) {
+        url.https = true;
+        hostStart = 8;
+    } else {
+        return false;
+    }
+
+    size_t pathStart = text.find('/', hostStart);
+    string authority = text.substr(hostStart, pathStart == string::npos ? string::npos : pathStart - hostStart);
+    url.path = pathStart == string::npos ? "/" : text.substr(pathStart);
+    url.port = url.https ? 443 : 80;
+
+    // host, host:port, [v6] or [v6]:port
+    size_t colon = authority.rfind(':');
+    size_t bracket = authority.rfind(']');
+    if (colon != string::npos && (bracket == string::npos || colon > bracket)) {
+        url.port = atoi(authority.c_str() + colon + 1);
+        authority.erase(colon);
+    }
+    if (authority.size() > 2 && authority.front() == '[' && authority.back() == ']')
+        authority = authority.substr(1, authority.size() - 2);
+    url.host = authority;
+    return !url.host.empty() && url.port > 0 && url.port < 65536;
+}
+
+unique_ptr<Connection> SocketTransport::connect(const Url& url, Clock::time_point deadline,
+                                                string& error)
+{
+#ifndef CHATMACHINE_WITH_OPENSSL
+    if (url.https) {
+        error = "https:// needs a build with OpenSSL (CHATMACHINE_WITH_OPENSSL)";
+        return unique_ptr<Connection>();
+    }
+#endif
+    int fd = connectSocket(url, deadline, error);
+    if (fd < 0)
+        return unique_ptr<Connection>();
+    if (!url.https)
+        return unique_ptr<Connection>(new SocketConnection(fd));
+
+#ifdef CHATMACHINE_WITH_OPENSSL
+    SSL_CTX* ctx = tlsContext();
+    SSL* ssl = ctx ? SSL_new(ctx) : nullptr;
+    if (!ssl) {
+        error = "TLS setup: " + tlsError();
+        close(fd);
+        return unique_ptr<Connection>();
+    }
+    SSL_set_fd(ssl, fd);
+    SSL_set_tlsext_host_name(ssl, url.host.c_str());
+    SSL_set1_host(ssl, url.host.c_str());
+    unique_ptr<TlsConnection> tls(new TlsConnection(fd, ssl));
+    if (!tls->handshake(deadline, error))
+        return unique_ptr<Connection>();
+    return unique_ptr<Connection>(tls.release());
+#else
+    return unique_ptr<Connection>();
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// HttpClient
+// ---------------------------------------------------------------------------
+
+HttpClient::HttpClient(const HttpClientConfig& config, shared_ptr<Transport> transport)
+    : m_config(config),
+      m_transport(transport ? transport : shared_ptr<Transport>(new SocketTransport())),
+      m_requests(0), m_failures(0), m_opened(0), m_reused(0), m_retries(0)
+{
+}
+
+HttpResponse HttpClient::post(const string& url, const string& headers, const string& body,
+                              const cancel_token::CancelToken* cancel)
+{
+    return perform("POST", url, headers, body, cancel, nullptr);
+}
+
+HttpResponse HttpClient::request(const string& method, const string& url,
+                                 const string& headers, const string& body,
+                                 const cancel_token::CancelToken* cancel)
+{
+    return perform(method, url, headers, body, cancel, nullptr);
+}
+
+HttpResponse HttpClient::postStreaming(const string& url, const string& headers,
+                                       const string& body, const BodySink& sink,
+                                       const cancel_token::CancelToken* cancel)
+{
+    return perform("POST", url, headers, body, cancel, &sink);
+}
+
+HttpResponse HttpClient::perform(const string& method, const string& urlText,
+                                 const string& headers, const string& body,
+                                 const cancel_token::CancelToken* cancel, const BodySink* sink)
+{
+    HttpResponse response = {0, "", "", false, ""};
+    m_requests++;
+
+    Url url;
+    if (!parseUrl(urlText, url)) {
+        response.error = "invalid URL: " + urlText;
+        m_failures++;
+        return response;
+    }
+
+    Clock::time_point deadline = Clock::now() + chrono::milliseconds(m_config.requestTimeoutMs);
+    if (cancel && cancel->deadline() < deadline)
+        deadline = cancel->deadline();
+
+    string requestText = method + " " + url.path + " HTTP/1.1\r\n";
+    requestText += "Host: " + url.host;
+    if (url.port != (url.https ? 443 : 80))
+        requestText += ":" + to_string(url.port);
+    requestText += "\r\nConnection: keep-alive\r\n";
+    if (lower(headers).find("content-length:") == string::npos)
+        requestText += "Content-Length: " + to_string(body.size()) + "\r\n";
+    requestText += headers;
+    requestText += "\r\n";
+    requestText += body;
+
+    // A pooled connection may have been closed by the server while idle;
+    // that shows as no response at all, and is worth one fresh attempt.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        unique_ptr<Connection> connection = attempt == 0 ? checkout(url) : unique_ptr<Connection>();
+        bool reused = (bool)connection;
+        if (reused) {
+            m_reused++;
+        } else {
+            Clock::time_point connectBy = min(deadline,
+                Clock::now() + chrono::milliseconds(m_config.connectTimeoutMs));
+            connection = m_transport->connect(url, connectBy, response.error);
+            if (!connection) break;
+            m_opened++;
+        }
+
+        bool keepAlive = false, noResponse = false;
+        response = {0, "", "", false, ""};
+        if (exchange(*connection, requestText, deadline, cancel, sink, response, keepAlive,
+                     noResponse)) {
+            if (keepAlive)
+                checkin(url, std::move(connection));
+            response.success = response.statusCode >= 200 && response.statusCode < 300;
+            return response;
+        }
+        if (!(reused && noResponse) || cancel_token::isCancelled(cancel))
+            break;
+        m_retries++;
+    }
+
+    m_failures++;
+    return response;
+}
+
+bool HttpClient::exchange(Connection& connection, const string& requestText,
+                          Clock::time_point deadline, const cancel_token::CancelToken* cancel,
+                          const BodySink* sink,
+                          HttpResponse& response, bool& keepAlive, bool& noResponse)
+{
+    // Send.
+    size_t sent = 0;
+    while (sent < requestText.size()) {
+        if (cancel_token::isCancelled(cancel)) { response.error = "cancelled"; return false; }
+        int left = msUntil(deadline);
+        if (left <= 0) { response.error = "timed out"; return false; }
+        long n = connection.write(requestText.data() + sent, requestText.size() - sent,
+                                  min(left, HTTP_POLL_SLICE_MS));
+        if (n == HTTP_IO_TIMEOUT) continue;
+        if (n <= 0) {
+            // Nothing of ours was read back: a stale pooled connection.
+            noResponse = true;
+            response.error = "write failed";
+            return false;
+        }
+        sent += (size_t)n;
+    }
+
+    // Status line and headers.
+    Reader reader(connection, deadline, cancel);
+    string line;
+    if (!reader.readLine(line, HTTP_MAX_HEADER_BYTES)) {
+        noResponse = reader.received() == 0;
+        response.error = reader.error();
+        return false;
+    }
+    // HTTP/1.x NNN reason
+    if (line.compare(0, 5, "HTTP/") != 0 || line.size() < 12) {
+        response.error = "malformed status line";
+        return false;
+    }
+    bool http10 = line.compare(0, 8, "HTTP/1.0") == 0;
+    response.statusCode = atoi(line.c_str() + 9);
+
+    long long contentLength = -1;
+    bool chunked = false;
+    string connectionHeader;
+    for (;;) {
+        if (!reader.readLine(line, HTTP_MAX_HEADER_BYTES)) {
+            response.error = reader.error();
+            return false;
+        }
+        if (line.empty()) break;
+        response.headers += line + "\r\n";
+        if (response.headers.size() > HTTP_MAX_HEADER_BYTES) {
+            response.error = "headers too large";
+            return false;
+        }
+        size_t colon = line.find(':');
+        if (colon == string::npos) continue;
+        string name = lower(trimmed(line.substr(0, colon)));
+        string value = trimmed(line.substr(colon + 1));
+        if (name == "content-length")
+            contentLength = atoll(value.c_str());
+        else if (name == "transfer-encoding")
+            chunked = lower(value).find("chunked") != string::npos;
+        else if (name == "connection")
+            connectionHeader = lower(value);
+    }
+
+    keepAlive = http10 ? connectionHeader.find("keep-alive") != string::npos
+                       : connectionHeader.find("close") == string::npos;
+
+    // Body.
+    int status = response.statusCode;
+    if ((status >= 100 && status < 200) || status == 204 || status == 304)
+        return true;
+
+    // A 2xx body goes to the sink as it arrives; anything else is kept.
+    if (status < 200 || status >= 300)
+        sink = nullptr;
+    const char* data;
+    size_t size;
+    auto copyBody = [&](size_t length) -> bool {
+        while (length > 0) {
+            if (!reader.readSome(length, data, size)) {
+                response.error = reader.error();
+                return false;
+            }
+            length -= size;
+            if (!sink) {
+                response.body.append(data, size);
+            } else if (!(*sink)(data, size)) {
+                response.error = "aborted";
+                keepAlive = false;
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (chunked) {
+        for (;;) {
+            if (!reader.readLine(line, HTTP_MAX_HEADER_BYTES)) { response.error = reader.error(); return false; }
+            size_t length = strtoul(line.c_str(), nullptr, 16);   // stops at any ";ext"
+            if (length == 0) break;
+            if (!copyBody(length)) return false;
+            if (!reader.readLine(line, 2)) { response.error = reader.error(); return false; }
+        }
+        // Trailers, up to the blank line.
+        do {
+            if (!reader.readLine(line, HTTP_MAX_HEADER_BYTES)) { response.error = reader.error(); return false; }
+        } while (!line.empty());
+    } else if (contentLength >= 0) {
+        if (!copyBody((size_t)contentLength))
+            return false;
+    } else {
+        keepAlive = false;
+        if (!copyBody(string::npos) && !reader.closed())
+            return false;
+        response.error.clear();
+    }
+    return true;
+}
+
+string HttpClient::poolKey(const Url& url)
+{
+    return url.host + ":" + to_string(url.port) + (url.https ? ":tls" : "");
+}
+
+unique_ptr<Connection> HttpClient::checkout(const Url& url)
+{
+    lock_guard<mutex> lock(m_poolMutex);
+    auto it = m_pool.find(poolKey(url));
+    if (it == m_pool.end()) return unique_ptr<Connection>();
+
+    vector<IdleConnection>& idle = it->second;
+    Clock::time_point staleBefore = Clock::now() - chrono::seconds(m_config.idleTimeoutS);
+    while (!idle.empty()) {
+        IdleConnection entry = std::move(idle.back());
+        idle.pop_back();
+        if (entry.since >= staleBefore)
+            return std::move(entry.connection);
+    }
+    return unique_ptr<Connection>();
+}
+
+void HttpClient::checkin(const Url& url, unique_ptr<Connection> connection)
+{
+    lock_guard<mutex> lock(m_poolMutex);
+    vector<IdleConnection>& idle = m_pool[poolKey(url)];
+    if (m_config.maxIdlePerHost == 0) return;
+    if (idle.size() >= m_config.maxIdlePerHost)
+        idle.erase(idle.begin());
+    IdleConnection entry;
+    entry.connection = std::move(connection);
+    entry.since = Clock::now();
+    idle.push_back(std::move(entry));
+}
+
+void HttpClient::closeIdle()
+{
+    lock_guard<mutex> lock(m_poolMutex);
+    m_pool.clear();
+}
+
+HttpClientStats HttpClient::getStats() const
+{
+    HttpClientStats st;
+    st.requests          = m_requests.load();
+    st.failures          = m_failures.load();
+    st.connectionsOpened = m_opened.load();
+    st.connectionsReused = m_reused.load();
+    st.retries           = m_retries.load();
+    st.idle              = 0;
+    lock_guard<mutex> lock(m_poolMutex);
+    for (const auto& entry : m_pool)
+        st.idle += entry.second.size();
+    return st;
+}
+
+// ---------------------------------------------------------------------------
+// SseDecoder
+// ---------------------------------------------------------------------------
+
+SseDecoder::SseDecoder(EventHandler onEvent)
+    : m_onEvent(onEvent), m_hasData(false), m_afterCr(false), m_stopped(false)
+{
+}
+
+bool SseDecoder::feed(const char* data, size_t size)
+{
+    const char* end = data + size;
+    while (data < end && !m_stopped) {
+        if (m_afterCr && *data == '\n') {
+            ++data;
+            m_afterCr = false;
+            continue;
+        }
+        m_afterCr = false;
+        const char* eol = data;
+        while (eol < end && *eol != '\n' && *eol != '\r') ++eol;
+        m_line.append(data, (size_t)(eol - data));
+        if (eol == end) break;
+        m_afterCr = *eol == '\r';
+        data = eol + 1;
+        if (!line()) m_stopped = true;
+        m_line.clear();
+    }
+    return !m_stopped;
+}
+
+bool SseDecoder::line()
+{
+    if (m_line.empty()) {
+        // End of an event.
+        bool dispatch = m_hasData;
+        string event = m_event.empty() ? string("message") : m_event;
+        m_event.clear();
+        m_hasData = false;
+        if (!dispatch) return true;
+        string data;
+        data.swap(m_data);
+        return m_onEvent(event, data);
+    }
+    if (m_line[0] == ':')                       // comment
+        return true;
+
+    size_t colon = m_line.find(':');
+    string field = m_line.substr(0, colon);
+    size_t start = colon == string::npos ? m_line.size() : colon + 1;
+    if (start < m_line.size() && m_line[start] == ' ') ++start;
+
+    if (field == "data") {
+        if (m_hasData) m_data += '\n';
+        m_data.append(m_line, start, string::npos);
+        m_hasData = true;
+    } else if (field == "event") {
+        m_event.assign(m_line, start, string::npos);
+    }
+    return true;
+}
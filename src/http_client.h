@@ -0,0 +1,223 @@
+#ifndef __HTTP_CLIENT_H__
+#define __HTTP_CLIENT_H__
+
+/**
+ * http_client.h — HTTP/1.1 client with persistent connections (Phase 6)
+ *
+ * Used by ChatGPT4oIntegration for the OpenAI API.  An HttpClient keeps
+ * idle keep-alive connections in a per-host pool, so consecutive requests
+ * skip the TCP (and TLS) handshake.  Responses may be framed by
+ * Content-Length, chunked transfer encoding, or connection close; only
+ * connections whose response was fully framed and not marked
+ * `Connection: close` go back to the pool.  A pooled connection the server
+ * has meanwhile closed is detected on reuse and the request is retried
+ * once on a fresh one.
+ *
+ * Byte transport is pluggable: SocketTransport (the default) speaks plain
+ * TCP for http:// URLs and TLS for https:// ones when built with OpenSSL
+ * (CHATMACHINE_WITH_OPENSSL, set by the makefile when the headers are
+ * installed).  Tests and benchmarks can point the client at a local
+ * plain-HTTP mock server, or supply their own Transport, and run without
+ * network access.
+ *
+ * Every request has a deadline (connect and whole-request timeouts) and an
+ * optional CancelToken; I/O waits in short slices so cancellation is
+ * noticed promptly.  The client is safe to share between threads.
+ *
+ * postStreaming() hands a successful response's body to a callback piece
+ * by piece as it arrives, and SseDecoder turns those pieces into
+ * server-sent events (text/event-stream), so a streamed completion can be
+ * shown while it is still being generated.
+ */
+
+#include "cancel_token.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstddef>
+
+using namespace std;
+
+namespace http_client {
+
+    static const int    HTTP_CONNECT_TIMEOUT_MS = 5000;
+    static const int    HTTP_REQUEST_TIMEOUT_MS = 30000;
+    static const size_t HTTP_MAX_IDLE_PER_HOST  = 4;
+    static const int    HTTP_IDLE_TIMEOUT_S     = 60;     // drop pooled connections idle longer
+    static const int    HTTP_POLL_SLICE_MS      = 50;     // cancellation check interval
+    static const size_t HTTP_MAX_HEADER_BYTES   = 64 * 1024;
+
+    // Connection::read/write results besides a byte count.
+    static const long HTTP_IO_CLOSED  = 0;    // read: orderly close by the peer
+    static const long HTTP_IO_ERROR   = -1;
+    static const long HTTP_IO_TIMEOUT = -2;   // nothing happened within timeoutMs
+
+    struct Url {
+        bool   https;
+        string host;
+        int    port;
+        string path;   // including any query, "/" at least
+    };
+
+    // http(s)://host[:port][/path].  False for anything else.
+    bool parseUrl(const string& text, Url& url);
+
+    // One open byte stream to a server.
+    class Connection {
+    public:
+        virtual ~Connection() {}
+        // Bytes transferred (> 0), or an HTTP_IO_* code.
+        virtual long write(const char* data, size_t size, int timeoutMs) = 0;
+        virtual long read(char* buffer, size_t size, int timeoutMs) = 0;
+    };
+
+    class Transport {
+    public:
+        virtual ~Transport() {}
+        // Open a connection to url's host and port; nullptr (error set)
+        // when that fails before the deadline.
+        virtual unique_ptr<Connection> connect(const Url& url,
+                                               chrono::steady_clock::time_point deadline,
+                                               string& error) = 0;
+    };
+
+    // TCP sockets, with TLS for https:// when built with OpenSSL.
+    class SocketTransport : public Transport {
+    public:
+        unique_ptr<Connection> connect(const Url& url,
+                                       chrono::steady_clock::time_point deadline,
+                                       string& error);
+    };
+
+    struct HttpClientConfig {
+        int    connectTimeoutMs;
+        int    requestTimeoutMs;   // whole request, connect included
+        size_t maxIdlePerHost;
+        int    idleTimeoutS;
+
+        HttpClientConfig()
+            : connectTimeoutMs(HTTP_CONNECT_TIMEOUT_MS),
+              requestTimeoutMs(HTTP_REQUEST_TIMEOUT_MS),
+              maxIdlePerHost(HTTP_MAX_IDLE_PER_HOST),
+              idleTimeoutS(HTTP_IDLE_TIMEOUT_S) {}
+    };
+
+    struct HttpResponse {
+        int    statusCode;    // 0 when no response was received
+        string headers;       // raw header block, status line excluded
+        string body;          // de-chunked
+        bool   success;       // a complete 2xx response
+        string error;         // why not, when no response was received
+    };
+
+    // Receives body bytes as they arrive; false aborts the request.
+    typedef function<bool(const char* data, size_t size)> BodySink;
+
+    struct HttpClientStats {
+        size_t requests;
+        size_t failures;            // no complete response
+        size_t connectionsOpened;
+        size_t connectionsReused;
+        size_t retries;             // stale pooled connection, retried fresh
+        size_t idle;                // pooled right now
+    };
+
+    class HttpClient {
+    public:
+        explicit HttpClient(const HttpClientConfig& config = HttpClientConfig(),
+                            shared_ptr<Transport> transport = shared_ptr<Transport>());
+
+        HttpClient(const HttpClient&) = delete;
+        HttpClient& operator=(const HttpClient&) = delete;
+
+        // headers: extra "Name: value\r\n" lines.  Host, Connection and
+        // (unless given) Content-Length are added.
+        HttpResponse post(const string& url, const string& headers, const string& body,
+                          const cancel_token::CancelToken* cancel = nullptr);
+        HttpResponse request(const string& method, const string& url,
+                             const string& headers, const string& body,
+                             const cancel_token::CancelToken* cancel = nullptr);
+        // As post(), but a 2xx body goes to sink as it arrives instead of
+        // into HttpResponse::body (error bodies are still collected there).
+        // A request the sink aborted fails with error "aborted".
+        HttpResponse postStreaming(const string& url, const string& headers, const string& body,
+                                   const BodySink& sink,
+                                   const cancel_token::CancelToken* cancel = nullptr);
+
+        // Close every pooled connection (e.g. before fork()).
+        void closeIdle();
+
+        HttpClientStats getStats() const;
+
+    private:
+        typedef chrono::steady_clock Clock;
+
+        struct IdleConnection {
+            unique_ptr<Connection> connection;
+            Clock::time_point      since;
+        };
+
+        HttpClientConfig                          m_config;
+        shared_ptr<Transport>                     m_transport;
+        mutable mutex                             m_poolMutex;
+        map<string, vector<IdleConnection>>       m_pool;   // "host:port:tls" -> idle
+
+        atomic<size_t> m_requests;
+        atomic<size_t> m_failures;
+        atomic<size_t> m_opened;
+        atomic<size_t> m_reused;
+        atomic<size_t> m_retries;
+
+        HttpResponse perform(const string& method, const string& url,
+                             const string& headers, const string& body,
+                             const cancel_token::CancelToken* cancel, const BodySink* sink);
+
+        static string poolKey(const Url& url);
+        unique_ptr<Connection> checkout(const Url& url);
+        void checkin(const Url& url, unique_ptr<Connection> connection);
+
+        // One attempt on one connection.  keepAlive: the connection may be
+        // pooled again.  noResponse: failed before any response byte.
+        bool exchange(Connection& connection, const string& requestText,
+                      Clock::time_point deadline, const cancel_token::CancelToken* cancel,
+                      const BodySink* sink,
+                      HttpResponse& response, bool& keepAlive, bool& noResponse);
+    };
+
+    /**
+     * SseDecoder — splits a text/event-stream body into events.  Feed it
+     * bytes in whatever pieces they arrive; onEvent gets each event's type
+     * ("message" unless an event: field set one) and its data lines joined
+     * with '\n' when the blank line ending the event is seen.  Comments and
+     * other fields (id:, retry:) are ignored.
+     */
+    class SseDecoder {
+    public:
+        // False stops decoding.
+        typedef function<bool(const string& event, const string& data)> EventHandler;
+
+        explicit SseDecoder(EventHandler onEvent);
+
+        // False once the handler has stopped decoding.
+        bool feed(const char* data, size_t size);
+
+    private:
+        EventHandler m_onEvent;
+        string       m_line;       // incomplete line
+        string       m_event;
+        string       m_data;
+        bool         m_hasData;
+        bool         m_afterCr;    // a CR ended the last line; skip a following LF
+        bool         m_stopped;
+
+        bool line();
+    };
+
+} // namespace http_client
+
+#endif // __HTTP_CLIENT_H__
@@ -0,0 +1,603 @@
+#include "json.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+using namespace json;
+
+namespace {
+
+    struct Cursor {
+        const string& s;
+        size_t        i;
+        string        error;
+
+        explicit Cursor(const string& text) : s(text), i(0) {}
+
+        void skipSpace() {
+            while (i < s.size() && (s[i] == ' ' || s[i] == '\t' ||
+                                    s[i] == '\r' || s[i] == '\n'))
+                ++i;
+        }
+        bool fail(const string& what) {
+            if (error.empty())
+                error = what + " at offset " + to_string(i);
+            return false;
+        }
+        bool expect(char c) {
+            skipSpace();
+            if (i >= s.size() || s[i] != c)
+                return fail(string("expected '") + c + "'");
+            ++i;
+            return true;
+        }
+    };
+
+    void appendUtf8(string& out, unsigned cp)
+    {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool readHex4(Cursor& c, unsigned& value)
+    {
+        if (c.i + 4 > c.s.size()) return c.fail("truncated \\u escape");
+        value = 0;
+        for (int k = 0; k < 4; ++k) {
+            char h = c.s[c.i++];
+            value <<= 4;
+            if      (h >= '0' && h <= '9') value |= (unsigned)(h - '0');
+            else if (h >= 'a' && h <= 'f') value |= (unsigned)(h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F') value |= (unsigned)(h - 'A' + 10);
+            else return c.fail("bad \\u escape");
+        }
+        return true;
+    }
+
+    bool readString(Cursor& c, string& out)
+    {
+        if (!c.expect('"')) return false;
+        out.clear();
+        while (c.i < c.s.size()) {
+            char ch = c.s[c.i++];
+            if (ch == '"') return true;
+            if ((unsigned char)ch < 0x20) return c.fail("control character in string");
+            if (ch != '\\') { out += ch; continue; }
+            if (c.i >= c.s.size()) break;
+            char e = c.s[c.i++];
+            switch (e) {
+                case '"':  out += '"';  break;
+                case '\\': out += '\\'; break;
+                case '/':  out += '/';  break;
+                case 'b':  out += '\b'; break;
+                case 'f':  out += '\f'; break;
+                case 'n':  out += '\n'; break;
+                case 'r':  out += '\r'; break;
+                case 't':  out += '\t'; break;
+                case 'u': {
+                    unsigned cp;
+                    if (!readHex4(c, cp)) return false;
+                    if (cp >= 0xD800 && cp <= 0xDBFF &&
+                        c.i + 1 < c.s.size() && c.s[c.i] == '\\' && c.s[c.i + 1] == 'u')
+                    {
+                        c.i += 2;
+                        unsigned lo;
+                        if (!readHex4(c, lo)) return false;
+                        if (lo >= 0xDC00 && lo <= 0xDFFF)
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        else
+                            return c.fail("unpaired surrogate");
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default:
+                    return c.fail("bad escape");
+            }
+        }
+        return c.fail("unterminated string");
+    }
+
+    // Number / true / false / null, kept verbatim.
+    bool readLiteral(Cursor& c, string& out)
+    {
+        size_t start = c.i;
+        while (c.i < c.s.size()) {
+            char ch = c.s[c.i];
+            if (ch == ',' || ch == '}' || ch == ' ' || ch == '\t' ||
+                ch == '\r' || ch == '\n')
+                break;
+            ++c.i;
+        }
+        out = c.s.substr(start, c.i - start);
+        if (out.empty()) return c.fail("expected value");
+        if (out == "true" || out == "false" || out == "null") return true;
+        size_t k = 0;
+        if (out[k] == '-') ++k;
+        bool digits = false;
+        for (; k < out.size(); ++k) {
+            char ch = out[k];
+            if (ch >= '0' && ch <= '9') { digits = true; continue; }
+            if (ch == '.' || ch == 'e' || ch == 'E' || ch == '+' || ch == '-') continue;
+            return c.fail("bad literal");
+        }
+        return digits ? true : c.fail("bad literal");
+    }
+
+    // SWAR: true when any of the eight bytes in v needs escaping (a control
+    // character, '"' or '\\').  Each test is exact for "any byte matches".
+    const uint64_t ONES  = 0x0101010101010101ULL;
+    const uint64_t HIGHS = 0x8080808080808080ULL;
+
+    inline bool hasZeroByte(uint64_t v)
+    {
+        return ((v - ONES) & ~v & HIGHS) != 0;
+    }
+
+    inline bool needsEscape(uint64_t v)
+    {
+        return ((v - ONES * 0x20) & ~v & HIGHS) != 0 ||     // byte < 0x20
+               hasZeroByte(v ^ (ONES * '"')) ||
+               hasZeroByte(v ^ (ONES * '\\'));
+    }
+
+    inline bool isSpecial(unsigned char ch)
+    {
+        return ch < 0x20 || ch == '"' || ch == '\\';
+    }
+
+    void appendEscape(string& out, unsigned char ch)
+    {
+        switch (ch) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b";  break;
+            case '\f': out += "\\f";  break;
+            case '\n': out += "\\n";  break;
+            case '\r': out += "\\r";  break;
+            case '\t': out += "\\t";  break;
+            default: {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)ch);
+                out += buf;
+            }
+        }
+    }
+
+    // Shortest of %.15g / %.17g that reads back as the same double.
+    void appendNumber(string& out, double v)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.15g", v);
+        if (strtod(buf, nullptr) != v)
+            snprintf(buf, sizeof(buf), "%.17g", v);
+        out += buf;
+    }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Parsing
+// ---------------------------------------------------------------------------
+
+bool json::parseObject(const string& text, map<string, string>& out, string* error)
+{
+    Cursor c(text);
+    out.clear();
+    bool ok = c.expect('{');
+    if (ok) {
+        c.skipSpace();
+        if (c.i < c.s.size() && c.s[c.i] == '}') {
+            ++c.i;
+        } else {
+            for (;;) {
+                string name, value;
+                c.skipSpace();
+                if (!(ok = readString(c, name)) || !(ok = c.expect(':'))) break;
+                c.skipSpace();
+                if (c.i < c.s.size() && (c.s[c.i] == '{' || c.s[c.i] == '[')) {
+                    ok = c.fail("nested values are not supported");
+                    break;
+                }
+                ok = (c.i < c.s.size() && c.s[c.i] == '"') ? readString(c, value)
+                                                            : readLiteral(c, value);
+                if (!ok) break;
+                out[name] = value;
+                c.skipSpace();
+                if (c.i < c.s.size() && c.s[c.i] == ',') { ++c.i; continue; }
+                ok = c.expect('}');
+                break;
+            }
+        }
+    }
+    if (ok) {
+        c.skipSpace();
+        if (c.i != c.s.size()) ok = c.fail("trailing characters");
+    }
+    if (!ok && error) *error = c.error;
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Writing
+// ---------------------------------------------------------------------------
+
+void json::appendEscaped(string& out, const char* s, size_t n)
+{
+    size_t i = 0, run = 0;
+    while (i < n) {
+        while (i + 8 <= n) {
+            uint64_t v;
+            memcpy(&v, s + i, 8);
+            if (needsEscape(v)) break;
+            i += 8;
+        }
+        while (i < n && !isSpecial((unsigned char)s[i]))
+            ++i;
+        out.append(s + run, i - run);
+        if (i == n) break;
+        appendEscape(out, (unsigned char)s[i]);
+        run = ++i;
+    }
+}
+
+void json::appendQuoted(string& out, const string& s)
+{
+    out += '"';
+    appendEscaped(out, s.data(), s.size());
+    out += '"';
+}
+
+string json::quote(const string& s)
+{
+    string out;
+    out.reserve(s.size() + 2);
+    appendQuoted(out, s);
+    return out;
+}
+
+void Writer::separator()
+{
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (!m_first.empty()) {
+        if (!m_first.back()) m_out += ',';
+        m_first.back() = 0;
+    }
+}
+
+Writer& Writer::beginObject()
+{
+    separator();
+    m_out += '{';
+    m_first.push_back(1);
+    return *this;
+}
+
+Writer& Writer::endObject()
+{
+    m_out += '}';
+    m_first.pop_back();
+    return *this;
+}
+
+Writer& Writer::beginArray()
+{
+    separator();
+    m_out += '[';
+    m_first.push_back(1);
+    return *this;
+}
+
+Writer& Writer::endArray()
+{
+    m_out += ']';
+    m_first.pop_back();
+    return *this;
+}
+
+Writer& Writer::key(const string& name)
+{
+    separator();
+    appendQuoted(m_out, name);
+    m_out += ':';
+    m_afterKey = true;
+    return *this;
+}
+
+Writer& Writer::str(const string& value)
+{
+    return str(value.data(), value.size());
+}
+
+Writer& Writer::str(const char* value, size_t n)
+{
+    separator();
+    m_out += '"';
+    appendEscaped(m_out, value, n);
+    m_out += '"';
+    return *this;
+}
+
+Writer& Writer::number(double value)
+{
+    separator();
+    appendNumber(m_out, value);
+    return *this;
+}
+
+Writer& Writer::integer(long long value)
+{
+    separator();
+    m_out += to_string(value);
+    return *this;
+}
+
+Writer& Writer::boolean(bool value)
+{
+    separator();
+    m_out += value ? "true" : "false";
+    return *this;
+}
+
+Writer& Writer::null()
+{
+    separator();
+    m_out += "null";
+    return *this;
+}
+
+// ---------------------------------------------------------------------------
+// Pull parsing
+// ---------------------------------------------------------------------------
+
+Reader::Reader(const string& text)
+    : m_text(text), m_pos(0), m_needComma(false), m_afterComma(false),
+      m_afterKey(false), m_done(false), m_start(0), m_length(0), m_escaped(false)
+{
+}
+
+Token Reader::fail(const string& what)
+{
+    if (m_error.empty())
+        m_error = what + " at offset " + to_string(m_pos);
+    return TOKEN_ERROR;
+}
+
+void Reader::skipSpace()
+{
+    while (m_pos < m_text.size()) {
+        char ch = m_text[m_pos];
+        if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n') break;
+        ++m_pos;
+    }
+}
+
+// At an opening quote: record the contents and move past the closing one.
+// Escapes are only checked for shape here; decode() validates them.
+bool Reader::scanString()
+{
+    const char* s = m_text.data();
+    size_t n = m_text.size();
+    size_t i = m_pos + 1;
+    m_escaped = false;
+    for (;;) {
+        while (i + 8 <= n) {
+            uint64_t v;
+            memcpy(&v, s + i, 8);
+            if (needsEscape(v)) break;
+            i += 8;
+        }
+        while (i < n && !isSpecial((unsigned char)s[i]))
+            ++i;
+        if (i >= n) {
+            m_pos = i;
+            fail("unterminated string");
+            return false;
+        }
+        char ch = s[i];
+        if (ch == '"') break;
+        if (ch != '\\') {
+            m_pos = i;
+            fail("control character in string");
+            return false;
+        }
+        m_escaped = true;
+        i += 2;
+    }
+    m_start  = m_pos + 1;
+    m_length = i - m_start;
+    m_pos    = i + 1;
+    return true;
+}
+
+Token Reader::valueDone(Token t)
+{
+    if (m_stack.empty())
+        m_done = true;
+    else
+        m_needComma = true;
+    return t;
+}
+
+Token Reader::next()
+{
+    if (!m_error.empty()) return TOKEN_ERROR;
+    skipSpace();
+    if (m_stack.empty() && m_done) {
+        if (m_pos == m_text.size()) return TOKEN_END;
+        return fail("trailing characters");
+    }
+    if (m_pos >= m_text.size())
+        return fail("unexpected end of input");
+
+    if (!m_stack.empty() && !m_afterKey) {
+        char top   = m_stack.back();
+        char close = top == '{' ? '}' : ']';
+        if (m_text[m_pos] == close) {
+            if (m_afterComma) return fail("trailing comma");
+            ++m_pos;
+            m_stack.pop_back();
+            return valueDone(top == '{' ? TOKEN_END_OBJECT : TOKEN_END_ARRAY);
+        }
+        if (m_needComma) {
+            if (m_text[m_pos] != ',') return fail("expected ','");
+            ++m_pos;
+            skipSpace();
+            m_needComma  = false;
+            m_afterComma = true;
+        }
+        if (top == '{') {
+            if (m_pos >= m_text.size() || m_text[m_pos] != '"')
+                return fail("expected key");
+            if (!scanString()) return TOKEN_ERROR;
+            skipSpace();
+            if (m_pos >= m_text.size() || m_text[m_pos] != ':')
+                return fail("expected ':'");
+            ++m_pos;
+            m_afterKey   = true;
+            m_afterComma = false;
+            return TOKEN_KEY;
+        }
+    }
+
+    // A value.
+    m_afterKey   = false;
+    m_afterComma = false;
+    skipSpace();
+    if (m_pos >= m_text.size())
+        return fail("expected value");
+    char ch = m_text[m_pos];
+    switch (ch) {
+        case '{':
+        case '[':
+            ++m_pos;
+            m_stack.push_back(ch);
+            m_needComma = false;
+            return ch == '{' ? TOKEN_BEGIN_OBJECT : TOKEN_BEGIN_ARRAY;
+        case '"':
+            if (!scanString()) return TOKEN_ERROR;
+            return valueDone(TOKEN_STRING);
+        case 't':
+        case 'f':
+        case 'n': {
+            static const char* const words[] = {"true", "false", "null"};
+            static const Token tokens[] = {TOKEN_TRUE, TOKEN_FALSE, TOKEN_NULL};
+            int k = ch == 't' ? 0 : ch == 'f' ? 1 : 2;
+            size_t len = strlen(words[k]);
+            if (m_text.compare(m_pos, len, words[k]) != 0)
+                return fail("bad literal");
+            m_pos += len;
+            return valueDone(tokens[k]);
+        }
+        default:
+            break;
+    }
+    if (ch != '-' && (ch < '0' || ch > '9'))
+        return fail("expected value");
+    m_start = m_pos;
+    while (m_pos < m_text.size()) {
+        char d = m_text[m_pos];
+        if ((d >= '0' && d <= '9') || d == '-' || d == '+' || d == '.' || d == 'e' || d == 'E')
+            ++m_pos;
+        else
+            break;
+    }
+    m_length  = m_pos - m_start;
+    m_escaped = false;
+    return valueDone(TOKEN_NUMBER);
+}
+
+bool Reader::decode(string& out)
+{
+    if (!m_escaped) {
+        out.assign(data(), m_length);
+        return true;
+    }
+    Cursor c(m_text);
+    c.i = m_start - 1;
+    if (readString(c, out)) return true;
+    if (m_error.empty()) m_error = c.error;
+    return false;
+}
+
+bool Reader::equals(const char* s, size_t n) const
+{
+    return !m_escaped && m_length == n && memcmp(data(), s, n) == 0;
+}
+
+bool Reader::skip(Token first)
+{
+    if (first == TOKEN_ERROR || first == TOKEN_END ||
+        first == TOKEN_END_OBJECT || first == TOKEN_END_ARRAY)
+        return false;
+    if (first != TOKEN_BEGIN_OBJECT && first != TOKEN_BEGIN_ARRAY)
+        return true;
+    size_t depth = 1;
+    while (depth > 0) {
+        Token t = next();
+        if (t == TOKEN_ERROR || t == TOKEN_END) return false;
+        if (t == TOKEN_BEGIN_OBJECT || t == TOKEN_BEGIN_ARRAY) ++depth;
+        else if (t == TOKEN_END_OBJECT || t == TOKEN_END_ARRAY) --depth;
+    }
+    return true;
+}
+
+bool json::getString(const string& text, const char* path, string& out)
+{
+    Reader r(text);
+    Token t = r.next();
+    const char* seg = path;
+    while (*seg) {
+        const char* end = strchr(seg, '.');
+        size_t len = end ? (size_t)(end - seg) : strlen(seg);
+
+        if (t == TOKEN_BEGIN_OBJECT) {
+            for (;;) {
+                t = r.next();
+                if (t != TOKEN_KEY) return false;
+                bool match;
+                if (r.escaped()) {
+                    string key;
+                    match = r.decode(key) && key.compare(0, string::npos, seg, len) == 0;
+                } else {
+                    match = r.equals(seg, len);
+                }
+                t = r.next();
+                if (match) break;
+                if (!r.skip(t)) return false;
+            }
+        } else if (t == TOKEN_BEGIN_ARRAY) {
+            char* stop = nullptr;
+            long index = strtol(seg, &stop, 10);
+            if (stop != seg + len || index < 0) return false;
+            for (long k = 0; ; ++k) {
+                t = r.next();
+                if (t == TOKEN_END_ARRAY || t == TOKEN_ERROR) return false;
+                if (k == index) break;
+                if (!r.skip(t)) return false;
+            }
+        } else {
+            return false;
+        }
+        seg += len;
+        if (*seg == '.') ++seg;
+    }
+    return t == TOKEN_STRING && r.decode(out);
+}
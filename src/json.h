@@ -0,0 +1,141 @@
+#ifndef __JSON_H__
+#define __JSON_H__
+
+/**
+ * json.h — Minimal JSON helpers (Phase 6)
+ *
+ * Just enough JSON for the conversation server's wire format and the
+ * OpenAI chat-completions payloads, without building a DOM.
+ *
+ *   parseObject()  flat object → name/value map.  String values are
+ *                  unescaped (\uXXXX, including surrogate pairs, becomes
+ *                  UTF-8); numbers, true, false and null are kept as their
+ *                  literal text.  Nested objects / arrays are rejected.
+ *   quote()        string → quoted, escaped JSON string literal.
+ *   appendEscaped  the escaper behind quote() and Writer.  It scans eight
+ *                  bytes per step (SWAR) and copies clean runs in one
+ *                  append, so long plain-text messages cost little more
+ *                  than a memcpy.
+ *   Writer         appends a document to a caller-owned string, which can
+ *                  be cleared and reused across requests.  Commas and
+ *                  colons are inserted automatically.
+ *   Reader         pull parser: next() returns one token at a time.  Keys
+ *                  and strings are views into the input, decoded only on
+ *                  request; skip() passes over whole values.
+ *   getString()    the string at a dotted path such as
+ *                  "choices.0.message.content" (numeric segments index
+ *                  arrays).  It stops reading as soon as the value is found.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+
+using namespace std;
+
+namespace json {
+
+    // Returns false (and sets *error if given) on malformed input.
+    bool parseObject(const string& text, map<string, string>& out,
+                     string* error = nullptr);
+
+    string quote(const string& s);
+
+    // Escaped contents of a string literal, without the quotes.
+    void appendEscaped(string& out, const char* s, size_t n);
+    void appendQuoted(string& out, const string& s);
+
+    /**
+     * Writer — streaming serialiser.
+     *
+     *   string buf;
+     *   json::Writer w(buf);
+     *   w.beginObject().key("model").str(m).key("n").integer(1).endObject();
+     *
+     * Mismatched begin/end calls are the caller's bug; they are not checked.
+     */
+    class Writer {
+    public:
+        explicit Writer(string& out) : m_out(out), m_afterKey(false) {}
+
+        Writer& beginObject();
+        Writer& endObject();
+        Writer& beginArray();
+        Writer& endArray();
+        Writer& key(const string& name);
+
+        Writer& str(const string& value);
+        Writer& str(const char* value, size_t n);
+        Writer& number(double value);
+        Writer& integer(long long value);
+        Writer& boolean(bool value);
+        Writer& null();
+
+    private:
+        string&      m_out;
+        vector<char> m_first;      // per open container: nothing written yet
+        bool         m_afterKey;
+
+        void separator();
+    };
+
+    enum Token {
+        TOKEN_ERROR, TOKEN_END,
+        TOKEN_BEGIN_OBJECT, TOKEN_END_OBJECT, TOKEN_BEGIN_ARRAY, TOKEN_END_ARRAY,
+        TOKEN_KEY, TOKEN_STRING, TOKEN_NUMBER, TOKEN_TRUE, TOKEN_FALSE, TOKEN_NULL
+    };
+
+    /**
+     * Reader — pull parser over a complete document.  The text must outlive
+     * the reader.  After TOKEN_KEY, TOKEN_STRING or TOKEN_NUMBER, data()
+     * and size() give the raw token (string contents without the quotes,
+     * escapes not decoded).  Any syntax error yields TOKEN_ERROR from then
+     * on, with error() describing it.
+     */
+    class Reader {
+    public:
+        explicit Reader(const string& text);
+
+        Token next();
+
+        const char* data() const { return m_text.data() + m_start; }
+        size_t      size() const { return m_length; }
+        bool        escaped() const { return m_escaped; }
+        // Current key or string, unescaped; false on a bad escape.
+        bool decode(string& out);
+        // Raw equality with an unescaped key or string.
+        bool equals(const char* s, size_t n) const;
+
+        // Pass over the rest of the value whose first token was `first`
+        // (all of it for scalars, up to the matching end for containers).
+        bool skip(Token first);
+
+        const string& error() const { return m_error; }
+
+    private:
+        const string& m_text;
+        size_t        m_pos;
+        vector<char>  m_stack;      // '{' or '[' per open container
+        bool          m_needComma;  // a member of the current container is complete
+        bool          m_afterComma;
+        bool          m_afterKey;
+        bool          m_done;       // the top-level value is complete
+        size_t        m_start;
+        size_t        m_length;
+        bool          m_escaped;
+        string        m_error;
+
+        Token fail(const string& what);
+        void  skipSpace();
+        bool  scanString();
+        Token valueDone(Token t);
+    };
+
+    // False when the path does not lead to a string (or the text up to it
+    // is malformed).
+    bool getString(const string& text, const char* path, string& out);
+
+} // namespace json
+
+#endif // __JSON_H__
@@ -0,0 +1,484 @@
+#include "llm_cache.h"
+#include "model_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace llm_cache;
+
+namespace {
+
+    // Words that change how a question is asked, not what it asks.
+    // Question words, pronouns and negations stay content words.
+    const char* const FILLER_WORDS[] = {
+        "a", "an", "the", "is", "are", "was", "were", "be", "been", "am",
+        "do", "does", "did", "please", "kindly", "just", "really", "actually",
+        "um", "uh", "hey", "hi", "hello", "ok", "okay", "so", "well", "then",
+        "of"
+    };
+
+    // A near-duplicate must agree with the input on these.
+    const char* const NEGATIONS[] = {
+        "not", "no", "never", "nor", "none", "nothing", "without", "cannot",
+        "cant", "dont", "doesnt", "didnt", "isnt", "arent", "wasnt", "werent",
+        "wont", "wouldnt", "shouldnt", "couldnt"
+    };
+
+    // Filler phrases, removed before single words.
+    const char* const FILLER_PHRASES[][4] = {
+        {"can", "you", nullptr, nullptr},
+        {"could", "you", nullptr, nullptr},
+        {"would", "you", nullptr, nullptr},
+        {"will", "you", nullptr, nullptr},
+        {"tell", "me", nullptr, nullptr},
+        {"show", "me", nullptr, nullptr},
+        {"i", "wonder", nullptr, nullptr},
+        {"i", "want", "to", "know"},
+        {"you", "know", nullptr, nullptr}
+    };
+
+    const char   SECTION_NAME[] = "llm_cache";
+
+    // splitmix64 finaliser: spreads a 64-bit value over all bits.
+    uint64_t mix(uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    bool isFiller(const string& w)
+    {
+        for (const char* f : FILLER_WORDS)
+            if (w == f) return true;
+        return false;
+    }
+
+    // Length of the filler phrase starting at words[i], or 0.
+    size_t fillerPhrase(const vector<string>& words, size_t i)
+    {
+        for (const auto& phrase : FILLER_PHRASES) {
+            size_t n = 0;
+            while (n < 4 && phrase[n] && i + n < words.size() && words[i + n] == phrase[n])
+                ++n;
+            if (n == 4 || (n > 0 && !phrase[n]))
+                return n;
+        }
+        return 0;
+    }
+
+    bool isWildcard(const string& w)
+    {
+        return w == "*" || w == "_";
+    }
+
+    // With wildcards, AIML's * and _ are words of their own.
+    vector<string> tokenize(const string& input, bool wildcards = false)
+    {
+        vector<string> words;
+        string cur;
+        for (unsigned char c : input) {
+            if (c == '\'') continue;                 // "don't" -> "dont"
+            if (isalnum(c) || c >= 0x80) {
+                cur += (char)tolower(c);
+                continue;
+            }
+            if (!cur.empty()) {
+                words.push_back(cur);
+                cur.clear();
+            }
+            if (wildcards && (c == '*' || c == '_'))
+                words.push_back(string(1, (char)c));
+        }
+        if (!cur.empty()) words.push_back(cur);
+        return words;
+    }
+
+    // Crude plural folding: "holes" -> "hole", but not "glass" or "bus".
+    void stripPlural(string& w)
+    {
+        size_t n = w.size();
+        if (n > 3 && w[n - 1] == 's' && w[n - 2] != 's' && w[n - 2] != 'u' && w[n - 2] != 'i')
+            w.erase(n - 1);
+    }
+
+    // Word set, exact key and MinHash signature of sig.sequence within
+    // sig.scope.  With pairs, the set also holds each pair of adjacent
+    // words, so order counts towards similarity too.
+    void finishSignature(Signature& sig, bool pairs = false)
+    {
+        uint64_t key = sig.scope;
+        for (const string& w : sig.sequence)
+            key = fnv1a(w, mix(key));
+        sig.key = key;
+
+        sig.words = sig.sequence;
+        if (pairs)
+            for (size_t i = 1; i < sig.sequence.size(); ++i)
+                sig.words.push_back(sig.sequence[i - 1] + " " + sig.sequence[i]);
+        sort(sig.words.begin(), sig.words.end());
+        sig.words.erase(unique(sig.words.begin(), sig.words.end()), sig.words.end());
+
+        for (size_t i = 0; i < LLM_CACHE_MINHASHES; ++i)
+            sig.minhash[i] = UINT32_MAX;
+        for (const string& w : sig.words) {
+            uint64_t h = fnv1a(w);
+            for (size_t i = 0; i < LLM_CACHE_MINHASHES; ++i) {
+                uint32_t v = (uint32_t)mix(h ^ (0x51afd7ed558ccd00ULL * (i + 1)));
+                if (v < sig.minhash[i]) sig.minhash[i] = v;
+            }
+        }
+    }
+
+    // Content words of text in order (wildcards kept when asked); true when
+    // there is at least one that is not a wildcard.
+    bool contentWords(const string& text, bool wildcards, vector<string>& out)
+    {
+        vector<string> tokens = tokenize(text, wildcards);
+        out.clear();
+        bool content = false;
+        for (size_t i = 0; i < tokens.size(); ) {
+            size_t skip = fillerPhrase(tokens, i);
+            if (skip) { i += skip; continue; }
+            string w = tokens[i++];
+            if (isFiller(w)) continue;
+            if (!isWildcard(w)) {
+                stripPlural(w);
+                content = true;
+            }
+            out.push_back(w);
+        }
+        return content;
+    }
+
+    int64_t nowSeconds()
+    {
+        return chrono::duration_cast<chrono::seconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Signatures
+// ---------------------------------------------------------------------------
+
+uint64_t llm_cache::fnv1a(const string& s, uint64_t h)
+{
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool llm_cache::makeSignature(const string& scope, const string& input, Signature& sig)
+{
+    if (!contentWords(input, false, sig.sequence))
+        return false;
+    sig.scope = fnv1a(scope);
+    finishSignature(sig);
+    return true;
+}
+
+bool llm_cache::makePatternSignature(const string& scope, const string& pattern, Signature& sig)
+{
+    if (!contentWords(pattern, true, sig.sequence))
+        return false;
+    sig.scope = fnv1a(scope);
+    finishSignature(sig, true);
+    return true;
+}
+
+uint64_t llm_cache::bandKey(const Signature& sig, size_t band)
+{
+    const size_t rows = LLM_CACHE_MINHASHES / LLM_CACHE_BANDS;
+    uint64_t h = mix(sig.scope ^ (uint64_t)band);
+    for (size_t r = 0; r < rows; ++r)
+        h = mix(h ^ sig.minhash[band * rows + r]);
+    return h;
+}
+
+string llm_cache::conversationScope(const string& scope, const string& systemPrompt,
+                                    const vector<string>& history)
+{
+    uint64_t h = fnv1a(systemPrompt);
+    size_t from = history.size() > LLM_CACHE_HISTORY ? history.size() - LLM_CACHE_HISTORY : 0;
+    for (size_t i = from; i < history.size(); ++i)
+        h = fnv1a(history[i], mix(h));
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+    return scope + "#" + hex;
+}
+
+double llm_cache::jaccard(const vector<string>& a, const vector<string>& b)
+{
+    size_t common = 0, i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        int c = a[i].compare(b[j]);
+        if (c == 0) { ++common; ++i; ++j; }
+        else if (c < 0) ++i;
+        else ++j;
+    }
+    size_t all = a.size() + b.size() - common;
+    return all ? (double)common / (double)all : 1.0;
+}
+
+bool llm_cache::negated(const vector<string>& words)
+{
+    for (const string& w : words)
+        for (const char* n : NEGATIONS)
+            if (w == n) return true;
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// LlmCache
+// ---------------------------------------------------------------------------
+
+LlmCache::LlmCache(size_t capacity, int ttlSeconds)
+    : m_capacity(capacity), m_ttl(ttlSeconds), m_unsaved(0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void LlmCache::configure(size_t capacity, int ttlSeconds)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_capacity = capacity;
+    m_ttl      = ttlSeconds;
+    trim();
+}
+
+bool LlmCache::enabled() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_capacity > 0;
+}
+
+bool LlmCache::expired(const Entry& e, int64_t now) const
+{
+    return m_ttl > 0 && now - e.created >= m_ttl;
+}
+
+void LlmCache::link(LruList::iterator it)
+{
+    m_exact[it->sig.key] = it;
+    for (size_t b = 0; b < LLM_CACHE_BANDS; ++b)
+        m_bands.insert(make_pair(bandKey(it->sig, b), it));
+}
+
+void LlmCache::erase(LruList::iterator it)
+{
+    auto ex = m_exact.find(it->sig.key);
+    if (ex != m_exact.end() && ex->second == it)
+        m_exact.erase(ex);
+    for (size_t b = 0; b < LLM_CACHE_BANDS; ++b) {
+        auto range = m_bands.equal_range(bandKey(it->sig, b));
+        for (auto bi = range.first; bi != range.second; ++bi) {
+            if (bi->second == it) {
+                m_bands.erase(bi);
+                break;
+            }
+        }
+    }
+    m_lru.erase(it);
+}
+
+void LlmCache::trim()
+{
+    while (m_lru.size() > m_capacity) {
+        erase(prev(m_lru.end()));
+        ++m_stats.evictions;
+    }
+}
+
+void LlmCache::add(Entry&& entry)
+{
+    auto old = m_exact.find(entry.sig.key);
+    if (old != m_exact.end())
+        erase(old->second);
+    m_lru.push_front(move(entry));
+    link(m_lru.begin());
+    trim();
+}
+
+bool LlmCache::lookup(const string& scope, const string& input, string& reply,
+                      const vector<string>& exclude)
+{
+    Signature sig;
+    bool content = makeSignature(scope, input, sig);
+
+    lock_guard<mutex> lock(m_mutex);
+    if (!content || m_capacity == 0) {
+        ++m_stats.misses;
+        return false;
+    }
+
+    int64_t now = nowSeconds();
+    LruList::iterator found = m_lru.end();
+    bool near = false;
+
+    auto usable = [&](const Entry& e) {
+        return find(exclude.begin(), exclude.end(), e.reply) == exclude.end();
+    };
+
+    auto ex = m_exact.find(sig.key);
+    if (ex != m_exact.end() && ex->second->sig.sequence == sig.sequence &&
+        usable(*ex->second)) {
+        found = ex->second;
+    } else {
+        // Near duplicates: best Jaccard among entries sharing a band.
+        double best = LLM_CACHE_MIN_JACCARD;
+        bool   neg  = negated(sig.words);
+        for (size_t b = 0; b < LLM_CACHE_BANDS; ++b) {
+            auto range = m_bands.equal_range(bandKey(sig, b));
+            for (auto bi = range.first; bi != range.second; ++bi) {
+                const Entry& e = *bi->second;
+                if (e.sig.scope != sig.scope || negated(e.sig.words) != neg || !usable(e))
+                    continue;
+                double j = jaccard(sig.words, e.sig.words);
+                if (j >= best && !expired(e, now)) {
+                    best  = j;
+                    found = bi->second;
+                }
+            }
+        }
+        near = found != m_lru.end();
+    }
+
+    if (found != m_lru.end() && expired(*found, now)) {
+        erase(found);
+        ++m_stats.expired;
+        found = m_lru.end();
+    }
+    if (found == m_lru.end()) {
+        ++m_stats.misses;
+        return false;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, found);
+    reply = found->reply;
+    ++m_stats.hits;
+    if (near) ++m_stats.nearHits;
+    m_stats.msSaved += found->latencyMs;
+    return true;
+}
+
+void LlmCache::insert(const string& scope, const string& input, const string& reply,
+                      double latencyMs)
+{
+    if (reply.empty()) return;
+    Entry entry;
+    if (!makeSignature(scope, input, entry.sig)) return;
+    entry.reply     = reply;
+    entry.created   = nowSeconds();
+    entry.latencyMs = latencyMs;
+
+    lock_guard<mutex> lock(m_mutex);
+    if (m_capacity == 0) return;
+    add(move(entry));
+    ++m_stats.inserts;
+    ++m_unsaved;
+}
+
+void LlmCache::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_lru.clear();
+    m_exact.clear();
+    m_bands.clear();
+}
+
+size_t LlmCache::unsaved() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_unsaved;
+}
+
+LlmCacheStats LlmCache::getStats() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    LlmCacheStats st = m_stats;
+    st.entries = m_lru.size();
+    return st;
+}
+
+// ---------------------------------------------------------------------------
+// Persistence
+// ---------------------------------------------------------------------------
+
+// Section layout: u64 count, then per entry (oldest first)
+//   u64 scope hash, u64 created, f64 latencyMs, string reply,
+//   strings content words in input order.
+// Word sets, keys and MinHash signatures are recomputed on load.
+bool LlmCache::save(const string& path)
+{
+    model_store::ModelWriter writer;
+    model_store::SectionWriter& w = writer.section(SECTION_NAME);
+    {
+        lock_guard<mutex> lock(m_mutex);
+        int64_t now = nowSeconds();
+        uint64_t live = 0;
+        for (const Entry& e : m_lru)
+            if (!expired(e, now)) ++live;
+        w.putU64(live);
+        for (auto it = m_lru.rbegin(); it != m_lru.rend(); ++it) {
+            if (expired(*it, now)) continue;
+            w.putU64(it->sig.scope);
+            w.putU64((uint64_t)it->created);
+            w.putF64(it->latencyMs);
+            w.putString(it->reply);
+            w.putStrings(it->sig.sequence);
+        }
+        m_unsaved = 0;
+    }
+    // Concurrent requests share the process's temporary file.
+    lock_guard<mutex> lock(m_saveMutex);
+    return writer.save(path);
+}
+
+bool LlmCache::load(const string& path)
+{
+    model_store::ModelFile file;
+    if (!file.open(path) || !file.hasSection(SECTION_NAME)) {
+        clear();
+        return false;
+    }
+    model_store::SectionReader r = file.section(SECTION_NAME);
+    uint64_t count = r.getU64();
+
+    vector<Entry> entries;
+    for (uint64_t i = 0; i < count && r.ok(); ++i) {
+        Entry e;
+        e.sig.scope  = r.getU64();
+        e.created    = (int64_t)r.getU64();
+        e.latencyMs  = r.getF64();
+        e.reply      = r.getString();
+        if (!r.getStrings(e.sig.sequence) || e.sig.sequence.empty()) {
+            r.fail();
+            break;
+        }
+        finishSignature(e.sig);
+        entries.push_back(move(e));
+    }
+
+    lock_guard<mutex> lock(m_mutex);
+    m_lru.clear();
+    m_exact.clear();
+    m_bands.clear();
+    m_unsaved = 0;
+    if (!r.ok()) {
+        cerr << "[LlmCache] " << path << " is malformed; starting empty." << endl;
+        return false;
+    }
+    int64_t now = nowSeconds();
+    for (Entry& e : entries)
+        if (!expired(e, now))
+            add(move(e));
+    return true;
+}
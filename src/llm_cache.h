@@ -0,0 +1,172 @@
+#ifndef __LLM_CACHE_H__
+#define __LLM_CACHE_H__
+
+/**
+ * llm_cache.h — Near-duplicate cache of GPT-4o replies (Phase 6)
+ *
+ * Every GPT-4o fallback is a paid request with a round trip of a second or
+ * more, yet users keep asking the same questions in slightly different
+ * words.  LlmCache remembers replies by what the input says rather than
+ * how it is phrased:
+ *
+ *   - the input is reduced to its content words: lower-cased, apostrophes
+ *     dropped, split on anything else that is not a letter or digit,
+ *     filler words removed and plural 's' stripped.  "Can you please tell
+ *     me what a black hole is?" and "what are black holes" both become
+ *     (what, black, hole).  Question words and negations are content words.
+ *   - an exact fingerprint of (scope, content words in order) answers
+ *     repeats directly.
+ *   - otherwise a MinHash signature of the content-word set (sorted and
+ *     de-duplicated, so order no longer counts), split into
+ *     LLM_CACHE_BANDS bands (locality-sensitive hashing), finds entries
+ *     that probably share most words.  A candidate is a near hit when the
+ *     Jaccard similarity of the two word sets is at least
+ *     LLM_CACHE_MIN_JACCARD and both or neither contain a negation.
+ *
+ * The scope separates requests that must not share replies: model and
+ * kind of request, and (see conversationScope()) a hash of the system
+ * prompt and of the latest history entries, so a reply is only reused in
+ * the conversation context it was given in.  A lookup can also exclude
+ * replies the caller must not get back, such as its recent ones.  Inputs
+ * with no content words are never cached.
+ *
+ * Entries expire after a TTL and the least recently used ones go first
+ * when the cache is full.  Each entry keeps the latency of the request
+ * that produced it, so hits can report the time they saved.  save()/load()
+ * persist the entries (one model_store section) so restarts keep them.
+ * Pre-forked workers each cache on their own, and the last save wins.
+ * The cache is safe to share between threads.
+ */
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+namespace llm_cache {
+
+    static const size_t LLM_CACHE_CAPACITY    = 2048;            // entries
+    static const int    LLM_CACHE_TTL_S       = 7 * 24 * 3600;
+    static const size_t LLM_CACHE_MINHASHES   = 16;
+    static const size_t LLM_CACHE_BANDS       = 8;               // of MINHASHES / BANDS rows
+    static const double LLM_CACHE_MIN_JACCARD = 0.8;
+    static const size_t LLM_CACHE_HISTORY     = 10;              // history strings in the scope
+
+    // Content words of an input and the hashes derived from them.
+    struct Signature {
+        vector<string> sequence;                 // in input order
+        vector<string> words;                    // sorted, unique
+        uint64_t       scope;                    // hash of the scope
+        uint64_t       key;                      // exact fingerprint of sequence, scope included
+        uint32_t       minhash[LLM_CACHE_MINHASHES];
+    };
+
+    // 64-bit FNV-1a of s, continuing from h.
+    uint64_t fnv1a(const string& s, uint64_t h = 1469598103934665603ULL);
+
+    // False when the input has no content words.
+    bool makeSignature(const string& scope, const string& input, Signature& sig);
+
+    // The same for an AIML pattern, keeping its * and _ wildcards in place.
+    // The word set also holds each pair of adjacent words, so two patterns
+    // are only similar if their words and wildcards come in much the same
+    // order.  False when the pattern has nothing but wildcards and filler.
+    bool makePatternSignature(const string& scope, const string& pattern, Signature& sig);
+
+    // Hash of one LSH band of sig's MinHash signature, scope included.
+    uint64_t bandKey(const Signature& sig, size_t band);
+
+    // scope extended with hashes of the system prompt and the last
+    // LLM_CACHE_HISTORY entries of history (alternating input / reply).
+    string conversationScope(const string& scope, const string& systemPrompt,
+                             const vector<string>& history);
+
+    // |a ∩ b| / |a ∪ b| of two sorted, unique word lists.
+    double jaccard(const vector<string>& a, const vector<string>& b);
+
+    // True when the content words include a negation ("not", "never", ...).
+    bool negated(const vector<string>& words);
+
+    struct LlmCacheStats {
+        size_t entries;
+        size_t hits;          // exact and near
+        size_t nearHits;      // of which near-duplicates
+        size_t misses;
+        size_t inserts;
+        size_t evictions;     // capacity
+        size_t expired;       // TTL
+        double msSaved;       // summed latency of the requests hits replaced
+
+        double hitRate() const {
+            size_t n = hits + misses;
+            return n ? (double)hits / (double)n : 0.0;
+        }
+    };
+
+    class LlmCache {
+    public:
+        explicit LlmCache(size_t capacity = LLM_CACHE_CAPACITY, int ttlSeconds = LLM_CACHE_TTL_S);
+
+        LlmCache(const LlmCache&) = delete;
+        LlmCache& operator=(const LlmCache&) = delete;
+
+        // Capacity 0 disables the cache.  Shrinking evicts at once.
+        void configure(size_t capacity, int ttlSeconds);
+        bool enabled() const;
+
+        // True (and reply set) on an exact or near hit; counts a hit or a
+        // miss.  A cached reply equal to one in exclude counts as a miss.
+        bool lookup(const string& scope, const string& input, string& reply,
+                    const vector<string>& exclude = vector<string>());
+
+        // Remember the reply to input; latencyMs is what producing it cost.
+        void insert(const string& scope, const string& input, const string& reply,
+                    double latencyMs);
+
+        void clear();
+
+        // Atomic write of the live entries; false on I/O error.
+        bool save(const string& path);
+        // Replace the contents with the file's unexpired entries; false if
+        // the file is missing or malformed (the cache is left empty).
+        bool load(const string& path);
+
+        // Entries inserted since the last save()/load().
+        size_t unsaved() const;
+
+        LlmCacheStats getStats() const;
+
+    private:
+        struct Entry {
+            Signature sig;
+            string    reply;
+            int64_t   created;     // seconds since the epoch
+            double    latencyMs;
+        };
+        typedef list<Entry> LruList;     // MRU first
+
+        mutable mutex                                   m_mutex;
+        mutex                                           m_saveMutex;
+        size_t                                          m_capacity;
+        int                                             m_ttl;
+        LruList                                         m_lru;
+        unordered_map<uint64_t, LruList::iterator>      m_exact;
+        unordered_multimap<uint64_t, LruList::iterator> m_bands;   // band key -> entry
+        size_t                                          m_unsaved;
+        LlmCacheStats                                   m_stats;
+
+        bool expired(const Entry& e, int64_t now) const;
+        void link(LruList::iterator it);
+        void erase(LruList::iterator it);
+        void trim();
+        void add(Entry&& entry);
+    };
+
+} // namespace llm_cache
+
+#endif // __LLM_CACHE_H__
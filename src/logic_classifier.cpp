@@ -20,14 +20,44 @@ LogicClassifier::LogicClassifier()
         return w;
     };
 
-    m_W1 = initMatrix(HIDDEN_DIM, INPUT_DIM);
-    m_W2 = initMatrix(OUTPUT_DIM, HIDDEN_DIM);
-    m_b1.assign(HIDDEN_DIM, 0.0);
-    m_b2.assign(OUTPUT_DIM, 0.0);
-
-    m_lastInput.assign(INPUT_DIM, 0.0);
-    m_lastH.assign(HIDDEN_DIM, 0.0);
-    m_lastOut.assign(OUTPUT_DIM, 0.0);
+    LogicWeights w;
+    w.W1 = initMatrix(HIDDEN_DIM, INPUT_DIM);
+    w.W2 = initMatrix(OUTPUT_DIM, HIDDEN_DIM);
+    w.b1.assign(HIDDEN_DIM, 0.0);
+    w.b2.assign(OUTPUT_DIM, 0.0);
+    publish(std::move(w));
+}
+
+shared_ptr<const LogicWeights> LogicClassifier::weights() const {
+    return atomic_load(&m_weights);
+}
+
+void LogicClassifier::publish(LogicWeights&& w) {
+    shared_ptr<const LogicWeights> next = make_shared<LogicWeights>(std::move(w));
+    atomic_store(&m_weights, next);
+}
+
+void LogicClassifier::exportTo(model_store::SectionWriter& out) const {
+    shared_ptr<const LogicWeights> w = weights();
+    out.putMatrix(w->W1);
+    out.putF64Array(w->b1.data(), w->b1.size());
+    out.putMatrix(w->W2);
+    out.putF64Array(w->b2.data(), w->b2.size());
+    out.putU32((uint32_t)m_updateCount.load());
+}
+
+bool LogicClassifier::importFrom(model_store::SectionReader& in) {
+    LogicWeights w;
+    in.getMatrix(w.W1, HIDDEN_DIM, INPUT_DIM);
+    in.getF64Array(w.b1, HIDDEN_DIM);
+    in.getMatrix(w.W2, OUTPUT_DIM, HIDDEN_DIM);
+    in.getF64Array(w.b2, OUTPUT_DIM);
+    uint32_t updates = in.getU32();
+    if (!in.ok()) return false;
+
+    publish(std::move(w));
+    m_updateCount.store((int)updates);
+    return true;
 }
 
 vector<string> LogicClassifier::tokenize(const string& text) {
@@ -113,60 +143,98 @@ vector<double> LogicClassifier::buildFeatures(
     return feat;
 }
 
-vector<double> LogicClassifier::forward(const vector<double>& input) {
-    m_lastInput = input;
+vector<double> LogicClassifier::forward(const vector<double>& input) const {
+    shared_ptr<const LogicWeights> w = weights();
 
     vector<double> h(HIDDEN_DIM, 0.0);
     for (int i = 0; i < HIDDEN_DIM; ++i) {
-        double v = m_b1[i];
-        for (int j = 0; j < INPUT_DIM; ++j)
-            v += m_W1[i][j] * m_lastInput[j];
+        double v = w->b1[i];
+        for (int j = 0; j < INPUT_DIM && j < (int)input.size(); ++j)
+            v += w->W1[i][j] * input[j];
         h[i] = v;
     }
-
-    m_lastH = tanhVec(h);
+    h = tanhVec(h);
 
     vector<double> out(OUTPUT_DIM, 0.0);
     for (int i = 0; i < OUTPUT_DIM; ++i) {
-        double v = m_b2[i];
+        double v = w->b2[i];
         for (int j = 0; j < HIDDEN_DIM; ++j)
-            v += m_W2[i][j] * m_lastH[j];
+            v += w->W2[i][j] * h[j];
         out[i] = v;
     }
-
-    m_lastOut = softmax(out);
-    return m_lastOut;
+    return softmax(out);
 }
 
-void LogicClassifier::backward(const vector<double>& input, int targetIndex, double learningRate) {
-    if (targetIndex < 0 || targetIndex >= OUTPUT_DIM) return;
-    auto out = forward(input);
-
-    vector<double> dz2(OUTPUT_DIM, 0.0);
-    for (int i = 0; i < OUTPUT_DIM; ++i)
-        dz2[i] = out[i] - (i == targetIndex ? 1.0 : 0.0);
-
-    for (int i = 0; i < OUTPUT_DIM; ++i) {
-        m_b2[i] -= learningRate * dz2[i];
-        for (int j = 0; j < HIDDEN_DIM; ++j)
-            m_W2[i][j] -= learningRate * dz2[i] * m_lastH[j];
+void LogicClassifier::trainBatch(const vector<TrainingSample>& batch) {
+    // Pack samples row-major: X [B × INPUT].
+    int B = (int)batch.size();
+    if (B == 0) return;
+    vector<double> X((size_t)B * INPUT_DIM, 0.0);
+    for (int n = 0; n < B; ++n)
+        for (int j = 0; j < INPUT_DIM && j < (int)batch[n].features.size(); ++j)
+            X[(size_t)n * INPUT_DIM + j] = batch[n].features[j];
+
+    shared_ptr<const LogicWeights> cur = weights();
+    LogicWeights next = *cur;
+
+    // Forward: H = tanh(X W1ᵀ + b1), P = softmax(H W2ᵀ + b2).
+    vector<double> H((size_t)B * HIDDEN_DIM, 0.0);
+    vector<double> dZ2((size_t)B * OUTPUT_DIM, 0.0);
+    for (int n = 0; n < B; ++n) {
+        const double* x = &X[(size_t)n * INPUT_DIM];
+        double*       h = &H[(size_t)n * HIDDEN_DIM];
+        for (int i = 0; i < HIDDEN_DIM; ++i) {
+            double v = cur->b1[i];
+            for (int j = 0; j < INPUT_DIM; ++j) v += cur->W1[i][j] * x[j];
+            h[i] = tanh(v);
+        }
+        vector<double> z(OUTPUT_DIM, 0.0);
+        for (int i = 0; i < OUTPUT_DIM; ++i) {
+            double v = cur->b2[i];
+            for (int j = 0; j < HIDDEN_DIM; ++j) v += cur->W2[i][j] * h[j];
+            z[i] = v;
+        }
+        // Softmax + cross-entropy gradient, pre-scaled by this sample's
+        // learning rate (backprop is linear in dZ2, so the scale carries
+        // through to the hidden layer).
+        auto p = softmax(z);
+        int target = systemToIndex(batch[n].target);
+        for (int i = 0; i < OUTPUT_DIM; ++i)
+            dZ2[(size_t)n * OUTPUT_DIM + i] =
+                batch[n].learningRate * (p[i] - (i == target ? 1.0 : 0.0));
     }
 
-    vector<double> dh(HIDDEN_DIM, 0.0);
-    for (int j = 0; j < HIDDEN_DIM; ++j) {
-        double s = 0.0;
-        for (int i = 0; i < OUTPUT_DIM; ++i)
-            s += m_W2[i][j] * dz2[i];
-        dh[j] = s * (1.0 - m_lastH[j] * m_lastH[j]);
+    // Backprop into the hidden layer against the pre-update W2.
+    vector<double> dH((size_t)B * HIDDEN_DIM, 0.0);
+    for (int n = 0; n < B; ++n) {
+        const double* dz = &dZ2[(size_t)n * OUTPUT_DIM];
+        const double* h  = &H[(size_t)n * HIDDEN_DIM];
+        double*       dh = &dH[(size_t)n * HIDDEN_DIM];
+        for (int j = 0; j < HIDDEN_DIM; ++j) {
+            double s = 0.0;
+            for (int i = 0; i < OUTPUT_DIM; ++i) s += cur->W2[i][j] * dz[i];
+            dh[j] = s * (1.0 - h[j] * h[j]);
+        }
     }
 
-    for (int i = 0; i < HIDDEN_DIM; ++i) {
-        m_b1[i] -= learningRate * dh[i];
-        for (int j = 0; j < INPUT_DIM; ++j)
-            m_W1[i][j] -= learningRate * dh[i] * m_lastInput[j];
+    // Apply summed gradients and publish.
+    for (int n = 0; n < B; ++n) {
+        const double* dz = &dZ2[(size_t)n * OUTPUT_DIM];
+        const double* dh = &dH[(size_t)n * HIDDEN_DIM];
+        const double* h  = &H[(size_t)n * HIDDEN_DIM];
+        const double* x  = &X[(size_t)n * INPUT_DIM];
+        for (int i = 0; i < OUTPUT_DIM; ++i) {
+            next.b2[i] -= dz[i];
+            for (int j = 0; j < HIDDEN_DIM; ++j) next.W2[i][j] -= dz[i] * h[j];
+        }
+        for (int i = 0; i < HIDDEN_DIM; ++i) {
+            next.b1[i] -= dh[i];
+            for (int j = 0; j < INPUT_DIM; ++j) next.W1[i][j] -= dh[i] * x[j];
+        }
     }
+    publish(std::move(next));
 
-    m_updateCount++;
+    m_updateCount += B;
 }
 
 int LogicClassifier::systemToIndex(LogicSystem s) {
@@ -215,8 +283,12 @@ Classification LogicClassifier::classify(const string& input,
     c.system = indexToSystem(bestIdx);
     c.confidence = bestP;
     c.probabilities = probs;
+    c.features = feat;
     c.isLogic = (c.system != LOGIC_NONE);
-    m_lastClassification = c;
+    {
+        std::lock_guard<std::mutex> lock(m_lastMutex);
+        m_lastClassification = c;
+    }
     return c;
 }
 
@@ -254,6 +326,9 @@ void LogicClassifier::reinforce(const string& input,
                                 LogicSystem target,
                                 double learningRate)
 {
-    auto feat = buildFeatures(input, contextVector, hgnnNet, dtesnnNet);
-    backward(feat, systemToIndex(target), learningRate);
+    TrainingSample sample;
+    sample.features = buildFeatures(input, contextVector, hgnnNet, dtesnnNet);
+    sample.target = target;
+    sample.learningRate = learningRate;
+    trainBatch(vector<TrainingSample>(1, sample));
 }
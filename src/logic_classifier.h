@@ -4,9 +4,13 @@
 #include "logic_meta_patterns.h"
 #include "hgnn.h"
 #include "dtesnn.h"
+#include "model_store.h"
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
 
 namespace logic_classifier {
 
@@ -14,12 +18,29 @@ namespace logic_classifier {
         logic_meta_patterns::LogicSystem system;
         double confidence;
         std::vector<double> probabilities;
+        std::vector<double> features;   // classifier input, for later reinforcement
         bool isLogic;
 
         Classification()
             : system(logic_meta_patterns::LOGIC_NONE), confidence(0.0), isLogic(false) {}
     };
 
+    // One immutable set of classifier weights.
+    struct LogicWeights {
+        std::vector<std::vector<double>> W1;
+        std::vector<double> b1;
+        std::vector<std::vector<double>> W2;
+        std::vector<double> b2;
+    };
+
+    // One reinforcement example: the features the classifier saw, the
+    // system it should have chosen, and the step size for this example.
+    struct TrainingSample {
+        std::vector<double> features;
+        logic_meta_patterns::LogicSystem target;
+        double learningRate;
+    };
+
     class LogicClassifier {
     public:
         LogicClassifier();
@@ -41,35 +62,43 @@ namespace logic_classifier {
                        logic_meta_patterns::LogicSystem target,
                        double learningRate = 0.01);
 
-        int getUpdateCount() const { return m_updateCount; }
-        Classification getLastClassification() const { return m_lastClassification; }
+        // Classifier input features (exposed so callers can queue training
+        // samples built from exactly what classify() saw).
+        std::vector<double> buildFeatures(const std::string& input,
+                                          const std::map<std::string, double>& contextVector,
+                                          hgnn::HyperGraphNeuralNet* hgnnNet,
+                                          dtesnn::DeepTreeEchoStateNet* dtesnnNet) const;
+
+        // Batched backprop over a mini-batch; the new weights are published
+        // atomically so classify() never blocks.  One writer at a time.
+        void trainBatch(const std::vector<TrainingSample>& batch);
+
+        // Binary persistence of the classifier weights (see model_store.h).
+        void exportTo(model_store::SectionWriter& out) const;
+        bool importFrom(model_store::SectionReader& in);
+
+        int getUpdateCount() const { return m_updateCount.load(); }
+        Classification getLastClassification() const {
+            std::lock_guard<std::mutex> lock(m_lastMutex);
+            return m_lastClassification;
+        }
 
     private:
         static const int INPUT_DIM = 28;
         static const int HIDDEN_DIM = 16;
         static const int OUTPUT_DIM = 7; // NONE + 6 systems
 
-        std::vector<std::vector<double>> m_W1;
-        std::vector<double> m_b1;
-        std::vector<std::vector<double>> m_W2;
-        std::vector<double> m_b2;
+        // Current weights; read with atomic_load, replaced with atomic_store.
+        std::shared_ptr<const LogicWeights> m_weights;
 
-        std::vector<double> m_lastInput;
-        std::vector<double> m_lastH;
-        std::vector<double> m_lastOut;
+        std::atomic<int> m_updateCount;
+        Classification m_lastClassification;   // guarded by m_lastMutex
+        mutable std::mutex m_lastMutex;
 
-        int m_updateCount;
-        Classification m_lastClassification;
+        std::shared_ptr<const LogicWeights> weights() const;
+        void publish(LogicWeights&& w);
 
-        std::vector<double> buildFeatures(const std::string& input,
-                                     const std::map<std::string, double>& contextVector,
-                                     hgnn::HyperGraphNeuralNet* hgnnNet,
-                                     dtesnn::DeepTreeEchoStateNet* dtesnnNet) const;
-
-        std::vector<double> forward(const std::vector<double>& input);
-        void backward(const std::vector<double>& input,
-                      int targetIndex,
-                      double learningRate);
+        std::vector<double> forward(const std::vector<double>& input) const;
 
         static std::vector<std::string> tokenize(const std::string& text);
         static std::vector<double> softmax(const std::vector<double>& x);
@@ -1,11 +1,6 @@
 #include "logic_meta_patterns.h"
 #include <algorithm>
-#include <fstream>
-#include <iostream>
 #include <sstream>
-#include <sys/stat.h>
-#include <cerrno>
-#include <cstring>
 
 using namespace std;
 using namespace logic_meta_patterns;
@@ -101,19 +96,11 @@ string MetaPatternRegistry::systemToFilename(LogicSystem system) {
     }
 }
 
-bool MetaPatternRegistry::writeAIMLFiles(const string& outputDir) const {
-    if (mkdir(outputDir.c_str(), 0755) != 0 && errno != EEXIST) {
-        cerr << "[MetaPatternRegistry] Failed to create directory "
-             << outputDir << ": " << strerror(errno) << endl;
-        return false;
-    }
-
+vector<pair<string, string>> MetaPatternRegistry::renderAIMLFiles(const string& outputDir) const {
+    vector<pair<string, string>> files;
     vector<LogicSystem> systems = {PL, FOL, MODAL, LINEAR, DTT, CAT_THEORY};
     for (auto system : systems) {
-        string path = outputDir + "/" + systemToFilename(system);
-        ofstream out(path.c_str());
-        if (!out.is_open()) return false;
-
+        ostringstream out;
         out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
         out << "<aiml version=\"1.0\">\n";
         out << "  <topic name=\"" << toString(system) << "\">\n";
@@ -130,7 +117,7 @@ bool MetaPatternRegistry::writeAIMLFiles(const string& outputDir) const {
 
         out << "  </topic>\n";
         out << "</aiml>\n";
+        files.push_back(make_pair(outputDir + "/" + systemToFilename(system), out.str()));
     }
-
-    return true;
+    return files;
 }
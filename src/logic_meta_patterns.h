@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <utility>
 
 namespace logic_meta_patterns {
 
@@ -43,8 +44,9 @@ namespace logic_meta_patterns {
         const std::vector<MetaPattern>& getPatterns() const { return m_patterns; }
         std::vector<MetaPattern> getPatternsForSystem(LogicSystem system) const;
 
-        // Generate AIML files grouped per logic system.
-        bool writeAIMLFiles(const std::string& outputDir) const;
+        // AIML files grouped per logic system, as (path, contents).
+        std::vector<std::pair<std::string, std::string>>
+        renderAIMLFiles(const std::string& outputDir) const;
 
     private:
         MetaPatternRegistry();
@@ -2,7 +2,6 @@
 #include "aimlpattern.h"
 #include "aimltemplate.h"
 #include "aimltext.h"
-#include <fstream>
 #include <sstream>
 #include <algorithm>
 
@@ -104,10 +103,8 @@ vector<unique_ptr<Category>> MathPrimitiveRegistry::generateCategories() const {
     return out;
 }
 
-bool MathPrimitiveRegistry::writeAIMLFile(const string& outputPath) const {
-    ofstream out(outputPath.c_str());
-    if (!out.is_open()) return false;
-
+string MathPrimitiveRegistry::renderAIML() const {
+    ostringstream out;
     out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
     out << "<aiml version=\"1.0\">\n";
     for (const auto& p : m_primitives) {
@@ -117,5 +114,5 @@ bool MathPrimitiveRegistry::writeAIMLFile(const string& outputPath) const {
         out << "  </category>\n";
     }
     out << "</aiml>\n";
-    return true;
+    return out.str();
 }
@@ -31,7 +31,8 @@ namespace math_primitives {
         const std::vector<MathPrimitive>& primitives() const { return m_primitives; }
 
         std::vector<std::unique_ptr<aiml::Category>> generateCategories() const;
-        bool writeAIMLFile(const std::string& outputPath) const;
+        // The registry as an AIML file (database/logic/math_primitives.aiml).
+        std::string renderAIML() const;
 
     private:
         MathPrimitiveRegistry();
@@ -14,89 +14,162 @@ using namespace mlp_engine;
 MLPEngine::MLPEngine()
     : m_lr(0.01), m_updateCount(0)
 {
-    xavierInit(m_W1, m_b1, MLP_INPUT_DIM,  MLP_HIDDEN1);
-    xavierInit(m_W2, m_b2, MLP_HIDDEN1,    MLP_HIDDEN2);
-    xavierInit(m_W3, m_b3, MLP_HIDDEN2,    MLP_OUTPUT_DIM);
-
-    m_h1.assign(MLP_HIDDEN1,    0.0);
-    m_h2.assign(MLP_HIDDEN2,    0.0);
-    m_out.assign(MLP_OUTPUT_DIM, 0.0);
-    m_lastInput.assign(MLP_INPUT_DIM, 0.0);
+    MLPWeights w;
+    xavierInit(w.W1, w.b1, MLP_INPUT_DIM,  MLP_HIDDEN1);
+    xavierInit(w.W2, w.b2, MLP_HIDDEN1,    MLP_HIDDEN2);
+    xavierInit(w.W3, w.b3, MLP_HIDDEN2,    MLP_OUTPUT_DIM);
+    publish(std::move(w));
+}
+
+shared_ptr<const MLPWeights> MLPEngine::weights() const
+{
+    return atomic_load(&m_weights);
+}
+
+void MLPEngine::publish(MLPWeights&& w)
+{
+    shared_ptr<const MLPWeights> next = make_shared<MLPWeights>(std::move(w));
+    atomic_store(&m_weights, next);
 }
 
 // ---------------------------------------------------------------------------
 // Forward pass
 // ---------------------------------------------------------------------------
 
-vector<double> MLPEngine::forward(const vector<double>& input)
+vector<double> MLPEngine::forward(const vector<double>& input) const
 {
+    shared_ptr<const MLPWeights> w = weights();
+
     // Pad / truncate input to MLP_INPUT_DIM.
-    m_lastInput = input;
-    m_lastInput.resize(MLP_INPUT_DIM, 0.0);
+    vector<double> x = input;
+    x.resize(MLP_INPUT_DIM, 0.0);
 
-    m_h1  = tanh_vec(affine(m_W1, m_b1, m_lastInput));
-    m_h2  = tanh_vec(affine(m_W2, m_b2, m_h1));
-    m_out = softmax(affine(m_W3, m_b3, m_h2));
-    return m_out;
+    vector<double> h1 = tanh_vec(affine(w->W1, w->b1, x));
+    vector<double> h2 = tanh_vec(affine(w->W2, w->b2, h1));
+    return softmax(affine(w->W3, w->b3, h2));
 }
 
 // ---------------------------------------------------------------------------
-// Backward pass (online SGD, cross-entropy + softmax loss)
+// Backward pass (mini-batch SGD, cross-entropy + softmax loss)
 // ---------------------------------------------------------------------------
 
+namespace {
+
+    // Y[b][i] = act(b[i] + Σ_j W[i][j] * X[b][j]) for a row-major batch.
+    void denseForward(const vector<vector<double>>& W, const vector<double>& bias,
+                      const vector<double>& X, int B, int inDim,
+                      vector<double>& Y, bool useTanh)
+    {
+        int outDim = (int)W.size();
+        Y.assign((size_t)B * outDim, 0.0);
+        for (int n = 0; n < B; ++n) {
+            const double* x = &X[(size_t)n * inDim];
+            double*       y = &Y[(size_t)n * outDim];
+            for (int i = 0; i < outDim; ++i) {
+                const double* wi = W[i].data();
+                double v = bias[i];
+                for (int j = 0; j < inDim; ++j) v += wi[j] * x[j];
+                y[i] = useTanh ? tanh(v) : v;
+            }
+        }
+    }
+
+    // dX[b][j] = (Σ_i W[i][j] * dZ[b][i]) * (1 - H[b][j]²)   (tanh layer below)
+    void denseBackprop(const vector<vector<double>>& W,
+                       const vector<double>& dZ, const vector<double>& H,
+                       int B, int inDim, vector<double>& dX)
+    {
+        int outDim = (int)W.size();
+        dX.assign((size_t)B * inDim, 0.0);
+        for (int n = 0; n < B; ++n) {
+            const double* dz = &dZ[(size_t)n * outDim];
+            double*       dx = &dX[(size_t)n * inDim];
+            for (int i = 0; i < outDim; ++i) {
+                const double* wi = W[i].data();
+                for (int j = 0; j < inDim; ++j) dx[j] += wi[j] * dz[i];
+            }
+            const double* h = &H[(size_t)n * inDim];
+            for (int j = 0; j < inDim; ++j) dx[j] *= (1.0 - h[j] * h[j]);
+        }
+    }
+
+    // W -= lr * Σ_b dZ[b]ᵀ X[b];  bias -= lr * Σ_b dZ[b]
+    void denseUpdate(vector<vector<double>>& W, vector<double>& bias,
+                     const vector<double>& dZ, const vector<double>& X,
+                     int B, int inDim, double lr)
+    {
+        int outDim = (int)W.size();
+        for (int n = 0; n < B; ++n) {
+            const double* dz = &dZ[(size_t)n * outDim];
+            const double* x  = &X[(size_t)n * inDim];
+            for (int i = 0; i < outDim; ++i) {
+                double g = lr * dz[i];
+                if (g == 0.0) continue;
+                bias[i] -= g;
+                double* wi = W[i].data();
+                for (int j = 0; j < inDim; ++j) wi[j] -= g * x[j];
+            }
+        }
+    }
+
+} // namespace
+
 void MLPEngine::backward(const vector<double>& input, int targetIndex,
                           double learningRate)
 {
-    if (targetIndex < 0 || targetIndex >= MLP_OUTPUT_DIM) return;
-
-    // Re-run forward to refresh cached activations if input changed.
-    if (input != m_lastInput)
-        forward(input);
+    TrainingSample sample;
+    sample.features = input;
+    sample.target   = targetIndex;
+    trainBatch(vector<TrainingSample>(1, sample), learningRate);
+}
 
-    // ---- Output layer gradient (softmax + cross-entropy): dL/dz3 = out - y ----
-    vector<double> dz3(MLP_OUTPUT_DIM, 0.0);
-    for (int i = 0; i < MLP_OUTPUT_DIM; ++i)
-        dz3[i] = m_out[i] - (i == targetIndex ? 1.0 : 0.0);
-
-    // ---- Gradient of W3, b3 ----
-    for (int i = 0; i < MLP_OUTPUT_DIM; ++i) {
-        m_b3[i] -= learningRate * dz3[i];
-        for (int j = 0; j < MLP_HIDDEN2; ++j)
-            m_W3[i][j] -= learningRate * dz3[i] * m_h2[j];
+void MLPEngine::trainBatch(const vector<TrainingSample>& batch,
+                           double learningRate)
+{
+    // Pack valid samples into a row-major [B × INPUT] matrix.
+    vector<double> X;
+    vector<int>    targets;
+    X.reserve(batch.size() * MLP_INPUT_DIM);
+    for (const auto& s : batch) {
+        if (s.target < 0 || s.target >= MLP_OUTPUT_DIM) continue;
+        for (int j = 0; j < MLP_INPUT_DIM; ++j)
+            X.push_back(j < (int)s.features.size() ? s.features[j] : 0.0);
+        targets.push_back(s.target);
     }
+    int B = (int)targets.size();
+    if (B == 0) return;
 
-    // ---- Backprop through hidden layer 2 ----
-    // dh2 = W3^T * dz3 ∘ dtanh(h2)
-    vector<double> dh2(MLP_HIDDEN2, 0.0);
-    for (int j = 0; j < MLP_HIDDEN2; ++j) {
-        double sum = 0.0;
-        for (int i = 0; i < MLP_OUTPUT_DIM; ++i)
-            sum += m_W3[i][j] * dz3[i];
-        dh2[j] = sum * (1.0 - m_h2[j] * m_h2[j]); // dtanh
-    }
+    shared_ptr<const MLPWeights> cur = weights();
+    MLPWeights next = *cur;
 
-    for (int i = 0; i < MLP_HIDDEN2; ++i) {
-        m_b2[i] -= learningRate * dh2[i];
-        for (int j = 0; j < MLP_HIDDEN1; ++j)
-            m_W2[i][j] -= learningRate * dh2[i] * m_h1[j];
-    }
+    // ---- Forward over the whole batch ----
+    vector<double> H1, H2, Z3;
+    denseForward(cur->W1, cur->b1, X,  B, MLP_INPUT_DIM, H1, true);
+    denseForward(cur->W2, cur->b2, H1, B, MLP_HIDDEN1,   H2, true);
+    denseForward(cur->W3, cur->b3, H2, B, MLP_HIDDEN2,   Z3, false);
 
-    // ---- Backprop through hidden layer 1 ----
-    vector<double> dh1(MLP_HIDDEN1, 0.0);
-    for (int j = 0; j < MLP_HIDDEN1; ++j) {
-        double sum = 0.0;
-        for (int i = 0; i < MLP_HIDDEN2; ++i)
-            sum += m_W2[i][j] * dh2[i];
-        dh1[j] = sum * (1.0 - m_h1[j] * m_h1[j]);
+    // ---- Output layer gradient (softmax + cross-entropy): dL/dz3 = out - y ----
+    vector<double> dZ3(Z3.size());
+    for (int n = 0; n < B; ++n) {
+        vector<double> z(Z3.begin() + (size_t)n * MLP_OUTPUT_DIM,
+                         Z3.begin() + (size_t)(n + 1) * MLP_OUTPUT_DIM);
+        vector<double> out = softmax(z);
+        for (int i = 0; i < MLP_OUTPUT_DIM; ++i)
+            dZ3[(size_t)n * MLP_OUTPUT_DIM + i] = out[i] - (i == targets[n] ? 1.0 : 0.0);
     }
 
-    for (int i = 0; i < MLP_HIDDEN1; ++i) {
-        m_b1[i] -= learningRate * dh1[i];
-        for (int j = 0; j < MLP_INPUT_DIM; ++j)
-            m_W1[i][j] -= learningRate * dh1[i] * m_lastInput[j];
-    }
+    // ---- Backprop through hidden layers (against pre-update weights) ----
+    vector<double> dH2, dH1;
+    denseBackprop(cur->W3, dZ3, H2, B, MLP_HIDDEN2, dH2);
+    denseBackprop(cur->W2, dH2, H1, B, MLP_HIDDEN1, dH1);
+
+    // ---- Apply summed gradients to the copy and publish ----
+    denseUpdate(next.W3, next.b3, dZ3, H2, B, MLP_HIDDEN2,   learningRate);
+    denseUpdate(next.W2, next.b2, dH2, H1, B, MLP_HIDDEN1,   learningRate);
+    denseUpdate(next.W1, next.b1, dH1, X,  B, MLP_INPUT_DIM, learningRate);
+    publish(std::move(next));
 
-    m_updateCount++;
+    m_updateCount += B;
 }
 
 // ---------------------------------------------------------------------------
@@ -137,7 +210,7 @@ vector<double> MLPEngine::encodeFeatures(
 
 void MLPEngine::decayLearningRate(double factor)
 {
-    m_lr = max(1e-5, m_lr * factor);
+    m_lr.store(max(1e-5, m_lr.load() * factor));
 }
 
 // ---------------------------------------------------------------------------
@@ -163,10 +236,11 @@ void MLPEngine::saveWeights(const string& filename) const
         f << "\n";
     };
 
-    writeMatrix(m_W1, m_b1);
-    writeMatrix(m_W2, m_b2);
-    writeMatrix(m_W3, m_b3);
-    f << m_lr << "\n";
+    shared_ptr<const MLPWeights> w = weights();
+    writeMatrix(w->W1, w->b1);
+    writeMatrix(w->W2, w->b2);
+    writeMatrix(w->W3, w->b3);
+    f << m_lr.load() << "\n";
 }
 
 bool MLPEngine::loadWeights(const string& filename)
@@ -184,10 +258,41 @@ bool MLPEngine::loadWeights(const string& filename)
         for (double& v : b) f >> v;
     };
 
-    readMatrix(m_W1, m_b1);
-    readMatrix(m_W2, m_b2);
-    readMatrix(m_W3, m_b3);
-    f >> m_lr;
+    MLPWeights w;
+    readMatrix(w.W1, w.b1);
+    readMatrix(w.W2, w.b2);
+    readMatrix(w.W3, w.b3);
+    double lr = m_lr.load();
+    f >> lr;
+    if (!f) return false;
+    publish(std::move(w));
+    m_lr.store(lr);
+    return true;
+}
+
+void MLPEngine::exportTo(model_store::SectionWriter& out) const
+{
+    shared_ptr<const MLPWeights> w = weights();
+    out.putMatrix(w->W1); out.putF64Array(w->b1.data(), w->b1.size());
+    out.putMatrix(w->W2); out.putF64Array(w->b2.data(), w->b2.size());
+    out.putMatrix(w->W3); out.putF64Array(w->b3.data(), w->b3.size());
+    out.putF64(m_lr.load());
+    out.putU32((uint32_t)m_updateCount.load());
+}
+
+bool MLPEngine::importFrom(model_store::SectionReader& in)
+{
+    MLPWeights w;
+    in.getMatrix(w.W1, MLP_HIDDEN1, MLP_INPUT_DIM);     in.getF64Array(w.b1, MLP_HIDDEN1);
+    in.getMatrix(w.W2, MLP_HIDDEN2, MLP_HIDDEN1);       in.getF64Array(w.b2, MLP_HIDDEN2);
+    in.getMatrix(w.W3, MLP_OUTPUT_DIM, MLP_HIDDEN2);    in.getF64Array(w.b3, MLP_OUTPUT_DIM);
+    double lr = in.getF64();
+    uint32_t updates = in.getU32();
+    if (!in.ok()) return false;
+
+    publish(std::move(w));
+    m_lr.store(lr);
+    m_updateCount.store((int)updates);
     return true;
 }
 
@@ -18,13 +18,22 @@
  *
  * Output: softmax over 5 blend weights (one per response path).
  *
- * Weight updates use online SGD with a cross-entropy loss against a
- * one-hot target built from whichever path produced the accepted response.
+ * Weight updates use SGD with a cross-entropy loss against a one-hot target
+ * built from whichever path produced the accepted response, applied in
+ * mini-batches by the background ReplayTrainer (replay_trainer.h).
  * The outer learning loop decays the learning rate to stabilise training.
+ *
+ * Weights are an immutable MLPWeights snapshot published through an atomic
+ * shared_ptr: forward() reads whichever snapshot is current without locking,
+ * and trainBatch() (single writer) builds a new snapshot and swaps it in.
  */
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <atomic>
+
+#include "model_store.h"
 
 using namespace std;
 
@@ -42,20 +51,44 @@ namespace mlp_engine {
     static const int PATH_DTESNN      = 3;
     static const int PATH_WORKFLOW    = 4;
 
+    // One immutable set of weights.
+    struct MLPWeights {
+        vector<vector<double>> W1;  // [H1 × INPUT]
+        vector<double>         b1;  // [H1]
+        vector<vector<double>> W2;  // [H2 × H1]
+        vector<double>         b2;  // [H2]
+        vector<vector<double>> W3;  // [OUTPUT × H2]
+        vector<double>         b3;  // [OUTPUT]
+    };
+
+    // One training example: the features seen by forward() and the path
+    // that eventually won the turn.
+    struct TrainingSample {
+        vector<double> features;
+        int            target;
+    };
+
     class MLPEngine {
     public:
         MLPEngine();
         ~MLPEngine() = default;
 
         // Forward pass — returns softmax blend weights (sum to 1).
-        vector<double> forward(const vector<double>& input);
+        // Lock-free; safe to call concurrently with trainBatch().
+        vector<double> forward(const vector<double>& input) const;
 
-        // Online SGD backward pass with cross-entropy loss.
+        // Single-sample SGD step (a batch of one).
         // targetIndex: one of PATH_* constants above.
         void backward(const vector<double>& input,
                       int targetIndex,
                       double learningRate = 0.01);
 
+        // Batched backprop over a mini-batch.  Gradients are summed over the
+        // batch (so a batch of one matches a single online step) and the new
+        // weights are published atomically.  One writer at a time.
+        void trainBatch(const vector<TrainingSample>& batch,
+                        double learningRate);
+
         // Convenience: encode a 20-D feature vector from the four path scores
         // and the two 8-D feature vectors.  Scores are clamped to [0,1] before
         // insertion; feature vectors are zero-padded / truncated to 8 elements.
@@ -70,30 +103,27 @@ namespace mlp_engine {
         void saveWeights(const string& filename) const;
         bool loadWeights(const string& filename);
 
+        // Same weights in the binary model file (see model_store.h).
+        // importFrom() leaves the engine unchanged if the section is malformed.
+        void exportTo(model_store::SectionWriter& out) const;
+        bool importFrom(model_store::SectionReader& in);
+
         // Outer-loop learning-rate decay.
         void decayLearningRate(double factor = 0.95);
-        double getLearningRate() const { return m_lr; }
+        double getLearningRate() const { return m_lr.load(); }
 
-        // Number of backward passes executed (for diagnostics).
-        int getUpdateCount() const { return m_updateCount; }
+        // Number of training samples applied (for diagnostics).
+        int getUpdateCount() const { return m_updateCount.load(); }
 
     private:
-        // Weight matrices and bias vectors.
-        vector<vector<double>> m_W1;  // [H1 × INPUT]
-        vector<double>         m_b1;  // [H1]
-        vector<vector<double>> m_W2;  // [H2 × H1]
-        vector<double>         m_b2;  // [H2]
-        vector<vector<double>> m_W3;  // [OUTPUT × H2]
-        vector<double>         m_b3;  // [OUTPUT]
-
-        // Cached activations from the last forward pass (used in backward).
-        vector<double> m_h1;
-        vector<double> m_h2;
-        vector<double> m_out;
-        vector<double> m_lastInput;
-
-        double m_lr;
-        int    m_updateCount;
+        // Current weights; read with atomic_load, replaced with atomic_store.
+        shared_ptr<const MLPWeights> m_weights;
+
+        atomic<double> m_lr;
+        atomic<int>    m_updateCount;
+
+        shared_ptr<const MLPWeights> weights() const;
+        void publish(MLPWeights&& w);
 
         // Activation helpers.
         static vector<double> tanh_vec(const vector<double>& x);
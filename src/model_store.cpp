@@ -0,0 +1,367 @@
+#include "model_store.h"
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace model_store;
+
+namespace {
+
+    const char MAGIC[8] = {'A', 'I', '9', 'M', 'O', 'D', 'E', 'L'};
+
+    struct FileHeader {
+        char     magic[8];
+        uint32_t version;
+        uint32_t sectionCount;
+    };
+
+    struct SectionEntry {
+        char     name[SECTION_NAME_LEN];
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    inline size_t pad8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// SectionWriter
+// ---------------------------------------------------------------------------
+
+void SectionWriter::put(const void* p, size_t n)
+{
+    const char* c = static_cast<const char*>(p);
+    m_buf.insert(m_buf.end(), c, c + n);
+}
+
+void SectionWriter::align8()
+{
+    m_buf.resize(pad8(m_buf.size()), 0);
+}
+
+void SectionWriter::putU32(uint32_t v) { put(&v, sizeof(v)); }
+void SectionWriter::putU64(uint64_t v) { put(&v, sizeof(v)); }
+void SectionWriter::putF64(double v)   { put(&v, sizeof(v)); }
+
+void SectionWriter::putString(const string& s)
+{
+    putU32((uint32_t)s.size());
+    put(s.data(), s.size());
+}
+
+void SectionWriter::putStrings(const vector<string>& v)
+{
+    putU32((uint32_t)v.size());
+    for (const string& s : v)
+        putString(s);
+}
+
+void SectionWriter::putStringMap(const map<string, string>& m)
+{
+    putU32((uint32_t)m.size());
+    for (const auto& kv : m) {
+        putString(kv.first);
+        putString(kv.second);
+    }
+}
+
+void SectionWriter::putF32Array(const float* data, size_t n)
+{
+    align8();
+    putU64(n);
+    put(data, n * sizeof(float));
+}
+
+void SectionWriter::putF64Array(const double* data, size_t n)
+{
+    align8();
+    putU64(n);
+    put(data, n * sizeof(double));
+}
+
+void SectionWriter::putI32Array(const int32_t* data, size_t n)
+{
+    align8();
+    putU64(n);
+    put(data, n * sizeof(int32_t));
+}
+
+void SectionWriter::putMatrix(const vector<vector<double>>& M)
+{
+    uint32_t rows = (uint32_t)M.size();
+    uint32_t cols = rows ? (uint32_t)M[0].size() : 0;
+    putU32(rows);
+    putU32(cols);
+    vector<double> flat;
+    flat.reserve((size_t)rows * cols);
+    for (const auto& row : M)
+        flat.insert(flat.end(), row.begin(), row.begin() + min((size_t)cols, row.size()));
+    flat.resize((size_t)rows * cols, 0.0);
+    putF64Array(flat.data(), flat.size());
+}
+
+// ---------------------------------------------------------------------------
+// SectionReader
+// ---------------------------------------------------------------------------
+
+const char* SectionReader::take(size_t n)
+{
+    if (!m_ok || n > m_size - m_pos) {
+        m_ok = false;
+        return nullptr;
+    }
+    const char* p = m_data + m_pos;
+    m_pos += n;
+    return p;
+}
+
+bool SectionReader::get(void* p, size_t n)
+{
+    const char* src = take(n);
+    if (!src) return false;
+    memcpy(p, src, n);
+    return true;
+}
+
+void SectionReader::align8()
+{
+    size_t next = pad8(m_pos);
+    if (next > m_size) m_ok = false;
+    else m_pos = next;
+}
+
+uint32_t SectionReader::getU32() { uint32_t v = 0; get(&v, sizeof(v)); return v; }
+uint64_t SectionReader::getU64() { uint64_t v = 0; get(&v, sizeof(v)); return v; }
+double   SectionReader::getF64() { double   v = 0; get(&v, sizeof(v)); return v; }
+
+string SectionReader::getString()
+{
+    uint32_t n = getU32();
+    const char* p = take(n);
+    return p ? string(p, n) : string();
+}
+
+bool SectionReader::getStrings(vector<string>& out)
+{
+    out.clear();
+    uint32_t n = getU32();
+    for (uint32_t i = 0; i < n && m_ok; ++i)
+        out.push_back(getString());
+    return m_ok;
+}
+
+bool SectionReader::getStringMap(map<string, string>& out)
+{
+    out.clear();
+    uint32_t n = getU32();
+    for (uint32_t i = 0; i < n && m_ok; ++i) {
+        string name = getString();
+        string value = getString();
+        if (m_ok) out[name] = value;
+    }
+    return m_ok;
+}
+
+template <typename T>
+bool SectionReader::getArray(vector<T>& out, size_t expected)
+{
+    align8();
+    uint64_t n = getU64();
+    if (!m_ok || (expected != SIZE_MAX && n != expected) ||
+        n > (m_size - m_pos) / sizeof(T)) {
+        m_ok = false;
+        return false;
+    }
+    out.resize((size_t)n);
+    return n == 0 || get(out.data(), (size_t)n * sizeof(T));
+}
+
+bool SectionReader::getF32Array(vector<float>& out, size_t expected)
+{
+    return getArray(out, expected);
+}
+
+bool SectionReader::getF64Array(vector<double>& out, size_t expected)
+{
+    return getArray(out, expected);
+}
+
+bool SectionReader::getI32Array(vector<int32_t>& out, size_t expected)
+{
+    return getArray(out, expected);
+}
+
+bool SectionReader::getMatrix(vector<vector<double>>& M,
+                              size_t rows, size_t cols)
+{
+    uint32_t r = getU32();
+    uint32_t c = getU32();
+    vector<double> flat;
+    if (!m_ok || r != rows || c != cols || !getF64Array(flat, rows * cols)) {
+        m_ok = false;
+        return false;
+    }
+    M.assign(rows, vector<double>(cols));
+    for (size_t i = 0; i < rows; ++i)
+        copy(flat.begin() + i * cols, flat.begin() + (i + 1) * cols, M[i].begin());
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// ModelWriter
+// ---------------------------------------------------------------------------
+
+SectionWriter& ModelWriter::section(const string& name)
+{
+    return m_sections[name.substr(0, SECTION_NAME_LEN - 1)];
+}
+
+string ModelWriter::image() const
+{
+    FileHeader hdr;
+    memcpy(hdr.magic, MAGIC, sizeof(MAGIC));
+    hdr.version      = MODEL_FILE_VERSION;
+    hdr.sectionCount = (uint32_t)m_sections.size();
+
+    // Lay out payloads after the header and section table.
+    vector<SectionEntry> table;
+    uint64_t offset = pad8(sizeof(FileHeader) +
+                           m_sections.size() * sizeof(SectionEntry));
+    for (const auto& kv : m_sections) {
+        SectionEntry e;
+        memset(&e, 0, sizeof(e));
+        strncpy(e.name, kv.first.c_str(), SECTION_NAME_LEN - 1);
+        e.offset = offset;
+        e.size   = kv.second.bytes().size();
+        table.push_back(e);
+        offset = pad8(offset + e.size);
+    }
+
+    string out;
+    out.reserve(offset);
+    out.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    if (!table.empty())
+        out.append(reinterpret_cast<const char*>(table.data()),
+                   table.size() * sizeof(SectionEntry));
+
+    size_t i = 0;
+    for (const auto& kv : m_sections) {
+        out.resize(table[i].offset, '\0');
+        const vector<char>& bytes = kv.second.bytes();
+        if (!bytes.empty()) out.append(bytes.data(), bytes.size());
+        ++i;
+    }
+    return out;
+}
+
+bool ModelWriter::save(const string& path) const
+{
+    string bytes = image();
+
+    // Per-process temporary: pre-forked workers may save concurrently, and
+    // each rename() is atomic, so the last complete file wins.
+    string tmp = path + ".tmp." + to_string((long long)getpid());
+    ofstream f(tmp.c_str(), ios::binary | ios::trunc);
+    if (!f.is_open()) {
+        cerr << "[ModelStore] Cannot write model to " << tmp << endl;
+        return false;
+    }
+    f.write(bytes.data(), bytes.size());
+    f.close();
+    if (!f) {
+        cerr << "[ModelStore] Short write to " << tmp << endl;
+        remove(tmp.c_str());
+        return false;
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        cerr << "[ModelStore] Cannot rename " << tmp << " to " << path << endl;
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// ModelFile
+// ---------------------------------------------------------------------------
+
+ModelFile::ModelFile() : m_data(nullptr), m_size(0), m_version(0) {}
+
+ModelFile::~ModelFile()
+{
+    close();
+}
+
+void ModelFile::close()
+{
+    if (m_data) munmap(const_cast<char*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_version = 0;
+    m_index.clear();
+}
+
+bool ModelFile::open(const string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FileHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+
+    m_data = static_cast<const char*>(p);
+    m_size = (size_t)st.st_size;
+
+    FileHeader hdr;
+    memcpy(&hdr, m_data, sizeof(hdr));
+    if (memcmp(hdr.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        hdr.version != MODEL_FILE_VERSION ||
+        hdr.sectionCount > (m_size - sizeof(hdr)) / sizeof(SectionEntry)) {
+        cerr << "[ModelStore] " << path << " is not a version "
+             << MODEL_FILE_VERSION << " model file." << endl;
+        close();
+        return false;
+    }
+    m_version = hdr.version;
+
+    for (uint32_t i = 0; i < hdr.sectionCount; ++i) {
+        SectionEntry e;
+        memcpy(&e, m_data + sizeof(hdr) + i * sizeof(SectionEntry), sizeof(e));
+        e.name[SECTION_NAME_LEN - 1] = '\0';
+        if (e.offset > m_size || e.size > m_size - e.offset) {
+            cerr << "[ModelStore] " << path << " is truncated." << endl;
+            close();
+            return false;
+        }
+        m_index[e.name] = make_pair(e.offset, e.size);
+    }
+    return true;
+}
+
+bool ModelFile::hasSection(const string& name) const
+{
+    return m_index.count(name) > 0;
+}
+
+SectionReader ModelFile::section(const string& name) const
+{
+    auto it = m_index.find(name);
+    if (it == m_index.end()) return SectionReader();
+    return SectionReader(m_data + it->second.first, (size_t)it->second.second);
+}
@@ -0,0 +1,159 @@
+#ifndef __MODEL_STORE_H__
+#define __MODEL_STORE_H__
+
+/**
+ * model_store.h — Versioned binary model file (Phase 5)
+ *
+ * Persists the weights of every neural module (DTESNN reservoirs, HGNN
+ * projection + embeddings, MLP and LogicClassifier) in a single file so a
+ * restarted process resumes with the same model instead of re-randomising
+ * and re-estimating spectral radii.
+ *
+ * Layout (little-endian, every payload 8-byte aligned; the file is mapped
+ * read-only and each array is copied out into its module's vector):
+ *
+ *   FileHeader   { magic "AI9MODEL", version, sectionCount }
+ *   SectionEntry { name[24], offset, size }   × sectionCount
+ *   payloads...
+ *
+ * A section payload is a flat sequence of u32 / u64 / f32 / f64 scalars and
+ * arrays written with SectionWriter and read back with SectionReader, which
+ * bounds-checks every access.  Unknown sections are ignored on load, and a
+ * module whose section is missing or malformed simply keeps its random
+ * initialisation.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+namespace model_store {
+
+    static const uint32_t MODEL_FILE_VERSION = 1;
+    static const size_t   SECTION_NAME_LEN   = 24;
+
+    /**
+     * SectionWriter — append-only byte buffer for one section.
+     * Arrays are prefixed by their element count and padded to 8 bytes.
+     */
+    class SectionWriter {
+    public:
+        void putU32(uint32_t v);
+        void putU64(uint64_t v);
+        void putF64(double v);
+        void putString(const string& s);
+        void putStrings(const vector<string>& v);
+        void putStringMap(const map<string, string>& m);
+        void putF32Array(const float* data, size_t n);
+        void putF64Array(const double* data, size_t n);
+        void putI32Array(const int32_t* data, size_t n);
+
+        // Row-major matrix as (rows, cols, f64 data).
+        void putMatrix(const vector<vector<double>>& M);
+
+        const vector<char>& bytes() const { return m_buf; }
+
+    private:
+        vector<char> m_buf;
+
+        void put(const void* p, size_t n);
+        void align8();
+    };
+
+    /**
+     * SectionReader — bounds-checked cursor over a section payload.
+     * Any short read sets the failure flag; callers check ok() once at
+     * the end rather than after every field.
+     */
+    class SectionReader {
+    public:
+        SectionReader() : m_data(nullptr), m_size(0), m_pos(0), m_ok(false) {}
+        SectionReader(const char* data, size_t size)
+            : m_data(data), m_size(size), m_pos(0), m_ok(data != nullptr) {}
+
+        uint32_t getU32();
+        uint64_t getU64();
+        double   getF64();
+        string   getString();
+        bool     getStrings(vector<string>& out);
+        bool     getStringMap(map<string, string>& out);
+
+        // Read an array written by the matching put*Array; returns false (and
+        // fails the reader) when the stored count differs from expected, if
+        // expected is not SIZE_MAX.
+        bool getF32Array(vector<float>& out, size_t expected = SIZE_MAX);
+        bool getF64Array(vector<double>& out, size_t expected = SIZE_MAX);
+        bool getI32Array(vector<int32_t>& out, size_t expected = SIZE_MAX);
+
+        // Matrix written by putMatrix; must be exactly rows × cols.
+        bool getMatrix(vector<vector<double>>& M, size_t rows, size_t cols);
+
+        bool ok() const { return m_ok; }
+        void fail() { m_ok = false; }
+
+    private:
+        const char* m_data;
+        size_t      m_size;
+        size_t      m_pos;
+        bool        m_ok;
+
+        bool get(void* p, size_t n);
+        const char* take(size_t n);
+        void align8();
+
+        template <typename T>
+        bool getArray(vector<T>& out, size_t expected);
+    };
+
+    /**
+     * ModelWriter — collects sections and writes the file atomically
+     * (temporary file + rename).
+     */
+    class ModelWriter {
+    public:
+        SectionWriter& section(const string& name);
+        bool save(const string& path) const;
+        // The file as save() writes it, for writing elsewhere (write_behind.h).
+        string image() const;
+
+    private:
+        map<string, SectionWriter> m_sections;
+    };
+
+    /**
+     * ModelFile — read-only view of a model file mapped into memory.
+     */
+    class ModelFile {
+    public:
+        ModelFile();
+        ~ModelFile();
+        ModelFile(const ModelFile&) = delete;
+        ModelFile& operator=(const ModelFile&) = delete;
+
+        // Map and validate the file; false if missing, truncated or of an
+        // unsupported version.
+        bool open(const string& path);
+        void close();
+
+        bool hasSection(const string& name) const;
+
+        // Reader over the named section (a failed reader if absent).
+        SectionReader section(const string& name) const;
+
+        uint32_t version() const { return m_version; }
+        size_t   size()    const { return m_size; }
+
+    private:
+        const char* m_data;
+        size_t      m_size;
+        uint32_t    m_version;
+        map<string, pair<uint64_t, uint64_t>> m_index; // name → (offset, size)
+    };
+
+} // namespace model_store
+
+#endif // __MODEL_STORE_H__
@@ -0,0 +1,95 @@
+#ifndef __OBJECT_POOL_H__
+#define __OBJECT_POOL_H__
+
+/**
+ * object_pool.h — Slab pool for objects of one type
+ *
+ * Objects are constructed in place in fixed-size slabs, and a destroyed
+ * object's slot goes on a free list for the next create().  Objects that
+ * come and go with traffic (learned categories) then cost no allocator
+ * round trip after the first slab fills, and sit next to each other in
+ * memory.  Slabs are only freed with the pool.
+ *
+ * Not thread-safe: the owner serialises create() and destroy().  Objects
+ * still alive when the pool is destroyed are not destructed; the owner
+ * destroys them first.
+ */
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace object_pool {
+
+    static const size_t OBJECT_POOL_SLAB = 64;   // objects per slab
+
+    template <typename T>
+    class ObjectPool {
+    public:
+        explicit ObjectPool(size_t slabSize = OBJECT_POOL_SLAB)
+            : m_slabSize(slabSize > 0 ? slabSize : 1), m_free(nullptr), m_live(0) {}
+
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        template <typename... Args>
+        T* create(Args&&... args)
+        {
+            if (!m_free)
+                grow();
+            // Unlinked first: the object overwrites the link.
+            Slot* slot = m_free;
+            m_free = slot->next;
+            T* object;
+            try {
+                object = new (&slot->storage) T(std::forward<Args>(args)...);
+            } catch (...) {
+                slot->next = m_free;
+                m_free = slot;
+                throw;
+            }
+            m_live++;
+            return object;
+        }
+
+        // object must have come from this pool's create().
+        void destroy(T* object)
+        {
+            if (!object) return;
+            object->~T();
+            Slot* slot = reinterpret_cast<Slot*>(object);
+            slot->next = m_free;
+            m_free = slot;
+            m_live--;
+        }
+
+        size_t live()     const { return m_live; }
+        size_t capacity() const { return m_slabs.size() * m_slabSize; }
+
+    private:
+        union Slot {
+            Slot* next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+        size_t                               m_slabSize;
+        std::vector<std::unique_ptr<Slot[]>> m_slabs;
+        Slot*                                m_free;
+        size_t                               m_live;
+
+        void grow()
+        {
+            std::unique_ptr<Slot[]> slab(new Slot[m_slabSize]);
+            for (size_t i = 0; i < m_slabSize; ++i)
+                slab[i].next = i + 1 < m_slabSize ? &slab[i + 1] : m_free;
+            m_free = &slab[0];
+            m_slabs.push_back(std::move(slab));
+        }
+    };
+
+} // namespace object_pool
+
+#endif // __OBJECT_POOL_H__
@@ -0,0 +1,120 @@
+#include "path_gate.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace path_gate;
+
+// ---------------------------------------------------------------------------
+// Construction
+// ---------------------------------------------------------------------------
+
+PathGate::PathGate(double minWeight, double turnBudgetMs, int exploreEvery)
+    : m_minWeight(minWeight), m_turnBudgetMs(turnBudgetMs),
+      m_exploreEvery(max(1, exploreEvery))
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    for (int p = 0; p < GATE_PATHS; ++p) {
+        m_skipStreak[p]  = 0;
+        m_haveLatency[p] = false;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Gating decision
+// ---------------------------------------------------------------------------
+
+GateDecision PathGate::decide(const vector<double>& blendWeights,
+                              double elapsedMs,
+                              unsigned pinnedMask)
+{
+    lock_guard<mutex> lock(m_mutex);
+    GateDecision d;
+    double remainingMs = m_turnBudgetMs - elapsedMs;
+    m_stats.decisions++;
+
+    for (int p = 0; p < GATE_PATHS; ++p) {
+        d.weight[p]   = (p < (int)blendWeights.size())
+                        ? blendWeights[p] : 1.0 / GATE_PATHS;
+        d.explored[p] = false;
+
+        bool pinned  = (p == mlp_engine::PATH_SYMBOLIC) || (pinnedMask & (1u << p));
+        bool lowGain = d.weight[p] < m_minWeight;
+        bool tooSlow = m_haveLatency[p] && expectedLatencyLocked(p) > remainingMs;
+
+        d.run[p] = pinned || (!lowGain && !tooSlow);
+        if (!d.run[p] && m_skipStreak[p] + 1 >= m_exploreEvery) {
+            d.run[p] = true;
+            d.explored[p] = true;
+            m_stats.explores[p]++;
+        }
+
+        if (d.run[p]) {
+            m_skipStreak[p] = 0;
+            m_stats.runs[p]++;
+        } else {
+            m_skipStreak[p]++;
+            m_stats.skips[p]++;
+            m_stats.savedMs[p] += expectedLatencyLocked(p);
+        }
+    }
+    return d;
+}
+
+void PathGate::recordEarlyExit()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_stats.decisions++;
+    m_stats.earlyExits++;
+    for (int p = 0; p < GATE_PATHS; ++p) {
+        m_stats.skips[p]++;
+        m_stats.savedMs[p] += expectedLatencyLocked(p);
+    }
+}
+
+void PathGate::recordDeadlineMiss(int path)
+{
+    if (path < 0 || path >= GATE_PATHS) return;
+    lock_guard<mutex> lock(m_mutex);
+    m_stats.deadlineMisses[path]++;
+    recordLatencyLocked(path, m_turnBudgetMs);
+}
+
+GateStats PathGate::getStats() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_stats;
+}
+
+// ---------------------------------------------------------------------------
+// Latency tracking
+// ---------------------------------------------------------------------------
+
+void PathGate::recordLatency(int path, double ms)
+{
+    lock_guard<mutex> lock(m_mutex);
+    recordLatencyLocked(path, ms);
+}
+
+double PathGate::expectedLatency(int path) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return expectedLatencyLocked(path);
+}
+
+void PathGate::recordLatencyLocked(int path, double ms)
+{
+    if (path < 0 || path >= GATE_PATHS) return;
+    double& ema = m_stats.latencyMs[path];
+    if (!m_haveLatency[path]) {
+        ema = ms;
+        m_haveLatency[path] = true;
+    } else {
+        ema = (1.0 - GATE_LATENCY_ALPHA) * ema + GATE_LATENCY_ALPHA * ms;
+    }
+}
+
+double PathGate::expectedLatencyLocked(int path) const
+{
+    if (path < 0 || path >= GATE_PATHS || !m_haveLatency[path]) return 0.0;
+    return m_stats.latencyMs[path];
+}
@@ -0,0 +1,103 @@
+#ifndef __PATH_GATE_H__
+#define __PATH_GATE_H__
+
+/**
+ * path_gate.h — Adaptive NSVD path gating (Phase 5)
+ *
+ * Decides, before dispatch, which of the five NSVD response paths are worth
+ * running this turn.  Inputs are the MLP blend weights predicted from the
+ * previous turn's path scores plus the current HGNN / DTESNN features, and
+ * an exponential moving average of each path's wall-clock latency.
+ *
+ * A path is skipped when
+ *   - its predicted blend weight is below minWeight, or
+ *   - its expected latency exceeds what is left of the turn budget.
+ * The symbolic path always runs.  A path that has been skipped exploreEvery
+ * times in a row is run anyway so its latency estimate and the MLP's view of
+ * it stay current.
+ *
+ * Saved time is estimated as the EMA latency of every skipped path.
+ *
+ * A path that misses the turn deadline is counted per path and its latency
+ * is recorded as the full budget, so the gate learns to skip it when the
+ * remaining time is short.
+ *
+ * Shared by all sessions; every method is thread-safe.
+ */
+
+#include "mlp_engine.h"
+#include <vector>
+#include <mutex>
+
+using namespace std;
+
+namespace path_gate {
+
+    static const int    GATE_PATHS          = mlp_engine::MLP_OUTPUT_DIM;
+    static const double GATE_MIN_WEIGHT     = 0.08;   // uniform weight is 0.2
+    static const double GATE_TURN_BUDGET_MS = 250.0;
+    static const int    GATE_EXPLORE_EVERY  = 8;
+    static const double GATE_LATENCY_ALPHA  = 0.2;    // EMA smoothing
+
+    struct GateDecision {
+        bool   run[GATE_PATHS];
+        bool   explored[GATE_PATHS];  // run only because of forced exploration
+        double weight[GATE_PATHS];    // predicted blend weight
+    };
+
+    struct GateStats {
+        size_t decisions;
+        size_t earlyExits;
+        size_t runs[GATE_PATHS];
+        size_t skips[GATE_PATHS];
+        size_t explores[GATE_PATHS];
+        double savedMs[GATE_PATHS];
+        double latencyMs[GATE_PATHS];  // current EMA
+        size_t deadlineMisses[GATE_PATHS];
+    };
+
+    class PathGate {
+    public:
+        PathGate(double minWeight    = GATE_MIN_WEIGHT,
+                 double turnBudgetMs = GATE_TURN_BUDGET_MS,
+                 int    exploreEvery = GATE_EXPLORE_EVERY);
+
+        // blendWeights: MLP softmax output (uniform if empty).
+        // elapsedMs:    time already spent on this turn before dispatch.
+        // pinnedMask:   bit p set → path p must run (e.g. an active workflow).
+        GateDecision decide(const vector<double>& blendWeights,
+                            double elapsedMs,
+                            unsigned pinnedMask = 0);
+
+        // Record a completed path's wall-clock time.
+        void recordLatency(int path, double ms);
+
+        // An exact symbolic match answered the turn before dispatch;
+        // every other path (and the full symbolic scan) was skipped.
+        void recordEarlyExit();
+
+        // Path p was still running at the turn deadline and was cancelled.
+        void recordDeadlineMiss(int path);
+
+        double turnBudgetMs() const { return m_turnBudgetMs; }
+
+        double expectedLatency(int path) const;
+        GateStats getStats() const;
+
+    private:
+        double m_minWeight;
+        double m_turnBudgetMs;
+        int    m_exploreEvery;
+
+        int       m_skipStreak[GATE_PATHS];
+        bool      m_haveLatency[GATE_PATHS];
+        GateStats m_stats;
+        mutable mutex m_mutex;
+
+        void recordLatencyLocked(int path, double ms);
+        double expectedLatencyLocked(int path) const;
+    };
+
+} // namespace path_gate
+
+#endif // __PATH_GATE_H__
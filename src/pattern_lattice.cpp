@@ -16,15 +16,18 @@ void PatternLattice::build(const vector<Category*>& categories) {
     m_categories.clear();
     m_wildcardCategories.clear();
     m_specificCategories.clear();
+    m_exactIndex.clear();
 
     for (Category* cat : categories) {
         if (!cat || !cat->pattern()) continue;
         m_categories.push_back(cat);
         string pat = cat->pattern()->toString();
-        if (hasWildcard(pat))
+        if (hasWildcard(pat)) {
             m_wildcardCategories.push_back(cat);
-        else
+        } else {
             m_specificCategories.push_back(cat);
+            indexExact(cat, pat);
+        }
     }
 }
 
@@ -32,21 +35,51 @@ void PatternLattice::addLearnedCategory(Category* category) {
     if (!category || !category->pattern()) return;
     m_categories.push_back(category);
     string pat = category->pattern()->toString();
-    if (hasWildcard(pat))
+    if (hasWildcard(pat)) {
         m_wildcardCategories.push_back(category);
-    else
+    } else {
         m_specificCategories.push_back(category);
+        indexExact(category, pat);
+    }
+}
+
+void PatternLattice::removeCategories(const unordered_set<Category*>& categories) {
+    if (categories.empty()) return;
+    auto doomed = [&](Category* cat) { return categories.count(cat) > 0; };
+    m_categories.erase(remove_if(m_categories.begin(), m_categories.end(), doomed),
+                       m_categories.end());
+    m_wildcardCategories.erase(remove_if(m_wildcardCategories.begin(),
+                                         m_wildcardCategories.end(), doomed),
+                               m_wildcardCategories.end());
+    size_t specific = m_specificCategories.size();
+    m_specificCategories.erase(remove_if(m_specificCategories.begin(),
+                                         m_specificCategories.end(), doomed),
+                               m_specificCategories.end());
+    if (m_specificCategories.size() == specific) return;
+
+    // A removed category may have shadowed a later one with the same key.
+    m_exactIndex.clear();
+    for (Category* cat : m_specificCategories)
+        indexExact(cat, cat->pattern()->toString());
+}
+
+Category* PatternLattice::findExact(const string& input) const {
+    auto it = m_exactIndex.find(canonicalKey(input));
+    return it != m_exactIndex.end() ? it->second : nullptr;
 }
 
 vector<ScoredCategory> PatternLattice::findBestCategories(
     const string& input,
     const map<string, double>& contextVector,
-    int topK) const
+    int topK,
+    const cancel_token::CancelToken* cancel) const
 {
     vector<ScoredCategory> results;
     results.reserve(m_categories.size());
 
-    for (Category* cat : m_categories) {
+    for (size_t i = 0; i < m_categories.size(); ++i) {
+        if (cancel_token::pollCancelled(cancel, (int)i)) break;
+        Category* cat = m_categories[i];
         double score = computeScore(input, cat, contextVector);
         bool wc = hasWildcard(cat->pattern()->toString());
         results.emplace_back(cat, score, wc);
@@ -74,11 +107,6 @@ Category* PatternLattice::findBest(
     return nullptr;
 }
 
-void PatternLattice::decayAll(double factor) {
-    for (Category* cat : m_categories)
-        cat->decayConfidence(factor);
-}
-
 // ---------------------------------------------------------------------------
 // Private helpers
 // ---------------------------------------------------------------------------
@@ -176,6 +204,28 @@ double PatternLattice::salienceBoost(
     return (count > 0) ? min(1.0, boost / count) : 0.0;
 }
 
+void PatternLattice::indexExact(Category* category, const string& pattern) {
+    if (pattern.find('_') != string::npos) return;   // AIML "_" wildcard
+    string key = canonicalKey(pattern);
+    if (!key.empty())
+        m_exactIndex.insert(make_pair(key, category));  // first registration wins
+}
+
+string PatternLattice::canonicalKey(const string& text) {
+    string key;
+    key.reserve(text.size());
+    bool pendingSpace = false;
+    for (char c : text) {
+        if (isspace((unsigned char)c)) {
+            pendingSpace = !key.empty();
+            continue;
+        }
+        if (pendingSpace) { key += ' '; pendingSpace = false; }
+        key += (char)tolower((unsigned char)c);
+    }
+    return key;
+}
+
 bool PatternLattice::hasWildcard(const string& pattern) const {
     return pattern.find('*') != string::npos;
 }
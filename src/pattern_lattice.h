@@ -16,10 +16,13 @@
  */
 
 #include "aimlcategory.h"
+#include "cancel_token.h"
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <map>
 #include <set>
+#include <unordered_map>
 
 using namespace std;
 using namespace aiml;
@@ -59,20 +62,26 @@ namespace pattern_lattice {
         // Add a soft (learned) category at runtime.
         void addLearnedCategory(Category* category);
 
+        // Forget categories about to be freed (pruned soft categories).
+        void removeCategories(const unordered_set<Category*>& categories);
+
         // Primary query: returns topK candidates scored by the variational metric.
         // contextVector: concept → salience (from ContextVector in OpenCog layer).
+        // cancel: when it fires the scan stops and ranks what it has scored so far.
         vector<ScoredCategory> findBestCategories(
             const string& input,
             const map<string, double>& contextVector,
-            int topK = 5) const;
+            int topK = 5,
+            const cancel_token::CancelToken* cancel = nullptr) const;
 
         // Return the single best category (convenience wrapper).
         Category* findBest(
             const string& input,
             const map<string, double>& contextVector) const;
 
-        // Decay confidence on all soft (learnable) categories.
-        void decayAll(double factor = 0.99);
+        // O(1) lookup of a wildcard-free pattern equal to input (compared
+        // case-insensitively with whitespace collapsed).  nullptr if none.
+        Category* findExact(const string& input) const;
 
         // Statistics.
         size_t size() const { return m_categories.size(); }
@@ -83,6 +92,11 @@ namespace pattern_lattice {
         vector<Category*> m_categories;          // all registered categories
         vector<Category*> m_wildcardCategories;  // patterns containing "*"
         vector<Category*> m_specificCategories;  // fully-specific patterns
+        unordered_map<string, Category*> m_exactIndex; // canonical pattern → first category
+
+        // Register a fully-specific category in the exact-match index.
+        void indexExact(Category* category, const string& pattern);
+        static string canonicalKey(const string& text);
 
         // Compute variational score for one (input, category) pair.
         double computeScore(const string& input,
@@ -0,0 +1,260 @@
+#include "prefork.h"
+#include "chatmachine.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+using namespace prefork;
+
+namespace {
+
+    volatile sig_atomic_t g_stopRequested = 0;
+
+    void onStopSignal(int) { g_stopRequested = 1; }
+    void onChildSignal(int) {}
+
+    // Sleep until a signal arrives or timeoutMs passes (< 0: no timeout),
+    // with the supervisor's signals unblocked only while waiting, so a
+    // signal delivered between checks is never lost.
+    void waitForSignal(const sigset_t& waitMask, int timeoutMs)
+    {
+        timespec ts;
+        timespec* tsp = nullptr;
+        if (timeoutMs >= 0) {
+            ts.tv_sec  = timeoutMs / 1000;
+            ts.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+            tsp = &ts;
+        }
+        ppoll(nullptr, 0, tsp, &waitMask);
+    }
+
+    string describeExit(int status)
+    {
+        if (WIFSIGNALED(status))
+            return "killed by signal " + to_string(WTERMSIG(status));
+        if (WIFEXITED(status))
+            return "exited with status " + to_string(WEXITSTATUS(status));
+        return "stopped";
+    }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Construction
+// ---------------------------------------------------------------------------
+
+Supervisor::Supervisor(Chatmachine& bot, const server::ServerConfig& config)
+    : m_bot(bot), m_config(config), m_listenFd(-1), m_spawned(0), m_restarts(0)
+{
+    int n = m_config.processes;
+    if (n < 1) n = 1;
+    if (n > PREFORK_MAX_PROCESSES) n = PREFORK_MAX_PROCESSES;
+    m_config.processes = n;
+    m_slots.resize((size_t)n);
+}
+
+Supervisor::~Supervisor()
+{
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        if (!m_config.unixPath.empty())
+            unlink(m_config.unixPath.c_str());
+    }
+}
+
+SupervisorStats Supervisor::getStats() const
+{
+    SupervisorStats st;
+    st.processes = m_config.processes;
+    st.spawned   = m_spawned;
+    st.restarts  = m_restarts;
+    return st;
+}
+
+// ---------------------------------------------------------------------------
+// Supervision
+// ---------------------------------------------------------------------------
+
+int Supervisor::run()
+{
+    // Unix sockets have no SO_REUSEPORT balancing: bind once here and let
+    // the children accept on the inherited descriptor.
+    if (!m_config.unixPath.empty()) {
+        m_listenFd = server::openListener(m_config, false);
+        if (m_listenFd < 0)
+            return 1;
+    }
+
+    // Block the supervisor's signals except while waiting for them.
+    sigset_t blocked, waitMask;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGCHLD);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    sigprocmask(SIG_BLOCK, &blocked, &waitMask);
+    sigdelset(&waitMask, SIGCHLD);
+    sigdelset(&waitMask, SIGINT);
+    sigdelset(&waitMask, SIGTERM);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onStopSignal;
+    sigaction(SIGINT,  &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    sa.sa_handler = onChildSignal;
+    sigaction(SIGCHLD, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // No threads may be running across fork().
+    m_bot.prepareFork();
+
+    cout << "Pre-forking " << m_config.processes << " worker processes ("
+         << m_config.workers << " turns each)." << endl;
+    for (int i = 0; i < m_config.processes; ++i)
+        spawn(i);
+
+    while (!g_stopRequested) {
+        reap(false);
+
+        // Restart empty slots that are due; otherwise sleep until the next
+        // one is, or until a child exits or a stop signal arrives.
+        Clock::time_point now = Clock::now();
+        int timeoutMs = -1;
+        for (size_t i = 0; i < m_slots.size(); ++i) {
+            Slot& slot = m_slots[i];
+            if (slot.pid != 0) continue;
+            if (slot.restartAt <= now) {
+                if (spawn((int)i)) ++m_restarts;
+                continue;
+            }
+            int ms = (int)chrono::duration_cast<chrono::milliseconds>(slot.restartAt - now).count() + 1;
+            if (timeoutMs < 0 || ms < timeoutMs) timeoutMs = ms;
+        }
+        if (!g_stopRequested)
+            waitForSignal(waitMask, timeoutMs);
+    }
+
+    stopWorkers();
+
+    sigprocmask(SIG_SETMASK, &waitMask, nullptr);
+    signal(SIGINT,  SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+
+    SupervisorStats st = getStats();
+    cout << "Supervisor stopped: " << st.processes << " processes, "
+         << st.spawned << " spawned, " << st.restarts << " restarts." << endl;
+    return 0;
+}
+
+bool Supervisor::spawn(int index)
+{
+    Slot& slot = m_slots[(size_t)index];
+    cout.flush();
+    cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        cerr << "[Prefork] fork: " << strerror(errno) << endl;
+        slot.restartAt = Clock::now() + chrono::milliseconds(PREFORK_BACKOFF_MS);
+        return false;
+    }
+    if (pid == 0)
+        workerMain(index);
+    slot.pid = pid;
+    ++m_spawned;
+    return true;
+}
+
+void Supervisor::workerMain(int index)
+{
+    // Back to default dispositions; Server::run installs its own handlers.
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGINT,  SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, nullptr);
+
+    m_bot.afterFork(index);
+
+    server::ServerConfig config = m_config;
+    if (m_listenFd >= 0)
+        config.listenFd = m_listenFd;
+    else
+        config.reusePort = true;
+
+    int code = 1;
+    {
+        server::Server srv(m_bot, config);
+        if (srv.start()) {
+            srv.run();
+            code = 0;
+        }
+    }
+    m_bot.flushFiles();
+    cout.flush();
+    cerr.flush();
+    // Skip static destructors and atexit handlers inherited from the parent.
+    _exit(code);
+}
+
+void Supervisor::reap(bool stopping)
+{
+    for (;;) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid <= 0) return;
+        for (size_t i = 0; i < m_slots.size(); ++i) {
+            Slot& slot = m_slots[i];
+            if (slot.pid != pid) continue;
+            slot.pid = 0;
+            if (stopping) break;
+
+            // Back off a worker that keeps dying instead of fork-looping.
+            Clock::time_point now = Clock::now();
+            slot.exits.push_back(now);
+            while (!slot.exits.empty() &&
+                   now - slot.exits.front() > chrono::seconds(PREFORK_CRASH_WINDOW))
+                slot.exits.pop_front();
+            bool backOff = (int)slot.exits.size() >= PREFORK_CRASH_LIMIT;
+            slot.restartAt = backOff ? now + chrono::milliseconds(PREFORK_BACKOFF_MS) : now;
+
+            cerr << "[Prefork] Worker " << pid << " (slot " << i << ") "
+                 << describeExit(status) << "; restarting"
+                 << (backOff ? " after back-off." : ".") << endl;
+            break;
+        }
+    }
+}
+
+void Supervisor::stopWorkers()
+{
+    for (const Slot& slot : m_slots)
+        if (slot.pid != 0)
+            kill(slot.pid, SIGTERM);
+
+    sigset_t waitMask;
+    sigprocmask(SIG_BLOCK, nullptr, &waitMask);
+    sigdelset(&waitMask, SIGCHLD);
+    Clock::time_point killAt = Clock::now() + chrono::seconds(PREFORK_STOP_TIMEOUT);
+    bool killed = false;
+    for (;;) {
+        reap(true);
+        bool running = false;
+        for (const Slot& slot : m_slots)
+            running = running || slot.pid != 0;
+        if (!running) break;
+        if (!killed && Clock::now() >= killAt) {
+            cerr << "[Prefork] Workers did not stop in time; killing them." << endl;
+            for (const Slot& slot : m_slots)
+                if (slot.pid != 0)
+                    kill(slot.pid, SIGKILL);
+            killed = true;
+        }
+        waitForSignal(waitMask, 100);
+    }
+}
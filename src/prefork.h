@@ -0,0 +1,92 @@
+#ifndef __PREFORK_H__
+#define __PREFORK_H__
+
+/**
+ * prefork.h — Pre-forked server processes (Phase 6)
+ *
+ * `chatmachine9 serve --processes N` loads the brain once (AIML category
+ * lists, PatternLattice, neural weights) and then forks N worker
+ * processes.  The children share the parent's pages copy-on-write, so the
+ * brain is read from the same physical memory until a worker learns
+ * something and touches a page.  Each child runs an ordinary
+ * server::Server:
+ *
+ *   TCP    every child binds the port with SO_REUSEPORT and the kernel
+ *          spreads connections across them;
+ *   Unix   the parent binds the socket once and the children accept on
+ *          the inherited descriptor.
+ *
+ * The parent only supervises: a worker that exits or crashes is forked
+ * again from the parent's pristine brain (after a back-off if it keeps
+ * crashing).  SIGINT / SIGTERM stop all workers and then the parent.
+ *
+ * Learned state (synthesised categories, model updates, session state) is
+ * per worker.  Workers tag their consolidation files and model temporaries
+ * so they never write the same file at once.
+ */
+
+#include "server.h"
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <sys/types.h>
+
+using namespace std;
+
+class Chatmachine;
+
+namespace prefork {
+
+    static const int PREFORK_MAX_PROCESSES = 64;
+    static const int PREFORK_CRASH_LIMIT   = 5;    // exits within the window ...
+    static const int PREFORK_CRASH_WINDOW  = 10;   // ... seconds ...
+    static const int PREFORK_BACKOFF_MS    = 2000; // ... delay the next restart
+    static const int PREFORK_STOP_TIMEOUT  = 10;   // seconds before SIGKILL
+
+    struct SupervisorStats {
+        int    processes;   // worker slots
+        size_t spawned;     // forks, including restarts
+        size_t restarts;    // workers replaced after exiting
+    };
+
+    class Supervisor {
+    public:
+        // The bot must already have loaded its brain (createCategoryLists).
+        Supervisor(Chatmachine& bot, const server::ServerConfig& config);
+        ~Supervisor();
+
+        Supervisor(const Supervisor&) = delete;
+        Supervisor& operator=(const Supervisor&) = delete;
+
+        // Fork the workers and supervise them until SIGINT / SIGTERM.
+        // Returns the process exit code.
+        int run();
+
+        SupervisorStats getStats() const;
+
+    private:
+        typedef chrono::steady_clock Clock;
+
+        struct Slot {
+            pid_t              pid;        // 0: not running
+            Clock::time_point  restartAt;  // when pid == 0
+            deque<Clock::time_point> exits;
+            Slot() : pid(0) {}
+        };
+
+        Chatmachine&         m_bot;
+        server::ServerConfig m_config;
+        int                  m_listenFd;   // Unix socket shared by the children
+        vector<Slot>         m_slots;
+        size_t               m_spawned;
+        size_t               m_restarts;
+
+        bool  spawn(int index);
+        void  workerMain(int index);        // never returns
+        void  reap(bool stopping);
+        void  stopWorkers();
+    };
+
+} // namespace prefork
+
+#endif // __PREFORK_H__
@@ -0,0 +1,177 @@
+#include "replay_trainer.h"
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace replay_trainer;
+
+// ---------------------------------------------------------------------------
+// Construction / lifecycle
+// ---------------------------------------------------------------------------
+
+ReplayTrainer::ReplayTrainer(mlp_engine::MLPEngine* mlp,
+                             logic_classifier::LogicClassifier* logic)
+    : m_mlp(mlp), m_logic(logic),
+      m_mlpQueue(REPLAY_QUEUE_CAPACITY), m_logicQueue(REPLAY_QUEUE_CAPACITY),
+      m_mlpMemoryNext(0), m_logicMemoryNext(0),
+      m_running(false),
+      m_queued(0), m_dropped(0), m_batches(0), m_samples(0)
+{
+}
+
+ReplayTrainer::~ReplayTrainer()
+{
+    stop();
+}
+
+void ReplayTrainer::start()
+{
+    if (m_running.exchange(true)) return;
+    m_worker = thread(&ReplayTrainer::run, this);
+}
+
+void ReplayTrainer::stop()
+{
+    if (m_running.exchange(false) && m_worker.joinable())
+        m_worker.join();
+    // Anything queued after the worker's last pass.
+    flush();
+}
+
+void ReplayTrainer::flush()
+{
+    while (trainOnce() > 0) {}
+}
+
+// ---------------------------------------------------------------------------
+// Response-path enqueue
+// ---------------------------------------------------------------------------
+
+bool ReplayTrainer::submitMLP(const vector<double>& features, int winningPath)
+{
+    if (!m_mlp || features.empty() ||
+        winningPath < 0 || winningPath >= mlp_engine::MLP_OUTPUT_DIM)
+        return false;
+
+    mlp_engine::TrainingSample s;
+    s.features = features;
+    s.target   = winningPath;
+    if (!m_mlpQueue.tryPush(std::move(s))) {
+        m_dropped++;
+        return false;
+    }
+    m_queued++;
+    return true;
+}
+
+bool ReplayTrainer::submitLogic(const vector<double>& features,
+                                logic_meta_patterns::LogicSystem target,
+                                double learningRate)
+{
+    if (!m_logic || features.empty()) return false;
+
+    logic_classifier::TrainingSample s;
+    s.features     = features;
+    s.target       = target;
+    s.learningRate = learningRate;
+    if (!m_logicQueue.tryPush(std::move(s))) {
+        m_dropped++;
+        return false;
+    }
+    m_queued++;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Background training
+// ---------------------------------------------------------------------------
+
+namespace {
+
+    // Take up to max fresh items from q, then top the batch up with replayed
+    // items from memory (at most as many as were fresh) and remember the
+    // fresh ones in the bounded replay memory.
+    template <typename Sample>
+    size_t buildBatch(ring_buffer::MPMCQueue<Sample>& q,
+                      vector<Sample>& memory, size_t& memoryNext,
+                      vector<Sample>& batch)
+    {
+        batch.clear();
+        Sample s;
+        while (batch.size() < REPLAY_BATCH_SIZE && q.tryPop(s))
+            batch.push_back(std::move(s));
+        size_t fresh = batch.size();
+        if (fresh == 0) return 0;
+
+        size_t replays = min(fresh, min(memory.size(),
+                                        REPLAY_BATCH_SIZE - fresh));
+        for (size_t i = 0; i < replays; ++i)
+            batch.push_back(memory[(size_t)rand() % memory.size()]);
+
+        for (size_t i = 0; i < fresh; ++i) {
+            if (memory.size() < REPLAY_MEMORY_SIZE) {
+                memory.push_back(batch[i]);
+            } else {
+                memory[memoryNext] = batch[i];
+                memoryNext = (memoryNext + 1) % REPLAY_MEMORY_SIZE;
+            }
+        }
+        return fresh;
+    }
+
+} // namespace
+
+size_t ReplayTrainer::trainOnce()
+{
+    lock_guard<mutex> lock(m_trainMutex);
+    size_t fresh = 0;
+
+    if (m_mlp) {
+        vector<mlp_engine::TrainingSample> batch;
+        size_t n = buildBatch(m_mlpQueue, m_mlpMemory, m_mlpMemoryNext, batch);
+        if (n > 0) {
+            m_mlp->trainBatch(batch, m_mlp->getLearningRate());
+            m_batches++;
+            m_samples += batch.size();
+            fresh += n;
+        }
+    }
+
+    if (m_logic) {
+        vector<logic_classifier::TrainingSample> batch;
+        size_t n = buildBatch(m_logicQueue, m_logicMemory, m_logicMemoryNext, batch);
+        if (n > 0) {
+            m_logic->trainBatch(batch);
+            m_batches++;
+            m_samples += batch.size();
+            fresh += n;
+        }
+    }
+    return fresh;
+}
+
+void ReplayTrainer::run()
+{
+    // Poll with a short back-off: experiences arrive at conversation speed,
+    // so a few milliseconds of latency is invisible and keeps the queue
+    // entirely lock-free on the producer side.
+    int idleMs = 1;
+    while (m_running.load()) {
+        if (trainOnce() > 0) {
+            idleMs = 1;
+        } else {
+            this_thread::sleep_for(chrono::milliseconds(idleMs));
+            idleMs = min(idleMs * 2, 20);
+        }
+    }
+}
+
+TrainerStats ReplayTrainer::getStats() const
+{
+    TrainerStats s;
+    s.queued  = m_queued.load();
+    s.dropped = m_dropped.load();
+    s.batches = m_batches.load();
+    s.samples = m_samples.load();
+    return s;
+}
@@ -0,0 +1,95 @@
+#ifndef __REPLAY_TRAINER_H__
+#define __REPLAY_TRAINER_H__
+
+/**
+ * replay_trainer.h — Background mini-batch trainer (Phase 5)
+ *
+ * Moves MLP and LogicClassifier learning off the response path.  The
+ * response thread only enqueues experiences (the exact feature vector the
+ * forward pass saw plus the path / logic system that won the turn) into
+ * lock-free ring buffers; a single background thread drains them, mixes in
+ * a few replayed past experiences, and runs one batched backprop per
+ * mini-batch.  New weights are published by atomic pointer swap inside the
+ * engines, so readers never wait on training.
+ *
+ * If a queue is full the experience is dropped and counted rather than
+ * blocking the conversation.
+ */
+
+#include "mlp_engine.h"
+#include "logic_classifier.h"
+#include "ring_buffer.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+using namespace std;
+
+namespace replay_trainer {
+
+    static const size_t REPLAY_QUEUE_CAPACITY = 1024;
+    static const size_t REPLAY_BATCH_SIZE     = 16;
+    static const size_t REPLAY_MEMORY_SIZE    = 256;  // past samples kept for replay
+
+    struct TrainerStats {
+        size_t queued;      // experiences accepted
+        size_t dropped;     // experiences rejected because a queue was full
+        size_t batches;     // trainBatch calls
+        size_t samples;     // samples trained, including replays
+    };
+
+    class ReplayTrainer {
+    public:
+        // Either engine may be null; its queue then stays unused.
+        ReplayTrainer(mlp_engine::MLPEngine* mlp,
+                      logic_classifier::LogicClassifier* logic);
+        ~ReplayTrainer();
+
+        void start();
+        // Drain everything still queued, then join the worker.
+        void stop();
+
+        // Response-path enqueue; never blocks.  False if dropped.
+        bool submitMLP(const vector<double>& features, int winningPath);
+        bool submitLogic(const vector<double>& features,
+                         logic_meta_patterns::LogicSystem target,
+                         double learningRate);
+
+        // Train on everything queued so far before returning (used before
+        // saving the model so the file reflects all accepted experience).
+        void flush();
+
+        TrainerStats getStats() const;
+
+    private:
+        mlp_engine::MLPEngine*             m_mlp;
+        logic_classifier::LogicClassifier* m_logic;
+
+        ring_buffer::MPMCQueue<mlp_engine::TrainingSample>       m_mlpQueue;
+        ring_buffer::MPMCQueue<logic_classifier::TrainingSample> m_logicQueue;
+
+        // Replay memory; touched only while holding m_trainMutex.
+        vector<mlp_engine::TrainingSample>       m_mlpMemory;
+        vector<logic_classifier::TrainingSample> m_logicMemory;
+        size_t m_mlpMemoryNext;
+        size_t m_logicMemoryNext;
+
+        // Serialises training between the worker and flush().
+        mutex  m_trainMutex;
+        thread m_worker;
+        atomic<bool> m_running;
+
+        atomic<size_t> m_queued;
+        atomic<size_t> m_dropped;
+        atomic<size_t> m_batches;
+        atomic<size_t> m_samples;
+
+        void run();
+        // One drain-and-train pass; returns the number of fresh samples.
+        size_t trainOnce();
+    };
+
+} // namespace replay_trainer
+
+#endif // __REPLAY_TRAINER_H__
@@ -0,0 +1,96 @@
+#include "response_cache.h"
+#include <functional>
+
+using namespace response_cache;
+
+ResponseCache::ResponseCache(size_t capacity)
+    : m_shardCapacity(capacity / RESPONSE_CACHE_SHARDS > 0 ? capacity / RESPONSE_CACHE_SHARDS : 1),
+      m_shards(new Shard[RESPONSE_CACHE_SHARDS]),
+      m_hits(0), m_misses(0), m_inserts(0), m_evictions(0), m_invalidations(0)
+{
+}
+
+// Unit separators cannot occur in normalised input.
+string ResponseCache::makeKey(const string& input, const string& that, const string& topic)
+{
+    string key;
+    key.reserve(input.size() + that.size() + topic.size() + 2);
+    key += input;
+    key += '\x1f';
+    key += that;
+    key += '\x1f';
+    key += topic;
+    return key;
+}
+
+ResponseCache::Shard& ResponseCache::shardFor(const string& key)
+{
+    return m_shards[hash<string>()(key) % RESPONSE_CACHE_SHARDS];
+}
+
+bool ResponseCache::lookup(const string& input, const string& that, const string& topic,
+                           string& response)
+{
+    string key = makeKey(input, that, topic);
+    Shard& shard = shardFor(key);
+    {
+        lock_guard<mutex> lock(shard.lock);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            response = it->second->second;
+            ++m_hits;
+            return true;
+        }
+    }
+    ++m_misses;
+    return false;
+}
+
+void ResponseCache::insert(const string& input, const string& that, const string& topic,
+                           const string& response)
+{
+    string key = makeKey(input, that, topic);
+    Shard& shard = shardFor(key);
+    lock_guard<mutex> lock(shard.lock);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->second = response;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    shard.lru.push_front(make_pair(key, response));
+    shard.index[key] = shard.lru.begin();
+    ++m_inserts;
+    while (shard.lru.size() > m_shardCapacity) {
+        shard.index.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+        ++m_evictions;
+    }
+}
+
+void ResponseCache::invalidate()
+{
+    for (size_t i = 0; i < RESPONSE_CACHE_SHARDS; ++i) {
+        lock_guard<mutex> lock(m_shards[i].lock);
+        m_shards[i].lru.clear();
+        m_shards[i].index.clear();
+    }
+    ++m_invalidations;
+}
+
+CacheStats ResponseCache::getStats() const
+{
+    CacheStats st;
+    st.entries = 0;
+    for (size_t i = 0; i < RESPONSE_CACHE_SHARDS; ++i) {
+        lock_guard<mutex> lock(m_shards[i].lock);
+        st.entries += m_shards[i].lru.size();
+    }
+    st.hits          = m_hits.load();
+    st.misses        = m_misses.load();
+    st.inserts       = m_inserts.load();
+    st.evictions     = m_evictions.load();
+    st.invalidations = m_invalidations.load();
+    return st;
+}
@@ -0,0 +1,96 @@
+#ifndef __RESPONSE_CACHE_H__
+#define __RESPONSE_CACHE_H__
+
+/**
+ * response_cache.h — Cache of deterministic AIML responses (Phase 6)
+ *
+ * Much of the traffic is repeated greetings and short phrases that always
+ * resolve to the same category, and many templates are plain text and
+ * <star/> captures.  For those, the response is a function of the input
+ * alone, so get_best_response can skip the full match and template
+ * evaluation the second time it sees the input.
+ *
+ * Purity is decided once at load time (mark_deterministic_templates in
+ * aimlparser): a template is deterministic when every element, however
+ * deeply nested, is text, <star/>, <br/> or <bot/>.  <random>, <get>,
+ * <set>, <think>, <condition>, <that>, <srai> and <sr> make it impure.
+ *
+ * Entries are keyed by (normalised input, that, topic).  They are spread
+ * over RESPONSE_CACHE_SHARDS independently locked LRU lists so concurrent
+ * turns rarely contend.  invalidate() drops everything; call it whenever
+ * the category set changes (learned categories).  Each brain generation
+ * has its own cache, so an AIML reload starts from an empty one.
+ */
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+using namespace std;
+
+namespace response_cache {
+
+    static const size_t RESPONSE_CACHE_SHARDS   = 16;
+    static const size_t RESPONSE_CACHE_CAPACITY = 4096;   // entries, all shards
+
+    struct CacheStats {
+        size_t entries;
+        size_t hits;
+        size_t misses;
+        size_t inserts;
+        size_t evictions;
+        size_t invalidations;
+
+        double hitRate() const {
+            size_t n = hits + misses;
+            return n ? (double)hits / (double)n : 0.0;
+        }
+    };
+
+    class ResponseCache {
+    public:
+        explicit ResponseCache(size_t capacity = RESPONSE_CACHE_CAPACITY);
+
+        ResponseCache(const ResponseCache&) = delete;
+        ResponseCache& operator=(const ResponseCache&) = delete;
+
+        // True (and response set) on a hit; counts a hit or a miss.
+        bool lookup(const string& input, const string& that, const string& topic,
+                    string& response);
+
+        void insert(const string& input, const string& that, const string& topic,
+                    const string& response);
+
+        void invalidate();
+
+        CacheStats getStats() const;
+
+    private:
+        typedef list<pair<string, string>> LruList;   // (key, response), MRU first
+
+        struct Shard {
+            mutex                                     lock;
+            LruList                                   lru;
+            unordered_map<string, LruList::iterator>  index;
+        };
+
+        size_t               m_shardCapacity;
+        unique_ptr<Shard[]>  m_shards;
+
+        atomic<size_t> m_hits;
+        atomic<size_t> m_misses;
+        atomic<size_t> m_inserts;
+        atomic<size_t> m_evictions;
+        atomic<size_t> m_invalidations;
+
+        static string makeKey(const string& input, const string& that, const string& topic);
+        Shard& shardFor(const string& key);
+    };
+
+} // namespace response_cache
+
+#endif // __RESPONSE_CACHE_H__
@@ -0,0 +1,125 @@
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+/**
+ * ring_buffer.h — Bounded lock-free MPMC queue
+ *
+ * Fixed-capacity ring of slots, each carrying a sequence number that tells
+ * producers and consumers whether the slot is free or full for the current
+ * lap (Vyukov's bounded MPMC design).  tryPush()/tryPop() never block and
+ * never allocate after construction; a full queue rejects the push so the
+ * caller can drop or retry, and the response path is never stalled behind a
+ * slow consumer.
+ *
+ * Capacity is rounded up to a power of two.
+ */
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace ring_buffer {
+
+    static const size_t CACHE_LINE = 64;
+
+    template <typename T>
+    class MPMCQueue {
+    public:
+        explicit MPMCQueue(size_t capacity)
+            : m_mask(roundUp(capacity) - 1), m_slots(m_mask + 1),
+              m_head(0), m_tail(0)
+        {
+            for (size_t i = 0; i <= m_mask; ++i)
+                m_slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+        // Enqueue by move; false if the queue is full.
+        bool tryPush(T&& value)
+        {
+            size_t pos = m_tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot& slot = m_slots[pos & m_mask];
+                size_t seq = slot.seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0) {
+                    if (m_tail.compare_exchange_weak(pos, pos + 1,
+                                                     std::memory_order_relaxed)) {
+                        slot.value = std::move(value);
+                        slot.seq.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false; // full
+                } else {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Dequeue into out; false if the queue is empty.
+        bool tryPop(T& out)
+        {
+            size_t pos = m_head.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot& slot = m_slots[pos & m_mask];
+                size_t seq = slot.seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (diff == 0) {
+                    if (m_head.compare_exchange_weak(pos, pos + 1,
+                                                     std::memory_order_relaxed)) {
+                        out = std::move(slot.value);
+                        slot.seq.store(pos + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false; // empty
+                } else {
+                    pos = m_head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        size_t capacity() const { return m_mask + 1; }
+
+        // Approximate number of queued items (exact when quiescent).
+        size_t sizeApprox() const
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t head = m_head.load(std::memory_order_relaxed);
+            return tail >= head ? tail - head : 0;
+        }
+
+    private:
+        struct Slot {
+            std::atomic<size_t> seq;
+            T                   value;
+        };
+
+        static size_t roundUp(size_t n)
+        {
+            size_t p = 2;
+            while (p < n) p <<= 1;
+            return p;
+        }
+
+        const size_t      m_mask;
+        std::vector<Slot> m_slots;
+
+        // Producer and consumer cursors on separate cache lines.  Padded
+        // rather than alignas(64): C++11 operator new ignores over-alignment
+        // for the objects that own a queue.
+        char                m_pad0[CACHE_LINE];
+        std::atomic<size_t> m_head;
+        char                m_pad1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> m_tail;
+        char                m_pad2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    };
+
+} // namespace ring_buffer
+
+#endif // __RING_BUFFER_H__
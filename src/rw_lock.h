@@ -0,0 +1,54 @@
+#ifndef __RW_LOCK_H__
+#define __RW_LOCK_H__
+
+/**
+ * rw_lock.h — Reader/writer lock (pthread_rwlock wrapper)
+ *
+ * C++11 has no shared_mutex.  Many turns may read the shared brain at once
+ * (ReadGuard); learning updates take it exclusively (WriteGuard).  Not
+ * recursive and not upgradable: release a read lock before writing.
+ */
+
+#include <pthread.h>
+
+namespace rw_lock {
+
+    class RWLock {
+    public:
+        RWLock()  { pthread_rwlock_init(&m_lock, nullptr); }
+        ~RWLock() { pthread_rwlock_destroy(&m_lock); }
+
+        RWLock(const RWLock&) = delete;
+        RWLock& operator=(const RWLock&) = delete;
+
+        void lockRead()  { pthread_rwlock_rdlock(&m_lock); }
+        void lockWrite() { pthread_rwlock_wrlock(&m_lock); }
+        void unlock()    { pthread_rwlock_unlock(&m_lock); }
+
+    private:
+        pthread_rwlock_t m_lock;
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(RWLock& lock) : m_lock(lock) { m_lock.lockRead(); }
+        ~ReadGuard() { m_lock.unlock(); }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    private:
+        RWLock& m_lock;
+    };
+
+    class WriteGuard {
+    public:
+        explicit WriteGuard(RWLock& lock) : m_lock(lock) { m_lock.lockWrite(); }
+        ~WriteGuard() { m_lock.unlock(); }
+        WriteGuard(const WriteGuard&) = delete;
+        WriteGuard& operator=(const WriteGuard&) = delete;
+    private:
+        RWLock& m_lock;
+    };
+
+} // namespace rw_lock
+
+#endif // __RW_LOCK_H__
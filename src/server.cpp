@@ -0,0 +1,623 @@
+#include "server.h"
+#include "chatmachine.h"
+#include "json.h"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace server;
+
+namespace {
+
+    // epoll user data for the two non-connection descriptors; connection
+    // ids start above these.
+    const uint64_t LISTEN_ID = 0;
+    const uint64_t WAKE_ID   = 1;
+
+    // Target for SIGINT / SIGTERM while run() is active.
+    Server* volatile g_signalTarget = nullptr;
+
+    void onSignal(int)
+    {
+        if (g_signalTarget) g_signalTarget->stop();
+    }
+
+    bool setNonBlocking(int fd)
+    {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    bool parsePositive(const char* s, int& out)
+    {
+        char* end = nullptr;
+        long v = strtol(s, &end, 10);
+        if (!end || *end != '\0' || v <= 0 || v > 65535) return false;
+        out = (int)v;
+        return true;
+    }
+
+    void printServeUsage()
+    {
+        cerr << "usage: chatmachine9 serve [--mode <mode>] [--unix <path> | --port <n>]"
+             << " [--workers <n>] [--processes <n>]"
+             << " [--session-dir <dir> [--max-sessions <n>]]" << endl;
+    }
+
+    session::SessionStoreConfig sessionStore(const ServerConfig& config, Chatmachine& bot)
+    {
+        session::SessionStoreConfig store;
+        store.spillDir    = config.sessionDir;
+        store.maxResident = config.maxSessions;
+        store.writer      = bot.fileWriter();
+        return store;
+    }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Command line
+// ---------------------------------------------------------------------------
+
+bool server::parseServeArgs(int argc, char* argv[], int first,
+                            ServerConfig& config, string& mode)
+{
+    for (int i = first; i < argc; ++i) {
+        string opt = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "[Server] Missing value for " << opt << endl;
+            printServeUsage();
+            return false;
+        }
+        const char* value = argv[++i];
+        if (opt == "--mode") {
+            mode = value;
+        } else if (opt == "--unix") {
+            config.unixPath = value;
+        } else if (opt == "--port") {
+            if (!parsePositive(value, config.tcpPort)) {
+                cerr << "[Server] Invalid port: " << value << endl;
+                return false;
+            }
+        } else if (opt == "--workers") {
+            if (!parsePositive(value, config.workers)) {
+                cerr << "[Server] Invalid worker count: " << value << endl;
+                return false;
+            }
+        } else if (opt == "--session-dir") {
+            config.sessionDir = value;
+        } else if (opt == "--max-sessions") {
+            char* end = nullptr;
+            long n = strtol(value, &end, 10);
+            if (!end || *end != '\0' || n <= 0) {
+                cerr << "[Server] Invalid session limit: " << value << endl;
+                return false;
+            }
+            config.maxSessions = (size_t)n;
+        } else if (opt == "--processes") {
+            if (!parsePositive(value, config.processes)) {
+                cerr << "[Server] Invalid process count: " << value << endl;
+                return false;
+            }
+        } else {
+            cerr << "[Server] Unknown option: " << opt << endl;
+            printServeUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Construction / lifecycle
+// ---------------------------------------------------------------------------
+
+Server::Server(Chatmachine& bot, const ServerConfig& config)
+    : m_bot(bot), m_config(config),
+      m_listenFd(-1), m_epollFd(-1), m_wakeFd(-1), m_ownsPath(false),
+      m_stopping(false), m_nextConnId(WAKE_ID + 1),
+      m_sessions([&bot](const string& id) { return bot.newSession(id); },
+                 sessionStore(config, bot)),
+      m_statConnections(0), m_statRequests(0), m_statErrors(0)
+{
+}
+
+Server::~Server()
+{
+    m_pool.reset();
+    for (auto& kv : m_connections)
+        close(kv.second.fd);
+    if (m_listenFd >= 0) close(m_listenFd);
+    if (m_wakeFd   >= 0) close(m_wakeFd);
+    if (m_epollFd  >= 0) close(m_epollFd);
+    if (m_ownsPath)
+        unlink(m_config.unixPath.c_str());
+}
+
+int server::openListener(const ServerConfig& config, bool reusePort)
+{
+    int fd = -1;
+    if (!config.unixPath.empty()) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (config.unixPath.size() >= sizeof(addr.sun_path)) {
+            cerr << "[Server] Socket path too long: " << config.unixPath << endl;
+            return -1;
+        }
+        strncpy(addr.sun_path, config.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            cerr << "[Server] socket: " << strerror(errno) << endl;
+            return -1;
+        }
+        unlink(config.unixPath.c_str());   // stale socket from a previous run
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            cerr << "[Server] bind " << config.unixPath << ": " << strerror(errno) << endl;
+            close(fd);
+            return -1;
+        }
+    } else {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons((uint16_t)config.tcpPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            cerr << "[Server] socket: " << strerror(errno) << endl;
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        // Every pre-forked worker binds the port itself; the kernel spreads
+        // incoming connections across them.
+        if (reusePort &&
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+            cerr << "[Server] SO_REUSEPORT: " << strerror(errno) << endl;
+            close(fd);
+            return -1;
+        }
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            cerr << "[Server] bind 127.0.0.1:" << config.tcpPort << ": "
+                 << strerror(errno) << endl;
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (listen(fd, SOMAXCONN) != 0 || !setNonBlocking(fd)) {
+        cerr << "[Server] listen: " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool Server::start()
+{
+    if (m_config.listenFd >= 0) {
+        m_listenFd = m_config.listenFd;
+        m_ownsPath = false;
+    } else {
+        m_listenFd = openListener(m_config, m_config.reusePort);
+        if (m_listenFd < 0)
+            return false;
+        m_ownsPath = !m_config.unixPath.empty();
+    }
+
+    m_epollFd = epoll_create1(0);
+    m_wakeFd  = eventfd(0, EFD_NONBLOCK);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        cerr << "[Server] epoll/eventfd: " << strerror(errno) << endl;
+        return false;
+    }
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = EPOLLIN;
+    ev.data.u64 = LISTEN_ID;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &ev);
+    ev.data.u64 = WAKE_ID;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+
+    m_pool.reset(new worker_pool::WorkerPool((size_t)m_config.workers));
+
+    if (m_config.processes > 1)
+        cout << "[Worker " << getpid() << "] ";
+    if (!m_config.unixPath.empty())
+        cout << "Serving on unix:" << m_config.unixPath;
+    else
+        cout << "Serving on 127.0.0.1:" << m_config.tcpPort;
+    cout << " (" << m_config.workers << " workers)." << endl;
+    return true;
+}
+
+void Server::stop()
+{
+    m_stopping.store(true);
+    wake();
+}
+
+void Server::wake()
+{
+    uint64_t one = 1;
+    ssize_t n = write(m_wakeFd, &one, sizeof(one));
+    (void)n;   // EAGAIN: counter already non-zero, loop will wake anyway
+}
+
+ServerStats Server::getStats() const
+{
+    ServerStats st;
+    st.connections = m_statConnections.load();
+    st.requests    = m_statRequests.load();
+    st.errors      = m_statErrors.load();
+    st.sessions    = m_sessions.size();
+    return st;
+}
+
+// ---------------------------------------------------------------------------
+// Event loop
+// ---------------------------------------------------------------------------
+
+void Server::run()
+{
+    g_signalTarget = this;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT,  &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // With a spill directory, wake up periodically to spill idle sessions.
+    int timeoutMs = m_sessions.spilling() ? SERVER_IDLE_SWEEP_MS : -1;
+    auto lastSweep = chrono::steady_clock::now();
+
+    epoll_event events[SERVER_MAX_EVENTS];
+    while (!m_stopping.load()) {
+        if (timeoutMs >= 0 &&
+            chrono::steady_clock::now() - lastSweep >= chrono::milliseconds(SERVER_IDLE_SWEEP_MS)) {
+            m_sessions.evictIdle();
+            lastSweep = chrono::steady_clock::now();
+        }
+        int n = epoll_wait(m_epollFd, events, SERVER_MAX_EVENTS, timeoutMs);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            cerr << "[Server] epoll_wait: " << strerror(errno) << endl;
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            uint64_t id = events[i].data.u64;
+            if (id == LISTEN_ID) {
+                acceptConnections();
+            } else if (id == WAKE_ID) {
+                uint64_t count;
+                ssize_t r = read(m_wakeFd, &count, sizeof(count));
+                (void)r;
+                deliverReplies();
+            } else {
+                auto it = m_connections.find(id);
+                if (it == m_connections.end()) continue;
+                // Fully hung up after we stopped reading: nothing more can
+                // be delivered, so drop any replies still in flight.
+                if (it->second.readClosed && (events[i].events & (EPOLLHUP | EPOLLERR))) {
+                    closeConnection(id);
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP))
+                    readConnection(id);
+                if ((events[i].events & EPOLLOUT) && m_connections.count(id))
+                    writeConnection(id);
+            }
+        }
+    }
+
+    // Let queued turns finish so their session state is consistent, then
+    // make a last attempt to hand their replies over.
+    m_pool.reset();
+    deliverReplies();
+    m_sessions.spillAll();
+
+    g_signalTarget = nullptr;
+    signal(SIGINT,  SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    ServerStats st = getStats();
+    cout << "Server stopped: " << st.connections << " connections, "
+         << st.requests << " requests, " << st.errors << " errors, "
+         << st.sessions << " sessions." << endl;
+    if (m_sessions.spilling()) {
+        session::SessionTableStats ss = m_sessions.getStats();
+        cout << "  Session store: " << ss.created << " created, " << ss.spilled
+             << " spilled, " << ss.restored << " restored (avg "
+             << ss.restoreUsAvg << " us, max " << ss.restoreUsMax << " us)." << endl;
+    }
+}
+
+void Server::acceptConnections()
+{
+    for (;;) {
+        int fd = accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                cerr << "[Server] accept: " << strerror(errno) << endl;
+            return;
+        }
+        if (!setNonBlocking(fd)) {
+            close(fd);
+            continue;
+        }
+        uint64_t id = m_nextConnId++;
+        Connection c;
+        c.fd = fd;
+        c.inflight   = 0;
+        c.readClosed = false;
+        c.wantWrite  = false;
+        m_connections[id] = c;
+
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events   = EPOLLIN | EPOLLRDHUP;
+        ev.data.u64 = id;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev);
+        m_statConnections++;
+    }
+}
+
+void Server::readConnection(uint64_t id)
+{
+    auto it = m_connections.find(id);
+    if (it == m_connections.end() || it->second.readClosed) return;
+
+    char buf[4096];
+    for (;;) {
+        ssize_t n = read(it->second.fd, buf, sizeof(buf));
+        if (n > 0) {
+            it->second.in.append(buf, (size_t)n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+        // EOF or error: stop reading, but answer what was already sent.
+        it->second.readClosed = true;
+        break;
+    }
+
+    // handleLine() never erases the connection, so `it` stays valid.
+    Connection& c = it->second;
+    size_t start = 0, nl;
+    while ((nl = c.in.find('\n', start)) != string::npos) {
+        string line = c.in.substr(start, nl - start);
+        start = nl + 1;
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        if (!line.empty())
+            handleLine(id, line);
+    }
+    c.in.erase(0, start);
+
+    if (c.in.size() > SERVER_MAX_LINE) {
+        m_statErrors++;
+        c.in.clear();
+        queueOutput(id, "{\"error\":\"request line too long\"}");
+        c.readClosed = true;
+    }
+
+    if (c.readClosed) {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events   = c.wantWrite ? EPOLLOUT : 0;
+        ev.data.u64 = id;
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+
+    // Flush error replies; closes the connection once it is finished.
+    writeConnection(id);
+}
+
+void Server::handleLine(uint64_t id, const string& line)
+{
+    map<string, string> fields;
+    string error;
+    if (!json::parseObject(line, fields, &error)) {
+        m_statErrors++;
+        queueOutput(id, "{\"error\":" + json::quote("malformed JSON: " + error) + "}");
+        return;
+    }
+    auto session = fields.find("session");
+    auto text    = fields.find("text");
+    if (session == fields.end() || session->second.empty() || text == fields.end()) {
+        m_statErrors++;
+        queueOutput(id, "{\"error\":\"request needs \\\"session\\\" and \\\"text\\\"\"}");
+        return;
+    }
+
+    m_statRequests++;
+    Turn turn;
+    turn.conn   = id;
+    turn.text   = text->second;
+    auto stream = fields.find("stream");
+    turn.stream = stream != fields.end() && stream->second == "true";
+    auto rid = fields.find("id");
+    if (rid != fields.end())
+        turn.requestId = rid->second;
+    m_connections[id].inflight++;
+    enqueueTurn(session->second, turn);
+}
+
+void Server::queueOutput(uint64_t id, const string& line)
+{
+    // Only buffers; callers flush with writeConnection() once they no
+    // longer hold a reference into m_connections.
+    auto it = m_connections.find(id);
+    if (it == m_connections.end()) return;
+    it->second.out += line;
+    it->second.out += '\n';
+}
+
+void Server::writeConnection(uint64_t id)
+{
+    auto it = m_connections.find(id);
+    if (it == m_connections.end()) return;
+    Connection& c = it->second;
+
+    while (!c.out.empty()) {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            c.out.erase(0, (size_t)n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        closeConnection(id);   // peer gone
+        return;
+    }
+
+    if (c.readClosed && c.inflight == 0 && c.out.empty()) {
+        closeConnection(id);
+        return;
+    }
+    updateInterest(id, c);
+}
+
+void Server::updateInterest(uint64_t id, Connection& c)
+{
+    bool want = !c.out.empty();
+    if (want == c.wantWrite) return;
+    c.wantWrite = want;
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = (c.readClosed ? 0 : (EPOLLIN | EPOLLRDHUP)) | (want ? EPOLLOUT : 0);
+    ev.data.u64 = id;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void Server::closeConnection(uint64_t id)
+{
+    auto it = m_connections.find(id);
+    if (it == m_connections.end()) return;
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    close(it->second.fd);
+    m_connections.erase(it);
+}
+
+void Server::deliverReplies()
+{
+    vector<Reply> replies;
+    {
+        lock_guard<mutex> lock(m_replyMutex);
+        replies.swap(m_replies);
+    }
+    for (const Reply& r : replies) {
+        auto it = m_connections.find(r.conn);
+        if (it == m_connections.end()) continue;   // client left; drop
+        if (r.last && it->second.inflight > 0) it->second.inflight--;
+        queueOutput(r.conn, r.line);
+        writeConnection(r.conn);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Workers
+// ---------------------------------------------------------------------------
+
+void Server::enqueueTurn(const string& sessionId, const Turn& turn)
+{
+    bool startDrain = false;
+    {
+        lock_guard<mutex> lock(m_queueMutex);
+        SessionQueue& q = m_queues[sessionId];
+        q.pending.push_back(turn);
+        if (!q.running) {
+            q.running  = true;
+            startDrain = true;
+        }
+    }
+    // One drain task per session at a time: that is what serialises a
+    // session's turns while other sessions proceed in parallel.
+    if (startDrain)
+        m_pool->submit([this, sessionId]() { drainSession(sessionId); });
+}
+
+void Server::drainSession(const string& sessionId)
+{
+    shared_ptr<session::Session> s = m_sessions.acquire(sessionId);
+
+    for (;;) {
+        Turn turn;
+        {
+            lock_guard<mutex> lock(m_queueMutex);
+            SessionQueue& q = m_queues[sessionId];
+            if (q.pending.empty()) {
+                q.running = false;
+                m_queues.erase(sessionId);
+                return;
+            }
+            turn = q.pending.front();
+            q.pending.pop_front();
+        }
+
+        auto start = chrono::steady_clock::now();
+        auto msSince = [](chrono::steady_clock::time_point t) {
+            return chrono::duration<double, milli>(chrono::steady_clock::now() - t).count();
+        };
+        // Request fields every line for this turn starts with.
+        string head = "{";
+        if (!turn.requestId.empty())
+            head += "\"id\":" + json::quote(turn.requestId) + ",";
+        head += "\"session\":" + json::quote(sessionId);
+
+        double firstMs = -1.0;
+        if (turn.stream)
+            s->partial = [&](const string& piece) {
+                if (firstMs < 0) firstMs = msSince(start);
+                postReply(turn.conn, head + ",\"partial\":" + json::quote(piece) + "}", false);
+            };
+        string reply;
+        try {
+            reply = m_bot.respondTo(*s, Chatmachine::normalized(turn.text));
+        } catch (const exception& e) {
+            cerr << "[Server] Turn failed for session " << sessionId << ": " << e.what() << endl;
+            reply = "";
+        } catch (...) {
+            cerr << "[Server] Turn failed for session " << sessionId << endl;
+            reply = "";
+        }
+        s->partial = nullptr;
+        double ms = msSince(start);
+
+        ostringstream line;
+        line << head
+             << ",\"text\":" << json::quote(reply)
+             << ",\"ms\":" << ms;
+        if (firstMs >= 0)
+            line << ",\"first_ms\":" << firstMs;
+        line << "}";
+        postReply(turn.conn, line.str());
+    }
+}
+
+void Server::postReply(uint64_t conn, const string& line, bool last)
+{
+    {
+        lock_guard<mutex> lock(m_replyMutex);
+        Reply r;
+        r.conn = conn;
+        r.line = line;
+        r.last = last;
+        m_replies.push_back(r);
+    }
+    wake();
+}
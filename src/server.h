@@ -0,0 +1,190 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+/**
+ * server.h — Multi-session conversation server (Phase 6)
+ *
+ * `chatmachine9 serve` runs one bot for many users.  A single epoll thread
+ * accepts connections on a Unix socket or a localhost TCP port and reads
+ * line-delimited JSON requests:
+ *
+ *     {"session":"alice","text":"hello"}        (an optional "id" is echoed)
+ *
+ * and answers each with one line:
+ *
+ *     {"session":"alice","text":"Hi there!","ms":1.8}
+ *     {"error":"..."}                               (malformed request)
+ *
+ * A request with "stream":true also gets the reply while it is generated
+ * (streamed GPT-4o text), as lines before the final one:
+ *
+ *     {"session":"alice","partial":"[GPT-4o] "}
+ *     {"session":"alice","partial":"Volcanoes erupt when"}
+ *     {"session":"alice","text":"[GPT-4o] Volcanoes erupt when ...","ms":912.4,"first_ms":143.0}
+ *
+ * first_ms is the time to the first partial line.  The final text is the
+ * reply; partial lines are a preview of it.
+ *
+ * Turns run on a worker pool.  Turns for different sessions run in
+ * parallel; turns for the same session are queued and run one at a time in
+ * arrival order, so a session's replies come back in request order.
+ * Workers hand finished replies back to the event loop through an eventfd.
+ *
+ * Per-session state lives in session::Session; the brain is shared (see
+ * Chatmachine::respondTo).  With --session-dir, idle sessions are spilled
+ * to snapshots there and the event loop sweeps for them once a second.
+ */
+
+#include "session.h"
+#include "worker_pool.h"
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+class Chatmachine;
+
+namespace server {
+
+    static const int    SERVER_DEFAULT_PORT    = 7878;
+    static const int    SERVER_DEFAULT_WORKERS = 4;
+    static const size_t SERVER_MAX_LINE        = 64 * 1024;  // bytes per request
+    static const int    SERVER_MAX_EVENTS      = 64;
+    static const int    SERVER_IDLE_SWEEP_MS   = 1000;       // idle-session spill check
+
+    struct ServerConfig {
+        string unixPath;    // listen on this Unix socket if set ...
+        int    tcpPort;     // ... otherwise on 127.0.0.1:tcpPort
+        int    workers;     // concurrent turns (per process)
+        int    processes;   // > 1: pre-forked worker processes (see prefork.h)
+        bool   reusePort;   // bind the TCP port with SO_REUSEPORT
+        int    listenFd;    // >= 0: serve on this already-listening socket
+        string sessionDir;  // spill idle sessions here (see session.h)
+        size_t maxSessions; // sessions kept in memory when spilling (0 = all)
+
+        ServerConfig()
+            : tcpPort(SERVER_DEFAULT_PORT), workers(SERVER_DEFAULT_WORKERS),
+              processes(1), reusePort(false), listenFd(-1), maxSessions(0) {}
+    };
+
+    // Parse the options after `serve`:
+    //   --mode <bot mode>  --unix <path>  --port <n>  --workers <n>
+    //   --processes <n>  --session-dir <dir>  --max-sessions <n>
+    // mode is left unchanged unless --mode is given.  Prints usage and
+    // returns false on a bad option.
+    bool parseServeArgs(int argc, char* argv[], int first,
+                        ServerConfig& config, string& mode);
+
+    // Bind and listen on the configured Unix socket or TCP port.  Returns
+    // the non-blocking descriptor, or -1 after reporting why.
+    int openListener(const ServerConfig& config, bool reusePort);
+
+    struct ServerStats {
+        size_t connections;   // accepted so far
+        size_t requests;      // well-formed requests
+        size_t errors;        // malformed requests
+        size_t sessions;      // sessions in memory
+    };
+
+    class Server {
+    public:
+        Server(Chatmachine& bot, const ServerConfig& config);
+        ~Server();
+
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+
+        // Bind and listen.  False (after reporting why) on failure.
+        bool start();
+
+        // Event loop; returns after stop() or SIGINT / SIGTERM.
+        void run();
+
+        // Safe from any thread and from a signal handler.
+        void stop();
+
+        ServerStats getStats() const;
+
+    private:
+        struct Connection {
+            int      fd;
+            string   in;          // bytes read, not yet a full line
+            string   out;         // bytes not yet written
+            size_t   inflight;    // requests without a reply yet
+            bool     readClosed;  // peer finished sending
+            bool     wantWrite;   // EPOLLOUT registered
+        };
+
+        struct Turn {
+            uint64_t conn;
+            string   requestId;   // "id" from the request (echoed as a string)
+            string   text;
+            bool     stream;      // send partial lines
+        };
+
+        struct SessionQueue {
+            deque<Turn> pending;
+            bool        running;
+            SessionQueue() : running(false) {}
+        };
+
+        struct Reply {
+            uint64_t conn;
+            string   line;
+            bool     last;        // the request's final line
+        };
+
+        Chatmachine&  m_bot;
+        ServerConfig  m_config;
+
+        int m_listenFd;
+        int m_epollFd;
+        int m_wakeFd;                          // eventfd: replies ready / stop
+        bool m_ownsPath;                       // created the Unix socket file
+
+        atomic<bool> m_stopping;
+
+        map<uint64_t, Connection> m_connections;  // event-loop thread only
+        uint64_t                  m_nextConnId;
+
+        session::SessionTable         m_sessions;
+        map<string, SessionQueue>     m_queues;   // guarded by m_queueMutex
+        mutex                         m_queueMutex;
+
+        vector<Reply> m_replies;                  // guarded by m_replyMutex
+        mutex         m_replyMutex;
+
+        atomic<size_t> m_statConnections;
+        atomic<size_t> m_statRequests;
+        atomic<size_t> m_statErrors;
+
+        // Declared last: destroyed (and joined) before the queues it uses.
+        unique_ptr<worker_pool::WorkerPool> m_pool;
+
+        // Event loop.
+        void acceptConnections();
+        void readConnection(uint64_t id);
+        void writeConnection(uint64_t id);
+        void closeConnection(uint64_t id);
+        void handleLine(uint64_t id, const string& line);
+        void deliverReplies();
+        void queueOutput(uint64_t id, const string& line);
+        void updateInterest(uint64_t id, Connection& c);
+
+        // Workers.
+        void enqueueTurn(const string& sessionId, const Turn& turn);
+        void drainSession(const string& sessionId);
+        void postReply(uint64_t conn, const string& line, bool last = true);
+        void wake();
+    };
+
+} // namespace server
+
+#endif // __SERVER_H__
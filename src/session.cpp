@@ -0,0 +1,410 @@
+#include "session.h"
+#include "write_behind.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <iterator>
+#include <atomic>
+#include <sys/stat.h>
+
+using namespace session;
+
+namespace {
+
+    const char   SNAPSHOT_MAGIC[8] = {'A', 'I', '9', 'S', 'E', 'S', 'S', '\0'};
+    const size_t SNAPSHOT_HEADER   = 16;   // magic, version, reserved
+
+    uint64_t fnv1a(const string& s)
+    {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    bool makeDir(const string& path)
+    {
+        if (mkdir(path.c_str(), 0755) == 0 || errno == EEXIST) return true;
+        cerr << "[Session] Cannot create " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Session
+// ---------------------------------------------------------------------------
+
+Session::Session(const string& sessionId)
+    : id(sessionId),
+      lastLogicSystem("NONE"), lastLogicConfidence(0.0),
+      turns(0), lastActive(chrono::steady_clock::now())
+{
+}
+
+void Session::remember(const string& in, const string& response)
+{
+    history.push_back(in);
+    history.push_back(response);
+    if (history.size() > SESSION_HISTORY_MAX)
+        history.erase(history.begin(), history.begin() + 2);
+}
+
+// ---------------------------------------------------------------------------
+// Snapshots
+// ---------------------------------------------------------------------------
+
+void session::saveSnapshot(const Session& s, vector<char>& out)
+{
+    model_store::SectionWriter w;
+    w.putString(s.id);
+    w.putString(s.input);
+    w.putString(s.prevInput);
+    w.putString(s.prevResponse);
+    w.putStrings(s.history);
+    w.putStrings(s.recentResponses);
+    w.putStringMap(s.vars);
+    w.putString(s.lastLogicSystem);
+    w.putF64(s.lastLogicConfidence);
+    w.putF64Array(s.lastLogicFeatures.data(), s.lastLogicFeatures.size());
+    w.putF64Array(s.lastPathScores.data(), s.lastPathScores.size());
+    w.putU64(s.turns);
+
+    w.putU32(s.temporal ? 1 : 0);
+    if (s.temporal) {
+        const dtesnn::ReservoirState& st = s.temporal->getState();
+        w.putU32((uint32_t)st.stepCount);
+        w.putF32Array(st.activation.data(), st.activation.size());
+    }
+    w.putU32(s.workflow ? 1 : 0);
+    if (s.workflow)
+        s.workflow->exportTo(w);
+
+    out.assign(SNAPSHOT_HEADER, 0);
+    memcpy(out.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    memcpy(out.data() + sizeof(SNAPSHOT_MAGIC), &SESSION_SNAPSHOT_VERSION,
+           sizeof(SESSION_SNAPSHOT_VERSION));
+    out.insert(out.end(), w.bytes().begin(), w.bytes().end());
+}
+
+bool session::loadSnapshot(const char* data, size_t size, Session& s)
+{
+    uint32_t version = 0;
+    if (size < SNAPSHOT_HEADER || memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        return false;
+    memcpy(&version, data + sizeof(SNAPSHOT_MAGIC), sizeof(version));
+    if (version != SESSION_SNAPSHOT_VERSION)
+        return false;
+
+    model_store::SectionReader r(data + SNAPSHOT_HEADER, size - SNAPSHOT_HEADER);
+    Session t(r.getString());
+    t.input        = r.getString();
+    t.prevInput    = r.getString();
+    t.prevResponse = r.getString();
+    r.getStrings(t.history);
+    r.getStrings(t.recentResponses);
+    r.getStringMap(t.vars);
+    t.lastLogicSystem     = r.getString();
+    t.lastLogicConfidence = r.getF64();
+    r.getF64Array(t.lastLogicFeatures);
+    r.getF64Array(t.lastPathScores);
+    t.turns = (size_t)r.getU64();
+
+    dtesnn::ReservoirState temporal;
+    bool hasTemporal = r.getU32() != 0;
+    if (hasTemporal) {
+        temporal.stepCount = (int)r.getU32();
+        r.getF32Array(temporal.activation);
+    }
+    // Decode the workflow into a scratch engine so a bad tail leaves s alone.
+    workflow_engine::WorkflowEngine workflow;
+    bool hasWorkflow = r.getU32() != 0;
+    if (hasWorkflow && r.ok() && !workflow.importFrom(r))
+        return false;
+    if (!r.ok() || t.id != s.id)
+        return false;
+
+    // A snapshot from a different reservoir geometry keeps the fresh state.
+    if (hasTemporal && s.temporal &&
+        temporal.activation.size() == s.temporal->getState().activation.size())
+        s.temporal->getState() = temporal;
+    if (hasWorkflow && s.workflow)
+        *s.workflow = workflow;
+
+    s.input               = t.input;
+    s.prevInput           = t.prevInput;
+    s.prevResponse        = t.prevResponse;
+    s.history             = t.history;
+    s.recentResponses     = t.recentResponses;
+    s.vars                = t.vars;
+    s.lastLogicSystem     = t.lastLogicSystem;
+    s.lastLogicConfidence = t.lastLogicConfidence;
+    s.lastLogicFeatures   = t.lastLogicFeatures;
+    if (t.lastPathScores.size() == s.lastPathScores.size())
+        s.lastPathScores = t.lastPathScores;
+    s.turns               = t.turns;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// SessionTable
+// ---------------------------------------------------------------------------
+
+SessionTable::SessionTable(Factory factory, const SessionStoreConfig& config)
+    : m_factory(factory), m_config(config), m_pending(0),
+      m_created(0), m_spilled(0), m_restored(0),
+      m_restoreUsTotal(0.0), m_restoreUsMax(0.0)
+{
+    if (spilling() && !makeDir(m_config.spillDir))
+        m_config.spillDir.clear();
+}
+
+SessionTable::~SessionTable()
+{
+    // Completions call back into the table.
+    waitForSpills();
+}
+
+shared_ptr<Session> SessionTable::acquire(const string& id)
+{
+    unique_lock<mutex> lock(m_mutex);
+    for (;;) {
+        auto it = m_sessions.find(id);
+        if (it != m_sessions.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            it->second.lastUsed = Clock::now();
+            if (it->second.spilling)
+                it->second.touched = true;   // keep it: the snapshot is stale
+            return it->second.session;
+        }
+        // One restore per id at a time; others wait for its entry.
+        if (!m_loading.count(id))
+            break;
+        m_changed.wait(lock);
+    }
+    m_loading.insert(id);
+    lock.unlock();
+
+    // The snapshot read or the factory may be slow; other sessions are
+    // looked up meanwhile.
+    double us = 0.0;
+    shared_ptr<Session> s;
+    bool restored = false;
+    try {
+        s = spilling() ? restore(id, us) : nullptr;
+        restored = (bool)s;
+        if (!s)
+            s = m_factory(id);
+    } catch (...) {
+        lock.lock();
+        m_loading.erase(id);
+        m_changed.notify_all();
+        throw;
+    }
+
+    vector<Spill> spills;
+    lock.lock();
+    m_loading.erase(id);
+    m_changed.notify_all();
+    if (restored) {
+        ++m_restored;
+        m_restoreUsTotal += us;
+        if (us > m_restoreUsMax) m_restoreUsMax = us;
+    } else {
+        ++m_created;
+    }
+    m_lru.push_front(id);
+    Entry e;
+    e.session  = s;
+    e.lru      = m_lru.begin();
+    e.lastUsed = Clock::now();
+    e.spilling = false;
+    e.touched  = false;
+    m_sessions[id] = e;
+    if (spilling())
+        trimLocked(spills);
+    lock.unlock();
+
+    writeSpills(spills);
+    return s;
+}
+
+void SessionTable::evictIdle()
+{
+    if (!spilling()) return;
+    vector<Spill> spills;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        Clock::time_point now = Clock::now();
+        // Oldest first; stop at the first session used recently.  Sessions
+        // in use or already being written are stepped over.
+        for (auto pos = m_lru.end(); pos != m_lru.begin(); ) {
+            --pos;
+            auto it = m_sessions.find(*pos);
+            double idle = chrono::duration<double>(now - it->second.lastUsed).count();
+            if (idle < m_config.idleSeconds)
+                break;
+            evictLocked(it, spills);
+        }
+    }
+    writeSpills(spills);
+}
+
+void SessionTable::spillAll()
+{
+    if (!spilling()) return;
+    vector<Spill> spills;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it)
+            evictLocked(it, spills, false);
+    }
+    // Written here rather than queued: the caller is about to exit.
+    for (Spill& sp : spills) {
+        string error;
+        bool ok = write_behind::writeFileAtomically(sp.path, sp.bytes, error);
+        if (!ok)
+            cerr << "[Session] " << error << endl;
+        finishSpill(sp.id, ok, sp.evict);
+    }
+    waitForSpills();
+}
+
+void SessionTable::trimLocked(vector<Spill>& spills)
+{
+    if (m_config.maxResident == 0) return;
+    // Sessions with a turn in flight are skipped, so the table can run over
+    // capacity briefly while every resident session is busy; sessions being
+    // written count as gone already.
+    auto pos = m_lru.end();
+    while (m_sessions.size() - m_pending > m_config.maxResident && pos != m_lru.begin()) {
+        --pos;
+        evictLocked(m_sessions.find(*pos), spills);
+    }
+}
+
+bool SessionTable::evictLocked(unordered_map<string, Entry>::iterator it,
+                               vector<Spill>& spills, bool evict)
+{
+    Entry& e = it->second;
+    if (e.spilling || e.session.use_count() > 1)
+        return false;
+    // use_count() is a relaxed read; pair it with the releasing decrement
+    // of the last turn's reference so that turn's writes are visible.
+    atomic_thread_fence(memory_order_acquire);
+    vector<char> bytes;
+    saveSnapshot(*e.session, bytes);
+
+    Spill sp;
+    sp.id    = it->first;
+    sp.path  = snapshotPath(it->first);
+    sp.bytes.assign(bytes.begin(), bytes.end());
+    sp.evict = evict;
+    spills.push_back(std::move(sp));
+    e.spilling = true;
+    e.touched  = false;
+    ++m_pending;
+    return true;
+}
+
+void SessionTable::writeSpills(vector<Spill>& spills)
+{
+    for (Spill& sp : spills) {
+        if (m_config.writer) {
+            string id = sp.id;
+            bool evict = sp.evict;
+            if (m_config.writer->submit(sp.path, std::move(sp.bytes),
+                    [this, id, evict](bool ok) { finishSpill(id, ok, evict); }))
+                continue;
+            finishSpill(sp.id, false, sp.evict);   // queue full: try again later
+            continue;
+        }
+        string error;
+        bool ok = write_behind::writeFileAtomically(sp.path, sp.bytes, error);
+        if (!ok)
+            cerr << "[Session] " << error << endl;
+        finishSpill(sp.id, ok, sp.evict);
+    }
+}
+
+void SessionTable::finishSpill(const string& id, bool ok, bool evict)
+{
+    lock_guard<mutex> lock(m_mutex);
+    auto it = m_sessions.find(id);
+    if (it != m_sessions.end() && it->second.spilling) {
+        Entry& e = it->second;
+        e.spilling = false;
+        --m_pending;
+        if (ok)
+            ++m_spilled;
+        if (ok && evict && !e.touched && e.session.use_count() == 1) {
+            m_lru.erase(e.lru);
+            m_sessions.erase(it);
+        } else {
+            if (!ok) {
+                // Kept in memory; retried once it is idle again.
+                m_lru.splice(m_lru.begin(), m_lru, e.lru);
+                e.lastUsed = Clock::now();
+            }
+            e.touched = false;
+        }
+    }
+    // Notified under the lock: a waiting destructor may free the table as
+    // soon as it sees m_pending reach zero.
+    m_changed.notify_all();
+}
+
+void SessionTable::waitForSpills()
+{
+    // Queued snapshots only complete once written; write them here in
+    // case the writer thread is stopped.
+    if (m_config.writer)
+        m_config.writer->flush();
+    unique_lock<mutex> lock(m_mutex);
+    m_changed.wait(lock, [this]() { return m_pending == 0; });
+}
+
+string SessionTable::snapshotPath(const string& id) const
+{
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)fnv1a(id));
+    return m_config.spillDir + "/" + string(hex, 2) + "/" + hex + ".snap";
+}
+
+shared_ptr<Session> SessionTable::restore(const string& id, double& us)
+{
+    Clock::time_point start = Clock::now();
+    ifstream f(snapshotPath(id).c_str(), ios::binary);
+    if (!f) return nullptr;
+    vector<char> bytes((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+
+    shared_ptr<Session> s = m_factory(id);
+    if (!loadSnapshot(bytes.data(), bytes.size(), *s))
+        return nullptr;   // collision, other version or corrupt: start fresh
+
+    us = chrono::duration<double, micro>(Clock::now() - start).count();
+    return s;
+}
+
+size_t SessionTable::size() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_sessions.size();
+}
+
+SessionTableStats SessionTable::getStats() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    SessionTableStats st;
+    st.resident     = m_sessions.size();
+    st.created      = m_created;
+    st.spilled      = m_spilled;
+    st.restored     = m_restored;
+    st.restoreUsAvg = m_restored ? m_restoreUsTotal / (double)m_restored : 0.0;
+    st.restoreUsMax = m_restoreUsMax;
+    return st;
+}
@@ -0,0 +1,221 @@
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+/**
+ * session.h — Per-conversation state (Phase 6)
+ *
+ * Everything that belongs to one conversation rather than to the bot:
+ * previous input / response, the GPT-4o history window, the anti-repetition
+ * window, AIML predicates, the DTESNN reservoir state, the active logic
+ * workflow and the last logic classification.  The brain (category lists,
+ * PatternLattice, HGNN / DTESNN / MLP weights, AtomSpace) is shared by all
+ * sessions and owned by Chatmachine.
+ *
+ * A Session is only ever touched by one turn at a time: the REPL has a
+ * single console session, and the server serialises turns per session.
+ * SessionTable maps session ids to sessions and is safe to use from any
+ * thread.
+ *
+ * Snapshots: saveSnapshot() / loadSnapshot() turn a session into a compact
+ * binary blob (model_store section encoding) and back.  Given a spill
+ * directory, SessionTable keeps only an LRU of hot sessions in memory; a
+ * session that falls off the LRU or sits idle is written to
+ *
+ *     <spillDir>/<hh>/<hash>.snap     (hh = first two hex digits of hash)
+ *
+ * and restored from there on its next turn.  Snapshots carry the session
+ * id, so a hash collision reads as a miss, and since every worker process
+ * writes through a temporary + rename(), pre-forked workers can share one
+ * directory and pick up each other's sessions.
+ *
+ * Only the snapshot encoding happens under the table lock.  The file is
+ * written by the write-behind thread (or, without one, by the caller after
+ * the lock is released), and the session stays resident until the write
+ * is known to have succeeded, so a failed write loses nothing; a session
+ * used again meanwhile simply stays.  Restores read the file outside the
+ * lock too, so a slow disk never stalls lookups of other sessions.
+ */
+
+#include "dtesnn.h"
+#include "workflow_engine.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+
+using namespace std;
+
+namespace brain {
+    struct Generation;
+}
+
+namespace write_behind {
+    class FileWriter;
+}
+
+namespace session {
+
+    static const size_t SESSION_HISTORY_MAX = 20;   // input/response strings
+    static const size_t SESSION_RECENT_MAX  = 10;   // anti-repetition window
+
+    static const uint32_t SESSION_SNAPSHOT_VERSION = 1;
+    static const double   SESSION_IDLE_SECONDS     = 300.0;  // spill after this long unused
+
+    struct Session {
+        explicit Session(const string& sessionId = "console");
+
+        string id;
+
+        // Conversation.
+        string         input;            // normalised input of the current turn
+        string         prevInput;
+        string         prevResponse;
+        vector<string> history;          // alternating input / response for GPT-4o
+        vector<string> recentResponses;  // anti-repetition window
+        map<string, string> vars;        // AIML <set>/<get> predicates
+
+        // NSVD per-conversation state; created by Chatmachine::newSession().
+        unique_ptr<dtesnn::DeepTreeEchoStateNet>    temporal;  // shared model, own state
+        unique_ptr<workflow_engine::WorkflowEngine> workflow;
+        string         lastLogicSystem;
+        double         lastLogicConfidence;
+        vector<double> lastLogicFeatures;  // classifier input behind lastLogicSystem
+        vector<double> lastPathScores;     // per PATH_*, last time each ran
+
+        size_t turns;
+        chrono::steady_clock::time_point lastActive;
+
+        // Set by the front end for a turn: receives the reply while it is
+        // still being generated (streamed GPT-4o text, prefix first).  The
+        // pieces add up to the reply unless generation fails part-way; the
+        // returned reply is what counts.  Not part of snapshots.
+        function<void(const string&)> partial;
+
+        // The brain generation (see brain.h) the current turn started on,
+        // pinned by Chatmachine::respondTo() until the turn returns so a
+        // reload cannot change it mid-turn.  Not part of snapshots.
+        shared_ptr<brain::Generation> brain;
+
+        // Append one exchange to the GPT-4o history window.
+        void remember(const string& in, const string& response);
+    };
+
+    // Encode s (conversation, predicates, reservoir state, workflow) into out.
+    void saveSnapshot(const Session& s, vector<char>& out);
+
+    // Decode a snapshot into s, which must come from the session factory so
+    // its reservoir and workflow engine exist.  False (s untouched) if the
+    // data is malformed, of another version or for another model geometry.
+    bool loadSnapshot(const char* data, size_t size, Session& s);
+
+    struct SessionStoreConfig {
+        string spillDir;       // empty: keep every session in memory
+        size_t maxResident;    // LRU capacity when spilling (0 = unbounded)
+        double idleSeconds;    // evictIdle() spills sessions unused this long
+        // Writes the snapshots (not owned; must outlive the table).  Null:
+        // the evicting caller writes them after releasing the table lock.
+        write_behind::FileWriter* writer;
+
+        SessionStoreConfig()
+            : maxResident(0), idleSeconds(SESSION_IDLE_SECONDS), writer(nullptr) {}
+    };
+
+    struct SessionTableStats {
+        size_t resident;       // sessions in memory
+        size_t created;        // new sessions from the factory
+        size_t spilled;        // snapshots written
+        size_t restored;       // sessions read back from a snapshot
+        double restoreUsAvg;   // snapshot read + decode latency
+        double restoreUsMax;
+    };
+
+    class SessionTable {
+    public:
+        typedef function<shared_ptr<Session>(const string&)> Factory;
+
+        explicit SessionTable(Factory factory,
+                              const SessionStoreConfig& config = SessionStoreConfig());
+        // Waits for snapshot writes still in flight.
+        ~SessionTable();
+
+        // Session for id: resident, restored from its snapshot, or new from
+        // the factory.  May spill the least recently used idle sessions.
+        shared_ptr<Session> acquire(const string& id);
+
+        // Spill sessions not used for config.idleSeconds.  No-op without a
+        // spill directory.
+        void evictIdle();
+
+        // Snapshot every idle resident session (e.g. at shutdown) so the
+        // next process resumes them, and wait for every snapshot write in
+        // flight.  No-op without a spill directory.
+        void spillAll();
+
+        bool spilling() const { return !m_config.spillDir.empty(); }
+
+        size_t size() const;
+        SessionTableStats getStats() const;
+
+    private:
+        typedef chrono::steady_clock Clock;
+
+        struct Entry {
+            shared_ptr<Session>    session;
+            list<string>::iterator lru;       // position in m_lru
+            Clock::time_point      lastUsed;
+            bool                   spilling;  // snapshot write in flight
+            bool                   touched;   // acquired since that snapshot
+        };
+
+        // A snapshot taken under the lock, written after it is released.
+        struct Spill {
+            string id;
+            string path;
+            string bytes;
+            bool   evict;     // drop the session once it is on disk
+        };
+
+        Factory                         m_factory;
+        SessionStoreConfig              m_config;
+        unordered_map<string, Entry>    m_sessions;
+        list<string>                    m_lru;        // most recent first
+        unordered_set<string>           m_loading;    // ids being restored or created
+        size_t                          m_pending;    // entries with spilling set
+        mutable mutex                   m_mutex;
+        condition_variable              m_changed;    // m_loading or m_pending shrank
+
+        size_t m_created;
+        size_t m_spilled;
+        size_t m_restored;
+        double m_restoreUsTotal;
+        double m_restoreUsMax;
+
+        string snapshotPath(const string& id) const;
+        // Read and decode id's snapshot; null if there is none usable.
+        // Called without the lock.
+        shared_ptr<Session> restore(const string& id, double& us);
+        // Queue spills for entries from the LRU tail until within capacity.
+        void   trimLocked(vector<Spill>& spills);
+        // Snapshot one entry into spills; false if it is in use or already
+        // being written.  The entry stays until finishSpill().
+        bool   evictLocked(unordered_map<string, Entry>::iterator it, vector<Spill>& spills,
+                           bool evict = true);
+        // Write snapshots taken under the lock; called without it.
+        void   writeSpills(vector<Spill>& spills);
+        // A snapshot write ended: drop the entry if it was evicted, wrote
+        // fine and has not been used since; otherwise keep it resident.
+        void   finishSpill(const string& id, bool ok, bool evict);
+        // Block until no snapshot write is in flight.
+        void   waitForSpills();
+    };
+
+} // namespace session
+
+#endif // __SESSION_H__
@@ -128,20 +128,29 @@ void transfer(char const *array[], vecstr &vs, int size) {
 // wikibooks.org
 // Levenshtein distance
 unsigned int edit_distance(const std::string& s1, const std::string& s2)
+{
+	std::vector<unsigned int> row;
+	return edit_distance(s1, s2, row);
+}
+
+// Single-row form: row[j] holds d[i][j] of the full matrix for the current i.
+unsigned int edit_distance(const std::string& s1, const std::string& s2, std::vector<unsigned int>& row)
 {
 	const std::size_t len1 = s1.size(), len2 = s2.size();
-	std::vector<std::vector<unsigned int> > d(len1 + 1, std::vector<unsigned int>(len2 + 1));
-
-	d[0][0] = 0;
-	for(unsigned int i = 1; i <= len1; ++i) d[i][0] = i;
-	for(unsigned int i = 1; i <= len2; ++i) d[0][i] = i;
-
-	for(unsigned int i = 1; i <= len1; ++i)
-		for(unsigned int j = 1; j <= len2; ++j)
-                      // note that std::min({arg1, arg2, arg3}) works only in C++11,
-                      // for C++98 use std::min(std::min(arg1, arg2), arg3)
-                      d[i][j] = std::min(std::min(d[i - 1][j] + 1, d[i][j - 1] + 1), d[i - 1][j - 1] + (s1[i - 1] == s2[j - 1] ? 0 : 1));
-	return d[len1][len2];
+	row.resize(len2 + 1);
+
+	for(unsigned int j = 0; j <= len2; ++j) row[j] = j;
+
+	for(unsigned int i = 1; i <= len1; ++i) {
+		unsigned int diag = row[0];
+		row[0] = i;
+		for(unsigned int j = 1; j <= len2; ++j) {
+			unsigned int up = row[j];
+			row[j] = std::min(std::min(up + 1, row[j - 1] + 1), diag + (s1[i - 1] == s2[j - 1] ? 0 : 1));
+			diag = up;
+		}
+	}
+	return row[len2];
 }
 
 void arraycopy(vector<string> src, int srcPos, vector<string> &dest, int destPos, int length) {
@@ -25,6 +25,9 @@ void transfer(char const *array[], vecstr &vs, int size);
 vecstr split(string str);
 int Split(vecstr& vecteur, string chaine, char separateur);
 unsigned int edit_distance(const string& s1, const string& s2);
+// Same distance, computed in the caller's row buffer (no allocation once it
+// has grown to s2.size() + 1).
+unsigned int edit_distance(const string& s1, const string& s2, vector<unsigned int>& row);
 string trim(const string& str);
 // supposition : dest size is greater or equal to desPos + length
 void arraycopy(vector<string> src, int srcPos, vector<string> &dest, int destPos, int length);
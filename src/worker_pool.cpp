@@ -0,0 +1,53 @@
+#include "worker_pool.h"
+
+using namespace worker_pool;
+
+WorkerPool::WorkerPool(size_t threads)
+    : m_stopping(false)
+{
+    if (threads == 0) threads = 1;
+    m_threads.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        m_threads.emplace_back(&WorkerPool::run, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_threads)
+        if (t.joinable()) t.join();
+}
+
+size_t WorkerPool::pending() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_tasks.size();
+}
+
+void WorkerPool::enqueue(function<void()> task)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_tasks.push(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void WorkerPool::run()
+{
+    for (;;) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty()) return;   // stopping and drained
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+/**
+ * worker_pool.h — Fixed-size thread pool
+ *
+ * Long-lived worker threads pulling tasks from a shared queue.  submit()
+ * returns a std::future backed by a packaged_task; unlike futures from
+ * std::async, destroying one never blocks, so a caller can give up on a
+ * late task (after cancelling it through its CancelToken) and move on.
+ *
+ * The destructor finishes all queued tasks before joining.
+ */
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+using namespace std;
+
+namespace worker_pool {
+
+    class WorkerPool {
+    public:
+        explicit WorkerPool(size_t threads);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        template <typename F>
+        future<typename result_of<F()>::type> submit(F&& fn)
+        {
+            typedef typename result_of<F()>::type R;
+            auto task = make_shared<packaged_task<R()>>(std::forward<F>(fn));
+            future<R> result = task->get_future();
+            enqueue([task]() { (*task)(); });
+            return result;
+        }
+
+        size_t size() const { return m_threads.size(); }
+
+        // Tasks queued but not yet started.
+        size_t pending() const;
+
+    private:
+        vector<thread>          m_threads;
+        queue<function<void()>> m_tasks;
+        mutable mutex           m_mutex;
+        condition_variable      m_cv;
+        bool                    m_stopping;
+
+        void enqueue(function<void()> task);
+        void run();
+    };
+
+} // namespace worker_pool
+
+#endif // __WORKER_POOL_H__
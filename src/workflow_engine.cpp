@@ -190,3 +190,77 @@ vector<MetaPattern> WorkflowEngine::collectConsolidatedMetaPatterns(double thres
     }
     return out;
 }
+
+void WorkflowEngine::exportTo(model_store::SectionWriter& out) const {
+    out.putU32(m_active ? 1 : 0);
+    out.putU32((uint32_t)m_activeSystem);
+    out.putU32((uint32_t)m_sequence.steps.size());
+    for (const auto& step : m_sequence.steps) {
+        const MetaPattern& m = step.metaPattern;
+        out.putU32((uint32_t)m.system);
+        out.putString(m.topic_guard);
+        out.putString(m.that_guard);
+        out.putString(m.pattern);
+        out.putString(m.template_action);
+        out.putStringMap(step.boundVars);
+        out.putU32(step.completed ? 1 : 0);
+    }
+    out.putU32((uint32_t)m_sequence.currentIndex);
+    out.putStringMap(m_sequence.variables);
+    out.putString(m_lastResponse);
+    out.putU32((uint32_t)m_completionCount);
+    out.putU32((uint32_t)m_activationStats.size());
+    for (const auto& kv : m_activationStats) {
+        out.putString(kv.first);
+        out.putU32((uint32_t)kv.second);
+    }
+    out.putU32((uint32_t)m_patternConfidence.size());
+    for (const auto& kv : m_patternConfidence) {
+        out.putString(kv.first);
+        out.putF64(kv.second);
+    }
+}
+
+bool WorkflowEngine::importFrom(model_store::SectionReader& in) {
+    bool active = in.getU32() != 0;
+    LogicSystem system = (LogicSystem)in.getU32();
+    WorkflowSequence seq;
+    uint32_t steps = in.getU32();
+    for (uint32_t i = 0; i < steps && in.ok(); ++i) {
+        WorkflowStep step;
+        step.metaPattern.system          = (LogicSystem)in.getU32();
+        step.metaPattern.topic_guard     = in.getString();
+        step.metaPattern.that_guard      = in.getString();
+        step.metaPattern.pattern         = in.getString();
+        step.metaPattern.template_action = in.getString();
+        in.getStringMap(step.boundVars);
+        step.completed = in.getU32() != 0;
+        seq.steps.push_back(step);
+    }
+    seq.currentIndex = (int)in.getU32();
+    in.getStringMap(seq.variables);
+    string lastResponse = in.getString();
+    int completions = (int)in.getU32();
+    map<string, int> activations;
+    uint32_t n = in.getU32();
+    for (uint32_t i = 0; i < n && in.ok(); ++i) {
+        string name = in.getString();
+        activations[name] = (int)in.getU32();
+    }
+    map<string, double> confidence;
+    n = in.getU32();
+    for (uint32_t i = 0; i < n && in.ok(); ++i) {
+        string name = in.getString();
+        confidence[name] = in.getF64();
+    }
+    if (!in.ok()) return false;
+
+    m_active = active;
+    m_activeSystem = system;
+    m_sequence = seq;
+    m_lastResponse = lastResponse;
+    m_completionCount = completions;
+    m_activationStats = activations;
+    m_patternConfidence = confidence;
+    return true;
+}
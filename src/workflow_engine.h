@@ -2,6 +2,7 @@
 #define WORKFLOW_ENGINE_H_
 
 #include "logic_meta_patterns.h"
+#include "model_store.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -58,6 +59,11 @@ namespace workflow_engine {
 
         std::vector<logic_meta_patterns::MetaPattern> collectConsolidatedMetaPatterns(double threshold) const;
 
+        // Binary snapshot of the whole engine (active sequence, bound
+        // variables, statistics) for session snapshots (see session.h).
+        void exportTo(model_store::SectionWriter& out) const;
+        bool importFrom(model_store::SectionReader& in);
+
     private:
         bool m_active;
         logic_meta_patterns::LogicSystem m_activeSystem;
@@ -0,0 +1,241 @@
+#include "write_behind.h"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace write_behind;
+
+namespace {
+
+    uint64_t fnv1a(const string& s)
+    {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    bool fileStamp(const string& path, time_t& mtime, long long& size)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return false;
+        mtime = st.st_mtime;
+        size  = (long long)st.st_size;
+        return true;
+    }
+
+    bool readFile(const string& path, string& contents)
+    {
+        ifstream f(path.c_str(), ios::binary);
+        if (!f) return false;
+        contents.assign((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+        return true;
+    }
+
+} // namespace
+
+bool write_behind::writeFileAtomically(const string& path, const string& contents,
+                                       string& error)
+{
+    size_t slash = path.rfind('/');
+    if (slash != string::npos && slash > 0) {
+        string dir = path.substr(0, slash);
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            error = "Cannot create " + dir + ": " + strerror(errno);
+            return false;
+        }
+    }
+
+    // Per-process temporary: pre-forked workers may write the same path,
+    // and each rename() is atomic, so the last complete file wins.
+    string tmp = path + ".tmp." + to_string((long long)getpid());
+    {
+        ofstream f(tmp.c_str(), ios::binary | ios::trunc);
+        f.write(contents.data(), (streamsize)contents.size());
+        f.close();
+        if (!f) {
+            error = "Cannot write " + tmp;
+            remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        error = "Cannot rename " + tmp + " to " + path + ": " + strerror(errno);
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Construction / lifecycle
+// ---------------------------------------------------------------------------
+
+FileWriter::FileWriter()
+    : m_queue(WRITE_BEHIND_QUEUE_CAPACITY), m_running(false),
+      m_queued(0), m_writtenCount(0), m_unchanged(0), m_failed(0), m_dropped(0)
+{
+}
+
+FileWriter::~FileWriter()
+{
+    stop();
+}
+
+void FileWriter::start()
+{
+    if (m_running.exchange(true)) return;
+    m_worker = thread(&FileWriter::run, this);
+}
+
+void FileWriter::stop()
+{
+    if (m_running.exchange(false) && m_worker.joinable())
+        m_worker.join();
+    // Anything queued after the worker's last pass.
+    flush();
+}
+
+void FileWriter::flush()
+{
+    while (writeOnce()) {}
+}
+
+// ---------------------------------------------------------------------------
+// Response-path enqueue
+// ---------------------------------------------------------------------------
+
+bool FileWriter::submit(const string& path, string contents)
+{
+    return submit(path, std::move(contents), function<void(bool)>());
+}
+
+bool FileWriter::submit(const string& path, string contents, function<void(bool ok)> done)
+{
+    Job job;
+    job.path     = path;
+    job.contents = std::move(contents);
+    job.done     = std::move(done);
+    if (!push(std::move(job))) {
+        cerr << "[WriteBehind] Queue full; not writing " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+bool FileWriter::then(function<void()> callback)
+{
+    Job job;
+    job.callback = std::move(callback);
+    return push(std::move(job));
+}
+
+bool FileWriter::push(Job&& job)
+{
+    if (!m_queue.tryPush(std::move(job))) {
+        m_dropped++;
+        return false;
+    }
+    m_queued++;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Background writing
+// ---------------------------------------------------------------------------
+
+void FileWriter::run()
+{
+    // Same back-off as the replay trainer: saves arrive at conversation
+    // speed, and polling keeps the producer side entirely lock-free.
+    int idleMs = 1;
+    while (m_running.load()) {
+        if (writeOnce()) {
+            idleMs = 1;
+        } else {
+            this_thread::sleep_for(chrono::milliseconds(idleMs));
+            idleMs = min(idleMs * 2, 20);
+        }
+    }
+}
+
+bool FileWriter::writeOnce()
+{
+    Job job;
+    bool ok = true;
+    {
+        lock_guard<mutex> lock(m_writeMutex);
+        if (!m_queue.tryPop(job))
+            return false;
+        if (!job.path.empty())
+            ok = write(job);
+    }
+    // Outside the lock: a callback may submit more.
+    if (job.done)
+        job.done(ok);
+    if (job.callback)
+        job.callback();
+    return true;
+}
+
+bool FileWriter::write(const Job& job)
+{
+    Written w;
+    w.hash = fnv1a(job.contents);
+
+    // Trust the remembered hash while the file is as it was left;
+    // otherwise compare with what is on disk now.
+    time_t mtime;
+    long long size;
+    bool exists = fileStamp(job.path, mtime, size);
+    bool same = false;
+    if (exists && size == (long long)job.contents.size()) {
+        auto it = m_written.find(job.path);
+        if (it != m_written.end() && it->second.mtime == mtime && it->second.size == size) {
+            same = it->second.hash == w.hash;
+        } else {
+            string existing;
+            same = readFile(job.path, existing) && fnv1a(existing) == w.hash;
+        }
+    }
+    if (same) {
+        m_unchanged++;
+        w.mtime = mtime;
+        w.size  = size;
+        m_written[job.path] = w;
+        return true;
+    }
+
+    string error;
+    if (!writeFileAtomically(job.path, job.contents, error)) {
+        cerr << "[WriteBehind] " << error << endl;
+        m_failed++;
+        m_written.erase(job.path);
+        return false;
+    }
+    m_writtenCount++;
+    if (fileStamp(job.path, w.mtime, w.size))
+        m_written[job.path] = w;
+    return true;
+}
+
+WriterStats FileWriter::getStats() const
+{
+    WriterStats s;
+    s.queued    = m_queued.load();
+    s.written   = m_writtenCount.load();
+    s.unchanged = m_unchanged.load();
+    s.failed    = m_failed.load();
+    s.dropped   = m_dropped.load();
+    return s;
+}
@@ -0,0 +1,129 @@
+#ifndef __WRITE_BEHIND_H__
+#define __WRITE_BEHIND_H__
+
+/**
+ * write_behind.h — Background file writer (Phase 6)
+ *
+ * Moves persistence off the response path.  A turn that has something to
+ * save (a consolidation pass, the neural model at the end of an outer loop)
+ * renders the file in memory and submit()s it; one background thread drains
+ * a lock-free ring buffer (ring_buffer.h) and writes the files, so no turn
+ * waits on the disk.  The startup registry files (database/logic/) go the
+ * same way.
+ *
+ * Every file is written to a per-process temporary and renamed over its
+ * path, so readers (the AIML loader, another worker) only ever see a whole
+ * file.  Files whose content hash matches what is on disk are not written
+ * again; the registry files are regenerated on every start but rarely
+ * change.
+ *
+ * then() queues a callback that runs on the writer thread once everything
+ * submitted before it is on disk (the consolidation reload uses it).  A
+ * submission can also carry its own completion, told whether that file
+ * made it to disk (session snapshots use it).
+ * flush() is a barrier: it returns once everything submitted before the
+ * call is written.  stop() flushes before it returns, so nothing submitted
+ * is lost at shutdown or before a fork.
+ *
+ * A full queue rejects the submission rather than blocking; it is counted
+ * as dropped.
+ */
+
+#include "ring_buffer.h"
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <ctime>
+#include <cstdint>
+
+using namespace std;
+
+namespace write_behind {
+
+    static const size_t WRITE_BEHIND_QUEUE_CAPACITY = 256;
+
+    // Write contents to path through a per-process temporary and rename(),
+    // creating path's directory if needed.  False (with error set) if any
+    // step failed; the temporary is removed then.
+    bool writeFileAtomically(const string& path, const string& contents, string& error);
+
+    struct WriterStats {
+        size_t queued;      // submissions accepted
+        size_t written;     // files written
+        size_t unchanged;   // files skipped because their content was on disk
+        size_t failed;      // files that could not be written
+        size_t dropped;     // submissions rejected because the queue was full
+    };
+
+    class FileWriter {
+    public:
+        FileWriter();
+        ~FileWriter();
+
+        void start();
+        // Write everything still queued, then join the worker.
+        void stop();
+
+        // Response-path enqueue; never blocks.  False if dropped.
+        bool submit(const string& path, string contents);
+        // The same; done(ok) runs on the writer thread (or in flush()) once
+        // the file is written, found unchanged (ok) or failed.  Not called
+        // when the submission is dropped.
+        bool submit(const string& path, string contents, function<void(bool ok)> done);
+        // Run callback on the writer thread (or in flush()) after everything
+        // submitted before it.  False if dropped.
+        bool then(function<void()> callback);
+
+        // Write everything queued so far before returning.
+        void flush();
+
+        WriterStats getStats() const;
+
+    private:
+        struct Job {
+            string               path;       // empty for a then() callback
+            string               contents;
+            function<void()>     callback;
+            function<void(bool)> done;       // completion of a submit()
+        };
+
+        // What was last written to (or found at) a path, so an unchanged
+        // file is recognised without reading it back.
+        struct Written {
+            uint64_t  hash;
+            time_t    mtime;
+            long long size;
+        };
+
+        ring_buffer::MPMCQueue<Job> m_queue;
+
+        // Serialises writing between the worker and flush(); guards m_written.
+        mutex                            m_writeMutex;
+        unordered_map<string, Written>   m_written;
+
+        thread       m_worker;
+        atomic<bool> m_running;
+
+        atomic<size_t> m_queued;
+        atomic<size_t> m_writtenCount;
+        atomic<size_t> m_unchanged;
+        atomic<size_t> m_failed;
+        atomic<size_t> m_dropped;
+
+        bool push(Job&& job);
+        void run();
+        // Take one job and carry it out; false if the queue was empty.
+        bool writeOnce();
+        // False if the file could not be written.
+        bool write(const Job& job);
+
+        FileWriter(const FileWriter&) = delete;
+        FileWriter& operator=(const FileWriter&) = delete;
+    };
+
+} // namespace write_behind
+
+#endif // __WRITE_BEHIND_H__
@@ -0,0 +1,297 @@
+// Admission control for the GPT-4o fallback (admission_control.h): the
+// token bucket, the semaphore's timeout and cancellation, the circuit
+// breaker's closed -> open -> half-open probe cycle, and single-flight
+// coalescing when the leader completes or gives up.
+
+#include "check.h"
+#include "admission_control.h"
+#include <thread>
+
+using namespace std;
+using namespace admission_control;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    double msSince(Clock::time_point t)
+    {
+        return chrono::duration<double, milli>(Clock::now() - t).count();
+    }
+
+    void sleepMs(int ms)
+    {
+        this_thread::sleep_for(chrono::milliseconds(ms));
+    }
+
+    // Released once by open(); send functions wait on it.
+    struct Gate {
+        mutex              m;
+        condition_variable cv;
+        bool               opened = false;
+
+        void open()
+        {
+            { lock_guard<mutex> lock(m); opened = true; }
+            cv.notify_all();
+        }
+        void wait()
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [this]() { return opened; });
+        }
+    };
+
+    void tokenBucketBurstThenRate()
+    {
+        TokenBucket bucket(10.0, 3.0);
+        CHECK(bucket.tryAcquire());
+        CHECK(bucket.tryAcquire());
+        CHECK(bucket.tryAcquire());
+        CHECK(!bucket.tryAcquire());       // burst spent
+
+        sleepMs(150);                      // 1.5 tokens at 10/s
+        CHECK(bucket.tryAcquire());
+        CHECK(!bucket.tryAcquire());
+
+        TokenBucket unlimited(0.0, 1.0);
+        for (int i = 0; i < 100; ++i)
+            CHECK(unlimited.tryAcquire());
+    }
+
+    void semaphoreTimesOut()
+    {
+        Semaphore slots(1);
+        CHECK(slots.acquire(Clock::now()));
+        CHECK_EQ(slots.inUse(), (size_t)1);
+
+        Clock::time_point t0 = Clock::now();
+        CHECK(!slots.acquire(t0 + chrono::milliseconds(60)));
+        double waited = msSince(t0);
+        CHECK(waited >= 55.0 && waited < 1000.0);
+
+        // A release wakes a waiter well before its deadline.
+        thread releaser([&]() { sleepMs(30); slots.release(); });
+        t0 = Clock::now();
+        CHECK(slots.acquire(t0 + chrono::seconds(5)));
+        CHECK(msSince(t0) < 1000.0);
+        releaser.join();
+        CHECK_EQ(slots.inUse(), (size_t)1);
+        slots.release();
+        CHECK_EQ(slots.inUse(), (size_t)0);
+
+        Semaphore unlimited(0);
+        for (int i = 0; i < 100; ++i)
+            CHECK(unlimited.acquire(Clock::now()));
+    }
+
+    void semaphoreCancel()
+    {
+        Semaphore slots(1);
+        CHECK(slots.acquire(Clock::now()));
+
+        cancel_token::CancelToken cancel;
+        thread canceller([&]() { sleepMs(30); cancel.cancel(); });
+        Clock::time_point t0 = Clock::now();
+        CHECK(!slots.acquire(t0 + chrono::seconds(5), &cancel));
+        CHECK(msSince(t0) < 1000.0);
+        canceller.join();
+        CHECK_EQ(slots.inUse(), (size_t)1);
+    }
+
+    void breakerOpensAndProbes()
+    {
+        CircuitBreaker breaker(2, 50);
+        CHECK(breaker.allow());
+        breaker.recordFailure();
+        CHECK_EQ(breaker.state(), BREAKER_CLOSED);
+        CHECK(breaker.allow());
+        breaker.recordFailure();
+        CHECK_EQ(breaker.state(), BREAKER_OPEN);
+        CHECK_EQ(breaker.trips(), (size_t)1);
+        CHECK(!breaker.allow());
+
+        // After the cool-down one probe goes through.
+        sleepMs(70);
+        CHECK(breaker.allow());
+        CHECK_EQ(breaker.state(), BREAKER_HALF_OPEN);
+        CHECK(!breaker.allow());
+
+        // An abandoned probe frees the slot for another.
+        breaker.recordAbandoned();
+        CHECK(breaker.allow());
+
+        // A failed probe opens it again at once.
+        breaker.recordFailure();
+        CHECK_EQ(breaker.state(), BREAKER_OPEN);
+        CHECK_EQ(breaker.trips(), (size_t)2);
+        CHECK(!breaker.allow());
+
+        // A successful probe closes it.
+        sleepMs(70);
+        CHECK(breaker.allow());
+        breaker.recordSuccess();
+        CHECK_EQ(breaker.state(), BREAKER_CLOSED);
+        CHECK(breaker.allow());
+        CHECK(breaker.allow());
+    }
+
+    void singleFlightJoin()
+    {
+        SingleFlight flights;
+        SingleFlight::Flight a = flights.join(42);
+        SingleFlight::Flight b = flights.join(42);
+        SingleFlight::Flight c = flights.join(7);
+        CHECK(a.leader);
+        CHECK(!b.leader);
+        CHECK(c.leader);
+        CHECK_EQ(flights.inFlight(), (size_t)2);
+
+        FlightResult r;
+        r.reply = "shared";
+        r.cancelled = false;
+        flights.finish(a, r);
+        CHECK(b.result.wait_for(chrono::seconds(0)) == future_status::ready);
+        CHECK_EQ(b.result.get().reply, string("shared"));
+        CHECK_EQ(flights.inFlight(), (size_t)1);
+
+        // A finished key starts a new flight.
+        CHECK(flights.join(42).leader);
+    }
+
+    AdmissionConfig openConfig()
+    {
+        AdmissionConfig config;
+        config.ratePerSecond   = 0.0;
+        config.maxConcurrent   = 0;
+        config.breakerFailures = 0;
+        return config;
+    }
+
+    void followerSharesLeaderReply()
+    {
+        AdmissionController ac(openConfig());
+        Gate started, release;
+        string leaderReply, followerReply;
+
+        thread leader([&]() {
+            leaderReply = ac.run(99, nullptr, [&]() {
+                started.open();
+                release.wait();
+                return string("from the leader");
+            });
+        });
+        started.wait();
+        thread follower([&]() {
+            followerReply = ac.run(99, nullptr, []() { return string("from the follower"); });
+        });
+        sleepMs(50);                       // the follower is waiting on the flight
+        release.open();
+        leader.join();
+        follower.join();
+
+        CHECK_EQ(leaderReply, string("from the leader"));
+        CHECK_EQ(followerReply, string("from the leader"));
+        AdmissionStats st = ac.getStats();
+        CHECK_EQ(st.admitted, (size_t)1);
+        CHECK_EQ(st.coalesced, (size_t)1);
+    }
+
+    void followerRetriesAfterLeaderCancels()
+    {
+        AdmissionController ac(openConfig());
+        Gate started, release;
+        cancel_token::CancelToken leaderCancel;
+        string leaderReply = "unset", followerReply;
+
+        thread leader([&]() {
+            leaderReply = ac.run(99, &leaderCancel, [&]() {
+                started.open();
+                release.wait();
+                return string("too late");
+            });
+        });
+        started.wait();
+        thread follower([&]() {
+            followerReply = ac.run(99, nullptr, []() { return string("own request"); });
+        });
+        sleepMs(50);
+        leaderCancel.cancel();
+        release.open();
+        leader.join();
+        follower.join();
+
+        CHECK_EQ(leaderReply, string());
+        CHECK_EQ(followerReply, string("own request"));
+        AdmissionStats st = ac.getStats();
+        CHECK_EQ(st.admitted, (size_t)2);
+        CHECK_EQ(st.coalesced, (size_t)0);
+        CHECK_EQ(st.failures, (size_t)0);  // a cancelled request is not a failure
+    }
+
+    void cancelledFollowerLeavesAtOnce()
+    {
+        AdmissionController ac(openConfig());
+        Gate started, release;
+        cancel_token::CancelToken followerCancel;
+        string followerReply = "unset";
+
+        thread leader([&]() {
+            ac.run(99, nullptr, [&]() {
+                started.open();
+                release.wait();
+                return string("slow");
+            });
+        });
+        started.wait();
+        Clock::time_point t0;
+        thread follower([&]() {
+            followerReply = ac.run(99, &followerCancel, []() { return string("unused"); });
+        });
+        sleepMs(30);
+        t0 = Clock::now();
+        followerCancel.cancel();
+        follower.join();
+        CHECK(msSince(t0) < 1000.0);
+        CHECK_EQ(followerReply, string());
+        release.open();
+        leader.join();
+    }
+
+    void refusalsSayWhy()
+    {
+        AdmissionConfig config = openConfig();
+        config.ratePerSecond = 1.0;
+        config.burst         = 1.0;
+        AdmissionController ac(config);
+        CHECK_EQ(ac.run(0, nullptr, []() { return string("ok"); }), string("ok"));
+        CHECK_EQ(AdmissionController::rejected(), string());
+        CHECK_EQ(ac.run(0, nullptr, []() { return string("ok"); }), string());
+        CHECK_EQ(AdmissionController::rejected(), string("rate limit reached"));
+        CHECK_EQ(ac.getStats().rateLimited, (size_t)1);
+
+        config = openConfig();
+        config.breakerFailures   = 1;
+        config.breakerCooldownMs = 60000;
+        AdmissionController failing(config);
+        CHECK_EQ(failing.run(0, nullptr, []() { return string(); }), string());
+        CHECK_EQ(failing.getStats().breaker, BREAKER_OPEN);
+        CHECK_EQ(failing.run(0, nullptr, []() { return string("ok"); }), string());
+        CHECK(AdmissionController::rejected().find("circuit breaker") != string::npos);
+    }
+
+} // namespace
+
+int main()
+{
+    RUN(tokenBucketBurstThenRate);
+    RUN(semaphoreTimesOut);
+    RUN(semaphoreCancel);
+    RUN(breakerOpensAndProbes);
+    RUN(singleFlightJoin);
+    RUN(followerSharesLeaderReply);
+    RUN(followerRetriesAfterLeaderCancels);
+    RUN(cancelledFollowerLeavesAtOnce);
+    RUN(refusalsSayWhy);
+    return check::result("admission_control_test");
+}
@@ -0,0 +1,61 @@
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+/**
+ * check.h — Minimal assertions for the test programs under tests/
+ *
+ * Each test program is a main() that runs its cases with RUN() and returns
+ * check::result(): a failed CHECK prints where and what and the case
+ * carries on, so one run reports every failure.  `make test` builds and runs them
+ * all.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace check {
+
+    inline int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline void fail(const char* file, int line, const std::string& what)
+    {
+        std::cerr << file << ":" << line << ": FAILED: " << what << std::endl;
+        ++failures();
+    }
+
+    inline int result(const char* program)
+    {
+        if (failures()) {
+            std::cerr << program << ": " << failures() << " check(s) failed" << std::endl;
+            return 1;
+        }
+        std::cout << program << ": all passed" << std::endl;
+        return 0;
+    }
+
+} // namespace check
+
+#define CHECK(cond) \
+    do { if (!(cond)) check::fail(__FILE__, __LINE__, #cond); } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        auto check_a_ = (actual); \
+        auto check_e_ = (expected); \
+        if (!(check_a_ == check_e_)) { \
+            std::ostringstream check_s_; \
+            check_s_ << #actual << " == " << #expected << " (got \"" << check_a_ \
+                     << "\", want \"" << check_e_ << "\")"; \
+            check::fail(__FILE__, __LINE__, check_s_.str()); \
+        } \
+    } while (0)
+
+#define RUN(test) \
+    do { std::cout << "  " << #test << std::endl; test(); } while (0)
+
+#endif // __CHECK_H__
@@ -0,0 +1,103 @@
+// Clustering of learned patterns before they are written
+// (consolidation::clusterLearned): rephrasings merge, while patterns that
+// differ in word order, wildcard position or negation stay apart.
+
+#include "check.h"
+#include "consolidation.h"
+#include "llm_cache.h"
+
+using namespace std;
+using consolidation::LearnedCategory;
+
+namespace {
+
+    LearnedCategory learned(const string& pattern, double confidence, const string& templ)
+    {
+        LearnedCategory c;
+        c.pattern    = pattern;
+        c.confidence = confidence;
+        c.templates.push_back(templ);
+        return c;
+    }
+
+    // Number of clusters clusterLearned() makes of the patterns.
+    size_t clusters(const vector<string>& patterns)
+    {
+        vector<LearnedCategory> categories;
+        for (size_t i = 0; i < patterns.size(); ++i)
+            categories.push_back(learned(patterns[i], 0.9 - 0.1 * i, "reply " + to_string(i)));
+        return consolidation::clusterLearned(categories).size();
+    }
+
+    void rephrasingsMerge()
+    {
+        vector<LearnedCategory> categories = {
+            learned("* HOW DO BLACK HOLES FORM", 0.8, "Stars collapse."),
+            learned("HOW DOES A BLACK HOLE FORM", 0.9, "Gravity wins."),
+            learned("WHAT IS THE CAPITAL OF FRANCE", 0.7, "Paris."),
+        };
+        size_t merged = 0;
+        vector<LearnedCategory> out = consolidation::clusterLearned(categories, &merged);
+        CHECK_EQ(out.size(), (size_t)2);
+        CHECK_EQ(merged, (size_t)1);
+        if (out.size() == 2) {
+            // Led by the most confident pattern, templates in confidence order.
+            CHECK_EQ(out[0].pattern, string("HOW DOES A BLACK HOLE FORM"));
+            CHECK_EQ(out[0].templates.size(), (size_t)2);
+            CHECK_EQ(out[0].templates[0], string("Gravity wins."));
+            CHECK_EQ(out[0].templates[1], string("Stars collapse."));
+        }
+    }
+
+    void wildcardPositionKeepsApart()
+    {
+        CHECK_EQ(clusters({"MY NAME IS *", "* IS MY NAME"}), (size_t)2);
+        CHECK_EQ(clusters({"I LIKE * MUSIC", "I LIKE MUSIC *"}), (size_t)2);
+        CHECK_EQ(clusters({"I LIKE * MUSIC", "I LIKE * MUSIC"}), (size_t)1);
+    }
+
+    void wordOrderKeepsApart()
+    {
+        CHECK_EQ(clusters({"DOG BITES MAN ON THE STREET", "MAN BITES DOG ON THE STREET"}),
+                 (size_t)2);
+    }
+
+    void negationKeepsApart()
+    {
+        CHECK_EQ(clusters({"WHY IS THE SKY BLUE AT NOON", "WHY IS THE SKY NOT BLUE AT NOON"}),
+                 (size_t)2);
+    }
+
+    void wildcardsAloneNeverMerge()
+    {
+        CHECK_EQ(clusters({"*", "* *", "_ THE *"}), (size_t)3);
+    }
+
+    void patternSignatureKeepsWildcards()
+    {
+        llm_cache::Signature a, b;
+        CHECK(llm_cache::makePatternSignature("learned", "MY NAME IS *", a));
+        CHECK(llm_cache::makePatternSignature("learned", "* IS MY NAME", b));
+        CHECK_EQ(a.sequence.size(), (size_t)3);
+        if (a.sequence.size() == 3)
+            CHECK_EQ(a.sequence[2], string("*"));
+        CHECK(a.key != b.key);
+        CHECK(!llm_cache::makePatternSignature("learned", "* THE _", a));
+
+        // Inputs drop the wildcards, as the reply cache always did.
+        CHECK(llm_cache::makeSignature("learned", "MY NAME IS *", a));
+        CHECK_EQ(a.sequence.size(), (size_t)2);
+    }
+
+} // namespace
+
+int main()
+{
+    RUN(rephrasingsMerge);
+    RUN(wildcardPositionKeepsApart);
+    RUN(wordOrderKeepsApart);
+    RUN(negationKeepsApart);
+    RUN(wildcardsAloneNeverMerge);
+    RUN(patternSignatureKeepsWildcards);
+    return check::result("consolidation_test");
+}
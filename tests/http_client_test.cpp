@@ -0,0 +1,331 @@
+// HttpClient against a local stub server through the pluggable transport:
+// response framing (Content-Length, chunked, read to close), keep-alive
+// reuse and the stale-connection retry, timeouts, and a TLS server that
+// closes without close_notify.
+
+#include "check.h"
+#include "stub_server.h"
+#include "http_client.h"
+#ifdef CHATMACHINE_WITH_OPENSSL
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+#include <openssl/pem.h>
+#endif
+
+using namespace std;
+using namespace stub_server;
+using namespace http_client;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    HttpClientConfig quickConfig()
+    {
+        HttpClientConfig config;
+        config.connectTimeoutMs = 1000;
+        config.requestTimeoutMs = 3000;
+        return config;
+    }
+
+    void contentLengthKeepAlive()
+    {
+        StubServer stub;
+        auto transport = make_shared<CountingTransport>();
+        HttpClient http(quickConfig(), transport);
+        stub.push(fixedReply("{\"n\":1}"));
+        stub.push(fixedReply("{\"n\":2}"));
+
+        HttpResponse first = http.post(stub.url("/a"), "", "one");
+        HttpResponse second = http.post(stub.url("/b"), "", "two");
+        CHECK(first.success);
+        CHECK(second.success);
+        CHECK_EQ(first.body, string("{\"n\":1}"));
+        CHECK_EQ(second.body, string("{\"n\":2}"));
+        CHECK_EQ(transport->connects(), (size_t)1);
+
+        HttpClientStats st = http.getStats();
+        CHECK_EQ(st.connectionsOpened, (size_t)1);
+        CHECK_EQ(st.connectionsReused, (size_t)1);
+        CHECK_EQ(st.idle, (size_t)1);
+
+        vector<string> received = stub.received();
+        CHECK_EQ(received.size(), (size_t)2);
+        if (received.size() == 2) {
+            CHECK(received[1].find("POST /b HTTP/1.1\r\n") == 0);
+            CHECK(received[1].find("Content-Length: 3\r\n") != string::npos);
+            CHECK(received[1].substr(received[1].size() - 3) == "two");
+        }
+    }
+
+    void chunkedSplitAnywhere()
+    {
+        StubServer stub;
+        HttpClient http(quickConfig(), make_shared<CountingTransport>());
+        // Split inside the status line, a chunk-size line, a CRLF and data.
+        string whole = chunkedHead("text/plain") + chunk("Hello, ") + chunk("chunked world") +
+                       lastChunk();
+        Reply r;
+        r.gapMs = 5;
+        size_t cuts[] = {7, 30, 61, 66, 75, whole.size()};
+        size_t from = 0;
+        for (size_t cut : cuts) {
+            r.pieces.push_back(whole.substr(from, cut - from));
+            from = cut;
+        }
+        stub.push(r);
+
+        HttpResponse response = http.request("GET", stub.url("/"), "", "");
+        CHECK(response.success);
+        CHECK_EQ(response.body, string("Hello, chunked world"));
+        CHECK_EQ(http.getStats().idle, (size_t)1);
+    }
+
+    void readToClose()
+    {
+        StubServer stub;
+        auto transport = make_shared<CountingTransport>();
+        HttpClient http(quickConfig(), transport);
+        Reply r;
+        r.pieces.push_back("HTTP/1.1 200 OK\r\nConnection: close\r\n\r\nno length, ");
+        r.pieces.push_back("ends at close");
+        r.gapMs = 10;
+        r.close = true;
+        stub.push(r);
+        stub.push(fixedReply("next"));
+
+        HttpResponse response = http.post(stub.url("/"), "", "");
+        CHECK(response.success);
+        CHECK_EQ(response.body, string("no length, ends at close"));
+        CHECK(response.error.empty());
+        CHECK_EQ(http.getStats().idle, (size_t)0);
+
+        // Not pooled, so the next request connects afresh.
+        CHECK_EQ(http.post(stub.url("/"), "", "").body, string("next"));
+        CHECK_EQ(transport->connects(), (size_t)2);
+    }
+
+    void truncatedBodyFails()
+    {
+        StubServer stub;
+        HttpClient http(quickConfig(), make_shared<CountingTransport>());
+        Reply r;
+        r.pieces.push_back("HTTP/1.1 200 OK\r\nContent-Length: 50\r\n\r\nonly ten b");
+        r.close = true;
+        stub.push(r);
+
+        HttpResponse response = http.post(stub.url("/"), "", "");
+        CHECK(!response.success);
+        CHECK_EQ(response.error, string("connection closed"));
+        CHECK_EQ(http.getStats().failures, (size_t)1);
+    }
+
+    void staleConnectionRetried()
+    {
+        StubServer stub;
+        auto transport = make_shared<CountingTransport>();
+        HttpClient http(quickConfig(), transport);
+        // Keep-alive as far as the client knows, but the server hangs up.
+        Reply r = fixedReply("first");
+        r.close = true;
+        stub.push(r);
+        stub.push(fixedReply("second"));
+
+        CHECK_EQ(http.post(stub.url("/"), "", "").body, string("first"));
+        this_thread::sleep_for(chrono::milliseconds(50));
+        HttpResponse response = http.post(stub.url("/"), "", "");
+        CHECK(response.success);
+        CHECK_EQ(response.body, string("second"));
+        CHECK_EQ(http.getStats().retries, (size_t)1);
+        CHECK_EQ(transport->connects(), (size_t)2);
+    }
+
+    void errorStatusKeepsBody()
+    {
+        StubServer stub;
+        HttpClient http(quickConfig(), make_shared<CountingTransport>());
+        stub.push(fixedReply("{\"error\":\"nope\"}", 404));
+
+        string streamed;
+        HttpResponse response = http.postStreaming(stub.url("/"), "", "",
+            [&](const char* data, size_t size) { streamed.append(data, size); return true; });
+        CHECK(!response.success);
+        CHECK_EQ(response.statusCode, 404);
+        CHECK_EQ(response.body, string("{\"error\":\"nope\"}"));
+        CHECK(streamed.empty());
+    }
+
+    void slowServerTimesOut()
+    {
+        StubServer stub;
+        HttpClientConfig config = quickConfig();
+        config.requestTimeoutMs = 300;
+        HttpClient http(config, make_shared<CountingTransport>());
+        Reply r;
+        r.pieces.push_back("HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n");
+        r.pieces.push_back("late");
+        r.gapMs = 2000;
+        stub.push(r);
+
+        Clock::time_point start = Clock::now();
+        HttpResponse response = http.post(stub.url("/"), "", "");
+        double ms = chrono::duration<double, milli>(Clock::now() - start).count();
+        CHECK(!response.success);
+        CHECK_EQ(response.error, string("timed out"));
+        CHECK(ms < 1000.0);
+    }
+
+    void unusableUrls()
+    {
+        HttpClient http(quickConfig(), make_shared<CountingTransport>());
+        HttpResponse response = http.post("ftp://example.com/", "", "");
+        CHECK(!response.success);
+        CHECK(response.error.find("invalid URL") == 0);
+
+        Url url;
+        CHECK(parseUrl("http://[::1]:8080/v1", url));
+        CHECK_EQ(url.host, string("::1"));
+        CHECK_EQ(url.port, 8080);
+        CHECK_EQ(url.path, string("/v1"));
+    }
+
+#ifdef CHATMACHINE_WITH_OPENSSL
+    // A one-shot TLS server for localhost with a throwaway self-signed
+    // certificate, trusted by the client through SSL_CERT_FILE.  Every
+    // connection gets reply and is then closed without close_notify, as
+    // many servers do after Connection: close.
+    class TlsStub {
+    public:
+        TlsStub() : m_ctx(nullptr), m_stopping(false)
+        {
+            EVP_PKEY* key = nullptr;
+            EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+            EVP_PKEY_keygen_init(kctx);
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1);
+            EVP_PKEY_keygen(kctx, &key);
+            EVP_PKEY_CTX_free(kctx);
+
+            X509* cert = X509_new();
+            X509_set_version(cert, 2);
+            ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+            X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+            X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+            X509_set_pubkey(cert, key);
+            X509_NAME* name = X509_get_subject_name(cert);
+            X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                       (const unsigned char*)"localhost", -1, -1, 0);
+            X509_set_issuer_name(cert, name);
+            X509_EXTENSION* san = X509V3_EXT_conf_nid(nullptr, nullptr, NID_subject_alt_name,
+                                                      (char*)"DNS:localhost");
+            X509_add_ext(cert, san, -1);
+            X509_EXTENSION_free(san);
+            X509_sign(cert, key, EVP_sha256());
+
+            m_certPath = "/tmp/chatmachine_test_cert." + to_string((long long)getpid()) + ".pem";
+            FILE* f = fopen(m_certPath.c_str(), "w");
+            PEM_write_X509(f, cert);
+            fclose(f);
+            setenv("SSL_CERT_FILE", m_certPath.c_str(), 1);
+
+            m_ctx = SSL_CTX_new(TLS_server_method());
+            SSL_CTX_use_certificate(m_ctx, cert);
+            SSL_CTX_use_PrivateKey(m_ctx, key);
+            X509_free(cert);
+            EVP_PKEY_free(key);
+
+            m_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t len = sizeof(addr);
+            bind(m_fd, (sockaddr*)&addr, sizeof(addr));
+            listen(m_fd, 4);
+            getsockname(m_fd, (sockaddr*)&addr, &len);
+            m_port = ntohs(addr.sin_port);
+            m_thread = thread(&TlsStub::serve, this);
+        }
+
+        ~TlsStub()
+        {
+            m_stopping = true;
+            m_thread.join();
+            close(m_fd);
+            SSL_CTX_free(m_ctx);
+            remove(m_certPath.c_str());
+        }
+
+        void setReply(const string& reply) { m_reply = reply; }
+        string url() const { return "https://localhost:" + to_string(m_port) + "/"; }
+
+    private:
+        SSL_CTX*     m_ctx;
+        int          m_fd;
+        int          m_port;
+        string       m_certPath;
+        string       m_reply;
+        atomic<bool> m_stopping;
+        thread       m_thread;
+
+        void serve()
+        {
+            while (!m_stopping) {
+                pollfd pfd = {m_fd, POLLIN, 0};
+                if (poll(&pfd, 1, 20) <= 0) continue;
+                int fd = accept(m_fd, nullptr, nullptr);
+                if (fd < 0) continue;
+                SSL* ssl = SSL_new(m_ctx);
+                SSL_set_fd(ssl, fd);
+                if (SSL_accept(ssl) == 1) {
+                    string request;
+                    char buffer[4096];
+                    while (request.find("\r\n\r\n") == string::npos) {
+                        int n = SSL_read(ssl, buffer, sizeof(buffer));
+                        if (n <= 0) break;
+                        request.append(buffer, (size_t)n);
+                    }
+                    SSL_write(ssl, m_reply.data(), (int)m_reply.size());
+                }
+                SSL_free(ssl);    // no SSL_shutdown(): no close_notify
+                close(fd);
+            }
+        }
+    };
+
+    void tlsCloseWithoutNotify()
+    {
+        TlsStub tls;
+        HttpClient http(quickConfig(), make_shared<CountingTransport>());
+
+        tls.setReply("HTTP/1.1 200 OK\r\nConnection: close\r\n\r\nread to the end");
+        HttpResponse response = http.post(tls.url(), "", "");
+        CHECK(response.success);
+        CHECK_EQ(response.body, string("read to the end"));
+        CHECK(response.error.empty());
+
+        // A framed body cut short is still an error.
+        tls.setReply("HTTP/1.1 200 OK\r\nContent-Length: 40\r\n\r\ncut short");
+        response = http.post(tls.url(), "", "");
+        CHECK(!response.success);
+        CHECK_EQ(response.error, string("connection closed"));
+    }
+#endif
+
+} // namespace
+
+int main()
+{
+    RUN(contentLengthKeepAlive);
+    RUN(chunkedSplitAnywhere);
+    RUN(readToClose);
+    RUN(truncatedBodyFails);
+    RUN(staleConnectionRetried);
+    RUN(errorStatusKeepsBody);
+    RUN(slowServerTimesOut);
+    RUN(unusableUrls);
+#ifdef CHATMACHINE_WITH_OPENSSL
+    RUN(tlsCloseWithoutNotify);
+#endif
+    return check::result("http_client_test");
+}
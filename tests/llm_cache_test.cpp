@@ -0,0 +1,194 @@
+// LlmCache (llm_cache.h): exact and near-duplicate hits, the negation
+// guard, word order, conversation scopes and excluded replies, expiry,
+// LRU trimming and the save/load round trip.
+
+#include "check.h"
+#include "llm_cache.h"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using llm_cache::LlmCache;
+
+namespace {
+
+    const string SCOPE = "constrained:gpt-4o";
+
+    string lookup(LlmCache& cache, const string& input,
+                  const string& scope = SCOPE,
+                  const vector<string>& exclude = vector<string>())
+    {
+        string reply;
+        return cache.lookup(scope, input, reply, exclude) ? reply : string("<miss>");
+    }
+
+    void exactAndNearHits()
+    {
+        LlmCache cache;
+        cache.insert(SCOPE, "what is a black hole", "A collapsed star.", 900.0);
+
+        CHECK_EQ(lookup(cache, "What is a black hole?"), string("A collapsed star."));
+        CHECK_EQ(lookup(cache, "can you please tell me what a black hole is"),
+                 string("A collapsed star."));
+        // Plural folded; "are" is filler.
+        CHECK_EQ(lookup(cache, "what are black holes"), string("A collapsed star."));
+        CHECK_EQ(lookup(cache, "what is a white dwarf"), string("<miss>"));
+        CHECK_EQ(lookup(cache, "please"), string("<miss>"));   // no content words
+
+        llm_cache::LlmCacheStats st = cache.getStats();
+        CHECK_EQ(st.hits, (size_t)3);
+        CHECK_EQ(st.misses, (size_t)2);
+        CHECK_EQ(st.entries, (size_t)1);
+        CHECK(st.msSaved > 2000.0);
+    }
+
+    void nearHitNeedsMostWords()
+    {
+        LlmCache cache;
+        cache.insert(SCOPE, "how far away is the moon from earth", "About 384,000 km.", 1.0);
+
+        // {how, far, away, moon, from, earth} vs one word more: 6/7 >= 0.8.
+        CHECK_EQ(lookup(cache, "how far away is the moon from the earth today"),
+                 string("About 384,000 km."));
+        CHECK_EQ(cache.getStats().nearHits, (size_t)1);
+        // Half the words differ.
+        CHECK_EQ(lookup(cache, "how far away is mars"), string("<miss>"));
+    }
+
+    void negationGuard()
+    {
+        LlmCache cache;
+        cache.insert(SCOPE, "why is the sky blue at noon", "Rayleigh scattering.", 1.0);
+        CHECK_EQ(lookup(cache, "why is the sky not blue at noon"), string("<miss>"));
+
+        cache.insert(SCOPE, "why do cats never sleep at night", "They do.", 1.0);
+        CHECK_EQ(lookup(cache, "why do cats sleep at night"), string("<miss>"));
+        CHECK_EQ(lookup(cache, "why do cats never sleep at night"), string("They do."));
+    }
+
+    void wordOrderInExactKey()
+    {
+        llm_cache::Signature a, b;
+        CHECK(llm_cache::makeSignature(SCOPE, "dog bites man", a));
+        CHECK(llm_cache::makeSignature(SCOPE, "man bites dog", b));
+        CHECK(a.key != b.key);
+        CHECK(a.words == b.words);
+
+        llm_cache::Signature c;
+        CHECK(llm_cache::makeSignature(SCOPE, "Dog, bites... MAN!", c));
+        CHECK_EQ(a.key, c.key);
+    }
+
+    void scopesKeepConversationsApart()
+    {
+        vector<string> history = {"hello", "Hi there!"};
+        string first  = llm_cache::conversationScope(SCOPE, "Be brief.", vector<string>());
+        string later  = llm_cache::conversationScope(SCOPE, "Be brief.", history);
+        string prompt = llm_cache::conversationScope(SCOPE, "Be verbose.", history);
+        CHECK(first != later);
+        CHECK(later != prompt);
+        CHECK_EQ(later, llm_cache::conversationScope(SCOPE, "Be brief.", history));
+
+        // Only the latest LLM_CACHE_HISTORY entries count.
+        vector<string> longer(1, "long forgotten");
+        for (size_t i = 0; i < llm_cache::LLM_CACHE_HISTORY; ++i)
+            longer.push_back("turn " + to_string(i));
+        vector<string> tail(longer.begin() + 1, longer.end());
+        CHECK_EQ(llm_cache::conversationScope(SCOPE, "", longer),
+                 llm_cache::conversationScope(SCOPE, "", tail));
+
+        LlmCache cache;
+        cache.insert(later, "tell me a joke", "Knock knock.", 1.0);
+        CHECK_EQ(lookup(cache, "tell me a joke", later), string("Knock knock."));
+        CHECK_EQ(lookup(cache, "tell me a joke", first), string("<miss>"));
+        CHECK_EQ(lookup(cache, "tell me a joke", prompt), string("<miss>"));
+    }
+
+    void excludedReplyIsAMiss()
+    {
+        LlmCache cache;
+        cache.insert(SCOPE, "tell me a joke", "Knock knock.", 1.0);
+        vector<string> recent = {"tell me a joke", "Knock knock."};
+        CHECK_EQ(lookup(cache, "tell me a joke", SCOPE, recent), string("<miss>"));
+        CHECK_EQ(lookup(cache, "tell me a funny joke", SCOPE, recent), string("<miss>"));
+        CHECK_EQ(lookup(cache, "tell me a joke"), string("Knock knock."));
+    }
+
+    void entriesExpire()
+    {
+        LlmCache cache(16, 1);
+        cache.insert(SCOPE, "what time is it", "Noon.", 1.0);
+        CHECK_EQ(lookup(cache, "what time is it"), string("Noon."));
+        this_thread::sleep_for(chrono::milliseconds(1100));
+        CHECK_EQ(lookup(cache, "what time is it"), string("<miss>"));
+        CHECK_EQ(cache.getStats().expired, (size_t)1);
+        CHECK_EQ(cache.getStats().entries, (size_t)0);
+    }
+
+    void leastRecentlyUsedGoesFirst()
+    {
+        LlmCache cache(2, 3600);
+        cache.insert(SCOPE, "first question", "one", 1.0);
+        cache.insert(SCOPE, "second question", "two", 1.0);
+        CHECK_EQ(lookup(cache, "first question"), string("one"));   // now most recent
+        cache.insert(SCOPE, "third question", "three", 1.0);
+
+        CHECK_EQ(lookup(cache, "second question"), string("<miss>"));
+        CHECK_EQ(lookup(cache, "first question"), string("one"));
+        CHECK_EQ(lookup(cache, "third question"), string("three"));
+        CHECK_EQ(cache.getStats().evictions, (size_t)1);
+
+        // Shrinking evicts at once; capacity 0 disables.
+        cache.configure(1, 3600);
+        CHECK_EQ(cache.getStats().entries, (size_t)1);
+        cache.configure(0, 3600);
+        CHECK(!cache.enabled());
+        cache.insert(SCOPE, "fourth question", "four", 1.0);
+        CHECK_EQ(lookup(cache, "fourth question"), string("<miss>"));
+    }
+
+    void saveLoadRoundTrip()
+    {
+        const string path = "/tmp/llm_cache_test." + to_string(getpid()) + ".bin";
+        {
+            LlmCache cache;
+            cache.insert(SCOPE, "dog bites man", "Not news.", 5.0);
+            cache.insert("contextual:gpt-4o", "what is a black hole", "A collapsed star.", 5.0);
+            CHECK_EQ(cache.unsaved(), (size_t)2);
+            CHECK(cache.save(path));
+            CHECK_EQ(cache.unsaved(), (size_t)0);
+        }
+
+        LlmCache loaded;
+        CHECK(loaded.load(path));
+        CHECK_EQ(loaded.getStats().entries, (size_t)2);
+        CHECK_EQ(lookup(loaded, "dog bites man"), string("Not news."));
+        // Word order survives the round trip: this is only a near hit.
+        CHECK_EQ(lookup(loaded, "man bites dog"), string("Not news."));
+        CHECK_EQ(loaded.getStats().nearHits, (size_t)1);
+        CHECK_EQ(lookup(loaded, "what are black holes", "contextual:gpt-4o"),
+                 string("A collapsed star."));
+        CHECK_EQ(lookup(loaded, "what are black holes"), string("<miss>"));
+        remove(path.c_str());
+
+        CHECK(!loaded.load(path));
+        CHECK_EQ(loaded.getStats().entries, (size_t)0);
+    }
+
+} // namespace
+
+int main()
+{
+    RUN(exactAndNearHits);
+    RUN(nearHitNeedsMostWords);
+    RUN(negationGuard);
+    RUN(wordOrderInExactKey);
+    RUN(scopesKeepConversationsApart);
+    RUN(excludedReplyIsAMiss);
+    RUN(entriesExpire);
+    RUN(leastRecentlyUsedGoesFirst);
+    RUN(saveLoadRoundTrip);
+    return check::result("llm_cache_test");
+}
@@ -0,0 +1,173 @@
+// Speculative GPT-4o requests (ChatGPT4oIntegration::submitConstrained)
+// against a local stub server: the reply streams into LlmRequest while the
+// caller does other work, and an abandoned request stops promptly.
+
+#include "check.h"
+#include "stub_server.h"
+#include "chatgpt4o.h"
+#include "json.h"
+#include <cstdlib>
+
+using namespace std;
+using namespace stub_server;
+using chatgpt4o::ChatGPT4oIntegration;
+using chatgpt4o::LlmRequest;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    string delta(const string& text)
+    {
+        return "data: {\"choices\":[{\"delta\":{\"content\":" + json::quote(text) + "}}]}\n\n";
+    }
+
+    // A streamed completion, one chunk per event, gapMs apart.
+    Reply stream(const vector<string>& words, int gapMs)
+    {
+        Reply r;
+        r.gapMs = gapMs;
+        r.pieces.push_back(chunkedHead());
+        for (const string& w : words)
+            r.pieces.push_back(chunk(delta(w)));
+        r.pieces.push_back(chunk("data: [DONE]\n\n") + lastChunk());
+        return r;
+    }
+
+    unique_ptr<ChatGPT4oIntegration> client(StubServer& stub, shared_ptr<CountingTransport> transport)
+    {
+        unique_ptr<ChatGPT4oIntegration> c(new ChatGPT4oIntegration());
+        c->setApiKey("test-key");
+        c->setEndpoint(stub.url("/v1/chat/completions"));
+        c->setTransport(transport);
+        c->setTimeouts(1000, 10000);
+        admission_control::AdmissionConfig admission;
+        admission.ratePerSecond   = 1000.0;
+        admission.burst           = 1000.0;
+        admission.breakerFailures = 1000;
+        c->setAdmission(admission);
+        return c;
+    }
+
+    double msSince(Clock::time_point t)
+    {
+        return chrono::duration<double, milli>(Clock::now() - t).count();
+    }
+
+    void replyStreamsIntoHandle()
+    {
+        StubServer stub;
+        auto transport = make_shared<CountingTransport>();
+        auto c = client(stub, transport);
+        stub.push(stream({"Hello ", "there ", "friend"}, 20));
+
+        LlmRequest request = c->submitConstrained("HELLO", vector<string>(), "Be brief.");
+        CHECK(request.valid());
+        string pieces;
+        string reply = request.get([&](const string& text) { pieces += text; return true; });
+        CHECK_EQ(reply, string("Hello there friend"));
+        CHECK_EQ(pieces, reply);
+
+        vector<string> received = stub.received();
+        CHECK_EQ(received.size(), (size_t)1);
+        if (!received.empty()) {
+            CHECK(received[0].find("POST /v1/chat/completions HTTP/1.1") == 0);
+            CHECK(received[0].find("Authorization: Bearer test-key") != string::npos);
+            CHECK(received[0].find("\"stream\":true") != string::npos);
+            CHECK(received[0].find("Be brief.") != string::npos);
+        }
+        chatgpt4o::LlmAsyncStats st = c->getAsyncStats();
+        CHECK_EQ(st.submitted, (size_t)1);
+        CHECK_EQ(st.completed, (size_t)1);
+        CHECK_EQ(st.cancelled, (size_t)0);
+    }
+
+    void requestsReuseConnection()
+    {
+        StubServer stub;
+        auto transport = make_shared<CountingTransport>();
+        auto c = client(stub, transport);
+        stub.push(stream({"one"}, 0));
+        stub.push(stream({"two"}, 0));
+
+        CHECK_EQ(c->submitConstrained("FIRST", vector<string>(), "").get(), string("one"));
+        CHECK_EQ(c->submitConstrained("SECOND", vector<string>(), "").get(), string("two"));
+        CHECK_EQ(transport->connects(), (size_t)1);
+        CHECK_EQ(stub.connections(), (size_t)1);
+    }
+
+    void cancelStopsStalledRequest()
+    {
+        StubServer stub;
+        auto transport = make_shared<CountingTransport>();
+        auto c = client(stub, transport);
+        // First word at once, then the server stalls.
+        stub.push(stream({"Partial ", "reply"}, 3000));
+
+        LlmRequest request = c->submitConstrained("STALL", vector<string>(), "");
+        CHECK(!request.waitUntil(Clock::now() + chrono::milliseconds(200)));
+        CHECK(!request.ready());
+
+        Clock::time_point cancelled = Clock::now();
+        request.cancel();
+        CHECK_EQ(request.get(), string());
+        CHECK(msSince(cancelled) < 1000.0);
+
+        chatgpt4o::LlmAsyncStats st = c->getAsyncStats();
+        CHECK_EQ(st.cancelled, (size_t)1);
+        CHECK_EQ(st.completed, (size_t)0);
+    }
+
+    void identicalRequestsShareOneUpstream()
+    {
+        StubServer stub;
+        auto transport = make_shared<CountingTransport>();
+        auto c = client(stub, transport);
+        stub.push(stream({"Shared ", "reply"}, 100));
+
+        vector<string> history = {"HELLO", "Hi there!"};
+        LlmRequest first  = c->submitConstrained("WHAT IS NEW", history, "Be brief.");
+        LlmRequest second = c->submitConstrained("WHAT IS NEW", history, "Be brief.");
+        CHECK_EQ(first.get(), string("Shared reply"));
+        CHECK_EQ(second.get(), string("Shared reply"));
+        CHECK_EQ(stub.received().size(), (size_t)1);
+        CHECK_EQ(c->getAdmissionStats().coalesced, (size_t)1);
+
+        // Same input in other conversations: requests of their own.
+        stub.push(stream({"One"}, 100));
+        stub.push(stream({"Two"}, 100));
+        LlmRequest other = c->submitConstrained("WHAT IS NEW", {"HI", "Hello!"}, "Be brief.");
+        LlmRequest terse = c->submitConstrained("WHAT IS NEW", history, "Be terse.");
+        string a = other.get(), b = terse.get();
+        CHECK(!a.empty() && !b.empty() && a != b);
+        CHECK_EQ(stub.received().size(), (size_t)3);
+        CHECK_EQ(c->getAdmissionStats().coalesced, (size_t)1);
+    }
+
+    void httpErrorGivesEmptyReply()
+    {
+        StubServer stub;
+        auto transport = make_shared<CountingTransport>();
+        auto c = client(stub, transport);
+        stub.push(fixedReply("{\"error\":{\"message\":\"overloaded\"}}", 503));
+
+        CHECK_EQ(c->submitConstrained("BUSY", vector<string>(), "").get(), string());
+        CHECK(c->getLastError().find("HTTP 503") != string::npos);
+        CHECK_EQ(c->getAsyncStats().completed, (size_t)0);
+    }
+
+} // namespace
+
+int main()
+{
+    // Talk to the stub, not the canned simulation.
+    unsetenv("CHATGPT4O_SIMULATE");
+    unsetenv("CHATGPT4O_MOCK_LATENCY_MS");
+
+    RUN(replyStreamsIntoHandle);
+    RUN(requestsReuseConnection);
+    RUN(cancelStopsStalledRequest);
+    RUN(identicalRequestsShareOneUpstream);
+    RUN(httpErrorGivesEmptyReply);
+    return check::result("speculation_test");
+}
@@ -0,0 +1,240 @@
+// Streamed GPT-4o replies: SseDecoder fed in every possible split, and
+// ChatGPT4oIntegration's streaming client against a local plain-HTTP SSE
+// stub — events split across chunks and writes, the closing [DONE], and a
+// server that goes away mid-stream.
+
+#include "check.h"
+#include "stub_server.h"
+#include "http_client.h"
+#include "chatgpt4o.h"
+#include "json.h"
+#include <cstdlib>
+
+using namespace std;
+using namespace stub_server;
+using chatgpt4o::ChatGPT4oIntegration;
+
+namespace {
+
+    string delta(const string& text)
+    {
+        return "data: {\"choices\":[{\"delta\":{\"content\":" + json::quote(text) + "}}]}\n\n";
+    }
+
+    const char* const DONE = "data: [DONE]\n\n";
+
+    // Events as "type|data" strings.
+    vector<string> decode(const vector<string>& pieces)
+    {
+        vector<string> events;
+        http_client::SseDecoder sse([&](const string& event, const string& data) {
+            events.push_back(event + "|" + data);
+            return true;
+        });
+        for (const string& p : pieces)
+            sse.feed(p.data(), p.size());
+        return events;
+    }
+
+    void decoderSplitAnywhere()
+    {
+        // LF, CRLF and bare CR line ends; a comment; a multi-line event;
+        // fields without the space after the colon.
+        string stream = ": keep-alive\n"
+                        "data: one\n\n"
+                        "event: note\r\ndata: two\r\ndata:  three\r\n\r\n"
+                        "id: 7\rdata:four\r\r"
+                        "data: [DONE]\n\n";
+        vector<string> expected = {"message|one", "note|two\n three", "message|four",
+                                   "message|[DONE]"};
+        CHECK(decode({stream}) == expected);
+
+        for (size_t cut = 1; cut < stream.size(); ++cut) {
+            vector<string> events = decode({stream.substr(0, cut), stream.substr(cut)});
+            if (events != expected) {
+                check::fail(__FILE__, __LINE__, "split at " + to_string(cut));
+                break;
+            }
+        }
+        vector<string> bytes;
+        for (char c : stream)
+            bytes.push_back(string(1, c));
+        CHECK(decode(bytes) == expected);
+
+        // An event only ends at its blank line.
+        CHECK(decode({"data: unfinished\n"}).empty());
+    }
+
+    void decoderStops()
+    {
+        size_t seen = 0;
+        http_client::SseDecoder sse([&](const string&, const string&) { return ++seen < 2; });
+        string stream = "data: a\n\ndata: b\n\ndata: c\n\n";
+        CHECK(!sse.feed(stream.data(), stream.size()));
+        CHECK_EQ(seen, (size_t)2);
+        CHECK(!sse.feed("data: d\n\n", 9));
+        CHECK_EQ(seen, (size_t)2);
+    }
+
+    unique_ptr<ChatGPT4oIntegration> client(StubServer& stub)
+    {
+        unique_ptr<ChatGPT4oIntegration> c(new ChatGPT4oIntegration());
+        c->setApiKey("test-key");
+        c->setEndpoint(stub.url("/v1/chat/completions"));
+        c->setTransport(make_shared<CountingTransport>());
+        c->setTimeouts(1000, 5000);
+        admission_control::AdmissionConfig admission;
+        admission.ratePerSecond   = 1000.0;
+        admission.burst           = 1000.0;
+        admission.breakerFailures = 1000;
+        c->setAdmission(admission);
+        return c;
+    }
+
+    // Stream reply text to a collector; the reply and what was delivered.
+    struct Streamed {
+        string reply;
+        string delivered;
+        size_t pieces;
+        chatgpt4o::StreamTiming timing;
+    };
+
+    Streamed streamFrom(ChatGPT4oIntegration& c, const string& input)
+    {
+        Streamed s;
+        s.pieces = 0;
+        s.reply = c.streamContextualResponse(input, vector<string>(),
+            [&](const string& text) { s.delivered += text; s.pieces++; return true; },
+            &s.timing);
+        return s;
+    }
+
+    void eventsSplitAcrossChunks()
+    {
+        StubServer stub;
+        auto c = client(stub);
+        // The event text cut mid-JSON and mid-line, in chunks that do not
+        // line up with the writes either.
+        string events = delta("Hello") + delta(", ") + delta("world") + DONE;
+        vector<string> body = {events.substr(0, 20), events.substr(20, 41),
+                               events.substr(61, 3), events.substr(64)};
+        Reply r;
+        r.gapMs = 10;
+        string head = chunkedHead();
+        r.pieces.push_back(head + chunk(body[0]).substr(0, 4));
+        r.pieces.push_back(chunk(body[0]).substr(4) + chunk(body[1]));
+        r.pieces.push_back(chunk(body[2]) + chunk(body[3]).substr(0, 9));
+        r.pieces.push_back(chunk(body[3]).substr(9) + lastChunk());
+        stub.push(r);
+
+        Streamed s = streamFrom(*c, "HELLO");
+        CHECK_EQ(s.reply, string("Hello, world"));
+        CHECK_EQ(s.delivered, s.reply);
+        CHECK_EQ(s.pieces, (size_t)3);
+        CHECK_EQ(s.timing.pieces, (size_t)3);
+        CHECK(s.timing.firstTokenMs >= 0.0);
+        CHECK(s.timing.firstTokenMs <= s.timing.totalMs);
+    }
+
+    void readToCloseStream()
+    {
+        StubServer stub;
+        auto c = client(stub);
+        Reply r;
+        r.pieces.push_back("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                           "Connection: close\r\n\r\n" + delta("Read "));
+        r.pieces.push_back(delta("to close") + DONE);
+        r.gapMs = 10;
+        r.close = true;
+        stub.push(r);
+
+        Streamed s = streamFrom(*c, "CLOSE");
+        CHECK_EQ(s.reply, string("Read to close"));
+        CHECK_EQ(s.delivered, s.reply);
+    }
+
+    void disconnectMidStream()
+    {
+        StubServer stub;
+        auto c = client(stub);
+
+        // Chunked: the terminating chunk never comes.
+        Reply chunked;
+        chunked.pieces.push_back(chunkedHead() + chunk(delta("Cut ")));
+        chunked.pieces.push_back(chunk(delta("off")));
+        chunked.gapMs = 10;
+        chunked.close = true;
+        stub.push(chunked);
+
+        Streamed s = streamFrom(*c, "DROP CHUNKED");
+        CHECK_EQ(s.reply, string());
+        CHECK_EQ(s.delivered, string("Cut off"));
+        CHECK(c->getLastError().find("connection closed") != string::npos);
+
+        // Read to close: only the missing [DONE] shows the cut.
+        Reply plain;
+        plain.pieces.push_back("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                               "Connection: close\r\n\r\n" + delta("Cut "));
+        plain.pieces.push_back(delta("again"));
+        plain.gapMs = 10;
+        plain.close = true;
+        stub.push(plain);
+
+        s = streamFrom(*c, "DROP PLAIN");
+        CHECK_EQ(s.reply, string());
+        CHECK_EQ(s.delivered, string("Cut again"));
+        CHECK(c->getLastError().find("[DONE]") != string::npos);
+
+        // The client recovers on a fresh connection.
+        Reply good;
+        good.pieces.push_back(chunkedHead() + chunk(delta("Back") + DONE) + lastChunk());
+        stub.push(good);
+        CHECK_EQ(streamFrom(*c, "AGAIN").reply, string("Back"));
+        CHECK_EQ(stub.connections(), (size_t)3);
+    }
+
+    void errorEventFails()
+    {
+        StubServer stub;
+        auto c = client(stub);
+        Reply r;
+        r.pieces.push_back(chunkedHead() + chunk(delta("Partial ")) +
+                           chunk("data: {\"error\":{\"message\":\"server overloaded\"}}\n\n") +
+                           chunk(DONE) + lastChunk());
+        stub.push(r);
+
+        Streamed s = streamFrom(*c, "OVERLOAD");
+        CHECK_EQ(s.reply, string());
+        CHECK(c->getLastError().find("server overloaded") != string::npos);
+    }
+
+    void plainCompletionFallback()
+    {
+        StubServer stub;
+        auto c = client(stub);
+        // An endpoint that ignores "stream": true.
+        stub.push(fixedReply("{\"choices\":[{\"message\":{\"role\":\"assistant\","
+                             "\"content\":\"Not streamed\"}}]}"));
+
+        Streamed s = streamFrom(*c, "PLAIN");
+        CHECK_EQ(s.reply, string("Not streamed"));
+        CHECK_EQ(s.delivered, s.reply);
+        CHECK_EQ(s.pieces, (size_t)1);
+    }
+
+} // namespace
+
+int main()
+{
+    unsetenv("CHATGPT4O_SIMULATE");
+    unsetenv("CHATGPT4O_MOCK_LATENCY_MS");
+
+    RUN(decoderSplitAnywhere);
+    RUN(decoderStops);
+    RUN(eventsSplitAcrossChunks);
+    RUN(readToCloseStream);
+    RUN(disconnectMidStream);
+    RUN(errorEventFails);
+    RUN(plainCompletionFallback);
+    return check::result("sse_stream_test");
+}
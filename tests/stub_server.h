@@ -0,0 +1,266 @@
+#ifndef __STUB_SERVER_H__
+#define __STUB_SERVER_H__
+
+/**
+ * stub_server.h — Scripted plain-HTTP server on 127.0.0.1 for client tests
+ *
+ * Listens on an ephemeral loopback port and answers each request it reads
+ * with the next queued Reply, written piece by piece (one send() each,
+ * with an optional pause between pieces) so a test controls exactly where
+ * the client sees the response split.  A reply can close the connection
+ * when it is done or drop it part-way, like a server going away
+ * mid-stream.  Connections are kept alive otherwise; each runs on its own
+ * thread, so a pooled idle connection never holds up the next one.
+ *
+ * A request with no reply queued gets a 500.
+ *
+ * CountingTransport plugs into HttpClient / ChatGPT4oIntegration through
+ * the Transport hook and counts the connections they open, so a test can
+ * tell a reused keep-alive connection from a new one.
+ */
+
+#include "http_client.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace stub_server {
+
+    struct Reply {
+        std::vector<std::string> pieces;   // sent in order, one send() each
+        int  gapMs;                        // pause before every piece but the first
+        bool close;                        // close the connection after the last piece
+
+        Reply() : gapMs(0), close(false) {}
+    };
+
+    // A whole response with Content-Length.
+    inline Reply fixedReply(const std::string& body, int status = 200,
+                            const std::string& contentType = "application/json")
+    {
+        Reply r;
+        r.pieces.push_back("HTTP/1.1 " + std::to_string(status) + " Stub\r\n"
+                           "Content-Type: " + contentType + "\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+        return r;
+    }
+
+    // Headers for a chunked response; the body pieces go through chunk().
+    inline std::string chunkedHead(const std::string& contentType = "text/event-stream")
+    {
+        return "HTTP/1.1 200 OK\r\nContent-Type: " + contentType +
+               "\r\nTransfer-Encoding: chunked\r\n\r\n";
+    }
+
+    inline std::string chunk(const std::string& data)
+    {
+        char size[32];
+        snprintf(size, sizeof(size), "%zx\r\n", data.size());
+        return size + data + "\r\n";
+    }
+
+    inline std::string lastChunk() { return "0\r\n\r\n"; }
+
+    // The socket transport, counting connects.
+    class CountingTransport : public http_client::Transport {
+    public:
+        CountingTransport() : m_connects(0) {}
+
+        std::unique_ptr<http_client::Connection> connect(const http_client::Url& url,
+                                                         std::chrono::steady_clock::time_point deadline,
+                                                         std::string& error)
+        {
+            m_connects++;
+            return m_socket.connect(url, deadline, error);
+        }
+
+        size_t connects() const { return m_connects.load(); }
+
+    private:
+        http_client::SocketTransport m_socket;
+        std::atomic<size_t>          m_connects;
+    };
+
+    class StubServer {
+    public:
+        StubServer() : m_fd(-1), m_port(0), m_stopping(false), m_connections(0), m_requests(0)
+        {
+            m_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            socklen_t len = sizeof(addr);
+            if (m_fd < 0 || bind(m_fd, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+                listen(m_fd, 16) != 0 || getsockname(m_fd, (sockaddr*)&addr, &len) != 0) {
+                perror("stub server");
+                exit(2);
+            }
+            m_port = ntohs(addr.sin_port);
+            m_acceptor = std::thread(&StubServer::acceptLoop, this);
+        }
+
+        ~StubServer()
+        {
+            m_stopping = true;
+            m_acceptor.join();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (int fd : m_open) shutdown(fd, SHUT_RDWR);
+            }
+            for (std::thread& t : m_handlers) t.join();
+            close(m_fd);
+        }
+
+        int port() const { return m_port; }
+        std::string url(const std::string& path) const
+        {
+            return "http://127.0.0.1:" + std::to_string(m_port) + path;
+        }
+
+        // Answer the next request with reply.
+        void push(const Reply& reply)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_replies.push_back(reply);
+        }
+
+        size_t connections() const { return m_connections.load(); }
+        size_t requests() const { return m_requests.load(); }
+
+        // Raw text (request line, headers and body) of every request so far.
+        std::vector<std::string> received() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_received;
+        }
+
+    private:
+        int               m_fd;
+        int               m_port;
+        std::atomic<bool> m_stopping;
+        std::atomic<size_t> m_connections;
+        std::atomic<size_t> m_requests;
+        std::thread       m_acceptor;
+        std::vector<std::thread> m_handlers;   // acceptor thread only
+
+        mutable std::mutex       m_mutex;
+        std::deque<Reply>        m_replies;
+        std::vector<std::string> m_received;
+        std::vector<int>         m_open;
+
+        void acceptLoop()
+        {
+            while (!m_stopping) {
+                pollfd pfd = {m_fd, POLLIN, 0};
+                if (poll(&pfd, 1, 20) <= 0) continue;
+                int fd = accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd < 0) continue;
+                m_connections++;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_open.push_back(fd);
+                }
+                m_handlers.push_back(std::thread(&StubServer::serve, this, fd));
+            }
+        }
+
+        void serve(int fd)
+        {
+            std::string buffer;
+            std::string request;
+            while (readRequest(fd, buffer, request)) {
+                m_requests++;
+                Reply reply;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_received.push_back(request);
+                    if (!m_replies.empty()) {
+                        reply = m_replies.front();
+                        m_replies.pop_front();
+                    } else {
+                        reply = fixedReply("no reply queued", 500, "text/plain");
+                    }
+                }
+                if (!send(fd, reply) || reply.close)
+                    break;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < m_open.size(); ++i)
+                if (m_open[i] == fd) { m_open.erase(m_open.begin() + i); break; }
+            close(fd);
+        }
+
+        // One request (headers and Content-Length body) into request.
+        bool readRequest(int fd, std::string& buffer, std::string& request)
+        {
+            size_t end;
+            while ((end = buffer.find("\r\n\r\n")) == std::string::npos)
+                if (!fill(fd, buffer)) return false;
+            size_t length = 0;
+            std::string head = buffer.substr(0, end);
+            for (char& c : head) c = (char)tolower((unsigned char)c);
+            size_t at = head.find("content-length:");
+            if (at != std::string::npos)
+                length = (size_t)atol(head.c_str() + at + 15);
+            while (buffer.size() < end + 4 + length)
+                if (!fill(fd, buffer)) return false;
+            request = buffer.substr(0, end + 4 + length);
+            buffer.erase(0, end + 4 + length);
+            return true;
+        }
+
+        bool fill(int fd, std::string& buffer)
+        {
+            char chunk[4096];
+            while (!m_stopping) {
+                pollfd pfd = {fd, POLLIN, 0};
+                if (poll(&pfd, 1, 20) <= 0) continue;
+                ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) return false;
+                buffer.append(chunk, (size_t)n);
+                return true;
+            }
+            return false;
+        }
+
+        bool send(int fd, const Reply& reply)
+        {
+            for (size_t i = 0; i < reply.pieces.size(); ++i) {
+                if (i > 0 && !pause(reply.gapMs)) return false;
+                const std::string& piece = reply.pieces[i];
+                if (::send(fd, piece.data(), piece.size(), MSG_NOSIGNAL) != (ssize_t)piece.size())
+                    return false;
+            }
+            return true;
+        }
+
+        // Sleep, but give up early when the server is being destroyed.
+        bool pause(int ms)
+        {
+            auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+            while (std::chrono::steady_clock::now() < until) {
+                if (m_stopping) return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return true;
+        }
+    };
+
+} // namespace stub_server
+
+#endif // __STUB_SERVER_H__